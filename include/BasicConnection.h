@@ -24,11 +24,18 @@
 #include <SmartPtr.h>
 #include <stdTypes.h>
 #include <Thread.h>
-#include <queue>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <sys/uio.h>
 
 namespace OpenNfsC {
 
 class RpcPacket;
+class AuthUnix;
+class ConnectionMgr;
+struct RpcWindowStats;
 
 enum ErrorCode
 {
@@ -52,6 +59,13 @@ enum ConnectionState
 class BasicConnection;
 typedef SmartPtr<BasicConnection> BasicConnectionPtr;
 
+// completion of an asynchronous request, run on the connection manager thread.
+// outcome is < 0 if the connection failed, reply is NULL if no reply arrived in time.
+typedef std::function<void(int outcome, RpcPacketPtr reply)> ReplyCallback;
+
+// outcome of a request given up by cancelRequest()
+const int REQUEST_CANCELLED = -2;
+
 // ConnKey class definition
 // it is essential a tuple: server IP, server port, transport type
 class ConnKey
@@ -98,16 +112,70 @@ class BasicConnection : public SmartRef
 
     virtual int sendAndWait(RpcPacketPtr request, RpcPacketPtr& reply, int timeout_ms) = 0;
 
+    // asynchronous send, does not wait for the reply
+    virtual int sendAsync(RpcPacketPtr request, const ReplyCallback& callback, int timeout_ms) = 0;
+
+    // give up a pending request, the waiter or completion sees REQUEST_CANCELLED.
+    // -1 if it is not pending or its reply is already there
+    virtual int cancelRequest(RpcPacketPtr request) { return -1; }
+
+    // used by connection manager to fire the timers of the pending requests
+    virtual void expireRequests() {}
+
+    // the connection manager lost the socket. true if the connection keeps its
+    // pending requests and reconnects after delay_ms, false to close it
+    virtual bool beginReconnect(uint32& delay_ms) { return false; }
+    // open the new socket once the delay is over, < 0 if that failed
+    int reopenSocket();
+    // send the pending requests again on the new socket
+    virtual void replayRequests() {}
+    bool isReconnecting() const { return m_reconnecting.load(std::memory_order_acquire); }
+
     // add packet to pending write queue and notify connection manager to send
     virtual int writePacket(RpcPacketPtr);
 
     // used by connection manager to send/recv packet Must be non-blocking
+    // sendPacket returns SUCCESS once the queue is drained, SOCKET_BUSY if
+    // EPOLLOUT has to be armed to send the rest
     int sendPacket();
+    // set while EPOLLOUT is armed for the socket, only the connection manager thread uses it
+    bool isPollingOut() const { return m_pollingOut; }
+    void setPollingOut(bool on) { m_pollingOut = on; }
+    // in flight window of the connection, false if it has none
+    virtual bool getWindowStats(RpcWindowStats& stats) { return false; }
+    // copy the caller memory a queued packet references into the packet.
+    // waits up to wait_ms for a send of the packet in progress to finish,
+    // returns false if it is still being sent then
+    bool releasePendingWrite(RpcPacketPtr pkt, uint32 wait_ms = 0);
+    // have the reactor fail the connection if it still uses socket skt,
+    // for threads other than the reactor, which owns the socket
+    bool requestFail(int skt, int error);
+    // socket given to requestFail(), -1 if none. cleared by the call
+    int takeFailedSocket() { return m_failSocket.exchange(-1, std::memory_order_acq_rel); }
+    // true while the packet is queued or being sent
+    bool isWritePending(RpcPacketPtr pkt);
     virtual int recvPacket() = 0;
 
+    // used by an io_uring reactor, which does the socket I/O itself.
+    // beginSend hands out the next batch of queued packets, it returns the iov count
+    // and holds the packets in batch until endSend is given the sendmsg result.
+    // endSend returns SUCCESS, SOCKET_BUSY if more is queued, or < 0 on failure
+    int beginSend(struct iovec* iov, int maxIov, std::vector<RpcPacketPtr>& batch, int& flags);
+    int endSend(int result);
+    // data received from the socket, returns -1 if the connection has to be closed
+    virtual int recvData(const unsigned char* data, uint32 len) = 0;
+
+    // only one thread reads the socket at a time: the reactor, or a caller
+    // reading its own reply. false if the other one is reading
+    bool beginRead(bool caller);
+    void endRead() { m_reader.store(READER_NONE, std::memory_order_seq_cst); }
+
     // connection cleanup
     virtual int closeConnection();
-    virtual RpcPacketPtr createRequest(int) = 0;
+    // cred is who the call is made as, NULL for AuthUnix::getDefault()
+    virtual RpcPacketPtr createRequest(int, const AuthUnix* cred = NULL) = 0;
+    // size an encoded request of the procedure took, later ones are allocated that large
+    virtual void hintRequestSize(int proc, uint32 size) {}
 
     int recvNbyte();
 
@@ -119,10 +187,17 @@ class BasicConnection : public SmartRef
     // lock protected
     bool isAlive();
     bool p_isAlive();
+    // lock free. false once the socket has been closed after a failure
+    bool isUsable() const { return m_usable.load(std::memory_order_acquire); }
     bool isConnected();
-    void setInConnMgr(bool isInConnMgr);
-    bool isInConnMgr();
-    int getSocketId() const;
+    // lock free, writers check it before waking up the connection manager
+    void setInConnMgr(bool isInConnMgr) { m_inConnMgr.store(isInConnMgr, std::memory_order_release); }
+    bool isInConnMgr() const { return m_inConnMgr.load(std::memory_order_acquire); }
+    // reactor serving the connection, see ConnectionMgr::getInstance()
+    ConnectionMgr* getConnMgr() const { return m_connMgr.load(std::memory_order_acquire); }
+    void setConnMgr(ConnectionMgr* mgr) { m_connMgr.store(mgr, std::memory_order_release); }
+    // lock free, see m_socketId
+    int getSocketId() const { return m_socketId.load(std::memory_order_acquire); }
     void setSocketId(int skt);
     void setConnectionState(enum ConnectionState);
     enum ConnectionState getConnectionState();
@@ -130,7 +205,30 @@ class BasicConnection : public SmartRef
     int getErrno() const;
     void setErrno(int value);
 
+    // requests sent or waiting for a window slot, and their request bytes
+    uint32 getOutstandingRequests() const { return m_outstandingReqs.load(std::memory_order_relaxed); }
+    uint64 getOutstandingBytes() const { return m_outstandingBytes.load(std::memory_order_relaxed); }
+
   protected:
+    // close the socket but stay usable, for a reconnect
+    void closeSocket();
+    void setReconnecting(bool on) { m_reconnecting.store(on, std::memory_order_release); }
+
+    // send the packet from the calling thread if nothing is queued ahead of it,
+    // whatever does not fit is queued for the reactor.
+    // returns 0 if done, 1 if it has to be queued instead
+    int sendDirect(RpcPacketPtr pkt);
+
+    void addLoad(uint32 bytes)
+    {
+      m_outstandingReqs.fetch_add(1, std::memory_order_relaxed);
+      m_outstandingBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    void removeLoad(uint32 bytes)
+    {
+      m_outstandingReqs.fetch_sub(1, std::memory_order_relaxed);
+      m_outstandingBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
 
     // class defination of read state
     class ReadState
@@ -175,9 +273,19 @@ class BasicConnection : public SmartRef
   private:
     // functions to add/remove packets to pending write queue
     void addPendingWrite(RpcPacketPtr);
-    void removePendingWrite();
     void clearPendingWriteQueue();
-    RpcPacketPtr getPendingWrite();
+    // under m_pendingWriteLock: move the inbox to the end of the queue, and
+    // clear m_writeArmed unless a writer raced in, false then
+    void p_takeInbox();
+    bool p_disarmWrite();
+    // under m_pendingWriteLock: true while a send of the packet is in progress
+    bool p_isSending(const RpcPacketPtr& pkt) const;
+    // under m_pendingWriteLock: wake up releasePendingWrite() callers
+    void p_sendDone();
+    int getPendingWrites(struct iovec* iov, int maxIov, uint32 maxPackets, bool& more, int* pktIovs = NULL);
+    int sendDatagrams(int skt);
+    void completePendingWrites(uint32 nwrite);
+    void p_closeSocket();
 
   private:
     // Mutex to protect data members
@@ -189,27 +297,71 @@ class BasicConnection : public SmartRef
     // flag to indicate whether to use reserved port or not. true means reserved port will be required
     bool m_reservedPort;
 
-    // socket id.
-    int m_socketId;
+    // socket id. written under m_connMutexLock, read without it
+    std::atomic<int> m_socketId;
 
     // connection state
     enum ConnectionState m_connectState;
 
     // whether connection is added to connection manager
-    bool m_inConnMgr;
+    std::atomic<bool> m_inConnMgr;
+    std::atomic<ConnectionMgr*> m_connMgr;
 
     time_t m_lastConnectTime;
 
-    // mutex lock to protect pending write queue
+    // writers push onto the inbox without a lock, newest first. the sending
+    // side takes it over into the pending write queue in push order
+    std::atomic<Packet*> m_writeInbox;
+
+    // mutex lock to protect pending write queue, writers never take it
     OpenNfsC::Thread::Mutex m_pendingWriteLock;
 
     // pending write queue
-    std::queue<RpcPacketPtr> m_pendingWriteQueue;
+    std::deque<RpcPacketPtr> m_pendingWriteQueue;
+
+    // set while the connection manager is bound to look at the queue again,
+    // woken up by a writer, sending or waiting for EPOLLOUT. only the writer
+    // that sets it wakes up the connection manager
+    std::atomic<bool> m_writeArmed;
+    // see isPollingOut()
+    bool m_pollingOut;
+
+    // packets of the send in progress, protected by m_pendingWriteLock
+    std::vector<RpcPacketPtr> m_sendBatch;
+    // packets handed out by beginSend() until endSend(), the kernel may
+    // still read them even if the queue is cleared meanwhile
+    std::vector<RpcPacketPtr> m_inFlight;
+    // broadcast when a send is over while m_sendWaiters is set
+    OpenNfsC::Thread::ConditionVar m_sendDone;
+    uint32 m_sendWaiters;
+    // see requestFail()
+    std::atomic<int> m_failSocket;
+
+    // link of the connection manager's write stack, see
+    // ConnectionMgr::writeConnection(). m_writeRef holds the connection
+    // while it is on the stack, m_writeQueued is set meanwhile
+    friend class ConnectionMgr;
+    std::atomic<bool> m_writeQueued;
+    BasicConnection* m_nextWriteConn;
+    SmartPtr<SmartRef> m_writeRef;
 
    // char m_serverIPStr[16];
    char m_serverIPStr[46];
 
    int m_errno;
+
+   // cleared on disconnect, set again only by a reconnect
+   std::atomic<bool> m_usable;
+   // set from beginReconnect() until the requests are replayed or the
+   // connection is closed
+   std::atomic<bool> m_reconnecting;
+
+   enum { READER_NONE, READER_REACTOR, READER_CALLER };
+   std::atomic<int> m_reader;
+
+   // load of this connection, see getOutstandingRequests()
+   std::atomic<uint32> m_outstandingReqs;
+   std::atomic<uint64> m_outstandingBytes;
 };
 
 } //end namespace
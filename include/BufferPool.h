@@ -0,0 +1,44 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _BUFFER_POOL_H_
+#define _BUFFER_POOL_H_
+
+#include <stdTypes.h>
+
+namespace OpenNfsC {
+
+/* Memory of packet buffers in size classes of 1K, 8K, 64K, 256K and
+ * 1M+64K (a reply of the largest rsize). Each thread caches freed blocks
+ * of every class, what it caches beyond a limit goes to a shared depot.
+ * Larger sizes come from malloc */
+class BufferPool
+{
+  public:
+    // memory of at least size bytes, capacity is set to what may be used of it
+    static unsigned char* allocate(uint32 size, uint32& capacity);
+    // memory from allocate()
+    static void release(unsigned char* buf);
+
+  private:
+    BufferPool(); // not implemented
+};
+
+} // end of namespace
+
+#endif /* _BUFFER_POOL_H_ */
@@ -23,12 +23,35 @@
 #ifndef _BYTE_BUFFER_
 #define _BYTE_BUFFER_
 
+#include "BufferPool.h"
 #include <stdTypes.h>
+#include <SmartPtr.h>
 #include <string.h>
 #include <stdlib.h>
 
 namespace OpenNfsC {
 
+/* a reference counted block of memory, several Buffers may reference
+ * parts of it. used to receive many replies with a single recv() */
+class BufferChunk : public SmartRef
+{
+  public:
+    BufferChunk(uint32 size):m_capacity(0) { m_buf = BufferPool::allocate(size, m_capacity); }
+    ~BufferChunk() { BufferPool::release(m_buf); }
+
+    unsigned char* begin() { return m_buf; }
+    uint32 capacity() { return m_capacity; }
+
+  private:
+    BufferChunk(const BufferChunk&); //not implemented
+    BufferChunk& operator=(const BufferChunk&); //not implemented
+
+  private:
+    unsigned char* m_buf;
+    uint32 m_capacity;
+};
+typedef SmartPtr<BufferChunk> BufferChunkPtr;
+
 class Buffer
 {
   public:
@@ -52,6 +75,10 @@ class Buffer
     /* write data of len starting at offset It doesnt change buffer data size */
     int write(uint32 offset, const unsigned char* ptr, uint32 len);
 
+    /* reference len bytes of a chunk instead of owning memory.
+     * the data is copied out before the buffer grows */
+    void attach(const BufferChunkPtr& chunk, unsigned char* ptr, uint32 len);
+
     /* resize buffer to newSize */
     bool resize(uint32 newSize);
 
@@ -81,6 +108,7 @@ class Buffer
     unsigned char* m_buf;  // hold allocated memory
     uint32 m_length;   // data size
     uint32 m_capacity; // allocated buffer size
+    BufferChunkPtr m_chunk; // owner of m_buf when attached to a chunk
 };
 
 
@@ -90,22 +118,30 @@ inline Buffer::Buffer():m_buf(NULL),m_length(0),m_capacity(0) {}
 inline Buffer::Buffer(uint32 size):m_buf(NULL), m_length(0), m_capacity(0)
 {
   if (size != 0)
-  {
-    m_buf = (unsigned char*)malloc(sizeof(char)*size);
-    m_capacity = size;
-  }
+    m_buf = BufferPool::allocate(size, m_capacity);
 }
 
 inline Buffer::~Buffer()
 {
   clear();
 
-  if (m_buf)
-    free(m_buf);
+  if (m_buf && m_chunk.empty())
+    BufferPool::release(m_buf);
   m_buf = NULL;
   m_capacity = 0;
 }
 
+inline void Buffer::attach(const BufferChunkPtr& chunk, unsigned char* ptr, uint32 len)
+{
+  if (m_buf && m_chunk.empty())
+    BufferPool::release(m_buf);
+
+  m_chunk = chunk;
+  m_buf = ptr;
+  m_length = len;
+  m_capacity = len;
+}
+
 inline bool Buffer::resize(uint32 newSize)
 {
   if (newSize <= m_capacity)
@@ -115,14 +151,24 @@ inline bool Buffer::resize(uint32 newSize)
   if (newSize > 2*m_capacity)
     adjustedSize = 2*newSize;
 
-  unsigned char* newPtr = (unsigned char*)realloc(m_buf, sizeof(char)*adjustedSize);
-  if (newPtr != NULL)
-  {
-    m_buf = newPtr;
-    m_capacity = adjustedSize;
-    return true;
-  }
-  return false;
+  // the pool rounds up to the size class
+  uint32 capacity = 0;
+  unsigned char* newPtr = BufferPool::allocate(adjustedSize, capacity);
+  if (newPtr == NULL)
+    return false;
+
+  if (m_length > 0)
+    memcpy(newPtr, m_buf, m_length);
+
+  // the chunk memory is shared, it is not ours to release
+  if (m_chunk.empty())
+    BufferPool::release(m_buf);
+  else
+    m_chunk.clear();
+
+  m_buf = newPtr;
+  m_capacity = capacity;
+  return true;
 }
 
 inline int Buffer::append(unsigned char* ptr, uint32 len)
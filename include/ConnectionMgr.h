@@ -19,21 +19,25 @@
 #define _CONN_MGR_H_
 
 /**************************************************
- * Singeton Connection Manager Class
+ * Connection Manager Class, a pool of reactor
+ * threads each serving a share of the connections
  *************************************************/
 
 #include "BasicConnection.h"
 
 #include <list>
 #include <map>
+#include <vector>
 #include <utility>
 #include <Thread.h>
 #include <stdTypes.h>
 #include <sys/epoll.h>
+#include <atomic>
 
 namespace OpenNfsC {
 
 class ConnectionMgr;
+class UringReactor;
 
 typedef std::map<int, BasicConnectionPtr> SocketConnectionMapBase;
 class SocketConnectionMap : protected SocketConnectionMapBase
@@ -46,6 +50,7 @@ public:
   bool remove(const BasicConnectionPtr& conn);
   BasicConnectionPtr get(int skt);
   BasicConnectionPtr get(const BasicConnectionPtr& bconn);
+  void getAll(std::vector<BasicConnectionPtr>& conns) const;
   void clear();
   bool empty() const;
   size_t size() const;
@@ -60,6 +65,7 @@ private:
 class ConnectionMgr : public Thread::Thread
 {
   friend class SocketConnectionMap;
+  friend class UringReactor;
   private:
     ConnectionMgr(const ConnectionMgr&); // not implemented
     ConnectionMgr& operator=(const ConnectionMgr&); // not implemented
@@ -73,6 +79,10 @@ class ConnectionMgr : public Thread::Thread
 
     // process control messages
     void processControlMsg();
+    // send for the connections on the write stack
+    void processWrites();
+    // send the queued packets of a connection
+    void writeSocket(BasicConnectionPtr conn);
     // process protocol messages
     void processProtocolMsg(int skt, const epoll_event& event);
 
@@ -82,18 +92,49 @@ class ConnectionMgr : public Thread::Thread
     // remove fd from epoll
     bool epollDel(int);
 
-    ConnectionMgr();
+    // start and stop polling a socket with the backend in use
+    bool watchSocket(BasicConnectionPtr conn);
+    void unwatchSocket(int skt);
+
+    // time out asynchronous requests of all connections
+    void expireRequests();
+
+    // reconnect a failed connection that has requests pending, close it otherwise
+    void failConnection(BasicConnectionPtr conn);
+    // open the sockets of the reconnects that are due
+    void processReconnects();
+
+    ConnectionMgr(uint32 index);
+
+    // create the reactors if not done yet
+    static bool createReactors();
 
   public:
     static bool startMgr();
     static void stopMgr();
-    static ConnectionMgr* getInstance();
+    // reactor serving the connection, the least loaded one is assigned on first use
+    static ConnectionMgr* getInstance(BasicConnection* conn);
+
+    // number of reactor threads, takes effect when the first one is started
+    static void setReactorCount(uint32 count);
+    // pin reactor i to cpu i modulo the cpu count
+    static void setCpuPinning(bool pin) { m_cpuPinning = pin; }
+    // true if called from any reactor thread
+    static bool isReactorThread() { return m_isReactorThread; }
+    // a caller reading replies runs completions like a reactor thread meanwhile
+    static void setCompletionThread(bool on) { m_isReactorThread = on; }
+    // backend of reactors started afterwards, io_uring falls back to epoll if unavailable
+    static void setBackend(TransportBackend backend);
+    static TransportBackend getBackend() { return m_backend; }
+    // poll sockets edge triggered, needed by callers reading their own replies.
+    // takes effect for sockets added afterwards
+    static void setEdgeTriggered(bool on) { m_edgeTriggered = on; }
 
     enum Action
     {
         ADD_SKT,
         DEL_SKT,
-        WRITE_SKT,
+        FAIL_SKT,
         STOP_MGR,
         NOOP
     };
@@ -104,11 +145,22 @@ class ConnectionMgr : public Thread::Thread
     bool addConnection(const BasicConnectionPtr& conn);
     // send control message to connection manager to remove a connection
     bool removeConnection(const BasicConnectionPtr& conn);
-    // send control message to connection manager to write packets to a connection
+    // have the connection manager write the packets of a connection. the
+    // connection is pushed onto a lock free stack, only the push onto an
+    // empty stack wakes the connection manager up
     bool writeConnection(BasicConnectionPtr bconn);
+    // send control message to connection manager to fail a connection, see
+    // BasicConnection::requestFail()
+    bool abortConnection(const BasicConnectionPtr& conn);
 
     virtual void run();
 
+    // true if called from the connection manager thread
+    bool isCurrentThread() const { return isRunning() && pthread_equal(pthread_self(), getThreadHandle()); }
+
+    // connections assigned to this reactor
+    uint32 getConnectionCount() const { return m_assigned.load(std::memory_order_relaxed); }
+
   private:
     bool sendControlMsg(const BasicConnectionPtr&, enum Action action);
 
@@ -119,6 +171,8 @@ class ConnectionMgr : public Thread::Thread
 
     // epoll fd
     int m_epollfd;
+    // set while the reactor runs on io_uring instead
+    UringReactor* m_uring;
     // socket pair to send control messages to connection mananer thread
     int m_controlfds[2];
 
@@ -128,8 +182,27 @@ class ConnectionMgr : public Thread::Thread
     // control messege list
     std::list<ControlMessage> m_controlMsgList;
 
+    // connections to write, newest first. see writeConnection()
+    std::atomic<BasicConnection*> m_writeHead;
+
+    // last time asynchronous requests were checked for expiry
+    uint64 m_lastExpireTime;  // monotonic ms
+
+    // connections waiting to reconnect and when to try, monotonic ms.
+    // only the connection manager thread uses it
+    std::vector<std::pair<uint64, BasicConnectionPtr> > m_reconnects;
+
+    // position in the pool, also the cpu it is pinned to
+    uint32 m_index;
+    std::atomic<uint32> m_assigned;
+
     static OpenNfsC::Thread::Mutex m_connMgrLock;
-    static ConnectionMgr * m_connMgrPtr;
+    static std::vector<ConnectionMgr*> m_reactors;
+    static uint32 m_reactorCount;
+    static bool m_cpuPinning;
+    static TransportBackend m_backend;
+    static bool m_edgeTriggered;
+    static thread_local bool m_isReactorThread;
 };
 
 } // end of namespace
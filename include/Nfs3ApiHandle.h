@@ -60,6 +60,14 @@ class Nfs3ApiHandle : public NfsApiHandle
               bool               &eof,
               NfsAttr            &postAttr,
               NfsError           &status);
+    bool read(NfsFh              &fileFH,
+              uint64_t            offset,
+              const struct iovec *iov,
+              int                 iovcnt,
+              uint32_t           &bytesRead,
+              bool               &eof,
+              NfsAttr            &postAttr,
+              NfsError           &status);
     bool write(NfsFh              &fileFH,
                uint64_t            offset,
                uint32_t            length,
@@ -120,6 +128,20 @@ class Nfs3ApiHandle : public NfsApiHandle
 
     bool renewCid();
 
+    bool readAsync(NfsFh                   &fileFH,
+                   uint64_t                 offset,
+                   uint32_t                 length,
+                   const NfsReadCompletion &done,
+                   NfsError                &status);
+    bool writeAsync(NfsFh                    &fileFH,
+                    uint64_t                  offset,
+                    uint32_t                  length,
+                    std::string              &data,
+                    const NfsWriteCompletion &done,
+                    NfsError                 &status);
+    bool getAttrAsync(NfsFh &fh, const NfsGetAttrCompletion &done, NfsError &status);
+    bool lookupAsync(NfsFh &dirFh, const std::string &file, const NfsLookupCompletion &done, NfsError &status);
+
 private:
     bool getAttrForDirEntry(const entryplus3* pEntry,
                             NfsFh&            fh,
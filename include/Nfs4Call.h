@@ -19,12 +19,15 @@
 #define _NFS4_CALL_
 
 #include "RpcCall.h"
+#include "ReplySink.h"
 #include <nfsrpc/nfs4.h>
 
 #define DEF_SMART_PTR(CLASS) typedef SmartPtr< CLASS > CLASS##Ptr
 
 namespace OpenNfsC {
 class Buffer;
+class XdrWriter;
+class XdrReader;
 namespace NFSv4 {
 
 
@@ -39,6 +42,14 @@ class NullCall: public RemoteCall
 };
 DEF_SMART_PTR(NullCall);
 
+// finds the data of the READ in a PUTFH, READ compound reply
+class ReadSink: public ReplySink
+{
+  public:
+    ReadSink(const struct iovec* iov, int iovcnt):ReplySink(iov, iovcnt) {}
+    virtual int locatePayload(const unsigned char* rec, uint32 len, uint32& offset, uint32& length);
+};
+
 class COMPOUNDCall : public RemoteCall
 {
   public:
@@ -54,85 +65,88 @@ class COMPOUNDCall : public RemoteCall
 
     int findOPIndex(int op);
 
+    // the data of OP_READ is returned in iov instead of data_val
+    void setReadSink(const struct iovec* iov, int iovcnt);
+
   private:
     void freeArg(nfs_argop4 *arg);
     void freeRes(nfs_resop4 *res);
 
   public:
-    int encode_OP_ACCESS(RpcPacketPtr packet, const ACCESS4args *arg);
-    int decode_OP_ACCESS(RpcPacketPtr packet, ACCESS4res *res);
-    int encode_OP_CLOSE(RpcPacketPtr packet, const CLOSE4args *arg);
-    int decode_OP_CLOSE(RpcPacketPtr packet, CLOSE4res *res);
-    int encode_OP_COMMIT(RpcPacketPtr packet, const COMMIT4args *arg);
-    int decode_OP_COMMIT(RpcPacketPtr packet, COMMIT4res *res);
-    int encode_OP_CREATE(RpcPacketPtr packet, const CREATE4args *arg);
-    int decode_OP_CREATE(RpcPacketPtr packet, CREATE4res *arg);
-    int encode_OP_DELEGPURGE(RpcPacketPtr packet, const DELEGPURGE4args *arg);
-    int decode_OP_DELEGPURGE(RpcPacketPtr packet, DELEGPURGE4res *arg);
-    int encode_OP_DELEGRETURN(RpcPacketPtr packet, const DELEGRETURN4args *arg);
-    int decode_OP_DELEGRETURN(RpcPacketPtr packet, DELEGRETURN4res *arg);
-    int encode_OP_GETATTR(RpcPacketPtr packet, const GETATTR4args *arg);
-    int decode_OP_GETATTR(RpcPacketPtr packet, GETATTR4res *arg);
-    int encode_OP_GETFH(RpcPacketPtr packet);
-    int decode_OP_GETFH(RpcPacketPtr packet, GETFH4res *res);
-    int encode_OP_LINK(RpcPacketPtr packet, const LINK4args *arg);
-    int decode_OP_LINK(RpcPacketPtr packet, LINK4res *res);
-    int encode_OP_LOCK(RpcPacketPtr packet, const LOCK4args *arg);
-    int decode_OP_LOCK(RpcPacketPtr packet, LOCK4res *res);
-    int encode_OP_LOCKT(RpcPacketPtr packet, const LOCKT4args *arg);
-    int decode_OP_LOCKT(RpcPacketPtr packet, LOCKT4res *res);
-    int encode_OP_LOCKU(RpcPacketPtr packet, const LOCKU4args *arg);
-    int decode_OP_LOCKU(RpcPacketPtr packet, LOCKU4res *res);
-    int encode_OP_LOOKUP(RpcPacketPtr packet, const LOOKUP4args *arg);
-    int decode_OP_LOOKUP(RpcPacketPtr packet, LOOKUP4res *res);
-    int encode_OP_LOOKUPP(RpcPacketPtr packet);
-    int decode_OP_LOOKUPP(RpcPacketPtr packet, LOOKUPP4res *res);
-    int encode_OP_NVERIFY(RpcPacketPtr packet, const NVERIFY4args *arg);
-    int decode_OP_NVERIFY(RpcPacketPtr packet, NVERIFY4res *res);
-    int encode_OP_OPEN(RpcPacketPtr packet, const OPEN4args *arg);
-    int decode_OP_OPEN(RpcPacketPtr packet, OPEN4res *res);
-    int encode_OP_OPENATTR(RpcPacketPtr packet, const OPENATTR4args *arg);
-    int decode_OP_OPENATTR(RpcPacketPtr packet, OPENATTR4res *res);
-    int encode_OP_OPEN_CONFIRM(RpcPacketPtr packet, const OPEN_CONFIRM4args *arg);
-    int decode_OP_OPEN_CONFIRM(RpcPacketPtr packet, OPEN_CONFIRM4res *res);
-    int encode_OP_OPEN_DOWNGRADE(RpcPacketPtr packet, const OPEN_DOWNGRADE4args *arg);
-    int decode_OP_OPEN_DOWNGRADE(RpcPacketPtr packet, OPEN_DOWNGRADE4res *res);
-    int encode_OP_PUTFH(RpcPacketPtr packet, const PUTFH4args *arg);
-    int decode_OP_PUTFH(RpcPacketPtr packet, PUTFH4res *res);
-    int encode_OP_PUTPUBFH(RpcPacketPtr packet);
-    int decode_OP_PUTPUBFH(RpcPacketPtr packet, PUTPUBFH4res *res);
-    int encode_OP_PUTROOTFH(RpcPacketPtr packet);
-    int decode_OP_PUTROOTFH(RpcPacketPtr packet, PUTROOTFH4res *res);
-    int encode_OP_READ(RpcPacketPtr packet, const READ4args *arg);
-    int decode_OP_READ(RpcPacketPtr packet, READ4res *res);
-    int encode_OP_READDIR(RpcPacketPtr packet, const READDIR4args *arg);
-    int decode_OP_READDIR(RpcPacketPtr packet, READDIR4res *res);
-    int encode_OP_READLINK(RpcPacketPtr packet);
-    int decode_OP_READLINK(RpcPacketPtr packet, READLINK4res *res);
-    int encode_OP_REMOVE(RpcPacketPtr packet, const REMOVE4args *arg);
-    int decode_OP_REMOVE(RpcPacketPtr packet, REMOVE4res *res);
-    int encode_OP_RENAME(RpcPacketPtr packet, const RENAME4args *arg);
-    int decode_OP_RENAME(RpcPacketPtr packet, RENAME4res *res);
-    int encode_OP_RENEW(RpcPacketPtr packet, const RENEW4args *arg);
-    int decode_OP_RENEW(RpcPacketPtr packet, RENEW4res *res);
-    int encode_OP_RESTOREFH(RpcPacketPtr packet);
-    int decode_OP_RESTOREFH(RpcPacketPtr packet, RESTOREFH4res *res);
-    int encode_OP_SAVEFH(RpcPacketPtr packet);
-    int decode_OP_SAVEFH(RpcPacketPtr packet, SAVEFH4res *res);
-    int encode_OP_SECINFO(RpcPacketPtr packet);
-    int decode_OP_SECINFO(RpcPacketPtr packet);
-    int encode_OP_SETATTR(RpcPacketPtr packet, const SETATTR4args *arg);
-    int decode_OP_SETATTR(RpcPacketPtr packet, SETATTR4res *res);
-    int encode_OP_SETCLIENTID(RpcPacketPtr packet, SETCLIENTID4args *arg);
-    int decode_OP_SETCLIENTID(RpcPacketPtr packet, SETCLIENTID4res *res);
-    int encode_OP_SETCLIENTID_CONFIRM(RpcPacketPtr packet, SETCLIENTID_CONFIRM4args *arg);
-    int decode_OP_SETCLIENTID_CONFIRM(RpcPacketPtr packet, SETCLIENTID_CONFIRM4res *res);
-    int encode_OP_VERIFY(RpcPacketPtr packet, const VERIFY4args *arg);
-    int decode_OP_VERIFY(RpcPacketPtr packet, VERIFY4res *res);
-    int encode_OP_WRITE(RpcPacketPtr packet, const WRITE4args *arg);
-    int decode_OP_WRITE(RpcPacketPtr packet, WRITE4res *res);
-    int encode_OP_RELEASE_LOCKOWNER(RpcPacketPtr packet, const RELEASE_LOCKOWNER4args *arg);
-    int decode_OP_RELEASE_LOCKOWNER(RpcPacketPtr packet, RELEASE_LOCKOWNER4res *res);
+    int encode_OP_ACCESS(XdrWriter& xdr, const ACCESS4args *arg);
+    int decode_OP_ACCESS(XdrReader& xdr, ACCESS4res *res);
+    int encode_OP_CLOSE(XdrWriter& xdr, const CLOSE4args *arg);
+    int decode_OP_CLOSE(XdrReader& xdr, CLOSE4res *res);
+    int encode_OP_COMMIT(XdrWriter& xdr, const COMMIT4args *arg);
+    int decode_OP_COMMIT(XdrReader& xdr, COMMIT4res *res);
+    int encode_OP_CREATE(XdrWriter& xdr, const CREATE4args *arg);
+    int decode_OP_CREATE(XdrReader& xdr, CREATE4res *arg);
+    int encode_OP_DELEGPURGE(XdrWriter& xdr, const DELEGPURGE4args *arg);
+    int decode_OP_DELEGPURGE(XdrReader& xdr, DELEGPURGE4res *arg);
+    int encode_OP_DELEGRETURN(XdrWriter& xdr, const DELEGRETURN4args *arg);
+    int decode_OP_DELEGRETURN(XdrReader& xdr, DELEGRETURN4res *arg);
+    int encode_OP_GETATTR(XdrWriter& xdr, const GETATTR4args *arg);
+    int decode_OP_GETATTR(XdrReader& xdr, GETATTR4res *arg);
+    int encode_OP_GETFH(XdrWriter& xdr);
+    int decode_OP_GETFH(XdrReader& xdr, GETFH4res *res);
+    int encode_OP_LINK(XdrWriter& xdr, const LINK4args *arg);
+    int decode_OP_LINK(XdrReader& xdr, LINK4res *res);
+    int encode_OP_LOCK(XdrWriter& xdr, const LOCK4args *arg);
+    int decode_OP_LOCK(XdrReader& xdr, LOCK4res *res);
+    int encode_OP_LOCKT(XdrWriter& xdr, const LOCKT4args *arg);
+    int decode_OP_LOCKT(XdrReader& xdr, LOCKT4res *res);
+    int encode_OP_LOCKU(XdrWriter& xdr, const LOCKU4args *arg);
+    int decode_OP_LOCKU(XdrReader& xdr, LOCKU4res *res);
+    int encode_OP_LOOKUP(XdrWriter& xdr, const LOOKUP4args *arg);
+    int decode_OP_LOOKUP(XdrReader& xdr, LOOKUP4res *res);
+    int encode_OP_LOOKUPP(XdrWriter& xdr);
+    int decode_OP_LOOKUPP(XdrReader& xdr, LOOKUPP4res *res);
+    int encode_OP_NVERIFY(XdrWriter& xdr, const NVERIFY4args *arg);
+    int decode_OP_NVERIFY(XdrReader& xdr, NVERIFY4res *res);
+    int encode_OP_OPEN(XdrWriter& xdr, const OPEN4args *arg);
+    int decode_OP_OPEN(XdrReader& xdr, OPEN4res *res);
+    int encode_OP_OPENATTR(XdrWriter& xdr, const OPENATTR4args *arg);
+    int decode_OP_OPENATTR(XdrReader& xdr, OPENATTR4res *res);
+    int encode_OP_OPEN_CONFIRM(XdrWriter& xdr, const OPEN_CONFIRM4args *arg);
+    int decode_OP_OPEN_CONFIRM(XdrReader& xdr, OPEN_CONFIRM4res *res);
+    int encode_OP_OPEN_DOWNGRADE(XdrWriter& xdr, const OPEN_DOWNGRADE4args *arg);
+    int decode_OP_OPEN_DOWNGRADE(XdrReader& xdr, OPEN_DOWNGRADE4res *res);
+    int encode_OP_PUTFH(XdrWriter& xdr, const PUTFH4args *arg);
+    int decode_OP_PUTFH(XdrReader& xdr, PUTFH4res *res);
+    int encode_OP_PUTPUBFH(XdrWriter& xdr);
+    int decode_OP_PUTPUBFH(XdrReader& xdr, PUTPUBFH4res *res);
+    int encode_OP_PUTROOTFH(XdrWriter& xdr);
+    int decode_OP_PUTROOTFH(XdrReader& xdr, PUTROOTFH4res *res);
+    int encode_OP_READ(XdrWriter& xdr, const READ4args *arg);
+    int decode_OP_READ(XdrReader& xdr, READ4res *res);
+    int encode_OP_READDIR(XdrWriter& xdr, const READDIR4args *arg);
+    int decode_OP_READDIR(XdrReader& xdr, READDIR4res *res);
+    int encode_OP_READLINK(XdrWriter& xdr);
+    int decode_OP_READLINK(XdrReader& xdr, READLINK4res *res);
+    int encode_OP_REMOVE(XdrWriter& xdr, const REMOVE4args *arg);
+    int decode_OP_REMOVE(XdrReader& xdr, REMOVE4res *res);
+    int encode_OP_RENAME(XdrWriter& xdr, const RENAME4args *arg);
+    int decode_OP_RENAME(XdrReader& xdr, RENAME4res *res);
+    int encode_OP_RENEW(XdrWriter& xdr, const RENEW4args *arg);
+    int decode_OP_RENEW(XdrReader& xdr, RENEW4res *res);
+    int encode_OP_RESTOREFH(XdrWriter& xdr);
+    int decode_OP_RESTOREFH(XdrReader& xdr, RESTOREFH4res *res);
+    int encode_OP_SAVEFH(XdrWriter& xdr);
+    int decode_OP_SAVEFH(XdrReader& xdr, SAVEFH4res *res);
+    int encode_OP_SECINFO(XdrWriter& xdr);
+    int decode_OP_SECINFO(XdrReader& xdr);
+    int encode_OP_SETATTR(XdrWriter& xdr, const SETATTR4args *arg);
+    int decode_OP_SETATTR(XdrReader& xdr, SETATTR4res *res);
+    int encode_OP_SETCLIENTID(XdrWriter& xdr, SETCLIENTID4args *arg);
+    int decode_OP_SETCLIENTID(XdrReader& xdr, SETCLIENTID4res *res);
+    int encode_OP_SETCLIENTID_CONFIRM(XdrWriter& xdr, SETCLIENTID_CONFIRM4args *arg);
+    int decode_OP_SETCLIENTID_CONFIRM(XdrReader& xdr, SETCLIENTID_CONFIRM4res *res);
+    int encode_OP_VERIFY(XdrWriter& xdr, const VERIFY4args *arg);
+    int decode_OP_VERIFY(XdrReader& xdr, VERIFY4res *res);
+    int encode_OP_WRITE(XdrWriter& xdr, const WRITE4args *arg);
+    int decode_OP_WRITE(XdrReader& xdr, WRITE4res *res);
+    int encode_OP_RELEASE_LOCKOWNER(XdrWriter& xdr, const RELEASE_LOCKOWNER4args *arg);
+    int decode_OP_RELEASE_LOCKOWNER(XdrReader& xdr, RELEASE_LOCKOWNER4res *res);
 
   private:
     virtual int encodeArguments() ;
@@ -141,6 +155,7 @@ class COMPOUNDCall : public RemoteCall
   private:
     COMPOUND4args args;
     COMPOUND4res  res;
+    ReadSink*     m_readSink;
 };
 DEF_SMART_PTR(COMPOUNDCall);
 
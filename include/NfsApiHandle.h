@@ -22,11 +22,20 @@
 #include "NfsConnectionGroup.h"
 #include <list>
 #include <vector>
+#include <functional>
 
 namespace OpenNfsC {
 
 class NfsConnectionGroup;
 
+// Completions of the asynchronous APIs, run on the connection manager thread.
+// The first argument tells whether the operation succeeded, the error is in
+// the NfsError otherwise. They must not block or issue synchronous calls.
+typedef std::function<void(bool, std::string&, uint32_t, bool, NfsAttr&, NfsError&)> NfsReadCompletion;
+typedef std::function<void(bool, uint32_t, NfsError&)> NfsWriteCompletion;
+typedef std::function<void(bool, NfsAttr&, NfsError&)> NfsGetAttrCompletion;
+typedef std::function<void(bool, NfsFh&, NfsAttr&, NfsError&)> NfsLookupCompletion;
+
 class NfsApiHandle;
 typedef SmartPtr<NfsApiHandle> NfsApiHandlePtr;
 
@@ -68,6 +77,15 @@ class NfsApiHandle : public SmartRef
                       bool               &eof,
                       NfsAttr            &postAttr,
                       NfsError           &status) = 0;
+    // reads into the caller buffers, the length is the size of iov
+    virtual bool read(NfsFh              &fileFH,
+                      uint64_t            offset,
+                      const struct iovec *iov,
+                      int                 iovcnt,
+                      uint32_t           &bytesRead,
+                      bool               &eof,
+                      NfsAttr            &postAttr,
+                      NfsError           &status) = 0;
     virtual bool write(NfsFh              &fileFH,
                        uint64_t            offset,
                        uint32_t            length,
@@ -121,6 +139,23 @@ class NfsApiHandle : public SmartRef
 
     virtual bool renewCid() = 0;
 
+    // Asynchronous variants. They return false with status set if the request
+    // could not be queued, otherwise the completion runs exactly once.
+    // The data of a write must stay valid until the completion has run.
+    virtual bool readAsync(NfsFh                   &fileFH,
+                           uint64_t                 offset,
+                           uint32_t                 length,
+                           const NfsReadCompletion &done,
+                           NfsError                &status) = 0;
+    virtual bool writeAsync(NfsFh                    &fileFH,
+                            uint64_t                  offset,
+                            uint32_t                  length,
+                            std::string              &data,
+                            const NfsWriteCompletion &done,
+                            NfsError                 &status) = 0;
+    virtual bool getAttrAsync(NfsFh &fh, const NfsGetAttrCompletion &done, NfsError &status) = 0;
+    virtual bool lookupAsync(NfsFh &dirFh, const std::string &file, const NfsLookupCompletion &done, NfsError &status) = 0;
+
   protected:
     NfsConnectionGroup *m_pConn;
 };
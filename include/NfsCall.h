@@ -19,6 +19,7 @@
 #define _NFS_CALL_
 
 #include "RpcCall.h"
+#include "ReplySink.h"
 #include <nfsrpc/mount.h>
 
 #define DEF_SMART_PTR(CLASS) typedef SmartPtr< CLASS > CLASS##Ptr
@@ -124,10 +125,20 @@ class ReadLinkCall: public RemoteCall
 };
 DEF_SMART_PTR(ReadLinkCall);
 
+// finds the data of a READ3 reply
+class ReadSink: public ReplySink
+{
+  public:
+    ReadSink(const struct iovec* iov, int iovcnt):ReplySink(iov, iovcnt) {}
+    virtual int locatePayload(const unsigned char* rec, uint32 len, uint32& offset, uint32& length);
+};
+
 class ReadCall: public RemoteCall
 {
   public:
     ReadCall(const READ3args&);
+    // the data is returned in iov instead of read3_data
+    ReadCall(const READ3args&, const struct iovec* iov, int iovcnt);
     ~ReadCall();
     READ3res& getResult() { return res; }
 
@@ -138,6 +149,7 @@ class ReadCall: public RemoteCall
   private:
     READ3args args;
     READ3res res;
+    ReadSink* m_sink;
 };
 DEF_SMART_PTR(ReadCall);
 
@@ -27,13 +27,18 @@
 #include <nfsrpc/nfs4.h>
 #include <Thread.h>
 #include <map>
+#include <vector>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <time.h>
 #include <unistd.h>
 
 namespace OpenNfsC {
 
+// upper bound of NFS connections per server, see setNconnect()
+#define NFS_MAX_NCONNECT 16
+
 //forward declaration
 class RpcConnection;
 
@@ -55,8 +60,10 @@ class NfsConnectionGroup : public SmartRef
     virtual ~NfsConnectionGroup();
     bool removeFromPool();
 
-    BasicConnectionPtr getNfsConnection(ServiceType type) const
+    BasicConnectionPtr getNfsConnection(ServiceType type)
     {
+        if ( type == NFS && m_nconnect > 1 )
+          return getLeastLoadedNfsConnection();
         return m_connections[type][m_nfsTransp];
     }
 
@@ -66,8 +73,11 @@ class NfsConnectionGroup : public SmartRef
     void setTransport(TransportType transp) { m_nfsTransp = transp; }
     bool update();
     bool ensureConnection();
+    // force the next ensureConnection() to revalidate the services
+    void invalidateConnections() { m_servicesReady.store(false, std::memory_order_release); }
 
-    static void init();
+    // backend the reactor threads use, see setReactorCount()
+    static void init(TransportBackend backend = BACKEND_EPOLL);
     static void fini();
     static NfsConnectionGroupPtr create(std::string   serverIP,
                                         TransportType transp,
@@ -94,6 +104,27 @@ class NfsConnectionGroup : public SmartRef
 
     static void setUdpTransport() { gTransportConfig = TRANSP_UDP; }
     static void setTcpTransport() { gTransportConfig = TRANSP_TCP; }
+    static void setPortmapCacheTTL(time_t ttl_s) { gPortmapCacheTTL = ttl_s; }
+    // number of NFS connections opened by groups created afterwards
+    static void setNconnect(uint32 n) { gNconnect = (n < 1) ? 1 : (n > NFS_MAX_NCONNECT ? NFS_MAX_NCONNECT : n); }
+    // times a synchronous call polls for its reply before it sleeps, 0 (default) to sleep at once
+    static void setReplySpinCount(uint32 spins);
+    // in flight window of NFS connections created afterwards, it adapts
+    // between minWindow and maxWindow. 0 keeps the default of a limit
+    static void setWindowLimits(uint32 initial, uint32 minWindow, uint32 maxWindow);
+    // reactor threads serving the connections, set before the first group
+    // is created. pinCpus pins reactor i to cpu i
+    static void setReactorCount(uint32 count, bool pinCpus = false);
+    // synchronous calls write to an idle socket and read their own reply instead of
+    // waiting on a reactor. set before the first group is created, epoll backend only.
+    // completions of asynchronous requests may then run on such a caller
+    static void setLowLatency(bool on);
+    // window of each NFS connection of the group
+    void getWindowStats(std::vector<RpcWindowStats>& stats);
+    // deadline in ms of calls on the group that give none, 0 for the default
+    // of the transport: 60 s on UDP, 180 s on TCP
+    void setCallTimeout(int timeout_ms) { m_callTimeoutMs.store(timeout_ms, std::memory_order_relaxed); }
+    int getCallTimeout() const { return m_callTimeoutMs.load(std::memory_order_relaxed); }
     void setConnected() { m_bConnected = true; } // used for nfs v4 keepalive
     bool isConnected(){ return(m_bConnected); }
 
@@ -111,6 +142,11 @@ class NfsConnectionGroup : public SmartRef
                         const bool    bReset);
 
     bool ensurePortMapperConnection(bool& bForceRecreate);
+    bool refreshServices(bool bForcePortRefresh);
+    bool hasFailedService();
+    bool isServiceValid(BasicConnectionPtr conn, uint16 port);
+    void initExtraNfsConnections(uint32 version, const bool bReset);
+    BasicConnectionPtr getLeastLoadedNfsConnection();
 
 
   private:
@@ -119,6 +155,8 @@ class NfsConnectionGroup : public SmartRef
     static std::map<std::string, NfsConnectionGroupPtr> serverTable;
 
     static enum TransportType gTransportConfig;
+    static time_t gPortmapCacheTTL;
+    static uint32 gNconnect;
 
     std:: string m_serverIP;
     enum TransportType m_nfsTransp;
@@ -126,7 +164,18 @@ class NfsConnectionGroup : public SmartRef
     OpenNfsC::Thread::Mutex m_connMutex;
     BasicConnectionPtr m_connections[MAX_SERVICE][MAX_TRANSP];
 
+    // NFS connections besides m_connections[NFS][m_nfsTransp]
+    uint32 m_nconnect;
+    BasicConnectionPtr m_extraNfsConnections[NFS_MAX_NCONNECT-1];
+
     uint16 m_rpcPorts[MAX_SERVICE][4][MAX_TRANSP];
+    time_t m_rpcPortsUpdateTime;
+
+    // set once all services are set up, cleared when one of them fails
+    std::atomic<bool> m_servicesReady;
+    // an extra NFS connection failed, ensureConnection() recreates it alone
+    std::atomic<bool> m_extraFailed;
+    std::atomic<int> m_callTimeoutMs;
     char m_serverIPStr[46];
     enum NFSVersion    m_nfsVersion;
 
@@ -157,6 +206,7 @@ class NfsConnectionGroup : public SmartRef
     bool create(NfsFh &dirFh, std::string &fileName, NfsAttr *inAttr, NfsFh &fileFh, NfsAttr &outAttr, NfsError &status);
     bool open(const std::string filePath, uint32_t access, uint32_t shareAccess, uint32_t shareDeny, NfsFh &file, NfsError &status);
     bool read(NfsFh &fileFH, uint64_t offset, uint32_t length, std::string &data, uint32_t &bytesRead, bool &eof, NfsAttr &postAttr, NfsError &status);
+    bool read(NfsFh &fileFH, uint64_t offset, const struct iovec *iov, int iovcnt, uint32_t &bytesRead, bool &eof, NfsAttr &postAttr, NfsError &status);
     bool write(NfsFh &fileFH, uint64_t offset, uint32_t length, std::string &data, uint32_t &bytesWritten, NfsError &status);
     bool write_unstable(NfsFh &fileFH, uint64_t offset,std::string &data,uint32_t &bytesWritten,char *verf, const bool needverify, NfsError &status);
     bool close(NfsFh &fileFh, NfsAttr &postAttr, NfsError &status);
@@ -198,6 +248,12 @@ class NfsConnectionGroup : public SmartRef
 
     bool renewCid();
 
+    // asynchronous variants, completions run on the connection manager thread
+    bool readAsync(NfsFh &fileFH, uint64_t offset, uint32_t length, const NfsReadCompletion &done, NfsError &status);
+    bool writeAsync(NfsFh &fileFH, uint64_t offset, uint32_t length, std::string &data, const NfsWriteCompletion &done, NfsError &status);
+    bool getAttrAsync(NfsFh &fh, const NfsGetAttrCompletion &done, NfsError &status);
+    bool lookupAsync(NfsFh &dirFh, const std::string &file, const NfsLookupCompletion &done, NfsError &status);
+
   public:
     char *getInitialClientVerifier() { return m_initialClientVerifier; }
     char *getClientVerifier() { return m_ClientVerifier; }
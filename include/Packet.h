@@ -20,13 +20,22 @@
 
 #include "ByteBuffer.h"
 #include <SmartPtr.h>
+#include <sys/uio.h>
+#include <vector>
+#include <atomic>
 
 namespace OpenNfsC {
 
+class BasicConnection;
+
 class Packet : public SmartRef
 {
+  friend class BasicConnection;
   public:
-    Packet(uint32 size=1024):m_buffer(size),m_writeIndex(0),m_readIndex(0){};
+    Packet(uint32 size=1024):m_buffer(size),m_refBytes(0),m_writeIndex(0),m_queued(false),m_nextWrite(NULL),m_readIndex(0){};
+    // packet referencing len bytes of a receive chunk, see Buffer::attach()
+    Packet(const BufferChunkPtr& chunk, unsigned char* data, uint32 len):m_buffer(),m_refBytes(0),m_writeIndex(0),m_queued(false),m_nextWrite(NULL),m_readIndex(0)
+    { m_buffer.attach(chunk, data, len); }
     virtual ~Packet() {};
 
     virtual int decodeHeader() = 0;
@@ -35,6 +44,15 @@ class Packet : public SmartRef
     int append(unsigned char* inBuf, uint32 len )
     { return m_buffer.append(inBuf,len); }
 
+    /* send len bytes of caller memory after the data appended so far,
+     * without copying them. The memory must stay valid until the packet
+     * has been sent or copyReferences() was called */
+    int appendRef(const unsigned char* inBuf, uint32 len);
+
+    /* copy the referenced memory into the packet */
+    void copyReferences();
+    bool hasReferences() const { return !m_refs.empty(); }
+
     /*
     int write(unsigned char* inBuf, uint32 len )
     {
@@ -77,22 +95,52 @@ class Packet : public SmartRef
     unsigned char* getReadAddress() { return m_buffer.seek(m_readIndex); }
     uint32 getUnparsedDataSize() { return m_buffer.size() - m_readIndex; }
 
+    // size on the wire, the packet data plus the referenced memory
+    uint32 getWireSize() { return m_buffer.size() + m_refBytes; }
+
     //unsigned char* seek(uint32 offset) { return m_buffer.seek(offset); }
-    unsigned char* getWriteAddress() { return m_buffer.seek(m_writeIndex); }
-    uint32 getWriteSize() { return m_buffer.size() - m_writeIndex; }
+    /* describe the bytes still to be sent, returns the iovec count */
+    int getWriteIov(struct iovec* iov, int maxIov);
+    uint32 getWriteSize() { return getWireSize() - m_writeIndex; }
     void advanceWriteIndex(uint32 nWrite) { m_writeIndex += nWrite; }
-    bool isWriteComplete() { return m_writeIndex == m_buffer.size(); }
+    bool isWriteComplete() { return m_writeIndex == getWireSize(); }
 
     void resetWriteIndex() { m_writeIndex = 0; }
+    // set while the packet is in the write queue of a connection
+    bool isQueued() const { return m_queued.load(std::memory_order_acquire); }
+    void setQueued(bool queued) { m_queued.store(queued, std::memory_order_release); }
+    // false if the packet was queued already
+    bool tryQueue() { return !m_queued.exchange(true, std::memory_order_acq_rel); }
   protected:
     void resetReadIndex()  { m_readIndex = 0;  }
 
+  private:
+    // caller memory sent before the packet data at offset
+    struct Reference
+    {
+      uint32 offset;
+      const unsigned char* data;
+      uint32 len;
+    };
+
   private:
     // internal data buffer
     Buffer m_buffer;
 
-    // write index: offset of the next send
+    // referenced memory in wire order
+    std::vector<Reference> m_refs;
+    uint32 m_refBytes;
+    // holds the referenced memory after copyReferences()
+    std::vector<unsigned char> m_refCopy;
+
+    // write index: wire offset of the next send
     uint32 m_writeIndex;
+    std::atomic<bool> m_queued;
+
+    // link of the lock-free write inbox of a connection and the reference
+    // the inbox holds meanwhile, see BasicConnection::addPendingWrite()
+    Packet* m_nextWrite;
+    SmartPtr<SmartRef> m_inboxRef;
 
     // read index: used to parse packet
     uint32 m_readIndex;
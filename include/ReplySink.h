@@ -0,0 +1,81 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _REPLY_SINK_
+#define _REPLY_SINK_
+
+#include <stdTypes.h>
+#include <sys/uio.h>
+#include <vector>
+
+namespace OpenNfsC {
+
+/* Caller memory that the bulk data of a reply (e.g. the READ payload) is
+ * received into. The connection asks the sink where the payload starts
+ * once the head of the reply is in, and then receives the payload straight
+ * into the caller buffers. Replies that could not be received this way are
+ * copied in by the decoder instead. */
+class ReplySink
+{
+  public:
+    ReplySink(const struct iovec* iov, int iovcnt);
+    virtual ~ReplySink() {}
+
+    /* locate the payload in the first len bytes of a reply record
+     * return value:
+     *      0: found, offset and length are set
+     *      1: more bytes of the reply are needed
+     *     -1: the reply carries no payload for the sink
+     */
+    virtual int locatePayload(const unsigned char* rec, uint32 len, uint32& offset, uint32& length) = 0;
+
+    uint32 capacity() const { return m_capacity; }
+    uint32 filled() const { return m_filled; }
+
+    /* true if the connection received the payload into the sink */
+    bool isPlaced() const { return m_placed; }
+    void setPlaced(bool placed) { m_placed = placed; }
+
+    /* copy len bytes after the data already in the sink */
+    int copyIn(const unsigned char* data, uint32 len);
+
+    /* describe at most len bytes of the unfilled space, returns the iovec count */
+    int getIov(struct iovec* iov, int maxIov, uint32 len) const;
+    void advance(uint32 len) { m_filled += len; }
+    /* drop what a reply that did not complete left after filled bytes */
+    void rewind(uint32 filled) { m_filled = filled; m_placed = false; }
+
+  protected:
+    /* skip the header of an accepted, successful rpc reply. off is set past it
+     * returns 0, 1 if more bytes are needed or -1 if the call did not succeed */
+    static int skipReplyHeader(const unsigned char* rec, uint32 len, uint32& off);
+    /* decode the xdr uint32 at off, returns 1 if it is not within len */
+    static int getUint32(const unsigned char* rec, uint32 len, uint32 off, uint32& val);
+
+  private:
+    ReplySink(const ReplySink&); // not implemented
+    ReplySink& operator=(const ReplySink&); // not implemented
+
+  private:
+    std::vector<struct iovec> m_iov;
+    uint32 m_capacity;
+    uint32 m_filled;
+    bool m_placed;
+};
+
+} // end of namespace
+#endif /* _REPLY_SINK_ */
@@ -0,0 +1,66 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _RPC_AUTH_H_
+#define _RPC_AUTH_H_
+
+#include <SmartPtr.h>
+#include <stdTypes.h>
+#include <vector>
+
+namespace OpenNfsC {
+
+class AuthUnix;
+typedef SmartPtr<AuthUnix> AuthUnixPtr;
+
+/* AUTH_UNIX credential of an identity, encoded once together with the
+ * AUTH_NULL verifier so a call only copies the bytes */
+class AuthUnix : public SmartRef
+{
+  public:
+    // the most groups a credential carries
+    static const uint32 MAX_GIDS = 16;
+    // flavor, length, stamp, machine name, uid, gid, gids and the verifier
+    static const uint32 MAX_ENCODED_SIZE = 4 * (10 + MAX_GIDS);
+
+    // credential of the identity, from a cache. gids past MAX_GIDS are dropped
+    static AuthUnixPtr get(uint32 uid, uint32 gid, const std::vector<uint32>& gids);
+    // root without groups, what calls are sent as unless told otherwise
+    static const AuthUnix* getDefault();
+
+    const unsigned char* getEncoded() const { return m_encoded; }
+    uint32 getEncodedSize() const { return m_size; }
+    uint32 getUid() const { return m_uid; }
+    uint32 getGid() const { return m_gid; }
+
+    ~AuthUnix() {}
+
+  private:
+    AuthUnix(uint32 uid, uint32 gid, const std::vector<uint32>& gids);
+    AuthUnix(const AuthUnix&); // not implemented
+    AuthUnix& operator=(const AuthUnix&); // not implemented
+
+    uint32 m_uid;
+    uint32 m_gid;
+    uint32 m_size;
+    unsigned char m_encoded[MAX_ENCODED_SIZE];
+};
+
+} // end of namespace
+
+#endif /* _RPC_AUTH_H_ */
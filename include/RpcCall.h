@@ -23,19 +23,42 @@
 #include <rpc/rpc.h>
 #include <SmartPtr.h>
 #include "RpcPacket.h"
+#include "RpcAuth.h"
+#include <functional>
 
 namespace OpenNfsC {
 
 class NfsConnectionGroup;
 class RpcPacket;
 
+class RemoteCall;
+typedef SmartPtr<RemoteCall> RemoteCallPtr;
+
 class RemoteCall : public SmartRef
 {
   public:
     virtual ~RemoteCall();
-    RemoteCall(enum ServiceType prog, uint32 proc):m_request(NULL), m_reply(NULL), m_program(prog), m_procedure(proc), m_errno(0) {}
+    RemoteCall(enum ServiceType prog, uint32 proc):m_request(NULL), m_reply(NULL), m_program(prog), m_procedure(proc), m_errno(0), m_replySink(NULL), m_timeoutMs(0), m_callLock(false) {}
+    // timeout_s is the deadline of the whole call including retransmissions.
+    // 0 takes setTimeout(), then the timeout of the group, then the default
     enum clnt_stat call(const NfsConnectionGroupPtr& groupPtr, int timeout_s=0);
     enum clnt_stat call(NfsConnectionGroup* pConnGroup, int timeout_s=0);
+
+    // Asynchronous call. Returns RPC_SUCCESS once the request is queued, the
+    // completion then runs exactly once on the connection manager thread with
+    // the results decoded. It must not block or issue synchronous calls.
+    // The call object must be owned by a SmartPtr, it is kept alive until the
+    // completion has run.
+    typedef std::function<void(enum clnt_stat)> Completion;
+    enum clnt_stat callAsync(const NfsConnectionGroupPtr& groupPtr, const Completion& completion, int timeout_s=0);
+    enum clnt_stat callAsync(NfsConnectionGroup* pConnGroup, const Completion& completion, int timeout_s=0);
+
+    // deadline of the call in ms, see call()
+    void setTimeout(int timeout_ms) { m_timeoutMs = timeout_ms; }
+    // give up the call in flight from another thread, it returns RPC_INTR.
+    // false if it is not in flight or its reply is already there
+    bool cancel();
+
     virtual int encodeArguments() = 0;
     virtual int decodeResults() = 0;
     //! By default for all calls we ensure the existence of the connection
@@ -49,6 +72,18 @@ class RemoteCall : public SmartRef
     int getErrno() const { return m_errno; }
     void setErrno(int value) { m_errno = value; }
 
+    // identity the call is made as, see AuthUnix::get(). root by default
+    void setCredential(const AuthUnixPtr& cred) { m_cred = cred; }
+
+  protected:
+    // caller memory the payload of the reply is received into, see ReplySink
+    void setReplySink(ReplySink* sink) { m_replySink = sink; }
+
+  private:
+    enum clnt_stat prepareRequest(NfsConnectionGroup* pConnGroup, BasicConnectionPtr& conn, bool borrowData);
+    enum clnt_stat processReply(NfsConnectionGroup* pConnGroup, BasicConnectionPtr& conn, int outcome);
+    int getTimeout(NfsConnectionGroup* pConnGroup, int timeout_s) const;
+
   private:
     RpcPacketPtr m_request;
     RpcPacketPtr m_reply;
@@ -56,6 +91,13 @@ class RemoteCall : public SmartRef
     enum ServiceType m_program;
     uint32 m_procedure;
     int m_errno;
+    ReplySink* m_replySink;
+    AuthUnixPtr m_cred;
+    int m_timeoutMs;
+
+    // the request in flight and its connection, for cancel()
+    Thread::Mutex m_callLock;
+    BasicConnectionPtr m_conn;
 };
 
 } // end of namespace
@@ -19,14 +19,22 @@
 #define _RPC_CONNECTION_H_
 
 #include "BasicConnection.h"
+#include "XidTable.h"
+#include "RpcWindow.h"
+#include "RpcRtt.h"
+#include "TimerWheel.h"
 #include <Thread.h>
 #include <arpa/inet.h>
-#include <map>
+#include <ByteBuffer.h>
+#include <deque>
+#include <vector>
 
 namespace OpenNfsC {
 
 class Responder;
+class ResponderPool;
 class RpcPacket;
+class ReplySink;
 
 class RpcConnection: public BasicConnection
 {
@@ -35,17 +43,35 @@ class RpcConnection: public BasicConnection
     // synchronous send and wait. will block
     virtual int sendAndWait(RpcPacketPtr, RpcPacketPtr& reply, int timeout_ms);
 
+    // asynchronous send. callback runs on the connection manager thread
+    virtual int sendAsync(RpcPacketPtr, const ReplyCallback& callback, int timeout_ms);
+    virtual int cancelRequest(RpcPacketPtr request);
+    virtual void expireRequests();
+    virtual bool beginReconnect(uint32& delay_ms);
+    virtual void replayRequests();
+    virtual bool getWindowStats(RpcWindowStats& stats);
+
+    // window of connections created afterwards, 0 keeps the default of a limit
+    static void setWindowLimits(uint32 initial, uint32 minWindow, uint32 maxWindow);
+    // synchronous callers send and read their replies themselves when the socket is idle
+    static void setLowLatency(bool on);
+    // reconnects tried for a failed TCP connection with requests pending, 0 to fail them at once
+    static void setReconnectAttempts(uint32 attempts) { gReconnectAttempts = attempts; }
+
     virtual int writePacket(RpcPacketPtr);
 
     // used by connection manager thread to recv replies
     virtual int recvPacket();
+    // used by an io_uring reactor to hand over received data
+    virtual int recvData(const unsigned char* data, uint32 len);
     virtual int closeConnection();
     uint32 getNextXid();
 
     // create a request
     // input: procedure number
     // output: a RpaPacket ref pointer to created request
-    virtual RpcPacketPtr createRequest(int);
+    virtual RpcPacketPtr createRequest(int, const AuthUnix* cred = NULL);
+    virtual void hintRequestSize(int proc, uint32 size);
     virtual std::string toString() const;
 
     static BasicConnectionPtr create(ConnKey& connKey, uint32 prog, uint32 version, bool resvPort = false);
@@ -58,58 +84,105 @@ class RpcConnection: public BasicConnection
     RpcConnection& operator=(const RpcConnection&); //not implemented;
     RpcConnection(ConnKey& connKey, uint32 prog, uint32 version, bool resvPort);
 
+    void initCallHeader();
+    void setRecordMark(RpcPacketPtr pkt);
+    int readOwnReply(Responder* responder, int timeout);
+    void drainSocket();
     int recvUDPPacket(RpcPacketPtr& reply);
     int recvTCPPacket(RpcPacketPtr& reply);
+    int parseTCPRecord(RpcPacketPtr& reply, uint32& needed);
+    int fillRecvBuffer(uint32 needed);
+    void resetRecvBuffer();
+    int beginDirectRecv(const unsigned char* rec, uint32 avail, uint32 length);
+    // completed is false if the reply was cut off, the sink is rewound then
+    void endDirectRecv(bool completed);
+    bool isReceivingReply(RpcPacketPtr request);
 
-    Responder* findPendingRequest(RpcPacketPtr);
     bool addPendingRequest( RpcPacketPtr, Responder* responder);
     bool removePendingRequest(RpcPacketPtr);
+    Responder* takePendingRequest(RpcPacketPtr);
     bool matchPendingRequest(RpcPacketPtr); // match reply with pending request
-
+    void completeAsync(Responder* responder, int outcome, RpcPacketPtr reply);
+
+    // timeout of one send, the sends to try and the deadline of the whole call
+    void getTimeouts(int timeout_ms, int& timeout, int& tries, uint64& deadline) const;
+    // udp retransmit timeouts of a request, none above timeout
+    int getTimerClass(RpcPacketPtr request) const;
+    int getFirstTimeout(int timerClass, int timeout);
+    int getNextTimeout(int last, int timeout) const;
     int cleanup();
 
-    int doSendAndWait(RpcPacketPtr, RpcPacketPtr& reply, int timeout_ms);
+    int doSendAndWait(RpcPacketPtr, RpcPacketPtr& reply, int timeout_ms, bool& retried);
+
+    // make the request pending with its timer armed, NULL if there is no slot for it
+    Responder* startRequest(RpcPacketPtr request, const ReplyCallback& callback, int timeout_ms);
+    void armTimer(Responder* responder, uint64 expires_ms);
+    // disarm the timer and give the responder back to the pool
+    void releaseResponder(Responder* responder);
 
   private: //data members
+    static uint32 gReconnectAttempts;
     static uint32 salt;
-    uint32 m_nextXid;
+    static uint32 initialXid();
     uint32 m_progNumber;
     uint32 m_version;
 
-    struct Fragment
-    {
-      bool isHeaderDone;
-      uint32 header;  //network order
-      bool isDataDone;
-      uint32 length;
-      RpcPacketPtr m_packet;
-      Fragment():isHeaderDone(false), header(0), isDataDone(0), length(0), m_packet(NULL){}
-      bool isLastFragment() { return !((ntohl(header) & 0x80000000) == 0); }
-      bool isIncompleteHeader() { return !isHeaderDone; }
-      bool isIncompleteFragment() { return !isDataDone; }
-      void clear() {isHeaderDone= false; header = 0;  isDataDone = 0; length = 0; m_packet = NULL; }
-    };
-
-    class SemaphoreGuard
-    {
-      public:
-        SemaphoreGuard(); //not implemented
-        SemaphoreGuard(Thread::Semaphore& sem) : m_pSem(&sem) { m_pSem->acquire(); }
-        SemaphoreGuard(Thread::Semaphore* psem) : m_pSem(psem) { m_pSem->acquire(); }
-        ~SemaphoreGuard() { m_pSem->release(); }
-      private:
-        Thread::Semaphore* m_pSem;
-    };
-
-    // internal data member to hold partial message
-    Fragment m_fragment;
-
-    // xid table
-    Thread::Mutex m_xidTableLock;
-    std::map<Xid, Responder*> m_xidTable;
-
-    //allowed concurrent pending requests for TCP
-    Thread::Semaphore m_concurrency;
+    // call header up to the credential, see initCallHeader()
+    unsigned char m_callHeader[7 * sizeof(uint32)];
+    uint32 m_callHeaderSize;
+    uint32 m_callXidOffset;
+
+    // size of the last request of each procedure
+    static const int SIZE_HINT_PROCS = 32;
+    std::atomic<uint32> m_sizeHints[SIZE_HINT_PROCS];
+
+    // TCP receive buffer. replies are carved out of it as slices, the
+    // chunk is replaced once replies still reference it and it fills up
+    BufferChunkPtr m_recvChunk;
+    uint32 m_recvStart;   // first byte not parsed yet
+    uint32 m_recvEnd;     // end of the received data
+    bool m_recvDrained;   // the last recv() emptied the socket
+    int m_recvSocket;     // socket the buffered data came from
+
+    // data handed over by recvData(), read from instead of the socket
+    const unsigned char* m_recvData;
+    uint32 m_recvDataLeft;
+
+    // datagrams received but not matched yet
+    std::deque<RpcPacketPtr> m_datagrams;
+    // recvmmsg() buffers, one per datagram of a batch. a chunk a reply
+    // still references is replaced before the next receive
+    std::vector<BufferChunkPtr> m_datagramChunks;
+
+    // reply of several record fragments being assembled
+    RpcPacketPtr m_partialReply;
+
+    // reply whose payload is received straight into the caller's ReplySink.
+    // m_directReply collects the bytes around the payload
+    ReplySink* m_directSink;
+    Xid m_directXid;
+    RpcPacketPtr m_directReply;
+    uint32 m_directPayloadLeft;
+    uint32 m_directSuffixLeft;
+    uint32 m_directFilled; // bytes in the sink before the reply
+    bool m_recordChecked; // the record at m_recvStart was offered to a sink
+
+    // pending requests by xid, also hands out the xids
+    XidTable m_xidTable;
+    ResponderPool* m_responderPool;
+
+    // allowed concurrent pending requests, adapts to the latency
+    RpcWindow m_window;
+    // udp retransmit timeouts, adapt to the round trip times
+    RpcRtt m_rtt;
+
+    // retransmissions and deadlines of the pending requests, advanced by
+    // the reactor through expireRequests()
+    Thread::Mutex m_timerLock;
+    TimerWheel m_timers;
+
+    // reconnects since a reply was last received
+    std::atomic<uint32> m_reconnects;
 };
 
 }
@@ -46,6 +46,13 @@ enum TransportType
   MAX_TRANSP
 };
 
+// how the reactor threads drive the sockets
+enum TransportBackend
+{
+  BACKEND_EPOLL = 0,
+  BACKEND_IO_URING
+};
+
 enum ServiceType
 {
   PORTMAP = 0,
@@ -23,6 +23,7 @@
 namespace OpenNfsC {
 
 class RpcPacket;
+class ReplySink;
 typedef SmartPtr<RpcPacket> RpcPacketPtr;
 
 struct RpcInfo
@@ -57,15 +58,30 @@ class RpcPacket: public Packet
   public:
     RpcPacket(uint32 size);
     RpcPacket(RpcHeader& hdr);
+    RpcPacket(RpcHeader& hdr, uint32 size);
+    RpcPacket(const BufferChunkPtr& chunk, unsigned char* data, uint32 len);
     virtual ~RpcPacket();
     uint32 getXid() { return m_header.xid; }
     void setXid(uint32 xid) { m_header.xid = xid; }
+    // give an encoded request another xid
+    int updateXid(uint32 xid);
     void setMessageType(uint32 call) { m_header.call = call; }
+    // procedure of a request
+    uint32 getProc() { return m_header.cr.proc.proc; }
 
     int encodeHeader();
+    // append a call header encoded by the caller, the xid is xidOffset bytes into it
+    int appendEncodedHeader(const unsigned char* hdr, uint32 len, uint32 xidOffset);
     int decodeHeader();
     bool isReplyValid() { return m_header.cr.r.status == 0; }
 
+    // caller memory to receive the payload of the reply to this request into
+    void setReplySink(ReplySink* sink) { m_sink = sink; }
+    ReplySink* getReplySink() const { return m_sink; }
+
+    // let xdrEncodeVarOpaqueRef() reference the caller memory, see Packet::appendRef()
+    void setBorrowData(bool borrow) { m_borrowData = borrow; }
+
   public:
     int xdrEncodeUint8(uint8 iValue) {return xdrEncodeUint32((uint32)iValue);}
     int xdrEncodeUint16(uint16 iValue) {return xdrEncodeUint32((uint32)iValue);}
@@ -73,6 +89,7 @@ class RpcPacket: public Packet
     int xdrEncodeUint64(uint64);
     int xdrEncodeFixedOpaque(void*, uint32);
     int xdrEncodeVarOpaque(void*, uint32);
+    int xdrEncodeVarOpaqueRef(void*, uint32);
     int xdrEncodeString(unsigned char*, uint32);
 
     int xdrDecodeSkipPadding(uint32 len);
@@ -85,6 +102,9 @@ class RpcPacket: public Packet
 
   private:
     RpcHeader m_header;
+    uint32 m_xidOffset; // where encodeHeader() put the xid
+    ReplySink* m_sink;
+    bool m_borrowData;
 };
 
 } // end of namespace
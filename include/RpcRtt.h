@@ -0,0 +1,76 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _RPC_RTT_H_
+#define _RPC_RTT_H_
+
+#include <stdTypes.h>
+#include <Thread.h>
+
+namespace OpenNfsC {
+
+/* Retransmit timeout of datagram requests, estimated per timer class from
+ * the round trip times (Jacobson/Karels): rto = srtt + 4 * rttvar.
+ * Following Karn, retransmitted requests give no sample; instead every
+ * timeout doubles the class timeout until a fresh sample arrives. */
+class RpcRtt
+{
+  public:
+    enum TimerClass
+    {
+      TIMER_OTHER = 0,
+      TIMER_GETATTR,
+      TIMER_LOOKUP,
+      TIMER_READ,
+      TIMER_WRITE,
+      TIMER_CLASSES
+    };
+
+    // initialMs until the first sample, no timeout goes below minMs or above maxMs
+    RpcRtt(uint32 initialMs, uint32 minMs, uint32 maxMs);
+
+    // timer class of a procedure of the program
+    static int getTimerClass(uint32 prog, uint32 vers, uint32 proc);
+
+    // timeout of the first send of a request of the class, in ms
+    uint32 getTimeout(int timerClass);
+    // timeout of a retransmission after the previous one of timeout ms
+    uint32 backoff(uint32 timeout) const;
+    // a request that was not retransmitted got its reply after rttUs
+    void update(int timerClass, uint64 rttUs);
+    // a request of the class timed out
+    void timedOut(int timerClass);
+
+  private:
+    RpcRtt(const RpcRtt&); // not implemented
+    RpcRtt& operator=(const RpcRtt&); // not implemented
+
+  private:
+    Thread::Mutex m_lock;
+    uint32 m_initial;
+    uint32 m_min;
+    uint32 m_max;
+
+    // in microseconds, srtt 0 until the first sample
+    uint64 m_srtt[TIMER_CLASSES];
+    uint64 m_rttvar[TIMER_CLASSES];
+    // timeouts in a row, each doubles the timeout
+    uint32 m_timeouts[TIMER_CLASSES];
+};
+
+} // end of namespace
+#endif /* _RPC_RTT_H_ */
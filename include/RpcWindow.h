@@ -0,0 +1,91 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _RPC_WINDOW_H_
+#define _RPC_WINDOW_H_
+
+#include <stdTypes.h>
+#include <Thread.h>
+#include "RpcRtt.h"
+
+namespace OpenNfsC {
+
+struct RpcWindowStats
+{
+  uint32 window;       // requests allowed in flight
+  uint32 inFlight;     // requests in flight
+  uint32 minRttUs;     // baseline round trip time of the last sampled class
+  uint32 srttUs;       // smoothed round trip time of that class
+  uint64 completed;    // requests done
+  uint64 congested;    // requests that were retransmitted or failed
+  uint64 decreases;    // times the window was cut
+};
+
+/* Number of requests a connection keeps in flight, adjusted AIMD-style.
+ * The window grows by one per round trip while it is the limit and the
+ * latency stays close to the lowest one seen. It is halved, at most once
+ * per round trip, when the latency inflates or requests are retransmitted
+ * or fail. Latency is judged per RpcRtt timer class, a large READ is
+ * never compared with the baseline of a GETATTR. */
+class RpcWindow
+{
+  public:
+    RpcWindow(uint32 initial, uint32 minWindow, uint32 maxWindow);
+
+    // take a slot, blocks while the window is full
+    void acquire();
+    // take a slot if one is free
+    bool tryAcquire();
+    // give a slot back. rttUs is 0 if the request gave no round trip sample,
+    // congested if it was retransmitted or failed. timerClass is the
+    // RpcRtt class of the request
+    void release(uint64 rttUs, bool congested, int timerClass);
+
+    uint32 getWindow();
+    void getStats(RpcWindowStats& stats);
+
+  private:
+    RpcWindow(const RpcWindow&); // not implemented
+    RpcWindow& operator=(const RpcWindow&); // not implemented
+
+    void sample(int timerClass, uint64 rttUs, uint64 now);
+
+  private:
+    Thread::Mutex m_lock;
+    Thread::ConditionVar m_cond;
+    uint32 m_waiters;
+
+    double m_window;
+    uint32 m_inFlight;
+    uint32 m_min;
+    uint32 m_max;
+
+    // per timer class, in microseconds
+    uint64 m_minRtt[RpcRtt::TIMER_CLASSES];
+    uint64 m_minRttTime[RpcRtt::TIMER_CLASSES];  // when the baseline was taken
+    uint64 m_srtt[RpcRtt::TIMER_CLASSES];
+    int m_lastClass;
+    uint64 m_lastDecrease;
+
+    uint64 m_completed;
+    uint64 m_congested;
+    uint64 m_decreases;
+};
+
+} // end of namespace
+#endif /* _RPC_WINDOW_H_ */
@@ -409,6 +409,7 @@ class Semaphore
     Semaphore(int nInitial);
     ~Semaphore();
     void acquire();
+    bool tryAcquire();
     void release();
 
   private:
@@ -0,0 +1,81 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include <stdTypes.h>
+#include <vector>
+#include <cstddef>
+
+namespace OpenNfsC {
+
+/* Hierarchical timer wheel. Level 0 has one slot per tick, every further
+ * level has slots as long as a whole turn of the level below; timers are
+ * moved down a level as their time comes closer. Scheduling and cancelling
+ * is O(1), advancing costs O(1) per tick and timer due.
+ *
+ * Timers are embedded in their owners. The wheel is not thread safe, its
+ * owner serializes the calls. */
+class TimerWheel
+{
+  public:
+    struct Timer
+    {
+      Timer():next(NULL), prev(NULL), expires(0), data(0) {}
+      bool isPending() const { return next != NULL; }
+
+      Timer* next;
+      Timer* prev;
+      uint64 expires;  // in ticks
+      uint32 data;     // for the owner, kept when the timer fires
+    };
+
+    TimerWheel(uint32 tickMs, uint64 nowMs);
+
+    // (re)schedule the timer to fire at expiresMs, the past means the next tick
+    void schedule(Timer* timer, uint64 expiresMs);
+    void cancel(Timer* timer);
+    // timers due by nowMs are taken off the wheel and appended to due
+    void advance(uint64 nowMs, std::vector<Timer*>& due);
+
+    uint32 size() const { return m_count; }
+
+  private:
+    TimerWheel(const TimerWheel&); // not implemented
+    TimerWheel& operator=(const TimerWheel&); // not implemented
+
+    static const uint32 LEVELS = 4;
+    static const uint32 SLOT_BITS = 6;
+    static const uint32 SLOTS = 1 << SLOT_BITS;
+
+    void add(Timer* timer);
+    // move the timers of a slot of a level down, returns the slot index
+    uint32 cascade(uint32 level);
+    static void link(Timer* head, Timer* timer);
+    static void unlink(Timer* timer);
+
+  private:
+    uint32 m_tickMs;
+    uint64 m_next;    // next tick to process
+    uint32 m_count;
+    // list heads, a timer is linked before its head
+    Timer m_slots[LEVELS][SLOTS];
+};
+
+} // end of namespace
+#endif /* _TIMER_WHEEL_H_ */
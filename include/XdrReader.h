@@ -0,0 +1,174 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _XDR_READER_
+#define _XDR_READER_
+
+/* ***************************************
+ * Decodes XDR in place from a reply. The space of a fixed size struct
+ * is checked once with need(), the fields are then loaded unchecked.
+ * Strings and opaques are returned as views into the reply.
+ * **************************************/
+
+#include "RpcPacket.h"
+#include "XdrSwap.h"
+#include <base.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <cstddef>
+
+namespace OpenNfsC {
+
+class XdrReader
+{
+  public:
+    // reads the unparsed part of pkt, the packet is advanced on sync()
+    XdrReader(const RpcPacketPtr& pkt);
+    // reads len bytes of data
+    XdrReader(const unsigned char* data, uint32 len):
+      m_pkt(NULL),m_base((unsigned char*)data),m_pos((unsigned char*)data),m_end((unsigned char*)data+len) {}
+    ~XdrReader() { sync(); }
+
+    /* make sure len more bytes are there, the get functions rely on it.
+     * returns -1 if the reply is short */
+    int need(uint32 len) const { return remaining() >= len ? 0 : -1; }
+    uint32 remaining() const { return m_end - m_pos; }
+
+    /* hand the bytes read so far back to the packet */
+    void sync();
+
+    uint32 getUint32()
+    {
+      uint32 nValue;
+      memcpy(&nValue, m_pos, sizeof(nValue));
+      m_pos += sizeof(nValue);
+      return ntohl(nValue);
+    }
+
+    uint64 getUint64()
+    {
+      uint64 nValue;
+      memcpy(&nValue, m_pos, sizeof(nValue));
+      m_pos += sizeof(nValue);
+#if defined(R_ENDIAN_LITTLE)
+      return __builtin_bswap64(nValue);
+#else
+      return nValue;
+#endif
+    }
+
+    // count values in a row, needs 4 * count
+    void getUint32Array(uint32* values, uint32 count)
+    {
+      XdrSwap::copy32(values, m_pos, count);
+      m_pos += 4 * count;
+    }
+
+    void getUint64Array(uint64* values, uint32 count)
+    {
+      XdrSwap::copy64(values, m_pos, count);
+      m_pos += 8 * count;
+    }
+
+    // view of len bytes, the padding is skipped. needs fixedOpaqueSize(len)
+    unsigned char* getFixedOpaque(uint32 len)
+    {
+      unsigned char* data = m_pos;
+      m_pos += fixedOpaqueSize(len);
+      return data;
+    }
+
+    /* checked versions, for fields not covered by need() */
+    int decodeUint32(uint32* value)
+    {
+      if (need(4) < 0)
+        return -1;
+      *value = getUint32();
+      return 0;
+    }
+
+    int decodeUint64(uint64* value)
+    {
+      if (need(8) < 0)
+        return -1;
+      *value = getUint64();
+      return 0;
+    }
+
+    // copies len bytes out and skips the padding
+    int decodeFixedOpaque(void* buf, uint32 len)
+    {
+      if (len > remaining() || need(fixedOpaqueSize(len)) < 0)
+        return -1;
+      memcpy(buf, getFixedOpaque(len), len);
+      return 0;
+    }
+
+    // a view of a variable length opaque or string, not terminated
+    int decodeString(unsigned char*& data, uint32& len)
+    {
+      if (need(4) < 0)
+        return -1;
+      uint32 length = getUint32();
+      if (length > remaining() || need(fixedOpaqueSize(length)) < 0)
+        return -1;
+      data = getFixedOpaque(length);
+      len = length;
+      return 0;
+    }
+
+    int skip(uint32 len)
+    {
+      if (need(len) < 0)
+        return -1;
+      m_pos += len;
+      return 0;
+    }
+
+    static uint32 fixedOpaqueSize(uint32 len) { return (len + 3) & ~3U; }
+
+  private:
+    XdrReader(const XdrReader&); //not implemented
+    XdrReader& operator=(const XdrReader&); //not implemented
+
+  private:
+    RpcPacket* m_pkt;
+    unsigned char* m_base; // first byte not yet consumed in the packet
+    unsigned char* m_pos;  // next byte to read
+    unsigned char* m_end;  // end of the data
+};
+
+inline XdrReader::XdrReader(const RpcPacketPtr& pkt):m_pkt(pkt.ptr()),m_base(NULL),m_pos(NULL),m_end(NULL)
+{
+  if (m_pkt == NULL)
+    return;
+  m_end = m_pkt->getBufferEnd();
+  m_pos = m_pkt->getReadAddress();
+  if (m_pos == NULL || m_pos > m_end)
+    m_pos = m_end;
+  m_base = m_pos;
+}
+
+inline void XdrReader::sync()
+{
+  if (m_pkt != NULL && m_pos != m_base)
+    m_pkt->skip(m_pos - m_base);
+  m_base = m_pos;
+}
+
+} // end of namespace
+#endif /* _XDR_READER_ */
@@ -0,0 +1,41 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _XDR_SWAP_H_
+#define _XDR_SWAP_H_
+
+#include <stdTypes.h>
+
+namespace OpenNfsC {
+
+/* Copies arrays of 32 and 64 bit values between host and XDR byte order.
+ * The swap uses AVX2 or SSSE3 when the cpu has them, the choice is made
+ * on the first call. dst and src may be the same but must not overlap
+ * otherwise, neither needs to be aligned */
+class XdrSwap
+{
+  public:
+    static void copy32(void* dst, const void* src, uint32 count);
+    static void copy64(void* dst, const void* src, uint32 count);
+
+  private:
+    XdrSwap(); // not implemented
+};
+
+} // end of namespace
+
+#endif /* _XDR_SWAP_H_ */
@@ -0,0 +1,143 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _XDR_WRITER_
+#define _XDR_WRITER_
+
+/* ***************************************
+ * Encodes XDR at the end of a packet. The space for a whole argument
+ * struct is reserved once, the fields are then stored unchecked.
+ * **************************************/
+
+#include "RpcPacket.h"
+#include "XdrSwap.h"
+#include <base.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <cstddef>
+
+namespace OpenNfsC {
+
+class XdrWriter
+{
+  public:
+    XdrWriter(const RpcPacketPtr& pkt):m_pkt(pkt.ptr()),m_base(NULL),m_pos(NULL),m_end(NULL) {}
+    ~XdrWriter() { flush(); }
+
+    /* make room for len more bytes, the put functions rely on it.
+     * returns -1 if the packet could not grow */
+    int reserve(uint32 len);
+
+    /* hand the bytes written so far to the packet. needed before
+     * anything else appends to it, reserve() again afterwards */
+    void flush();
+
+    void putUint32(uint32 value)
+    {
+      uint32 nValue = htonl(value);
+      memcpy(m_pos, &nValue, sizeof(nValue));
+      m_pos += sizeof(nValue);
+    }
+
+    void putUint64(uint64 value)
+    {
+#if defined(R_ENDIAN_LITTLE)
+      uint64 nValue = __builtin_bswap64(value);
+#else
+      uint64 nValue = value;
+#endif
+      memcpy(m_pos, &nValue, sizeof(nValue));
+      m_pos += sizeof(nValue);
+    }
+
+    // count values in a row, needs 4 * count
+    void putUint32Array(const uint32* values, uint32 count)
+    {
+      XdrSwap::copy32(m_pos, values, count);
+      m_pos += 4 * count;
+    }
+
+    void putUint64Array(const uint64* values, uint32 count)
+    {
+      XdrSwap::copy64(m_pos, values, count);
+      m_pos += 8 * count;
+    }
+
+    void putFixedOpaque(const void* buf, uint32 len)
+    {
+      if (len > 0)
+        memcpy(m_pos, buf, len);
+      m_pos += len;
+      // zero padding up to the next 4 byte boundary
+      while (len++ % 4 != 0)
+        *m_pos++ = 0;
+    }
+
+    void putVarOpaque(const void* buf, uint32 len)
+    {
+      putUint32(len);
+      putFixedOpaque(buf, len);
+    }
+
+    void putString(const char* str, uint32 len) { putVarOpaque(str, len); }
+
+    /* the packet references buf instead of copying it */
+    int putVarOpaqueRef(const void* buf, uint32 len)
+    {
+      flush();
+      return m_pkt->xdrEncodeVarOpaqueRef((void*)buf, len);
+    }
+
+    /* encoded sizes to reserve */
+    static uint32 fixedOpaqueSize(uint32 len) { return (len + 3) & ~3U; }
+    static uint32 varOpaqueSize(uint32 len) { return 4 + fixedOpaqueSize(len); }
+
+  private:
+    XdrWriter(const XdrWriter&); //not implemented
+    XdrWriter& operator=(const XdrWriter&); //not implemented
+
+  private:
+    RpcPacket* m_pkt;
+    unsigned char* m_base; // first byte not yet handed to the packet
+    unsigned char* m_pos;  // next byte to write
+    unsigned char* m_end;  // end of the reserved space
+};
+
+inline int XdrWriter::reserve(uint32 len)
+{
+  if (m_pos != NULL && (uint32)(m_end - m_pos) >= len)
+    return 0;
+
+  // the packet copies only what it was handed when it grows
+  flush();
+  if (m_pkt == NULL || !m_pkt->reserve(len))
+    return -1;
+
+  m_base = m_pos = m_pkt->getBufferEnd();
+  m_end = m_pkt->getBuffer() + m_pkt->getCapacity();
+  return 0;
+}
+
+inline void XdrWriter::flush()
+{
+  if (m_pos != m_base)
+    m_pkt->append(NULL, m_pos - m_base);
+  m_base = m_pos = m_end = NULL;
+}
+
+} // end of namespace
+#endif /* _XDR_WRITER_ */
@@ -0,0 +1,143 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _XID_TABLE_H_
+#define _XID_TABLE_H_
+
+#include <stdTypes.h>
+#include <atomic>
+#include <sched.h>
+
+namespace OpenNfsC {
+
+class Responder;
+
+/* Pending requests of a connection, indexed by the low bits of the xid.
+ * xids are handed out so that their slot is free, a reply is matched with
+ * a single slot lookup and no lock.
+ *
+ * A slot is FREE, CLAIMED while its owner fills it, ARMED while the request
+ * is pending and BUSY while a visitor works on the responder. A BUSY slot
+ * is neither freed nor reused, so a responder stays valid while visited. */
+class XidTable
+{
+  public:
+    enum Action { KEEP, TAKE };
+
+    XidTable(uint32 size, uint32 firstXid);
+    ~XidTable();
+
+    // next xid whose slot is free at the moment
+    uint32 nextXid();
+
+    // false if the slot of xid is in use
+    bool insert(uint32 xid, Responder* responder);
+    // the responder of xid, NULL if a visitor took it already
+    Responder* remove(uint32 xid);
+
+    // run fn on the responder of xid, TAKE removes it from the table
+    // returns false if xid is not pending
+    template <typename Fn> bool visit(uint32 xid, Fn fn);
+    // run fn on every pending responder
+    template <typename Fn> void sweep(Fn fn);
+
+    uint32 size() const { return m_mask + 1; }
+    uint32 pending() const { return m_pending.load(std::memory_order_relaxed); }
+
+  private:
+    XidTable(const XidTable&); // not implemented
+    XidTable& operator=(const XidTable&); // not implemented
+
+    enum State { FREE, CLAIMED, ARMED, BUSY };
+
+    struct Slot
+    {
+      std::atomic<int> state;
+      uint32 xid;
+      Responder* responder;
+    };
+
+    // lock an ARMED slot for a visit
+    bool lockSlot(Slot& slot)
+    {
+      int armed = ARMED;
+      return slot.state.compare_exchange_strong(armed, BUSY, std::memory_order_acquire);
+    }
+    void unlockSlot(Slot& slot, Action action);
+
+  private:
+    Slot* m_slots;
+    uint32 m_mask;
+    std::atomic<uint32> m_nextXid;
+    std::atomic<uint32> m_pending;
+};
+
+inline void XidTable::unlockSlot(Slot& slot, Action action)
+{
+  if ( action == TAKE )
+  {
+    slot.responder = NULL;
+    m_pending.fetch_sub(1, std::memory_order_relaxed);
+    slot.state.store(FREE, std::memory_order_release);
+  }
+  else
+  {
+    slot.state.store(ARMED, std::memory_order_release);
+  }
+}
+
+template <typename Fn>
+bool XidTable::visit(uint32 xid, Fn fn)
+{
+  Slot& slot = m_slots[xid & m_mask];
+  while ( !lockSlot(slot) )
+  {
+    // another visitor is on it, wait for it unless the slot is not pending
+    if ( slot.state.load(std::memory_order_acquire) != BUSY )
+      return false;
+    sched_yield();
+  }
+
+  if ( slot.xid != xid )
+  {
+    // a stale reply to an earlier user of the slot
+    unlockSlot(slot, KEEP);
+    return false;
+  }
+
+  unlockSlot(slot, fn(slot.responder));
+  return true;
+}
+
+template <typename Fn>
+void XidTable::sweep(Fn fn)
+{
+  if ( pending() == 0 )
+    return;
+
+  for ( uint32 i = 0; i <= m_mask; i++ )
+  {
+    Slot& slot = m_slots[i];
+    if ( slot.state.load(std::memory_order_relaxed) != ARMED || !lockSlot(slot) )
+      continue;
+    unlockSlot(slot, fn(slot.responder));
+  }
+}
+
+} // end of namespace
+#endif /* _XID_TABLE_H_ */
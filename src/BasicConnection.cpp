@@ -23,6 +23,8 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <limits.h>
 #include <sys/ioctl.h>
 #include <linux/sockios.h>
 #include <netinet/in.h>
@@ -39,6 +41,19 @@ using Thread::MutexGuard;
 
 const time_t gReconnectInterval = 3;
 
+// most bytes handed to one sendmsg() call
+const uint32 gSendBatchBytes = (1024 * 1024);
+
+// most datagrams handed to one sendmmsg() call
+const uint32 gDatagramBatch = 32;
+
+static inline uint64 monotonicMs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 BasicConnection::BasicConnection(ConnKey& key, bool resv):
   m_readState(),
   m_connMutexLock(false),
@@ -47,8 +62,22 @@ BasicConnection::BasicConnection(ConnKey& key, bool resv):
   m_socketId(-1),
   m_connectState(STATE_UNKNOWN),
   m_inConnMgr(false),
+  m_connMgr(nullptr),
   m_lastConnectTime(0),
-  m_errno(0)
+  m_writeInbox(NULL),
+  m_writeArmed(false),
+  m_pollingOut(false),
+  m_sendDone(&m_pendingWriteLock),
+  m_sendWaiters(0),
+  m_failSocket(-1),
+  m_writeQueued(false),
+  m_nextWriteConn(NULL),
+  m_errno(0),
+  m_usable(true),
+  m_reconnecting(false),
+  m_reader(READER_NONE),
+  m_outstandingReqs(0),
+  m_outstandingBytes(0)
 {
   strcpy(m_serverIPStr,getConnKey().getServerIP().c_str());
   syslog(LOG_DEBUG, "BasicConnection::%s: this=%p  %s:%d, fd=Yet to create\n", __func__, this, m_serverIPStr, getConnKey().getServerPort());
@@ -56,8 +85,10 @@ BasicConnection::BasicConnection(ConnKey& key, bool resv):
 
 BasicConnection::~BasicConnection()
 {
-  syslog(LOG_DEBUG, "BasicConnection::%s: this=%p  %s:%d, fd=%d\n", __func__, this, m_serverIPStr, getConnKey().getServerPort(),m_socketId);
+  syslog(LOG_DEBUG, "BasicConnection::%s: this=%p  %s:%d, fd=%d\n", __func__, this, m_serverIPStr, getConnKey().getServerPort(),getSocketId());
   disconnect();
+  // the inbox holds references to its packets
+  clearPendingWriteQueue();
 }
 
 int BasicConnection::nonblockConnect()
@@ -198,8 +229,12 @@ int BasicConnection::p_nonblockConnect()
     syslog(LOG_ERR, "BasicConnection::%s: Server %s, %s\n", __func__, toString().c_str(), "An unhandled exception occurred");
   }
 
-  if ( result == -1 && fd != -1 )
-    ::close(fd);
+  if ( result == -1 )
+  {
+    if ( fd != -1 )
+      ::close(fd);
+    m_usable.store(false, std::memory_order_release);
+  }
 
   return result;
 }
@@ -213,6 +248,9 @@ int BasicConnection::disconnect()
 
 int BasicConnection::p_disconnect()
 {
+  // a connection waiting for its reconnect has no socket, it is given up
+  m_reconnecting.store(false, std::memory_order_release);
+
   int skt = m_socketId;
   if ( skt == -1 )
   {
@@ -221,6 +259,14 @@ int BasicConnection::p_disconnect()
     return 0;
   }
 
+  p_closeSocket();
+  m_usable.store(false, std::memory_order_release);
+  return 0;
+}
+
+void BasicConnection::p_closeSocket()
+{
+  int skt = m_socketId;
   if ( skt > 0 )
   {
     //::shutdown(skt, SHUTDOW_WR);
@@ -232,7 +278,25 @@ int BasicConnection::p_disconnect()
   clearPendingWriteQueue();
   m_readState.reset();
   syslog(LOG_DEBUG, "BasicConnection::disconnect() called on skt=%d\n", skt);
-  return 0;
+}
+
+void BasicConnection::closeSocket()
+{
+  MutexGuard lock(m_connMutexLock);
+  if ( m_socketId != -1 )
+    p_closeSocket();
+}
+
+int BasicConnection::reopenSocket()
+{
+  MutexGuard lock(m_connMutexLock);
+  if ( !isReconnecting() )
+    return -1;
+
+  int result = p_nonblockConnect();
+  if ( result >= 0 )
+    m_usable.store(true, std::memory_order_release);
+  return result;
 }
 
 int BasicConnection::ensureConnection(bool* pbReconnected)
@@ -333,42 +397,218 @@ int BasicConnection::recvNbyte()
 
 void BasicConnection::addPendingWrite(RpcPacketPtr pkt)
 {
-  bool bSendNotify = false;
+  // a copy still waiting goes out once, its write index must not move
+  if ( !pkt->tryQueue() )
+    return;
+  pkt->resetWriteIndex();
+
+  // the inbox holds the reference until the packet is taken over
+  Packet* raw = pkt.ptr();
+  raw->m_inboxRef = static_cast<SmartRef*>(raw);
+  Packet* head = m_writeInbox.load(std::memory_order_relaxed);
+  do
   {
-    MutexGuard lock(m_pendingWriteLock);
-    m_pendingWriteQueue.push(pkt);
+    raw->m_nextWrite = head;
+  } while ( !m_writeInbox.compare_exchange_weak(head, raw, std::memory_order_seq_cst, std::memory_order_relaxed) );
+
+  // the connection manager is woken up once until it finds the queue empty
+  if ( m_writeArmed.exchange(true) )
+    return;
+  if ( !ConnectionMgr::getInstance(this)->writeConnection(this) )
+    m_writeArmed.store(false);
+}
+
+void BasicConnection::p_takeInbox()
+{
+  Packet* head = m_writeInbox.exchange(NULL, std::memory_order_seq_cst);
+  if ( head == NULL )
+    return;
+
+  // newest first, reverse it
+  Packet* first = NULL;
+  while ( head != NULL )
+  {
+    Packet* next = head->m_nextWrite;
+    head->m_nextWrite = first;
+    first = head;
+    head = next;
+  }
+
+  while ( first != NULL )
+  {
+    Packet* next = first->m_nextWrite;
+    first->m_nextWrite = NULL;
+    m_pendingWriteQueue.push_back(static_cast<RpcPacket*>(first));
+    first->m_inboxRef.clear();
+    first = next;
+  }
+}
 
-    // first element in the queue
-    if ( m_pendingWriteQueue.size() == 1 )
-      bSendNotify = true;
+bool BasicConnection::p_isSending(const RpcPacketPtr& pkt) const
+{
+  for ( size_t i = 0; i < m_sendBatch.size(); i++ )
+  {
+    if ( m_sendBatch[i] == pkt )
+      return true;
+  }
+  for ( size_t i = 0; i < m_inFlight.size(); i++ )
+  {
+    if ( m_inFlight[i] == pkt )
+      return true;
   }
-  if ( bSendNotify )
-    ConnectionMgr::getInstance()->writeConnection(this);
+  return false;
+}
+
+void BasicConnection::p_sendDone()
+{
+  if ( m_sendWaiters > 0 )
+    m_sendDone.broadcast();
+}
+
+bool BasicConnection::p_disarmWrite()
+{
+  m_writeArmed.store(false);
+  // a writer that found the flag still set did not wake anyone up
+  if ( m_writeInbox.load() == NULL || m_writeArmed.exchange(true) )
+    return true;
+
+  p_takeInbox();
+  return false;
 }
 
-RpcPacketPtr BasicConnection::getPendingWrite()
+// pktIovs, if given, gets the iovec count of each packet. a datagram has to
+// go whole, the batch then ends before one that does not fit
+int BasicConnection::getPendingWrites(struct iovec* iov, int maxIov, uint32 maxPackets, bool& more, int* pktIovs)
 {
-  RpcPacketPtr pkt = NULL;
+  int count = 0;
+  uint32 bytes = 0;
+
   MutexGuard lock(m_pendingWriteLock);
-  if ( !m_pendingWriteQueue.empty() )
+  p_takeInbox();
+  // nothing left to send, EPOLLOUT is not needed any more
+  if ( m_pendingWriteQueue.empty() && p_disarmWrite() )
   {
-    pkt = m_pendingWriteQueue.front();
-    //m_pendingWriteQueue.pop_front();
+    m_sendBatch.clear();
+    more = false;
+    return 0;
+  }
+
+  m_sendBatch.clear();
+  std::deque<RpcPacketPtr>::iterator it = m_pendingWriteQueue.begin();
+  for ( ; it != m_pendingWriteQueue.end() && count < maxIov && bytes < gSendBatchBytes &&
+          m_sendBatch.size() < maxPackets; ++it )
+  {
+    RpcPacketPtr& pkt = *it;
+    int n = pkt->getWriteIov(iov + count, maxIov - count);
+    uint32 len = 0;
+    for ( int i = 0; i < n; i++ )
+      len += iov[count + i].iov_len;
+
+    if ( pktIovs != NULL && len < pkt->getWriteSize() && count > 0 )
+      break;
+
+    if ( pktIovs != NULL )
+      pktIovs[m_sendBatch.size()] = n;
+    count += n;
+    bytes += len;
+    m_sendBatch.push_back(pkt);
+
+    // the rest of the packet did not fit, later packets must wait for it
+    if ( len < pkt->getWriteSize() )
+    {
+      ++it;
+      break;
+    }
   }
-  return pkt;
+  more = (it != m_pendingWriteQueue.end());
+  return count;
 }
 
-void BasicConnection::removePendingWrite()
+void BasicConnection::completePendingWrites(uint32 nwrite)
 {
   MutexGuard lock(m_pendingWriteLock);
-  m_pendingWriteQueue.pop();
+  for ( size_t i = 0; i < m_sendBatch.size() && nwrite > 0; i++ )
+  {
+    // the queue has been cleared by a disconnect meanwhile
+    if ( m_pendingWriteQueue.empty() || m_pendingWriteQueue.front() != m_sendBatch[i] )
+      break;
+
+    RpcPacketPtr& pkt = m_pendingWriteQueue.front();
+    uint32 len = (nwrite < pkt->getWriteSize()) ? nwrite : pkt->getWriteSize();
+    pkt->advanceWriteIndex(len);
+    nwrite -= len;
+
+    if ( pkt->isWriteComplete() )
+    {
+      pkt->setQueued(false);
+      m_pendingWriteQueue.pop_front();
+    }
+  }
+  m_sendBatch.clear();
+  p_sendDone();
 }
 
-void BasicConnection::clearPendingWriteQueue()
+bool BasicConnection::releasePendingWrite(RpcPacketPtr pkt, uint32 wait_ms)
 {
   MutexGuard lock(m_pendingWriteLock);
-  while ( !m_pendingWriteQueue.empty() )
-    m_pendingWriteQueue.pop();
+  if ( wait_ms > 0 && p_isSending(pkt) )
+  {
+    uint64 deadline = monotonicMs() + wait_ms;
+    m_sendWaiters++;
+    for ( uint64 now = monotonicMs(); p_isSending(pkt) && now < deadline; now = monotonicMs() )
+      m_sendDone.wait((unsigned int)(deadline - now));
+    m_sendWaiters--;
+  }
+
+  // being sent right now
+  if ( p_isSending(pkt) )
+    return false;
+
+  p_takeInbox();
+  std::deque<RpcPacketPtr>::iterator it = m_pendingWriteQueue.begin();
+  for ( ; it != m_pendingWriteQueue.end(); ++it )
+  {
+    if ( *it == pkt )
+    {
+      pkt->copyReferences();
+      break;
+    }
+  }
+  return true;
+}
+
+bool BasicConnection::isWritePending(RpcPacketPtr pkt)
+{
+  return pkt->isQueued();
+}
+
+bool BasicConnection::requestFail(int skt, int error)
+{
+  if ( skt == -1 || skt != getSocketId() )
+    return false;
+
+  setErrno(error);
+  m_failSocket.store(skt, std::memory_order_release);
+  return ConnectionMgr::getInstance(this)->abortConnection(this);
+}
+
+void BasicConnection::clearPendingWriteQueue()
+{
+  bool bSendNotify = false;
+  {
+    MutexGuard lock(m_pendingWriteLock);
+    p_takeInbox();
+    std::deque<RpcPacketPtr>::iterator it = m_pendingWriteQueue.begin();
+    for ( ; it != m_pendingWriteQueue.end(); ++it )
+      (*it)->setQueued(false);
+    m_pendingWriteQueue.clear();
+    m_sendBatch.clear();
+    p_sendDone();
+    // packets queued meanwhile are for the next socket
+    bSendNotify = !p_disarmWrite();
+  }
+  if ( bSendNotify && !ConnectionMgr::getInstance(this)->writeConnection(this) )
+    m_writeArmed.store(false);
 }
 
 int BasicConnection::writePacket(RpcPacketPtr pkt)
@@ -376,8 +616,9 @@ int BasicConnection::writePacket(RpcPacketPtr pkt)
   if ( pkt == NULL )
     return -1;
 
+  // while reconnecting the packet waits in the queue for the new socket
   int skt = getSocketId();
-  if (skt == -1)
+  if (skt == -1 && !isReconnecting())
   {
     if (nonblockConnect() < 0)
     {
@@ -386,7 +627,6 @@ int BasicConnection::writePacket(RpcPacketPtr pkt)
     }
   }
 
-  pkt->resetWriteIndex();
   addPendingWrite(pkt);
   return 0;
 }
@@ -397,6 +637,9 @@ int BasicConnection::sendPacket()
   int skt = getSocketId();
   if ( skt == -1 )
   {
+    // kept for the new socket
+    if ( isReconnecting() )
+      return SOCKET_BUSY;
     clearPendingWriteQueue();
     return -INVALID_SOCKET;
   }
@@ -404,13 +647,43 @@ int BasicConnection::sendPacket()
   if ( getConnectionState() == STATE_CONNECTING )
     return SOCKET_BUSY;
 
-  RpcPacketPtr pkt = getPendingWrite();
-  while ( pkt != NULL )
+  // a TCP stream takes the whole queue in one go
+  bool isTcp = (getConnKey().getTransport() == TRANSP_TCP);
+  if ( !isTcp )
+    return sendDatagrams(skt);
+
+  uint32 maxPackets = IOV_MAX;
+  struct iovec iov[IOV_MAX];
+  bool more = false;
+
+  int count = getPendingWrites(iov, IOV_MAX, maxPackets, more);
+  while ( count > 0 )
   {
-    syslog(LOG_DEBUG, "sendpacket to send xid=%d\n", pkt->getXid());
-    int nwrite = send(skt, pkt->getWriteAddress(), pkt->getWriteSize(), MSG_NOSIGNAL);
+    uint32 total = 0;
+    for ( int i = 0; i < count; i++ )
+      total += iov[i].iov_len;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+
+    // more packets follow right away, let the stack fill the segments
+    int flags = MSG_NOSIGNAL;
+    if ( isTcp && more )
+      flags |= MSG_MORE;
+
+    syslog(LOG_DEBUG, "sendpacket to send %d buffers, %u bytes\n", count, total);
+    ssize_t nwrite = sendmsg(skt, &msg, flags);
     if ( nwrite <= 0 )
     {
+      // nothing was sent, drop the batch
+      completePendingWrites(0);
+      if ( errno == EINTR )
+      {
+        count = getPendingWrites(iov, IOV_MAX, maxPackets, more);
+        continue;
+      }
       if ( errno != EAGAIN )
       {
         char errstr[128];
@@ -420,19 +693,172 @@ int BasicConnection::sendPacket()
         clearPendingWriteQueue();
         return -SEND_FAIL;
       }
-      return SOCKET_BUSY;
+      break;
     }
 
-    pkt->advanceWriteIndex(nwrite);
+    completePendingWrites(nwrite);
+
+    // a short write means the socket buffer is full
+    if ( (uint32)nwrite < total )
+      break;
+
+    count = getPendingWrites(iov, IOV_MAX, maxPackets, more);
+  }
+
+  // m_writeArmed stays set while packets are left
+  return ( count == 0 ) ? SUCCESS : SOCKET_BUSY;
+}
+
+int BasicConnection::sendDirect(RpcPacketPtr pkt)
+{
+  int skt = getSocketId();
+  if ( skt == -1 || getConnectionState() != STATE_CONNECTED )
+    return 1;
+
+  {
+    MutexGuard lock(m_pendingWriteLock);
+    if ( !m_pendingWriteQueue.empty() || !m_sendBatch.empty() || m_writeArmed.load() || m_writeInbox.load() != NULL )
+      return 1;
+
+    pkt->resetWriteIndex();
+    struct iovec iov[IOV_MAX];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = pkt->getWriteIov(iov, IOV_MAX);
+
+    ssize_t nwrite = sendmsg(skt, &msg, MSG_NOSIGNAL|MSG_DONTWAIT);
+    if ( nwrite < 0 )
+    {
+      // the reactor reports the failure
+      if ( errno != EAGAIN && errno != EINTR )
+        return 1;
+      nwrite = 0;
+    }
 
+    pkt->advanceWriteIndex(nwrite);
     if ( pkt->isWriteComplete() )
+      return 0;
+
+    pkt->setQueued(true);
+    m_pendingWriteQueue.push_back(pkt);
+  }
+
+  if ( !m_writeArmed.exchange(true) && !ConnectionMgr::getInstance(this)->writeConnection(this) )
+    m_writeArmed.store(false);
+  return 0;
+}
+
+bool BasicConnection::beginRead(bool caller)
+{
+  int none = READER_NONE;
+  return m_reader.compare_exchange_strong(none, caller ? READER_CALLER : READER_REACTOR, std::memory_order_seq_cst);
+}
+
+int BasicConnection::beginSend(struct iovec* iov, int maxIov, std::vector<RpcPacketPtr>& batch, int& flags)
+{
+  if ( getSocketId() == -1 || getConnectionState() == STATE_CONNECTING )
+    return 0;
+
+  bool isTcp = (getConnKey().getTransport() == TRANSP_TCP);
+  bool more = false;
+  int count = getPendingWrites(iov, maxIov, isTcp ? maxIov : 1, more);
+  if ( count == 0 )
+    return 0;
+
+  flags = MSG_NOSIGNAL;
+  if ( isTcp && more )
+    flags |= MSG_MORE;
+
+  // m_writeArmed stays set, the reactor sends the rest on completion
+  MutexGuard lock(m_pendingWriteLock);
+  batch = m_sendBatch;
+  m_inFlight = m_sendBatch;
+  return count;
+}
+
+int BasicConnection::endSend(int result)
+{
+  {
+    MutexGuard lock(m_pendingWriteLock);
+    m_inFlight.clear();
+    p_sendDone();
+  }
+
+  if ( result < 0 && result != -EAGAIN && result != -EINTR )
+  {
+    char errstr[128];
+    syslog(LOG_DEBUG, "BasicConnection::%s() server %s failed to send: %d (%s)\n",
+           __func__, toString().c_str(), -result, strerror_r(-result, errstr, sizeof(errstr)) );
+    clearPendingWriteQueue();
+    return -SEND_FAIL;
+  }
+
+  completePendingWrites((result > 0) ? result : 0);
+
+  MutexGuard lock(m_pendingWriteLock);
+  p_takeInbox();
+  if ( m_pendingWriteQueue.empty() && p_disarmWrite() )
+    return SUCCESS;
+  return SOCKET_BUSY;
+}
+
+// send queued datagrams, a batch of them per sendmmsg()
+int BasicConnection::sendDatagrams(int skt)
+{
+  struct iovec iov[IOV_MAX];
+  int pktIovs[gDatagramBatch];
+  struct mmsghdr msgs[gDatagramBatch];
+  bool more = false;
+
+  int count = getPendingWrites(iov, IOV_MAX, gDatagramBatch, more, pktIovs);
+  while ( count > 0 )
+  {
+    int npkts = 0;
+    for ( int offset = 0; offset < count; offset += pktIovs[npkts++] )
     {
-      removePendingWrite();
-      pkt = getPendingWrite();
+      memset(&msgs[npkts], 0, sizeof(msgs[npkts]));
+      msgs[npkts].msg_hdr.msg_iov = iov + offset;
+      msgs[npkts].msg_hdr.msg_iovlen = pktIovs[npkts];
     }
+
+    syslog(LOG_DEBUG, "sendDatagrams to send %d datagrams\n", npkts);
+    int sent = sendmmsg(skt, msgs, npkts, MSG_NOSIGNAL);
+    if ( sent <= 0 )
+    {
+      // nothing was sent, drop the batch
+      completePendingWrites(0);
+      if ( errno == EINTR )
+      {
+        count = getPendingWrites(iov, IOV_MAX, gDatagramBatch, more, pktIovs);
+        continue;
+      }
+      if ( errno != EAGAIN )
+      {
+        char errstr[128];
+        syslog(LOG_DEBUG, "BasicConnection::%s() server %s failed to send: %d (%s)\n",
+               __func__, toString().c_str(), errno, strerror_r(errno, errstr, sizeof(errstr)) );
+
+        clearPendingWriteQueue();
+        return -SEND_FAIL;
+      }
+      break;
+    }
+
+    uint32 nwrite = 0;
+    for ( int i = 0; i < sent; i++ )
+      nwrite += msgs[i].msg_len;
+    completePendingWrites(nwrite);
+
+    // the socket buffer is full
+    if ( sent < npkts )
+      break;
+
+    count = getPendingWrites(iov, IOV_MAX, gDatagramBatch, more, pktIovs);
   }
 
-  return SUCCESS;
+  // m_writeArmed stays set while packets are left
+  return ( count == 0 ) ? SUCCESS : SOCKET_BUSY;
 }
 
 bool BasicConnection::isAlive()
@@ -443,6 +869,10 @@ bool BasicConnection::isAlive()
 
 bool BasicConnection::p_isAlive()
 {
+  // the requests of a connection being reconnected are kept for it
+  if ( isReconnecting() )
+    return true;
+
   // This is a non-blocking socket, so we can call peek to see whether the socket is alive or not
   int error = 0;
   socklen_t len = sizeof(error);
@@ -456,24 +886,6 @@ bool BasicConnection::isConnected()
   return STATE_CONNECTED == m_connectState;
 }
 
-void BasicConnection::setInConnMgr(bool isInConnMgr)
-{
-  MutexGuard lock(m_connMutexLock);
-  m_inConnMgr = isInConnMgr;
-}
-
-bool BasicConnection::isInConnMgr()
-{
-  MutexGuard lock(m_connMutexLock);
-  return true == m_inConnMgr;
-}
-
-int BasicConnection::getSocketId() const
-{
-  MutexGuard lock(m_connMutexLock);
-  return m_socketId;
-}
-
 void BasicConnection::setSocketId(int skt)
 {
   MutexGuard lock(m_connMutexLock);
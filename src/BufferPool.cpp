@@ -0,0 +1,174 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "BufferPool.h"
+#include <Thread.h>
+#include <stdlib.h>
+#include <vector>
+
+using OpenNfsC::Thread::MutexGuard;
+
+namespace OpenNfsC {
+
+namespace
+{
+  const uint32 gClassCount = 5;
+  const uint32 gClassSizes[gClassCount] = { 1024, 8192, 65536, 262144, 1048576 + 65536 };
+  // blocks a thread keeps, and the depot keeps on top of that for all threads
+  const uint32 gThreadLimit[gClassCount] = { 64, 32, 8, 4, 2 };
+  const uint32 gDepotLimit[gClassCount] = { 1024, 256, 64, 32, 16 };
+
+  // in front of each block, keeps the data 16 byte aligned
+  struct BlockHeader
+  {
+    uint32 sizeClass;
+    uint32 reserved[3];
+  };
+
+  struct Depot
+  {
+    Depot():lock(false) {}
+    Thread::Mutex lock;
+    std::vector<BlockHeader*> blocks;
+  };
+
+  // never destroyed, buffers may be released during exit
+  Depot* getDepots()
+  {
+    static Depot* depots = new Depot[gClassCount];
+    return depots;
+  }
+
+  inline uint32 getClass(uint32 size)
+  {
+    for ( uint32 i = 0; i < gClassCount; i++ )
+    {
+      if ( size <= gClassSizes[i] )
+        return i;
+    }
+    return gClassCount;
+  }
+
+  void freeBlocks(uint32 cls, std::vector<BlockHeader*>& blocks, size_t keep)
+  {
+    Depot& depot = getDepots()[cls];
+    {
+      MutexGuard lock(depot.lock);
+      while ( blocks.size() > keep && depot.blocks.size() < gDepotLimit[cls] )
+      {
+        depot.blocks.push_back(blocks.back());
+        blocks.pop_back();
+      }
+    }
+
+    while ( blocks.size() > keep )
+    {
+      free(blocks.back());
+      blocks.pop_back();
+    }
+  }
+
+  struct ThreadCache
+  {
+    ~ThreadCache();
+    std::vector<BlockHeader*> blocks[gClassCount];
+  };
+
+  thread_local ThreadCache tCache;
+  // set once tCache is destroyed, blocks then go to the depot directly
+  thread_local bool tCacheGone = false;
+
+  ThreadCache::~ThreadCache()
+  {
+    for ( uint32 i = 0; i < gClassCount; i++ )
+      freeBlocks(i, blocks[i], 0);
+    tCacheGone = true;
+  }
+}
+
+unsigned char* BufferPool::allocate(uint32 size, uint32& capacity)
+{
+  uint32 cls = getClass(size);
+  uint32 blockSize = (cls < gClassCount) ? gClassSizes[cls] : size;
+  BlockHeader* block = NULL;
+
+  if ( cls < gClassCount && !tCacheGone )
+  {
+    std::vector<BlockHeader*>& cached = tCache.blocks[cls];
+    if ( cached.empty() )
+    {
+      // half of what a thread keeps
+      Depot& depot = getDepots()[cls];
+      MutexGuard lock(depot.lock);
+      while ( !depot.blocks.empty() && cached.size() < (gThreadLimit[cls] + 1) / 2 )
+      {
+        cached.push_back(depot.blocks.back());
+        depot.blocks.pop_back();
+      }
+    }
+
+    if ( !cached.empty() )
+    {
+      block = cached.back();
+      cached.pop_back();
+    }
+  }
+
+  if ( block == NULL )
+  {
+    block = (BlockHeader*)malloc(sizeof(BlockHeader) + blockSize);
+    if ( block == NULL )
+    {
+      capacity = 0;
+      return NULL;
+    }
+    block->sizeClass = cls;
+  }
+
+  capacity = blockSize;
+  return (unsigned char*)(block + 1);
+}
+
+void BufferPool::release(unsigned char* buf)
+{
+  if ( buf == NULL )
+    return;
+
+  BlockHeader* block = (BlockHeader*)buf - 1;
+  uint32 cls = block->sizeClass;
+  if ( cls >= gClassCount )
+  {
+    free(block);
+    return;
+  }
+
+  if ( tCacheGone )
+  {
+    std::vector<BlockHeader*> blocks(1, block);
+    freeBlocks(cls, blocks, 0);
+    return;
+  }
+
+  std::vector<BlockHeader*>& cached = tCache.blocks[cls];
+  cached.push_back(block);
+  // keep half, a thread that frees what others allocate passes them on in batches
+  if ( cached.size() > gThreadLimit[cls] )
+    freeBlocks(cls, cached, gThreadLimit[cls] / 2);
+}
+
+} // end of namespace
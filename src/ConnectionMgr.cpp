@@ -16,7 +16,7 @@
 */
 
 #include "ConnectionMgr.h"
-#include "ConnectionMgr.h"
+#include "UringReactor.h"
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <pthread.h>
@@ -28,6 +28,8 @@
 #include <iostream>
 #include <errno.h>
 #include <syslog.h>
+#include <sched.h>
+#include <time.h>
 
 using namespace std;
 
@@ -58,23 +60,87 @@ using OpenNfsC::Thread::MutexGuard;
 
 namespace OpenNfsC {
 
-ConnectionMgr * ConnectionMgr::m_connMgrPtr = nullptr;
+std::vector<ConnectionMgr*> ConnectionMgr::m_reactors;
+uint32 ConnectionMgr::m_reactorCount = 1;
+bool ConnectionMgr::m_cpuPinning = false;
+TransportBackend ConnectionMgr::m_backend = BACKEND_EPOLL;
+bool ConnectionMgr::m_edgeTriggered = false;
+thread_local bool ConnectionMgr::m_isReactorThread = false;
 Thread::Mutex ConnectionMgr::m_connMgrLock(false);
 const int epollEventSize = 128;
+// how often the request timers of the connections are advanced, below the
+// least udp retransmit timeout
+const int expireIntervalMs = 50;
+
+static uint64 monotonicMs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void ConnectionMgr::setReactorCount(uint32 count)
+{
+  MutexGuard lock(m_connMgrLock);
+  m_reactorCount = (count < 1) ? 1 : count;
+}
 
-ConnectionMgr * ConnectionMgr::getInstance()
+void ConnectionMgr::setBackend(TransportBackend backend)
 {
   MutexGuard lock(m_connMgrLock);
-  if ( m_connMgrPtr == nullptr )
+  if ( backend == BACKEND_IO_URING && !UringReactor::isSupported() )
   {
-    m_connMgrPtr = new ConnectionMgr();
-    if ( m_connMgrPtr == nullptr )
+    syslog(LOG_WARNING, "ConnectionMgr::%s: built without io_uring support, using epoll\n", __func__);
+    backend = BACKEND_EPOLL;
+  }
+  m_backend = backend;
+}
+
+bool ConnectionMgr::createReactors()
+{
+  MutexGuard lock(m_connMgrLock);
+  if ( !m_reactors.empty() )
+    return true;
+
+  for ( uint32 i = 0; i < m_reactorCount; i++ )
+  {
+    ConnectionMgr* mgr = new ConnectionMgr(i);
+    if ( mgr == nullptr )
       throw std::string("Failed to create Connection Manager object");
+    m_reactors.push_back(mgr);
   }
-  return m_connMgrPtr;
+  return true;
 }
 
-ConnectionMgr::ConnectionMgr():m_sktMap(this),m_epollfd(-1),m_msgListLock(false)
+ConnectionMgr * ConnectionMgr::getInstance(BasicConnection* conn)
+{
+  ConnectionMgr* mgr = conn->getConnMgr();
+  if ( mgr != nullptr )
+    return mgr;
+
+  createReactors();
+
+  MutexGuard lock(m_connMgrLock);
+  mgr = conn->getConnMgr();
+  if ( mgr != nullptr )
+    return mgr;
+
+  // the reactor with the fewest connections
+  mgr = m_reactors[0];
+  for ( size_t i = 1; i < m_reactors.size(); i++ )
+  {
+    if ( m_reactors[i]->getConnectionCount() < mgr->getConnectionCount() )
+      mgr = m_reactors[i];
+  }
+  mgr->m_assigned.fetch_add(1, std::memory_order_relaxed);
+  conn->setConnMgr(mgr);
+
+  syslog(LOG_DEBUG, "ConnectionMgr::%s connection %s served by reactor %u\n", __func__, conn->toString().c_str(), mgr->m_index);
+  return mgr;
+}
+
+ConnectionMgr::ConnectionMgr(uint32 index):m_sktMap(this),m_epollfd(-1),m_uring(NULL),m_msgListLock(false),m_writeHead(NULL),m_lastExpireTime(0),
+  m_index(index),m_assigned(0)
 {
   if ( enable() )
   {
@@ -93,6 +159,17 @@ ConnectionMgr::~ConnectionMgr()
     syslog(LOG_DEBUG, "Connection Manager is stopped successfully\n");
   }
   disable();
+
+  // connections left on the write stack hold a reference to themselves
+  BasicConnection* head = m_writeHead.exchange(NULL, std::memory_order_acq_rel);
+  while ( head != NULL )
+  {
+    BasicConnectionPtr conn = head;
+    head = conn->m_nextWriteConn;
+    conn->m_nextWriteConn = NULL;
+    conn->m_writeRef = NULL;
+    conn->m_writeQueued.store(false, std::memory_order_release);
+  }
 }
 
 bool ConnectionMgr::enable()
@@ -194,21 +271,84 @@ void ConnectionMgr::processControlMsg()
       }
       msg.second = NULL;
     }
-    else if ( msg.first == WRITE_SKT )
+    else if ( msg.first == FAIL_SKT )
     {
-      syslog(LOG_DEBUG, "ConnectionMgr::processControlMsg() write socket %d\n", msg.second->getSocketId());
-      int outcome = msg.second->sendPacket();
-      if (outcome == 1)
-        epollAdd(msg.second->getSocketId(), EPOLLIN|EPOLLOUT, true);
-      else if (outcome < 0)
-      {
-        syslog(LOG_ERR, "ConnectionMgr::processControlMsg() write socket failed to send packet\n");
-        m_sktMap.remove(msg.second);
-        msg.second->closeConnection();
-        msg.second = NULL;
-      }
+      // the socket may have been replaced since the request was made
+      int skt = msg.second->takeFailedSocket();
+      if ( skt == -1 || skt != msg.second->getSocketId() || !msg.second->isInConnMgr() )
+        continue;
+
+      syslog(LOG_WARNING, "ConnectionMgr::processControlMsg() fail socket %d of %s\n", skt, msg.second->toString().c_str());
+      m_sktMap.remove(skt);
+      failConnection(msg.second);
+      msg.second = NULL;
     }
   } while(true);
+
+  processWrites();
+}
+
+void ConnectionMgr::processWrites()
+{
+  // the control socket is drained before, a push after this finds the
+  // stack empty and wakes us up again
+  BasicConnection* head = m_writeHead.exchange(NULL, std::memory_order_acq_rel);
+
+  // newest first, reverse it
+  BasicConnection* first = NULL;
+  while ( head != NULL )
+  {
+    BasicConnection* next = head->m_nextWriteConn;
+    head->m_nextWriteConn = first;
+    first = head;
+    head = next;
+  }
+
+  while ( first != NULL )
+  {
+    BasicConnectionPtr conn = first;
+    first->m_writeRef = NULL;
+    BasicConnection* next = first->m_nextWriteConn;
+    first->m_nextWriteConn = NULL;
+    // the connection may be pushed again from here on
+    first->m_writeQueued.store(false, std::memory_order_release);
+    first = next;
+
+    writeSocket(conn);
+  }
+}
+
+void ConnectionMgr::writeSocket(BasicConnectionPtr conn)
+{
+  syslog(LOG_DEBUG, "ConnectionMgr::%s write socket %d\n", __func__, conn->getSocketId());
+  // removed meanwhile, or the queue is sent once the connection is back
+  if ( !conn->isInConnMgr() || conn->isReconnecting() )
+    return;
+
+  if ( m_uring != NULL )
+  {
+    m_uring->send(conn);
+    return;
+  }
+
+  bool wasArmed = conn->isPollingOut();
+  int outcome = conn->sendPacket();
+  if (outcome == SOCKET_BUSY && !wasArmed)
+  {
+    epollAdd(conn->getSocketId(), EPOLLIN|EPOLLOUT, true);
+    conn->setPollingOut(true);
+  }
+  else if (outcome == SUCCESS && wasArmed)
+  {
+    epollAdd(conn->getSocketId(), EPOLLIN, true);
+    conn->setPollingOut(false);
+  }
+  else if (outcome < 0)
+  {
+    syslog(LOG_ERR, "ConnectionMgr::%s write socket failed to send packet\n", __func__);
+    m_sktMap.remove(conn);
+    failConnection(conn);
+  }
 }
 
 bool ConnectionMgr::sendControlMsg(const BasicConnectionPtr& conn, enum Action op)
@@ -238,8 +378,7 @@ bool ConnectionMgr::sendControlMsg(const BasicConnectionPtr& conn, enum Action o
 
 bool ConnectionMgr::startMgr()
 {
-  ConnectionMgr* mgr = getInstance();
-  if ( !mgr )
+  if ( !createReactors() )
   {
     syslog(LOG_WARNING, "failed to restart Connection Manager\n");
     return false;
@@ -252,13 +391,18 @@ bool ConnectionMgr::startMgr()
 
 void ConnectionMgr::stopMgr()
 {
-  if (m_connMgrPtr && m_connMgrPtr->isRunning())
+  MutexGuard lock(m_connMgrLock);
+  for ( size_t i = 0; i < m_reactors.size(); i++ )
   {
-    m_connMgrPtr->stop();
-    m_connMgrPtr->sendControlMsg(NULL, STOP_MGR);
-    m_connMgrPtr->join();
-    m_connMgrPtr->disable();
-    syslog(LOG_DEBUG, "Connection Manager is stopped successfully\n");
+    ConnectionMgr* mgr = m_reactors[i];
+    if (mgr->isRunning())
+    {
+      mgr->stop();
+      mgr->sendControlMsg(NULL, STOP_MGR);
+      mgr->join();
+      mgr->disable();
+      syslog(LOG_DEBUG, "Connection Manager %u is stopped successfully\n", mgr->m_index);
+    }
   }
 }
 
@@ -269,6 +413,8 @@ bool ConnectionMgr::epollAdd(int skt, uint32 events, bool update)
   memset(&event, 0, sizeof(event) );
   event.data.fd = skt;
   event.events = events;
+  if ( m_edgeTriggered && skt != m_controlfds[0] )
+    event.events |= EPOLLET;
 
   if ( update )
     op = EPOLL_CTL_MOD;
@@ -314,6 +460,29 @@ bool ConnectionMgr::epollDel(int skt)
   return true;
 }
 
+bool ConnectionMgr::watchSocket(BasicConnectionPtr conn)
+{
+  if ( m_uring != NULL )
+  {
+    m_uring->watch(conn);
+    return true;
+  }
+
+  int events = EPOLLIN;
+  if( !conn->isConnected() )
+    events |= EPOLLOUT;
+  conn->setPollingOut(events & EPOLLOUT);
+  return epollAdd(conn->getSocketId(), events);
+}
+
+void ConnectionMgr::unwatchSocket(int skt)
+{
+  if ( m_uring != NULL )
+    m_uring->unwatch(skt);
+  else
+    epollDel(skt);
+}
+
 bool ConnectionMgr::addConnection(const BasicConnectionPtr& conn)
 {
   return sendControlMsg(conn, ADD_SKT);
@@ -321,15 +490,42 @@ bool ConnectionMgr::addConnection(const BasicConnectionPtr& conn)
 
 bool ConnectionMgr::removeConnection(const BasicConnectionPtr& conn)
 {
+  m_assigned.fetch_sub(1, std::memory_order_relaxed);
   return sendControlMsg(conn, DEL_SKT);
 }
 
 bool ConnectionMgr::writeConnection(BasicConnectionPtr bconn)
 {
-  BasicConnectionPtr conn = m_sktMap.get(bconn);
-  if ( conn.empty() )
+  // the flag spares writers the socket map lock, writeSocket() checks it again
+  if ( bconn.empty() || !bconn->isInConnMgr() || !isRunning() )
     return false;
-  return sendControlMsg(conn, WRITE_SKT);
+
+  // already on the stack, it is written once the stack is taken
+  if ( bconn->m_writeQueued.exchange(true, std::memory_order_acq_rel) )
+    return true;
+
+  BasicConnection* conn = bconn.ptr();
+  conn->m_writeRef = static_cast<SmartRef*>(conn);
+  BasicConnection* head = m_writeHead.load(std::memory_order_relaxed);
+  do
+  {
+    conn->m_nextWriteConn = head;
+  } while ( !m_writeHead.compare_exchange_weak(head, conn, std::memory_order_acq_rel, std::memory_order_relaxed) );
+
+  if ( head != NULL )
+    return true;
+
+  // send one byte to control socket to wake up epoll. if it is full, a
+  // wake up is pending anyway
+  const uint8 zero = 0;
+  if ( send(m_controlfds[1], &zero, sizeof(zero), MSG_NOSIGNAL) < 0 && errno != EAGAIN )
+    syslog(LOG_ERR, "ConnectionMgr::%s failed to send\n", __func__);
+  return true;
+}
+
+bool ConnectionMgr::abortConnection(const BasicConnectionPtr& conn)
+{
+  return sendControlMsg(conn, FAIL_SKT);
 }
 
 void ConnectionMgr::processProtocolMsg(int skt, const epoll_event& event)
@@ -356,11 +552,20 @@ void ConnectionMgr::processProtocolMsg(int skt, const epoll_event& event)
     {
       syslog(LOG_DEBUG, "ConnectionMgr::%s: socket %d got %s event from %s. conn: %p\n",
              __func__, skt, (event.events & EPOLLERR)?"EPOLLERR":"EPOLLHUP", conn->toString().c_str(), conn.ptr());
-      conn->recvPacket();
+      if ( conn->beginRead(false) )
+      {
+        conn->recvPacket();
+        conn->endRead();
+      }
       throw -1;
     }
 
-    if ( event.events & EPOLLIN )
+    // a caller reading its own reply has the socket, it also takes what arrived now
+    if ( (event.events & EPOLLIN) && !conn->beginRead(false) )
+    {
+      syslog(LOG_DEBUG, "ConnectionMgr::%s: socket %d is read by a caller\n", __func__, skt);
+    }
+    else if ( event.events & EPOLLIN )
     {
       syslog(LOG_DEBUG, "ConnectionMgr::%s: socket %d got EPOLLIN event from %s\n",
              __func__, skt, conn->toString().c_str());
@@ -369,6 +574,7 @@ void ConnectionMgr::processProtocolMsg(int skt, const epoll_event& event)
       {
         outcome = conn->recvPacket();
       } while(outcome == 0);
+      conn->endRead();
 
       if (outcome < 0)
       {
@@ -406,8 +612,11 @@ void ConnectionMgr::processProtocolMsg(int skt, const epoll_event& event)
         syslog(LOG_ERR, "ConnectionMgr::%s: sendPacket %d encountered error to %s\n", __func__, skt, conn->toString().c_str());
         throw -1;
       }
-      if (outcome == 0) // no more write
+      if (outcome == SUCCESS) // no more write, stop polling for EPOLLOUT
+      {
         epollAdd(skt, EPOLLIN, true);
+        conn->setPollingOut(false);
+      }
     }
   }
   catch (int errCode)
@@ -417,7 +626,7 @@ void ConnectionMgr::processProtocolMsg(int skt, const epoll_event& event)
       m_sktMap.remove(skt);
       if ( conn )
       {
-        conn->closeConnection();
+        failConnection(conn);
         conn = NULL;
       }
     }
@@ -428,25 +637,124 @@ void ConnectionMgr::processProtocolMsg(int skt, const epoll_event& event)
   }
 }
 
+void ConnectionMgr::expireRequests()
+{
+  std::vector<BasicConnectionPtr> conns;
+  m_sktMap.getAll(conns);
+  for ( size_t i = 0; i < conns.size(); i++ )
+    conns[i]->expireRequests();
+  // requests waiting for a reconnect still time out
+  for ( size_t i = 0; i < m_reconnects.size(); i++ )
+    m_reconnects[i].second->expireRequests();
+}
+
+void ConnectionMgr::failConnection(BasicConnectionPtr conn)
+{
+  uint32 delay = 0;
+  if ( conn->beginReconnect(delay) )
+    m_reconnects.push_back(std::make_pair(monotonicMs() + delay, conn));
+  else
+    conn->closeConnection();
+}
+
+void ConnectionMgr::processReconnects()
+{
+  if ( m_reconnects.empty() )
+    return;
+
+  uint64 now = monotonicMs();
+  std::vector<BasicConnectionPtr> due;
+  for ( size_t i = 0; i < m_reconnects.size(); )
+  {
+    if ( m_reconnects[i].first <= now )
+    {
+      due.push_back(m_reconnects[i].second);
+      m_reconnects[i] = m_reconnects.back();
+      m_reconnects.pop_back();
+    }
+    else
+      i++;
+  }
+
+  for ( size_t i = 0; i < due.size(); i++ )
+  {
+    BasicConnectionPtr conn = due[i];
+    // closed meanwhile
+    if ( !conn->isReconnecting() )
+      continue;
+
+    if ( conn->reopenSocket() < 0 )
+    {
+      syslog(LOG_WARNING, "ConnectionMgr::%s: failed to reconnect %s\n", __func__, conn->toString().c_str());
+      failConnection(conn);
+      continue;
+    }
+
+    // a failed connect shows up as a socket error like any other
+    m_sktMap.add(conn);
+    conn->replayRequests();
+  }
+}
+
 void ConnectionMgr::run()
 {
-  epollAdd(m_controlfds[0], EPOLLIN);
+  m_isReactorThread = true;
+  if ( m_cpuPinning )
+  {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(m_index % ((ncpu > 0) ? ncpu : 1), &cpus);
+    if ( pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0 )
+      syslog(LOG_WARNING, "ConnectionMgr::%s: failed to pin reactor %u\n", __func__, m_index);
+  }
+
+  if ( m_backend == BACKEND_IO_URING )
+  {
+    m_uring = new UringReactor(this, m_controlfds[0]);
+    if ( !m_uring->init() )
+    {
+      syslog(LOG_WARNING, "ConnectionMgr::%s: reactor %u falls back to epoll\n", __func__, m_index);
+      delete m_uring;
+      m_uring = NULL;
+    }
+  }
+
+  if ( m_uring == NULL )
+    epollAdd(m_controlfds[0], EPOLLIN);
 
   while ( continueRunning() )
   {
     try
     {
-      struct epoll_event events[epollEventSize];
-      int nfds = epoll_wait(m_epollfd, events, epollEventSize, -1);
-
-      for ( int i = 0; i < nfds; i++ )
+      if ( m_uring != NULL )
+      {
+        m_uring->wait(expireIntervalMs);
+      }
+      else
       {
-        int skt = events[i].data.fd;
+        struct epoll_event events[epollEventSize];
+        int nfds = epoll_wait(m_epollfd, events, epollEventSize, expireIntervalMs);
+
+        for ( int i = 0; i < nfds; i++ )
+        {
+          int skt = events[i].data.fd;
 
-        if (skt == m_controlfds[0])
-          processControlMsg();
-        else
-          processProtocolMsg(skt, events[i]);
+          if (skt == m_controlfds[0])
+            processControlMsg();
+          else
+            processProtocolMsg(skt, events[i]);
+        }
+      }
+
+      processReconnects();
+
+      // the timers retransmit and expire the pending requests
+      uint64 now = monotonicMs();
+      if ( now - m_lastExpireTime >= (uint64)expireIntervalMs )
+      {
+        m_lastExpireTime = now;
+        expireRequests();
       }
     }
     catch (const std::exception& e)
@@ -465,7 +773,13 @@ void ConnectionMgr::run()
     m_sktMap.clear();
   }
 
-  epollDel(m_controlfds[0]);
+  if ( m_uring != NULL )
+  {
+    delete m_uring;
+    m_uring = NULL;
+  }
+  else
+    epollDel(m_controlfds[0]);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////
@@ -498,10 +812,7 @@ bool SocketConnectionMap::add(BasicConnectionPtr conn)
     }
   }
 
-  int events = EPOLLIN;
-  if( !conn->isConnected() )
-    events |= EPOLLOUT;
-  if ( m_mgr ) m_mgr->epollAdd(skt, events);
+  if ( m_mgr ) m_mgr->watchSocket(conn);
 
   syslog(LOG_DEBUG, "SocketConnectionMap::%s: Added connection(%p) socket %d. Size: %zu\n",
          __func__, conn.ptr(), skt, this->size());
@@ -533,7 +844,7 @@ bool SocketConnectionMap::remove(int skt)
              __func__, skt, SocketConnectionMapBase::size());
     }
 
-    if ( m_mgr ) m_mgr->epollDel(skt);
+    if ( m_mgr ) m_mgr->unwatchSocket(skt);
   }
   return true;
 }
@@ -545,9 +856,12 @@ bool SocketConnectionMap::remove(const BasicConnectionPtr& conn)
   {
     if ( it->second == conn )
     {
+      BasicConnectionPtr removed = it->second;
       int skt = (conn == NULL)? -1 : conn->getSocketId();
       this->erase(it);
-      if ( m_mgr ) m_mgr->epollDel(skt);
+      if ( removed != NULL )
+        removed->setInConnMgr(false);
+      if ( m_mgr ) m_mgr->unwatchSocket(skt);
       syslog(LOG_DEBUG, "SocketConnectionMap::%s: removed connection(%p) socket %d. Size: %zu\n",
              __func__, conn.ptr(), skt, SocketConnectionMapBase::size());
       return true;
@@ -579,17 +893,23 @@ BasicConnectionPtr SocketConnectionMap::get(const BasicConnectionPtr& bconn)
   return conn;
 }
 
+void SocketConnectionMap::getAll(std::vector<BasicConnectionPtr>& conns) const
+{
+  MutexGuard lock(m_mutex);
+  for ( SocketConnectionMap::const_iterator it = this->begin(); it != this->end(); ++it )
+    conns.push_back(it->second);
+}
+
 void SocketConnectionMap::clear()
 {
   syslog(LOG_DEBUG, "SocketConnectionMap::%s\n", __func__);
 
   MutexGuard lock(m_mutex);
-  std::map<int, BasicConnectionPtr>::iterator iter;
   for ( SocketConnectionMap::iterator it = this->begin(); it != this->end(); ++it )
   {
     syslog(LOG_DEBUG, "SocketConnectionMap::%s: cleared %d\n", __func__, it->first);
     it->second->setInConnMgr(false);
-    if ( m_mgr ) m_mgr->epollDel(iter->first);
+    if ( m_mgr ) m_mgr->unwatchSocket(it->first);
     it->second = NULL;
   }
 
@@ -19,6 +19,8 @@
 #include "RpcPacket.h"
 #include "RpcConnection.h"
 #include "NfsUtil.h"
+#include "XdrWriter.h"
+#include "XdrReader.h"
 #include <iostream>
 #include <vector>
 #include <utility>
@@ -40,7 +42,13 @@ int MntCall::encodeArguments()
 {
   RpcPacketPtr request = getRequest();
   if (request)
-    return request->xdrEncodeString((unsigned char*)args, strlen((const char*)args));
+  {
+    uint32 len = strlen((const char*)args);
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(XdrWriter::varOpaqueSize(len)));
+    xdr.putString(args, len);
+    return 0;
+  }
   else
     return -1;
 }
@@ -53,11 +61,13 @@ int MntCall::decodeResults()
   if (reply == NULL)
     return -1;
 
-  RETURN_ON_ERROR(reply->xdrDecodeUint32(&status));
+  XdrReader xdr(reply);
+
+  RETURN_ON_ERROR(xdr.decodeUint32(&status));
   res.fhs_status = (enum mountstat3)status;
   if (status == 0)
   {
-    RETURN_ON_ERROR(NfsUtil::decodeFH3(reply, &res.mountres3_u.mount3_mountinfo.mount3_fhandle));
+    RETURN_ON_ERROR(NfsUtil::decodeFH3(xdr, &res.mountres3_u.mount3_mountinfo.mount3_fhandle));
   }
   return 0;
 }
@@ -70,7 +80,13 @@ int UMountCall::encodeArguments()
 {
   RpcPacketPtr request = getRequest();
   if (request)
-    return request->xdrEncodeString((unsigned char*)args, strlen((const char*)args));
+  {
+    uint32 len = strlen((const char*)args);
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(XdrWriter::varOpaqueSize(len)));
+    xdr.putString(args, len);
+    return 0;
+  }
   return -1;
 }
 
@@ -106,8 +122,10 @@ int DumpCall::decodeResults()
   if (reply == NULL)
     return -1;
 
+  XdrReader xdr(reply);
+
   uint32 entryFollow;
-  RETURN_ON_ERROR(reply->xdrDecodeUint32(&entryFollow));
+  RETURN_ON_ERROR(xdr.decodeUint32(&entryFollow));
 
   /* allocate a buffer large enough to hold all null-teminrated strings */
   m_decodedStringBuffer = new Buffer(reply->getCapacity());
@@ -118,13 +136,13 @@ int DumpCall::decodeResults()
   while (entryFollow != 0)
   {
     char* hostname = reinterpret_cast<char*>(m_decodedStringBuffer->end());
-    RETURN_ON_ERROR(NfsUtil::decodeStringToBuffer(reply, m_decodedStringBuffer));
+    RETURN_ON_ERROR(NfsUtil::decodeStringToBuffer(xdr, m_decodedStringBuffer));
 
     char* pathname = reinterpret_cast<char*>(m_decodedStringBuffer->end());
-    RETURN_ON_ERROR(NfsUtil::decodeStringToBuffer(reply, m_decodedStringBuffer));
+    RETURN_ON_ERROR(NfsUtil::decodeStringToBuffer(xdr, m_decodedStringBuffer));
 
     dumpVec.push_back(std::make_pair(hostname, pathname));
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&entryFollow));
+    RETURN_ON_ERROR(xdr.decodeUint32(&entryFollow));
   }
 
   // populate the result data structure
@@ -175,8 +193,10 @@ int ExportCall::decodeResults()
   if (reply == NULL)
     return -1;
 
+  XdrReader xdr(reply);
+
   uint32 entryFollow;
-  RETURN_ON_ERROR(reply->xdrDecodeUint32(&entryFollow));
+  RETURN_ON_ERROR(xdr.decodeUint32(&entryFollow));
 
   m_decodedStringBuffer = new Buffer(reply->getCapacity());
 
@@ -189,27 +209,27 @@ int ExportCall::decodeResults()
   {
     char* dirName = NULL;
     dirName = reinterpret_cast<char*>(m_decodedStringBuffer->end());
-    RETURN_ON_ERROR(NfsUtil::decodeStringToBuffer(reply, m_decodedStringBuffer));
+    RETURN_ON_ERROR(NfsUtil::decodeStringToBuffer(xdr, m_decodedStringBuffer));
     stringVector.push_back(dirName);
     ++numExports;
 
     uint32 groupfollow = 0;
     syslog(LOG_DEBUG, "ExportCall get export dir=%s\n", dirName);
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&groupfollow));
+    RETURN_ON_ERROR(xdr.decodeUint32(&groupfollow));
     while (groupfollow)
     {
       char* name = NULL;
       name = reinterpret_cast<char*>(m_decodedStringBuffer->end());
-      RETURN_ON_ERROR(NfsUtil::decodeStringToBuffer(reply, m_decodedStringBuffer));
+      RETURN_ON_ERROR(NfsUtil::decodeStringToBuffer(xdr, m_decodedStringBuffer));
       stringVector.push_back(name);
 
       ++numGroups;
 
-      RETURN_ON_ERROR(reply->xdrDecodeUint32(&groupfollow));
+      RETURN_ON_ERROR(xdr.decodeUint32(&groupfollow));
     }
 
     stringVector.push_back(NULL);  // delimiter
-    reply->xdrDecodeUint32(&entryFollow);
+    xdr.decodeUint32(&entryFollow);
   }
 
   if (stringVector.size() > 0)
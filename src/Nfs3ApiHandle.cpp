@@ -398,24 +398,14 @@ bool Nfs3ApiHandle::open(const std::string filePath,
   return false;
 }
 
-bool Nfs3ApiHandle::read(NfsFh       &fileFH,
-                         uint64_t     offset,
-                         uint32_t     length,
-                         std::string &data,
-                         uint32_t    &bytesRead,
-                         bool        &eof,
-                         NfsAttr     &postAttr,
-                         NfsError    &status)
+static bool readResult(enum clnt_stat    readRet,
+                       NFSv3::ReadCall  &nfsReadCall,
+                       std::string      *data,
+                       uint32_t         &bytesRead,
+                       bool             &eof,
+                       NfsAttr          &postAttr,
+                       NfsError         &status)
 {
-  READ3args readArg = {};
-
-  readArg.read3_file.fh3_data.fh3_data_len = fileFH.getLength();
-  readArg.read3_file.fh3_data.fh3_data_val = (char*)fileFH.getData();
-  readArg.read3_offset                     = offset;
-  readArg.read3_count                      = length;
-
-  NFSv3::ReadCall nfsReadCall(readArg);
-  enum clnt_stat readRet = nfsReadCall.call(m_pConn);
   if (readRet != RPC_SUCCESS)
   {
     status.setRpcError(readRet, "Nfs3ApiHandle::read(): read() rpc error");
@@ -432,8 +422,9 @@ bool Nfs3ApiHandle::read(NfsFh       &fileFH,
 
   // copy the read results
   bytesRead = res.READ3res_u.read3ok.read3_count_res;
-  data = std::string(res.READ3res_u.read3ok.read3_data.read3_data_val,
-                     res.READ3res_u.read3ok.read3_data.read3_data_len);
+  if (data)
+    *data = std::string(res.READ3res_u.read3ok.read3_data.read3_data_val,
+                        res.READ3res_u.read3ok.read3_data.read3_data_len);
 
   // return the EOF flag
   eof = res.READ3res_u.read3ok.read3_eof;
@@ -452,6 +443,110 @@ bool Nfs3ApiHandle::read(NfsFh       &fileFH,
   return true;
 }
 
+bool Nfs3ApiHandle::read(NfsFh       &fileFH,
+                         uint64_t     offset,
+                         uint32_t     length,
+                         std::string &data,
+                         uint32_t    &bytesRead,
+                         bool        &eof,
+                         NfsAttr     &postAttr,
+                         NfsError    &status)
+{
+  READ3args readArg = {};
+
+  readArg.read3_file.fh3_data.fh3_data_len = fileFH.getLength();
+  readArg.read3_file.fh3_data.fh3_data_val = (char*)fileFH.getData();
+  readArg.read3_offset                     = offset;
+  readArg.read3_count                      = length;
+
+  NFSv3::ReadCall nfsReadCall(readArg);
+  enum clnt_stat readRet = nfsReadCall.call(m_pConn);
+  return readResult(readRet, nfsReadCall, &data, bytesRead, eof, postAttr, status);
+}
+
+bool Nfs3ApiHandle::read(NfsFh              &fileFH,
+                         uint64_t            offset,
+                         const struct iovec *iov,
+                         int                 iovcnt,
+                         uint32_t           &bytesRead,
+                         bool               &eof,
+                         NfsAttr            &postAttr,
+                         NfsError           &status)
+{
+  READ3args readArg = {};
+
+  uint32_t length = 0;
+  for (int i = 0; i < iovcnt; i++)
+    length += iov[i].iov_len;
+
+  readArg.read3_file.fh3_data.fh3_data_len = fileFH.getLength();
+  readArg.read3_file.fh3_data.fh3_data_val = (char*)fileFH.getData();
+  readArg.read3_offset                     = offset;
+  readArg.read3_count                      = length;
+
+  NFSv3::ReadCall nfsReadCall(readArg, iov, iovcnt);
+  enum clnt_stat readRet = nfsReadCall.call(m_pConn);
+  return readResult(readRet, nfsReadCall, NULL, bytesRead, eof, postAttr, status);
+}
+
+bool Nfs3ApiHandle::readAsync(NfsFh                   &fileFH,
+                              uint64_t                 offset,
+                              uint32_t                 length,
+                              const NfsReadCompletion &done,
+                              NfsError                &status)
+{
+  READ3args readArg = {};
+
+  readArg.read3_file.fh3_data.fh3_data_len = fileFH.getLength();
+  readArg.read3_file.fh3_data.fh3_data_val = (char*)fileFH.getData();
+  readArg.read3_offset                     = offset;
+  readArg.read3_count                      = length;
+
+  NFSv3::ReadCallPtr nfsReadCall = new NFSv3::ReadCall(readArg);
+  NFSv3::ReadCall *pCall = nfsReadCall.ptr();
+  enum clnt_stat readRet = nfsReadCall->callAsync(m_pConn, [pCall, done](enum clnt_stat ret)
+  {
+    std::string data;
+    uint32_t bytesRead = 0;
+    bool eof = false;
+    NfsAttr postAttr;
+    NfsError status;
+    bool ok = readResult(ret, *pCall, &data, bytesRead, eof, postAttr, status);
+    done(ok, data, bytesRead, eof, postAttr, status);
+  });
+
+  if (readRet != RPC_SUCCESS)
+  {
+    status.setRpcError(readRet, "Nfs3ApiHandle::readAsync(): rpc error");
+    return false;
+  }
+  return true;
+}
+
+static bool writeResult(enum clnt_stat    ret,
+                        NFSv3::WriteCall &nfsWriteCall,
+                        uint32_t         &bytesWritten,
+                        NfsError         &status)
+{
+  if ( ret != RPC_SUCCESS )
+  {
+    status.setRpcError(ret, "Nfs3ApiHandle::write(): write() rpc error");
+    return false;
+  }
+
+  WRITE3res &writeRes = nfsWriteCall.getResult();
+  if (writeRes.status != NFS3_OK)
+  {
+    status.setError3(writeRes.status, "Nfs3ApiHandle::write() failed");
+    syslog(LOG_ERR, "Nfs3ApiHandle::write(): nfs_v3_write error: %d\n", writeRes.status);
+    return false;
+  }
+
+  bytesWritten = writeRes.WRITE3res_u.write3ok.write3_count_res;
+
+  return true;
+}
+
 bool Nfs3ApiHandle::write(NfsFh       &fileFH,
                           uint64_t     offset,
                           uint32_t     length,
@@ -471,22 +566,41 @@ bool Nfs3ApiHandle::write(NfsFh       &fileFH,
 
   NFSv3::WriteCall nfsWriteCall(writeArg);
   enum clnt_stat ret = nfsWriteCall.call(m_pConn);
-  if ( ret != RPC_SUCCESS )
+  return writeResult(ret, nfsWriteCall, bytesWritten, status);
+}
+
+bool Nfs3ApiHandle::writeAsync(NfsFh                    &fileFH,
+                               uint64_t                  offset,
+                               uint32_t                  length,
+                               std::string              &data,
+                               const NfsWriteCompletion &done,
+                               NfsError                 &status)
+{
+  WRITE3args writeArg = {};
+
+  writeArg.write3_file.fh3_data.fh3_data_len = fileFH.getLength();
+  writeArg.write3_file.fh3_data.fh3_data_val = (char*)fileFH.getData();
+  writeArg.write3_offset                     = (u_quad_t)offset;
+  writeArg.write3_count                      = length;
+  writeArg.write3_stable                     = STABLE_DATA_SYNC;
+  writeArg.write3_data.write3_data_len       = length;
+  writeArg.write3_data.write3_data_val       = (char*)data.c_str();
+
+  NFSv3::WriteCallPtr nfsWriteCall = new NFSv3::WriteCall(writeArg);
+  NFSv3::WriteCall *pCall = nfsWriteCall.ptr();
+  enum clnt_stat writeRet = nfsWriteCall->callAsync(m_pConn, [pCall, done](enum clnt_stat ret)
   {
-    status.setRpcError(ret, "Nfs3ApiHandle::write(): write() rpc error");
-    return false;
-  }
+    uint32_t bytesWritten = 0;
+    NfsError status;
+    bool ok = writeResult(ret, *pCall, bytesWritten, status);
+    done(ok, bytesWritten, status);
+  });
 
-  WRITE3res &writeRes = nfsWriteCall.getResult();
-  if (writeRes.status != NFS3_OK)
+  if (writeRet != RPC_SUCCESS)
   {
-    status.setError3(writeRes.status, "Nfs3ApiHandle::write() failed");
-    syslog(LOG_ERR, "Nfs3ApiHandle::write(): nfs_v3_write error: %d\n", writeRes.status);
+    status.setRpcError(writeRet, "Nfs3ApiHandle::writeAsync(): rpc error");
     return false;
   }
-
-  bytesWritten = writeRes.WRITE3res_u.write3ok.write3_count_res;
-
   return true;
 }
 
@@ -1243,15 +1357,11 @@ bool Nfs3ApiHandle::setattr(NfsFh &fh, NfsAttr &attr, NfsError &status)
   return true;
 }
 
-bool Nfs3ApiHandle::getAttr(NfsFh &fh, NfsAttr &attr, NfsError &status)
+static bool getAttrResult(enum clnt_stat      getAttrRet,
+                          NFSv3::GetAttrCall &nfsGetattrCall,
+                          NfsAttr            &attr,
+                          NfsError           &status)
 {
-  GETATTR3args getAttrArg = {};
-
-  getAttrArg.getattr3_object.fh3_data.fh3_data_len = fh.getLength();
-  getAttrArg.getattr3_object.fh3_data.fh3_data_val = (char*)fh.getData();
-
-  NFSv3::GetAttrCall nfsGetattrCall(getAttrArg);
-  enum clnt_stat getAttrRet = nfsGetattrCall.call(m_pConn);
   if (getAttrRet != RPC_SUCCESS)
   {
     status.setRpcError(getAttrRet, "Nfs3ApiHandle::getAttr(): rpc error");
@@ -1272,6 +1382,43 @@ bool Nfs3ApiHandle::getAttr(NfsFh &fh, NfsAttr &attr, NfsError &status)
   return true;
 }
 
+bool Nfs3ApiHandle::getAttr(NfsFh &fh, NfsAttr &attr, NfsError &status)
+{
+  GETATTR3args getAttrArg = {};
+
+  getAttrArg.getattr3_object.fh3_data.fh3_data_len = fh.getLength();
+  getAttrArg.getattr3_object.fh3_data.fh3_data_val = (char*)fh.getData();
+
+  NFSv3::GetAttrCall nfsGetattrCall(getAttrArg);
+  enum clnt_stat getAttrRet = nfsGetattrCall.call(m_pConn);
+  return getAttrResult(getAttrRet, nfsGetattrCall, attr, status);
+}
+
+bool Nfs3ApiHandle::getAttrAsync(NfsFh &fh, const NfsGetAttrCompletion &done, NfsError &status)
+{
+  GETATTR3args getAttrArg = {};
+
+  getAttrArg.getattr3_object.fh3_data.fh3_data_len = fh.getLength();
+  getAttrArg.getattr3_object.fh3_data.fh3_data_val = (char*)fh.getData();
+
+  NFSv3::GetAttrCallPtr nfsGetattrCall = new NFSv3::GetAttrCall(getAttrArg);
+  NFSv3::GetAttrCall *pCall = nfsGetattrCall.ptr();
+  enum clnt_stat getAttrRet = nfsGetattrCall->callAsync(m_pConn, [pCall, done](enum clnt_stat ret)
+  {
+    NfsAttr attr;
+    NfsError status;
+    bool ok = getAttrResult(ret, *pCall, attr, status);
+    done(ok, attr, status);
+  });
+
+  if (getAttrRet != RPC_SUCCESS)
+  {
+    status.setRpcError(getAttrRet, "Nfs3ApiHandle::getAttrAsync(): rpc error");
+    return false;
+  }
+  return true;
+}
+
 bool Nfs3ApiHandle::getAttr(const std::string& exp, const std::string& path, NfsAttr& attr, NfsError& status)
 {
   if (path.empty())
@@ -1299,34 +1446,23 @@ bool Nfs3ApiHandle::lookup(const std::string &path, NfsFh &lookup_fh, NfsError &
   return false;
 }
 
-bool Nfs3ApiHandle::lookup(NfsFh             &dirFh,
-                           const std::string &file,
-                           NfsFh             &lookup_fh,
-                           NfsAttr           &attr,
-                           NfsError          &status)
+static bool lookupResult(enum clnt_stat     lkpRet,
+                         NFSv3::LookUpCall &nfsLookupCall,
+                         const std::string &name,
+                         NfsFh             &lookup_fh,
+                         NfsAttr           &attr,
+                         bool              &gotAttributes,
+                         NfsError          &status)
 {
-  if (file.empty())
-  {
-    status.setError(NFSERR_INTERNAL_PATH_EMPTY, "Nfs3ApiHandle::lookup file name can not be empty");
-    return false;
-  }
-
-  LOOKUP3args lkpArg = {};
-
-  lkpArg.lookup3_what.dirop3_dir.fh3_data.fh3_data_len = dirFh.getLength();
-  lkpArg.lookup3_what.dirop3_dir.fh3_data.fh3_data_val = (char*)dirFh.getData();
-  string name = file;
-  lkpArg.lookup3_what.dirop3_name = (char*)name.c_str();
+  gotAttributes = false;
 
-  NFSv3::LookUpCall nfsLookupCall(lkpArg);
-  enum clnt_stat lkpRet = nfsLookupCall.call(m_pConn);
   if (lkpRet != RPC_SUCCESS)
   {
     status.setRpcError(lkpRet, "Nfs3ApiHandle::lookup(): rpc error");
     return false;
   }
 
-  LOOKUP3res res = nfsLookupCall.getResult();
+  LOOKUP3res &res = nfsLookupCall.getResult();
   if (res.status != NFS3_OK)
   {
     if (res.status != NFS3ERR_NOENT)
@@ -1341,8 +1477,6 @@ bool Nfs3ApiHandle::lookup(NfsFh             &dirFh,
   NfsFh fh(fh3->fh3_data.fh3_data_len, fh3->fh3_data.fh3_data_val);
   lookup_fh = fh;
 
-  bool gotAttributes = false;
-
   if (res.LOOKUP3res_u.lookup3ok.lookup3_obj_attributes.attributes_follow)
   {
     attr.Fattr3ToNfsAttr(&(res.LOOKUP3res_u.lookup3ok.lookup3_obj_attributes.post_op_attr_u.post_op_attr));
@@ -1354,6 +1488,35 @@ bool Nfs3ApiHandle::lookup(NfsFh             &dirFh,
     //= res.LOOKUP3res_u.lookup3ok.lookup3_dir_attributes.post_op_attr_u.post_op_attr;
   }
 
+  return true;
+}
+
+bool Nfs3ApiHandle::lookup(NfsFh             &dirFh,
+                           const std::string &file,
+                           NfsFh             &lookup_fh,
+                           NfsAttr           &attr,
+                           NfsError          &status)
+{
+  if (file.empty())
+  {
+    status.setError(NFSERR_INTERNAL_PATH_EMPTY, "Nfs3ApiHandle::lookup file name can not be empty");
+    return false;
+  }
+
+  LOOKUP3args lkpArg = {};
+
+  lkpArg.lookup3_what.dirop3_dir.fh3_data.fh3_data_len = dirFh.getLength();
+  lkpArg.lookup3_what.dirop3_dir.fh3_data.fh3_data_val = (char*)dirFh.getData();
+  string name = file;
+  lkpArg.lookup3_what.dirop3_name = (char*)name.c_str();
+
+  NFSv3::LookUpCall nfsLookupCall(lkpArg);
+  enum clnt_stat lkpRet = nfsLookupCall.call(m_pConn);
+
+  bool gotAttributes = false;
+  if (!lookupResult(lkpRet, nfsLookupCall, name, lookup_fh, attr, gotAttributes, status))
+    return false;
+
   if (gotAttributes)
     return true;
 
@@ -1384,6 +1547,58 @@ bool Nfs3ApiHandle::lookup(NfsFh             &dirFh,
   return true;
 }
 
+bool Nfs3ApiHandle::lookupAsync(NfsFh &dirFh, const std::string &file, const NfsLookupCompletion &done, NfsError &status)
+{
+  if (file.empty())
+  {
+    status.setError(NFSERR_INTERNAL_PATH_EMPTY, "Nfs3ApiHandle::lookupAsync file name can not be empty");
+    return false;
+  }
+
+  LOOKUP3args lkpArg = {};
+
+  lkpArg.lookup3_what.dirop3_dir.fh3_data.fh3_data_len = dirFh.getLength();
+  lkpArg.lookup3_what.dirop3_dir.fh3_data.fh3_data_val = (char*)dirFh.getData();
+  lkpArg.lookup3_what.dirop3_name = (char*)file.c_str();
+
+  NFSv3::LookUpCallPtr nfsLookupCall = new NFSv3::LookUpCall(lkpArg);
+  NFSv3::LookUpCall *pCall = nfsLookupCall.ptr();
+  std::string name = file;
+  // the completion holds the handle and its group, the chained getattr
+  // may run after the caller has let go of both
+  NfsApiHandlePtr self = this;
+  NfsConnectionGroupPtr group = m_pConn;
+  enum clnt_stat lkpRet = nfsLookupCall->callAsync(group, [self, group, pCall, name, done](enum clnt_stat ret) mutable
+  {
+    NfsFh lookup_fh;
+    NfsAttr attr;
+    NfsError status;
+    bool gotAttributes = false;
+    bool ok = lookupResult(ret, *pCall, name, lookup_fh, attr, gotAttributes, status);
+    if (!ok || gotAttributes)
+    {
+      done(ok, lookup_fh, attr, status);
+      return;
+    }
+
+    // no attributes in the reply, chain a getattr for the file handle
+    NfsFh fh = lookup_fh;
+    bool queued = self->getAttrAsync(lookup_fh, [fh, done](bool ok, NfsAttr &attr, NfsError &status) mutable
+    {
+      done(ok, fh, attr, status);
+    }, status);
+    if (!queued)
+      done(false, lookup_fh, attr, status);
+  });
+
+  if (lkpRet != RPC_SUCCESS)
+  {
+    status.setRpcError(lkpRet, "Nfs3ApiHandle::lookupAsync(): rpc error");
+    return false;
+  }
+  return true;
+}
+
 bool Nfs3ApiHandle::lookupPath(const std::string &exp_path,
                                const std::string &pathFromRoot,
                                NfsFh             &lookup_fh,
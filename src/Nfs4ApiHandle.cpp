@@ -50,6 +50,13 @@ static uint32_t statfs_attr[2] = {
    1 << (FATTR4_SPACE_USED - 32))
 };
 
+// compound args are encoded from these after the building function returns,
+// so the masks must outlive it
+static uint32_t write_attr[2] = { 0x00000018, 0x00300000 };
+
+// TODO sarat - change the masks to match v3 attrs
+static uint32_t getattr_attr[2] = { (0x0010011a | (1 << FATTR4_ACL)), 0x00b0a23a };
+
 Nfs4ApiHandle::Nfs4ApiHandle(NfsConnectionGroup *ptr) : NfsApiHandle(ptr)
 {
 }
@@ -1358,18 +1365,8 @@ bool Nfs4ApiHandle::open(const std::string filePath,
   return true;
 }
 
-bool Nfs4ApiHandle::read(NfsFh       &fileFH,
-                         uint64_t     offset,
-                         uint32_t     length,
-                         std::string &data,
-                         uint32_t    &bytesRead,
-                         bool        &eof,
-                         NfsAttr     &postAttr,
-                         NfsError    &status)
+static void buildRead(NFSv4::COMPOUNDCall &compCall, NfsFh &fileFH, uint64_t offset, uint32_t length)
 {
-  NFSv4::COMPOUNDCall compCall;
-  enum clnt_stat cst = RPC_SUCCESS;
-
   nfs_argop4 carg;
 
   carg.argop = OP_PUTFH;
@@ -1396,8 +1393,16 @@ bool Nfs4ApiHandle::read(NfsFh       &fileFH,
   gargs->attr_request.bitmap4_len = 2;
   gargs->attr_request.bitmap4_val = std_attr;
   compCall.appendCommand(&carg);
+}
 
-  cst = compCall.call(m_pConn);
+static bool readResult(enum clnt_stat       cst,
+                       NFSv4::COMPOUNDCall &compCall,
+                       std::string         *data,
+                       uint32_t            &bytesRead,
+                       bool                &eof,
+                       NfsAttr             &postAttr,
+                       NfsError            &status)
+{
   if (cst != RPC_SUCCESS)
   {
     status.setRpcError(cst, "Nfs4ApiHandle::read failed - rpc error");
@@ -1429,7 +1434,8 @@ bool Nfs4ApiHandle::read(NfsFh       &fileFH,
   if (rdres->data.data_len > 0)
   {
     bytesRead = rdres->data.data_len;
-    data = std::string(rdres->data.data_val, rdres->data.data_len);
+    if (data)
+      *data = std::string(rdres->data.data_val, rdres->data.data_len);
   }
 
   index = compCall.findOPIndex(OP_GETATTR);
@@ -1449,16 +1455,74 @@ bool Nfs4ApiHandle::read(NfsFh       &fileFH,
   return true;
 }
 
-bool Nfs4ApiHandle::write(NfsFh       &fileFH,
-                          uint64_t     offset,
-                          uint32_t     length,
-                          std::string &data,
-                          uint32_t    &bytesWritten,
-                          NfsError    &status)
+bool Nfs4ApiHandle::read(NfsFh       &fileFH,
+                         uint64_t     offset,
+                         uint32_t     length,
+                         std::string &data,
+                         uint32_t    &bytesRead,
+                         bool        &eof,
+                         NfsAttr     &postAttr,
+                         NfsError    &status)
 {
   NFSv4::COMPOUNDCall compCall;
-  enum clnt_stat cst = RPC_SUCCESS;
+  buildRead(compCall, fileFH, offset, length);
+
+  enum clnt_stat cst = compCall.call(m_pConn);
+  return readResult(cst, compCall, &data, bytesRead, eof, postAttr, status);
+}
+
+bool Nfs4ApiHandle::read(NfsFh              &fileFH,
+                         uint64_t            offset,
+                         const struct iovec *iov,
+                         int                 iovcnt,
+                         uint32_t           &bytesRead,
+                         bool               &eof,
+                         NfsAttr            &postAttr,
+                         NfsError           &status)
+{
+  uint32_t length = 0;
+  for (int i = 0; i < iovcnt; i++)
+    length += iov[i].iov_len;
+
+  NFSv4::COMPOUNDCall compCall;
+  buildRead(compCall, fileFH, offset, length);
+  compCall.setReadSink(iov, iovcnt);
 
+  enum clnt_stat cst = compCall.call(m_pConn);
+  return readResult(cst, compCall, NULL, bytesRead, eof, postAttr, status);
+}
+
+bool Nfs4ApiHandle::readAsync(NfsFh                   &fileFH,
+                              uint64_t                 offset,
+                              uint32_t                 length,
+                              const NfsReadCompletion &done,
+                              NfsError                &status)
+{
+  NFSv4::COMPOUNDCallPtr compCall = new NFSv4::COMPOUNDCall();
+  buildRead(*compCall, fileFH, offset, length);
+
+  NFSv4::COMPOUNDCall *pCall = compCall.ptr();
+  enum clnt_stat cst = compCall->callAsync(m_pConn, [pCall, done](enum clnt_stat ret)
+  {
+    std::string data;
+    uint32_t bytesRead = 0;
+    bool eof = false;
+    NfsAttr postAttr;
+    NfsError status;
+    bool ok = readResult(ret, *pCall, &data, bytesRead, eof, postAttr, status);
+    done(ok, data, bytesRead, eof, postAttr, status);
+  });
+
+  if (cst != RPC_SUCCESS)
+  {
+    status.setRpcError(cst, "Nfs4ApiHandle::readAsync failed - rpc error");
+    return false;
+  }
+  return true;
+}
+
+static void buildWrite(NFSv4::COMPOUNDCall &compCall, NfsFh &fileFH, uint64_t offset, uint32_t length, std::string &data)
+{
   nfs_argop4 carg;
 
   carg.argop = OP_PUTFH;
@@ -1484,13 +1548,16 @@ bool Nfs4ApiHandle::write(NfsFh       &fileFH,
 
   carg.argop = OP_GETATTR;
   GETATTR4args *gargs = &carg.nfs_argop4_u.opgetattr;
-  uint32_t mask[2];
-  mask[0] = 0x00000018; mask[1] = 0x00300000;
   gargs->attr_request.bitmap4_len = 2;
-  gargs->attr_request.bitmap4_val = mask;
+  gargs->attr_request.bitmap4_val = write_attr;
   compCall.appendCommand(&carg);
+}
 
-  cst = compCall.call(m_pConn);
+static bool writeResult(enum clnt_stat       cst,
+                        NFSv4::COMPOUNDCall &compCall,
+                        uint32_t            &bytesWritten,
+                        NfsError            &status)
+{
   if (cst != RPC_SUCCESS)
   {
     status.setRpcError(cst, "Nfs4ApiHandle::write failed - rpc error");
@@ -1518,6 +1585,47 @@ bool Nfs4ApiHandle::write(NfsFh       &fileFH,
   return true;
 }
 
+bool Nfs4ApiHandle::write(NfsFh       &fileFH,
+                          uint64_t     offset,
+                          uint32_t     length,
+                          std::string &data,
+                          uint32_t    &bytesWritten,
+                          NfsError    &status)
+{
+  NFSv4::COMPOUNDCall compCall;
+  buildWrite(compCall, fileFH, offset, length, data);
+
+  enum clnt_stat cst = compCall.call(m_pConn);
+  return writeResult(cst, compCall, bytesWritten, status);
+}
+
+bool Nfs4ApiHandle::writeAsync(NfsFh                    &fileFH,
+                               uint64_t                  offset,
+                               uint32_t                  length,
+                               std::string              &data,
+                               const NfsWriteCompletion &done,
+                               NfsError                 &status)
+{
+  NFSv4::COMPOUNDCallPtr compCall = new NFSv4::COMPOUNDCall();
+  buildWrite(*compCall, fileFH, offset, length, data);
+
+  NFSv4::COMPOUNDCall *pCall = compCall.ptr();
+  enum clnt_stat cst = compCall->callAsync(m_pConn, [pCall, done](enum clnt_stat ret)
+  {
+    uint32_t bytesWritten = 0;
+    NfsError status;
+    bool ok = writeResult(ret, *pCall, bytesWritten, status);
+    done(ok, bytesWritten, status);
+  });
+
+  if (cst != RPC_SUCCESS)
+  {
+    status.setRpcError(cst, "Nfs4ApiHandle::writeAsync failed - rpc error");
+    return false;
+  }
+  return true;
+}
+
 bool Nfs4ApiHandle::write_unstable(NfsFh       &fileFH,
                                    uint64_t     offset,
                                    std::string &data,
@@ -2201,17 +2309,8 @@ bool Nfs4ApiHandle::unlock(NfsFh &fh, uint32_t lockType, uint64_t offset, uint64
   return true;
 }
 
-bool Nfs4ApiHandle::lookup(NfsFh &dirFh, const std::string &file, NfsFh &lookup_fh, NfsAttr &attr, NfsError &status)
+static void buildLookup(NFSv4::COMPOUNDCall &compCall, NfsFh &dirFh, const std::string &file)
 {
-  if (file.empty())
-  {
-    status.setError(NFSERR_INTERNAL_PATH_EMPTY, "Nfs4ApiHandle::lookup file can not be empty");
-    return false;
-  }
-
-  NFSv4::COMPOUNDCall compCall;
-  enum clnt_stat cst = RPC_SUCCESS;
-
   nfs_argop4 carg;
 
   carg.argop = OP_PUTFH;
@@ -2234,8 +2333,14 @@ bool Nfs4ApiHandle::lookup(NfsFh &dirFh, const std::string &file, NfsFh &lookup_
 
   carg.argop = OP_GETFH;
   compCall.appendCommand(&carg);
+}
 
-  cst = compCall.call(m_pConn);
+static bool lookupResult(enum clnt_stat       cst,
+                         NFSv4::COMPOUNDCall &compCall,
+                         NfsFh               &lookup_fh,
+                         NfsAttr             &attr,
+                         NfsError            &status)
+{
   if (cst != RPC_SUCCESS)
   {
     status.setRpcError(cst, "Nfs4ApiHandle::lookup failed - rpc error");
@@ -2280,6 +2385,50 @@ bool Nfs4ApiHandle::lookup(NfsFh &dirFh, const std::string &file, NfsFh &lookup_
   return true;
 }
 
+bool Nfs4ApiHandle::lookup(NfsFh &dirFh, const std::string &file, NfsFh &lookup_fh, NfsAttr &attr, NfsError &status)
+{
+  if (file.empty())
+  {
+    status.setError(NFSERR_INTERNAL_PATH_EMPTY, "Nfs4ApiHandle::lookup file can not be empty");
+    return false;
+  }
+
+  NFSv4::COMPOUNDCall compCall;
+  buildLookup(compCall, dirFh, file);
+
+  enum clnt_stat cst = compCall.call(m_pConn);
+  return lookupResult(cst, compCall, lookup_fh, attr, status);
+}
+
+bool Nfs4ApiHandle::lookupAsync(NfsFh &dirFh, const std::string &file, const NfsLookupCompletion &done, NfsError &status)
+{
+  if (file.empty())
+  {
+    status.setError(NFSERR_INTERNAL_PATH_EMPTY, "Nfs4ApiHandle::lookupAsync file can not be empty");
+    return false;
+  }
+
+  NFSv4::COMPOUNDCallPtr compCall = new NFSv4::COMPOUNDCall();
+  buildLookup(*compCall, dirFh, file);
+
+  NFSv4::COMPOUNDCall *pCall = compCall.ptr();
+  enum clnt_stat cst = compCall->callAsync(m_pConn, [pCall, done](enum clnt_stat ret)
+  {
+    NfsFh lookup_fh;
+    NfsAttr attr;
+    NfsError status;
+    bool ok = lookupResult(ret, *pCall, lookup_fh, attr, status);
+    done(ok, lookup_fh, attr, status);
+  });
+
+  if (cst != RPC_SUCCESS)
+  {
+    status.setRpcError(cst, "Nfs4ApiHandle::lookupAsync failed - rpc error");
+    return false;
+  }
+  return true;
+}
+
 bool Nfs4ApiHandle::lookup(const std::string &path, NfsFh &lookup_fh, NfsError &status)
 {
   if (path.empty())
@@ -2478,11 +2627,8 @@ bool Nfs4ApiHandle::fileExists(const std::string& exp, const std::string& path,
   return sts;
 }
 
-bool Nfs4ApiHandle::getAttr(NfsFh &fh, NfsAttr &attr, NfsError &status)
+static void buildGetAttr(NFSv4::COMPOUNDCall &compCall, NfsFh &fh)
 {
-  NFSv4::COMPOUNDCall compCall;
-  enum clnt_stat cst = RPC_SUCCESS;
-
   nfs_argop4 carg;
 
   carg.argop = OP_PUTFH;
@@ -2493,12 +2639,16 @@ bool Nfs4ApiHandle::getAttr(NfsFh &fh, NfsAttr &attr, NfsError &status)
 
   carg.argop = OP_GETATTR;
   GETATTR4args *gargs = &carg.nfs_argop4_u.opgetattr;
-  uint32_t mask[2] = {0}; mask[0] = (0x0010011a | (1 << FATTR4_ACL)); mask[1] = 0x00b0a23a; // TODO sarat - change the masks to match v3 attrs
   gargs->attr_request.bitmap4_len = 2;
-  gargs->attr_request.bitmap4_val = mask;
+  gargs->attr_request.bitmap4_val = getattr_attr;
   compCall.appendCommand(&carg);
+}
 
-  cst = compCall.call(m_pConn);
+static bool getAttrResult(enum clnt_stat       cst,
+                          NFSv4::COMPOUNDCall &compCall,
+                          NfsAttr             &attr,
+                          NfsError            &status)
+{
   if (cst != RPC_SUCCESS)
   {
     status.setRpcError(cst, "Nfs4ApiHandle::getAttr failed - rpc error");
@@ -2533,6 +2683,37 @@ bool Nfs4ApiHandle::getAttr(NfsFh &fh, NfsAttr &attr, NfsError &status)
   return true;
 }
 
+bool Nfs4ApiHandle::getAttr(NfsFh &fh, NfsAttr &attr, NfsError &status)
+{
+  NFSv4::COMPOUNDCall compCall;
+  buildGetAttr(compCall, fh);
+
+  enum clnt_stat cst = compCall.call(m_pConn);
+  return getAttrResult(cst, compCall, attr, status);
+}
+
+bool Nfs4ApiHandle::getAttrAsync(NfsFh &fh, const NfsGetAttrCompletion &done, NfsError &status)
+{
+  NFSv4::COMPOUNDCallPtr compCall = new NFSv4::COMPOUNDCall();
+  buildGetAttr(*compCall, fh);
+
+  NFSv4::COMPOUNDCall *pCall = compCall.ptr();
+  enum clnt_stat cst = compCall->callAsync(m_pConn, [pCall, done](enum clnt_stat ret)
+  {
+    NfsAttr attr;
+    NfsError status;
+    bool ok = getAttrResult(ret, *pCall, attr, status);
+    done(ok, attr, status);
+  });
+
+  if (cst != RPC_SUCCESS)
+  {
+    status.setRpcError(cst, "Nfs4ApiHandle::getAttrAsync failed - rpc error");
+    return false;
+  }
+  return true;
+}
+
 bool Nfs4ApiHandle::getAttr(const std::string& exp, const std::string& path, NfsAttr& attr, NfsError& status)
 {
   NfsFh tmpFh;
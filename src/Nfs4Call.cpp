@@ -19,6 +19,8 @@
 #include "RpcPacket.h"
 #include "RpcConnection.h"
 #include "NfsUtil.h"
+#include "XdrWriter.h"
+#include "XdrReader.h"
 #include "RpcDefs.h"
 
 #include <iostream>
@@ -32,12 +34,86 @@ namespace NFSv4 {
     RpcPacketPtr reply = getReply();                  \
     if (reply == NULL)                                \
         return -1;                                    \
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&status)); \
+    XdrReader xdr(reply);                             \
+    RETURN_ON_ERROR(xdr.decodeUint32(&status));       \
     res.status = (nfsstat3)status;
 
 
+// the masks are malloc'd, freed with the result
+static int decodeBitmap(XdrReader& xdr, bitmap4* bitmap)
+{
+  uint32 len = 0;
+  RETURN_ON_ERROR(xdr.decodeUint32(&len));
+  if (len > xdr.remaining() / 4)
+    return -1;
+
+  bitmap->bitmap4_len = len;
+  bitmap->bitmap4_val = (uint32_t *)malloc(len * sizeof(uint32));
+  if (bitmap->bitmap4_val == NULL)
+    return -1;
+  xdr.getUint32Array(bitmap->bitmap4_val, len);
+  return 0;
+}
+
+int ReadSink::locatePayload(const unsigned char* rec, uint32 len, uint32& offset, uint32& length)
+{
+  uint32 off = 0;
+  uint32 val = 0;
+  uint32 numOps = 0;
+  int outcome = skipReplyHeader(rec, len, off);
+  if (outcome != 0)
+    return outcome;
+
+  // compound status
+  if (getUint32(rec, len, off, val) != 0)
+    return 1;
+  if (val != NFS4_OK)
+    return -1;
+  off += sizeof(uint32);
+
+  // tag
+  if (getUint32(rec, len, off, val) != 0)
+    return 1;
+  off += sizeof(uint32) + ((val + 3) & ~3);
+
+  if (getUint32(rec, len, off, numOps) != 0)
+    return 1;
+  off += sizeof(uint32);
+
+  for (uint32 i = 0; i < numOps; i++)
+  {
+    uint32 op = 0;
+    if (getUint32(rec, len, off, op) != 0)
+      return 1;
+    off += sizeof(uint32);
+
+    if (getUint32(rec, len, off, val) != 0)
+      return 1;
+    if (val != NFS4_OK)
+      return -1;
+    off += sizeof(uint32);
+
+    if (op == OP_PUTFH)
+      continue;
+    if (op != OP_READ)
+      return -1;
+
+    // eof, then the data length
+    off += sizeof(uint32);
+    if (getUint32(rec, len, off, val) != 0)
+      return 1;
+    off += sizeof(uint32);
+
+    offset = off;
+    length = val;
+    return 0;
+  }
+
+  return -1;
+}
+
 COMPOUNDCall::COMPOUNDCall():
-  RemoteCall(NFS, NFSPROC4_COMPOUND),args(),res()
+  RemoteCall(NFS, NFSPROC4_COMPOUND),args(),res(),m_readSink(NULL)
 {
   args.minorversion = 0;
   args.argarray.argarray_len = 0;
@@ -45,7 +121,7 @@ COMPOUNDCall::COMPOUNDCall():
 }
 
 COMPOUNDCall::COMPOUNDCall(const COMPOUND4args& arg):
-  RemoteCall(NFS, NFSPROC4_COMPOUND),args(arg),res()
+  RemoteCall(NFS, NFSPROC4_COMPOUND),args(arg),res(),m_readSink(NULL)
 {
   args.minorversion = 0;
 }
@@ -106,7 +182,6 @@ void COMPOUNDCall::freeRes(nfs_resop4 *res)
     {
       fattr4 *R = &res->nfs_resop4_u.opgetattr.GETATTR4res_u.resok4.obj_attributes;
       free(R->attrmask.bitmap4_val);
-      free(R->attr_vals.attrlist4_val);
     }
     break;
     case OP_READDIR:
@@ -116,7 +191,6 @@ void COMPOUNDCall::freeRes(nfs_resop4 *res)
       while (entry)
       {
         free(entry->attrs.attrmask.bitmap4_val);
-        free(entry->attrs.attr_vals.attrlist4_val);
         entry4 *tmp = entry;
         entry = entry->nextentry;
         free(tmp);
@@ -168,20 +242,31 @@ COMPOUNDCall::appendCommand(const nfs_argop4 *cmd)
 COMPOUNDCall::~COMPOUNDCall()
 {
   clear();
+  if (m_readSink)
+    delete m_readSink;
+}
+
+void COMPOUNDCall::setReadSink(const struct iovec* iov, int iovcnt)
+{
+  if (m_readSink)
+    delete m_readSink;
+  m_readSink = new ReadSink(iov, iovcnt);
+  setReplySink(m_readSink);
 }
 
 int
-COMPOUNDCall::encode_OP_ACCESS(RpcPacketPtr request, const ACCESS4args *arg)
+COMPOUNDCall::encode_OP_ACCESS(XdrWriter& xdr, const ACCESS4args *arg)
 {
-  RETURN_ON_ERROR(request->xdrEncodeUint32(arg->access));
+  RETURN_ON_ERROR(xdr.reserve(4));
+  xdr.putUint32(arg->access);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_ACCESS(RpcPacketPtr packet, ACCESS4res *res)
+COMPOUNDCall::decode_OP_ACCESS(XdrReader& xdr, ACCESS4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
@@ -190,8 +275,8 @@ COMPOUNDCall::decode_OP_ACCESS(RpcPacketPtr packet, ACCESS4res *res)
   uint32_t supported=0;
   uint32_t access=0;
 
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&supported));
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&access));
+  RETURN_ON_ERROR(xdr.decodeUint32(&supported));
+  RETURN_ON_ERROR(xdr.decodeUint32(&access));
 
   res->ACCESS4res_u.resok4.supported=supported;
   res->ACCESS4res_u.resok4.access=access;
@@ -200,209 +285,178 @@ COMPOUNDCall::decode_OP_ACCESS(RpcPacketPtr packet, ACCESS4res *res)
 }
 
 int
-COMPOUNDCall::encode_OP_CLOSE(RpcPacketPtr packet, const CLOSE4args *arg)
+COMPOUNDCall::encode_OP_CLOSE(XdrWriter& xdr, const CLOSE4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->seqid));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->open_stateid.seqid));
-  RETURN_ON_ERROR(packet->xdrEncodeFixedOpaque((void*)arg->open_stateid.other, 12));
+  RETURN_ON_ERROR(xdr.reserve(4 + 4 + 12));
+  xdr.putUint32(arg->seqid);
+  xdr.putUint32(arg->open_stateid.seqid);
+  xdr.putFixedOpaque(arg->open_stateid.other, 12);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_CLOSE(RpcPacketPtr packet, CLOSE4res *res)
+COMPOUNDCall::decode_OP_CLOSE(XdrReader& xdr, CLOSE4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
     return 0;
 
   uint32 seqid = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&seqid));
+  RETURN_ON_ERROR(xdr.decodeUint32(&seqid));
   res->CLOSE4res_u.open_stateid.seqid = seqid;
-  RETURN_ON_ERROR(packet->xdrDecodeFixedOpaque((unsigned char*)res->CLOSE4res_u.open_stateid.other, 12));
+  RETURN_ON_ERROR(xdr.decodeFixedOpaque((unsigned char*)res->CLOSE4res_u.open_stateid.other, 12));
 
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_COMMIT(RpcPacketPtr packet, const COMMIT4args *arg)
+COMPOUNDCall::encode_OP_COMMIT(XdrWriter& xdr, const COMMIT4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->offset));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->count));
+  RETURN_ON_ERROR(xdr.reserve(8 + 4));
+  xdr.putUint64(arg->offset);
+  xdr.putUint32(arg->count);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_COMMIT(RpcPacketPtr packet, COMMIT4res *res)
+COMPOUNDCall::decode_OP_COMMIT(XdrReader& xdr, COMMIT4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
     return 0;
 
   verifier4 cookieverf;
-  RETURN_ON_ERROR(packet->xdrDecodeFixedOpaque((unsigned char*)&cookieverf, NFS4_VERIFIER_SIZE));
+  RETURN_ON_ERROR(xdr.decodeFixedOpaque((unsigned char*)&cookieverf, NFS4_VERIFIER_SIZE));
   memcpy(res->COMMIT4res_u.resok4.writeverf, cookieverf, NFS4_VERIFIER_SIZE);
 
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_CREATE(RpcPacketPtr packet, const CREATE4args *arg)
+COMPOUNDCall::encode_OP_CREATE(XdrWriter& xdr, const CREATE4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->objtype.type));
+  RETURN_ON_ERROR(xdr.reserve(4 + XdrWriter::varOpaqueSize(arg->objname.utf8string_len) + NfsUtil::fattr4MaxSize(&arg->createattrs)));
+  xdr.putUint32(arg->objtype.type);
   //TODO sarat - linkdata and devdata are to be used ??
-  RETURN_ON_ERROR(packet->xdrEncodeString((unsigned char*)arg->objname.utf8string_val, arg->objname.utf8string_len ));
+  xdr.putString(arg->objname.utf8string_val, arg->objname.utf8string_len );
 
-  RETURN_ON_ERROR(NfsUtil::encode_fattr4(packet, &(arg->createattrs)));
+  NfsUtil::encode_fattr4(xdr, &(arg->createattrs));
 
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_CREATE(RpcPacketPtr packet, CREATE4res *res)
+COMPOUNDCall::decode_OP_CREATE(XdrReader& xdr, CREATE4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
     return 0;
 
   uint32 atmc = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&atmc));
+  RETURN_ON_ERROR(xdr.decodeUint32(&atmc));
   res->CREATE4res_u.resok4.cinfo.atomic = atmc;
 
   uint64 val = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint64(&val));
+  RETURN_ON_ERROR(xdr.decodeUint64(&val));
   res->CREATE4res_u.resok4.cinfo.before = val;
   val = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint64(&val));
+  RETURN_ON_ERROR(xdr.decodeUint64(&val));
   res->CREATE4res_u.resok4.cinfo.after = val;
 
-  uint32 bitmapLen = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&bitmapLen));
-  res->CREATE4res_u.resok4.attrset.bitmap4_len = bitmapLen;
-
-  res->CREATE4res_u.resok4.attrset.bitmap4_val = (uint32*)malloc(bitmapLen * sizeof(uint32));
-  if (res->CREATE4res_u.resok4.attrset.bitmap4_val == NULL)
-    return -1;
-
-  for (unsigned i = 0; i < bitmapLen; i++)
-  {
-    uint32 mask = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint32(&mask));
-    res->CREATE4res_u.resok4.attrset.bitmap4_val[i] = mask;
-  }
+  RETURN_ON_ERROR(decodeBitmap(xdr, &res->CREATE4res_u.resok4.attrset));
 
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_DELEGPURGE(RpcPacketPtr packet, const DELEGPURGE4args *arg)
+COMPOUNDCall::encode_OP_DELEGPURGE(XdrWriter& xdr, const DELEGPURGE4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint64((uint64)arg->clientid));
+  RETURN_ON_ERROR(xdr.reserve(8));
+  xdr.putUint64((uint64)arg->clientid);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_DELEGPURGE(RpcPacketPtr packet, DELEGPURGE4res *res)
+COMPOUNDCall::decode_OP_DELEGPURGE(XdrReader& xdr, DELEGPURGE4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_DELEGRETURN(RpcPacketPtr packet, const DELEGRETURN4args *arg)
+COMPOUNDCall::encode_OP_DELEGRETURN(XdrWriter& xdr, const DELEGRETURN4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->deleg_stateid.seqid));
-  RETURN_ON_ERROR(packet->xdrEncodeFixedOpaque((void*)arg->deleg_stateid.other, 12));
+  RETURN_ON_ERROR(xdr.reserve(4 + 12));
+  xdr.putUint32(arg->deleg_stateid.seqid);
+  xdr.putFixedOpaque(arg->deleg_stateid.other, 12);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_DELEGRETURN(RpcPacketPtr packet, DELEGRETURN4res *res)
+COMPOUNDCall::decode_OP_DELEGRETURN(XdrReader& xdr, DELEGRETURN4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_GETATTR(RpcPacketPtr request, const GETATTR4args *arg)
+COMPOUNDCall::encode_OP_GETATTR(XdrWriter& xdr, const GETATTR4args *arg)
 {
-  RETURN_ON_ERROR(request->xdrEncodeUint32(arg->attr_request.bitmap4_len));
-  uint32_t *mask = arg->attr_request.bitmap4_val;
-  for (unsigned i = 0; i < arg->attr_request.bitmap4_len; i++)
-  {
-    RETURN_ON_ERROR(request->xdrEncodeUint32(*mask));
-    mask++;
-  }
+  RETURN_ON_ERROR(xdr.reserve(4 + 4 * arg->attr_request.bitmap4_len));
+  xdr.putUint32(arg->attr_request.bitmap4_len);
+  xdr.putUint32Array(arg->attr_request.bitmap4_val, arg->attr_request.bitmap4_len);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_GETATTR(RpcPacketPtr packet, GETATTR4res *res)
+COMPOUNDCall::decode_OP_GETATTR(XdrReader& xdr, GETATTR4res *res)
 {
   uint32 opSts;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
     return 0;
 
-  uint32 bitMapLength = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&bitMapLength));
-
   bitmap4 *bitmap = &(res->GETATTR4res_u.resok4.obj_attributes.attrmask);
   attrlist4 *attrList = &(res->GETATTR4res_u.resok4.obj_attributes.attr_vals);
 
-  bitmap->bitmap4_len = bitMapLength;
-  bitmap->bitmap4_val = (uint32_t *)malloc(bitMapLength * sizeof(uint32));
-  if (bitmap->bitmap4_val == NULL)
-    return -1;
-
-  for (unsigned i = 0; i < bitMapLength; i++)
-  {
-    uint32 mask = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint32(&mask));
-    bitmap->bitmap4_val[i] = mask;
-  }
+  RETURN_ON_ERROR(decodeBitmap(xdr, bitmap));
 
+  // the attrs stay in the reply, NfsUtil::decode_fattr4 reads them there
+  unsigned char* attrs = NULL;
   uint32 attrLength = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&attrLength));
+  RETURN_ON_ERROR(xdr.decodeString(attrs, attrLength));
+  attrList->attrlist4_val = (char*)attrs;
   attrList->attrlist4_len = attrLength;
 
-  if (packet->getUnparsedDataSize() < attrLength)
-    return -1;
-
-  attrList->attrlist4_val = (char *) malloc(attrLength);
-  if (attrList->attrlist4_val == NULL)
-    return -1;
-
-  RETURN_ON_ERROR(packet->xdrGetRawData((unsigned char *)attrList->attrlist4_val, attrLength));
-
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_GETFH(RpcPacketPtr packet)
+COMPOUNDCall::encode_OP_GETFH(XdrWriter& xdr)
 {
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_GETFH(RpcPacketPtr packet, GETFH4res *res)
+COMPOUNDCall::decode_OP_GETFH(XdrReader& xdr, GETFH4res *res)
 {
   uint32 status;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&status));
+  RETURN_ON_ERROR(xdr.decodeUint32(&status));
 
   res->status = (nfsstat4)status;
   if (status != NFS4_OK)
@@ -410,111 +464,114 @@ COMPOUNDCall::decode_OP_GETFH(RpcPacketPtr packet, GETFH4res *res)
 
   unsigned char* str = NULL;
   uint32 len = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeString(str, len));
+  RETURN_ON_ERROR(xdr.decodeString(str, len));
   res->GETFH4res_u.resok4.object.nfs_fh4_len = len;
   res->GETFH4res_u.resok4.object.nfs_fh4_val = (char*)str;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_LINK(RpcPacketPtr packet, const LINK4args *arg)
+COMPOUNDCall::encode_OP_LINK(XdrWriter& xdr, const LINK4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeString((unsigned char*)arg->newname.utf8string_val,
-                                          arg->newname.utf8string_len));
+  RETURN_ON_ERROR(xdr.reserve(XdrWriter::varOpaqueSize(arg->newname.utf8string_len)));
+  xdr.putString(arg->newname.utf8string_val,
+                arg->newname.utf8string_len);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_LINK(RpcPacketPtr packet, LINK4res *res)
+COMPOUNDCall::decode_OP_LINK(XdrReader& xdr, LINK4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
     return 0;
 
   bool_t sato;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32((unsigned int*)&sato));
+  RETURN_ON_ERROR(xdr.decodeUint32((unsigned int*)&sato));
   res->LINK4res_u.resok4.cinfo.atomic = sato;
 
   uint64 sbefo;
-  RETURN_ON_ERROR(packet->xdrDecodeUint64(&sbefo));
+  RETURN_ON_ERROR(xdr.decodeUint64(&sbefo));
   res->LINK4res_u.resok4.cinfo.before = sbefo;
 
   uint64 safte;
-  RETURN_ON_ERROR(packet->xdrDecodeUint64(&safte));
+  RETURN_ON_ERROR(xdr.decodeUint64(&safte));
   res->LINK4res_u.resok4.cinfo.after = safte;
 
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_LOCK(RpcPacketPtr packet, const LOCK4args *arg)
+COMPOUNDCall::encode_OP_LOCK(XdrWriter& xdr, const LOCK4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->locktype));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->reclaim));
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->offset));
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->length));
+  RETURN_ON_ERROR(xdr.reserve(4 + 4 + 8 + 8 + 4 + 4 + 4 + 12 + 4 + 8 +
+                              XdrWriter::varOpaqueSize(arg->locker.locker4_u.open_owner.lock_owner.owner.owner_len)));
+  xdr.putUint32(arg->locktype);
+  xdr.putUint32(arg->reclaim);
+  xdr.putUint64(arg->offset);
+  xdr.putUint64(arg->length);
 
   // encode the lock owner
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->locker.new_lock_owner));
+  xdr.putUint32(arg->locker.new_lock_owner);
   if (arg->locker.new_lock_owner)
   {
     // encode the state id and sequence id
-    RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->locker.locker4_u.open_owner.open_seqid));
-    RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->locker.locker4_u.open_owner.open_stateid.seqid));
-    RETURN_ON_ERROR(packet->xdrEncodeFixedOpaque((void*)arg->locker.locker4_u.open_owner.open_stateid.other, 12));
-    RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->locker.locker4_u.open_owner.lock_seqid));
+    xdr.putUint32(arg->locker.locker4_u.open_owner.open_seqid);
+    xdr.putUint32(arg->locker.locker4_u.open_owner.open_stateid.seqid);
+    xdr.putFixedOpaque(arg->locker.locker4_u.open_owner.open_stateid.other, 12);
+    xdr.putUint32(arg->locker.locker4_u.open_owner.lock_seqid);
     // encode the owner details
-    RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->locker.locker4_u.open_owner.lock_owner.clientid));
-    RETURN_ON_ERROR(packet->xdrEncodeString((unsigned char *)arg->locker.locker4_u.open_owner.lock_owner.owner.owner_val,
-                                            arg->locker.locker4_u.open_owner.lock_owner.owner.owner_len));
+    xdr.putUint64(arg->locker.locker4_u.open_owner.lock_owner.clientid);
+    xdr.putString(arg->locker.locker4_u.open_owner.lock_owner.owner.owner_val,
+                  arg->locker.locker4_u.open_owner.lock_owner.owner.owner_len);
   }
   else
   {
-    RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->locker.locker4_u.lock_owner.lock_stateid.seqid));
-    RETURN_ON_ERROR(packet->xdrEncodeFixedOpaque((void*)arg->locker.locker4_u.lock_owner.lock_stateid.other, 12));
-    RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->locker.locker4_u.lock_owner.lock_seqid));
+    xdr.putUint32(arg->locker.locker4_u.lock_owner.lock_stateid.seqid);
+    xdr.putFixedOpaque(arg->locker.locker4_u.lock_owner.lock_stateid.other, 12);
+    xdr.putUint32(arg->locker.locker4_u.lock_owner.lock_seqid);
   }
 
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_LOCK(RpcPacketPtr packet, LOCK4res *res)
+COMPOUNDCall::decode_OP_LOCK(XdrReader& xdr, LOCK4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
 
   if (res->status == NFS4_OK)
   {
-    RETURN_ON_ERROR(packet->xdrDecodeUint32(&(res->LOCK4res_u.resok4.lock_stateid.seqid)));
-    RETURN_ON_ERROR(packet->xdrDecodeFixedOpaque((unsigned char*)res->LOCK4res_u.resok4.lock_stateid.other, 12));
+    RETURN_ON_ERROR(xdr.decodeUint32(&(res->LOCK4res_u.resok4.lock_stateid.seqid)));
+    RETURN_ON_ERROR(xdr.decodeFixedOpaque((unsigned char*)res->LOCK4res_u.resok4.lock_stateid.other, 12));
   }
   else if (res->status == NFS4ERR_DENIED)
   {
     uint64 value = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint64(&value));
+    RETURN_ON_ERROR(xdr.decodeUint64(&value));
     res->LOCK4res_u.denied.offset = value;
 
     value = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint64(&value));
+    RETURN_ON_ERROR(xdr.decodeUint64(&value));
     res->LOCK4res_u.denied.length = value;
 
     uint32 ltype = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint32(&ltype));
+    RETURN_ON_ERROR(xdr.decodeUint32(&ltype));
     res->LOCK4res_u.denied.locktype = (nfs_lock_type4) ltype;
 
     value = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint64(&value));
+    RETURN_ON_ERROR(xdr.decodeUint64(&value));
     res->LOCK4res_u.denied.owner.clientid = value;
 
     unsigned char* str = NULL;
     uint32 len = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeString(str, len));
+    RETURN_ON_ERROR(xdr.decodeString(str, len));
     res->LOCK4res_u.denied.owner.owner.owner_len = len;
     res->LOCK4res_u.denied.owner.owner.owner_val = (char*)str;
   }
@@ -523,46 +580,47 @@ COMPOUNDCall::decode_OP_LOCK(RpcPacketPtr packet, LOCK4res *res)
 }
 
 int
-COMPOUNDCall::encode_OP_LOCKT(RpcPacketPtr packet, const LOCKT4args *arg)
+COMPOUNDCall::encode_OP_LOCKT(XdrWriter& xdr, const LOCKT4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->locktype));
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->offset));
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->length));
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->owner.clientid));
-  RETURN_ON_ERROR(packet->xdrEncodeString((unsigned char *)arg->owner.owner.owner_val,
-                                          arg->owner.owner.owner_len));
+  RETURN_ON_ERROR(xdr.reserve(4 + 8 + 8 + 8 + XdrWriter::varOpaqueSize(arg->owner.owner.owner_len)));
+  xdr.putUint32(arg->locktype);
+  xdr.putUint64(arg->offset);
+  xdr.putUint64(arg->length);
+  xdr.putUint64(arg->owner.clientid);
+  xdr.putString(arg->owner.owner.owner_val,
+                arg->owner.owner.owner_len);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_LOCKT(RpcPacketPtr packet, LOCKT4res *res)
+COMPOUNDCall::decode_OP_LOCKT(XdrReader& xdr, LOCKT4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
 
   if (res->status == NFS4ERR_DENIED)
   {
     uint64 value = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint64(&value));
+    RETURN_ON_ERROR(xdr.decodeUint64(&value));
     res->LOCKT4res_u.denied.offset = value;
 
     value = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint64(&value));
+    RETURN_ON_ERROR(xdr.decodeUint64(&value));
     res->LOCKT4res_u.denied.length = value;
 
     uint32 ltype = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint32(&ltype));
+    RETURN_ON_ERROR(xdr.decodeUint32(&ltype));
     res->LOCKT4res_u.denied.locktype = (nfs_lock_type4) ltype;
 
     value = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint64(&value));
+    RETURN_ON_ERROR(xdr.decodeUint64(&value));
     res->LOCKT4res_u.denied.owner.clientid = value;
 
     unsigned char* str = NULL;
     uint32 len = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeString(str, len));
+    RETURN_ON_ERROR(xdr.decodeString(str, len));
     res->LOCKT4res_u.denied.owner.owner.owner_len = len;
     res->LOCKT4res_u.denied.owner.owner.owner_val = (char*)str;
   }
@@ -571,47 +629,49 @@ COMPOUNDCall::decode_OP_LOCKT(RpcPacketPtr packet, LOCKT4res *res)
 }
 
 int
-COMPOUNDCall::encode_OP_LOCKU(RpcPacketPtr packet, const LOCKU4args *arg)
+COMPOUNDCall::encode_OP_LOCKU(XdrWriter& xdr, const LOCKU4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->locktype));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->seqid));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->lock_stateid.seqid));
-  RETURN_ON_ERROR(packet->xdrEncodeFixedOpaque((void*)arg->lock_stateid.other, 12));
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->offset));
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->length));
+  RETURN_ON_ERROR(xdr.reserve(4 + 4 + 4 + 12 + 8 + 8));
+  xdr.putUint32(arg->locktype);
+  xdr.putUint32(arg->seqid);
+  xdr.putUint32(arg->lock_stateid.seqid);
+  xdr.putFixedOpaque(arg->lock_stateid.other, 12);
+  xdr.putUint64(arg->offset);
+  xdr.putUint64(arg->length);
 
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_LOCKU(RpcPacketPtr packet, LOCKU4res *res)
+COMPOUNDCall::decode_OP_LOCKU(XdrReader& xdr, LOCKU4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
     return 0;
 
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&(res->LOCKU4res_u.lock_stateid.seqid)));
-  RETURN_ON_ERROR(packet->xdrDecodeFixedOpaque((unsigned char*)res->LOCKU4res_u.lock_stateid.other, 12));
+  RETURN_ON_ERROR(xdr.decodeUint32(&(res->LOCKU4res_u.lock_stateid.seqid)));
+  RETURN_ON_ERROR(xdr.decodeFixedOpaque((unsigned char*)res->LOCKU4res_u.lock_stateid.other, 12));
 
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_LOOKUP(RpcPacketPtr request, const LOOKUP4args *arg)
+COMPOUNDCall::encode_OP_LOOKUP(XdrWriter& xdr, const LOOKUP4args *arg)
 {
-  RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)arg->objname.utf8string_val,
-                                           arg->objname.utf8string_len));
+  RETURN_ON_ERROR(xdr.reserve(XdrWriter::varOpaqueSize(arg->objname.utf8string_len)));
+  xdr.putString(arg->objname.utf8string_val,
+                arg->objname.utf8string_len);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_LOOKUP(RpcPacketPtr packet, LOOKUP4res *res)
+COMPOUNDCall::decode_OP_LOOKUP(XdrReader& xdr, LOOKUP4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
@@ -621,67 +681,72 @@ COMPOUNDCall::decode_OP_LOOKUP(RpcPacketPtr packet, LOOKUP4res *res)
 }
 
 int
-COMPOUNDCall::encode_OP_LOOKUPP(RpcPacketPtr packet)
+COMPOUNDCall::encode_OP_LOOKUPP(XdrWriter& xdr)
 {
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_LOOKUPP(RpcPacketPtr packet, LOOKUPP4res *res)
+COMPOUNDCall::decode_OP_LOOKUPP(XdrReader& xdr, LOOKUPP4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_NVERIFY(RpcPacketPtr packet, const NVERIFY4args *arg)
+COMPOUNDCall::encode_OP_NVERIFY(XdrWriter& xdr, const NVERIFY4args *arg)
 {
-  RETURN_ON_ERROR(NfsUtil::encode_fattr4(packet, &arg->obj_attributes));
+  RETURN_ON_ERROR(xdr.reserve(NfsUtil::fattr4MaxSize(&arg->obj_attributes)));
+  NfsUtil::encode_fattr4(xdr, &arg->obj_attributes);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_NVERIFY(RpcPacketPtr packet, NVERIFY4res *res)
+COMPOUNDCall::decode_OP_NVERIFY(XdrReader& xdr, NVERIFY4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_OPEN(RpcPacketPtr packet, const OPEN4args *arg)
+COMPOUNDCall::encode_OP_OPEN(XdrWriter& xdr, const OPEN4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->seqid));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->share_access));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->share_deny));
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->owner.clientid));
+  // the createhow and claim bodies are reserved in their branches
+  RETURN_ON_ERROR(xdr.reserve(4 + 4 + 4 + 8 + XdrWriter::varOpaqueSize(arg->owner.owner.owner_len) + 4 + 4));
+  xdr.putUint32(arg->seqid);
+  xdr.putUint32(arg->share_access);
+  xdr.putUint32(arg->share_deny);
+  xdr.putUint64(arg->owner.clientid);
 
-  RETURN_ON_ERROR(packet->xdrEncodeString((unsigned char*)arg->owner.owner.owner_val,
-                                          arg->owner.owner.owner_len));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->openhow.opentype));
+  xdr.putString(arg->owner.owner.owner_val,
+                arg->owner.owner.owner_len);
+  xdr.putUint32(arg->openhow.opentype);
 
   switch(arg->openhow.opentype)
   {
     case OPEN4_CREATE:
     {
-      RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->openhow.openflag4_u.how.mode));
+      xdr.putUint32(arg->openhow.openflag4_u.how.mode);
 
       switch (arg->openhow.openflag4_u.how.mode)
       {
         case UNCHECKED4:
         case GUARDED4:
         {
-          RETURN_ON_ERROR(NfsUtil::encode_fattr4(packet, &arg->openhow.openflag4_u.how.createhow4_u.createattrs));
+          RETURN_ON_ERROR(xdr.reserve(NfsUtil::fattr4MaxSize(&arg->openhow.openflag4_u.how.createhow4_u.createattrs)));
+          NfsUtil::encode_fattr4(xdr, &arg->openhow.openflag4_u.how.createhow4_u.createattrs);
         }
         break;
         case EXCLUSIVE4:
         {
           //TODO sarat nfs - exclusive not tested
-          RETURN_ON_ERROR(packet->xdrEncodeFixedOpaque((void*)arg->openhow.openflag4_u.how.createhow4_u.createverf,
-                                                       NFS4_VERIFIER_SIZE));
+          RETURN_ON_ERROR(xdr.reserve(NFS4_VERIFIER_SIZE));
+          xdr.putFixedOpaque(arg->openhow.openflag4_u.how.createhow4_u.createverf,
+                             NFS4_VERIFIER_SIZE);
         }
         break;
         default:
@@ -695,22 +760,23 @@ COMPOUNDCall::encode_OP_OPEN(RpcPacketPtr packet, const OPEN4args *arg)
     break;
   }
 
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->claim.claim));
+  xdr.putUint32(arg->claim.claim);
 
   switch(arg->claim.claim)
   {
     case CLAIM_NULL:
     {
+      RETURN_ON_ERROR(xdr.reserve(XdrWriter::varOpaqueSize(arg->claim.open_claim4_u.file.utf8string_len)));
       if (arg->claim.open_claim4_u.file.utf8string_len != 0)
-        RETURN_ON_ERROR(packet->xdrEncodeString((unsigned char*)arg->claim.open_claim4_u.file.utf8string_val,
-                                                arg->claim.open_claim4_u.file.utf8string_len));
+        xdr.putString(arg->claim.open_claim4_u.file.utf8string_val,
+                      arg->claim.open_claim4_u.file.utf8string_len);
     }
     break;
     case CLAIM_PREVIOUS:
     {
 #if 0
         //open_delegation_type4   delegate_type;
-        RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->claim.open_claim4_u.delegate_type));
+        xdr.putUint32(arg->claim.open_claim4_u.delegate_type);
 #endif
     }
     break;
@@ -718,11 +784,11 @@ COMPOUNDCall::encode_OP_OPEN(RpcPacketPtr packet, const OPEN4args *arg)
     {
 #if 0
       //open_claim_delegate_cur4        delegate_cur_info;
-      RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->claim.open_claim4_u.delegate_cur_info.delegate_stateid.seqid));
-      RETURN_ON_ERROR(packet->xdrEncodeString((unsigned char*)arg->claim.open_claim4_u.delegate_cur_info.delegate_stateid.other,
-                                              strlen((const char*)arg->claim.open_claim4_u.delegate_cur_info.delegate_stateid.other)));
-      RETURN_ON_ERROR(packet->xdrEncodeVarOpaque(arg->claim.open_claim4_u.delegate_cur_info.file.utf8string_val,
-                                                 arg->claim.open_claim4_u.delegate_cur_info.file.utf8string_len));
+      xdr.putUint32(arg->claim.open_claim4_u.delegate_cur_info.delegate_stateid.seqid);
+      xdr.putString(arg->claim.open_claim4_u.delegate_cur_info.delegate_stateid.other,
+                    strlen((const char*)arg->claim.open_claim4_u.delegate_cur_info.delegate_stateid.other));
+      xdr.putVarOpaque(arg->claim.open_claim4_u.delegate_cur_info.file.utf8string_val,
+                       arg->claim.open_claim4_u.delegate_cur_info.file.utf8string_len);
 #endif
     }
     break;
@@ -730,8 +796,8 @@ COMPOUNDCall::encode_OP_OPEN(RpcPacketPtr packet, const OPEN4args *arg)
     {
 #if 0
       //component4      file_delegate_prev;
-      RETURN_ON_ERROR(packet->xdrEncodeVarOpaque(arg->claim.open_claim4_u.file_delegate_prev.utf8string_val,
-                                                 arg->claim.open_claim4_u.file_delegate_prev.utf8string_len));
+      xdr.putVarOpaque(arg->claim.open_claim4_u.file_delegate_prev.utf8string_val,
+                       arg->claim.open_claim4_u.file_delegate_prev.utf8string_len);
 #endif
     }
     break;
@@ -743,10 +809,10 @@ COMPOUNDCall::encode_OP_OPEN(RpcPacketPtr packet, const OPEN4args *arg)
 }
 
 int
-COMPOUNDCall::decode_OP_OPEN(RpcPacketPtr packet, OPEN4res *res)
+COMPOUNDCall::decode_OP_OPEN(XdrReader& xdr, OPEN4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
@@ -754,49 +820,36 @@ COMPOUNDCall::decode_OP_OPEN(RpcPacketPtr packet, OPEN4res *res)
 
   /* get the state id */
   uint32 seqid = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&seqid));
+  RETURN_ON_ERROR(xdr.decodeUint32(&seqid));
   res->OPEN4res_u.resok4.stateid.seqid = seqid;
 
-  RETURN_ON_ERROR(packet->xdrDecodeFixedOpaque((unsigned char*)res->OPEN4res_u.resok4.stateid.other, 12));
+  RETURN_ON_ERROR(xdr.decodeFixedOpaque((unsigned char*)res->OPEN4res_u.resok4.stateid.other, 12));
 
   /* get the change_info4 */
   bool_t sato;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32((uint32 *)&sato));
+  RETURN_ON_ERROR(xdr.decodeUint32((uint32 *)&sato));
   res->OPEN4res_u.resok4.cinfo.atomic = sato;
 
   uint64 sbefo;
-  RETURN_ON_ERROR(packet->xdrDecodeUint64(&sbefo));
+  RETURN_ON_ERROR(xdr.decodeUint64(&sbefo));
   res->OPEN4res_u.resok4.cinfo.before = sbefo;
 
   uint64 safte;
-  RETURN_ON_ERROR(packet->xdrDecodeUint64(&safte));
+  RETURN_ON_ERROR(xdr.decodeUint64(&safte));
   res->OPEN4res_u.resok4.cinfo.after = safte;
 
   /* get the rflags */
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&res->OPEN4res_u.resok4.rflags));
+  RETURN_ON_ERROR(xdr.decodeUint32(&res->OPEN4res_u.resok4.rflags));
 
   /* get the attrset */
   bitmap4 *attrset = &(res->OPEN4res_u.resok4.attrset);
 
-  uint32 bitMapLength = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&bitMapLength));
-  attrset->bitmap4_len = bitMapLength;
-
-  attrset->bitmap4_val = (uint32_t *)malloc(bitMapLength * sizeof(uint32));
-  if (attrset->bitmap4_val == NULL)
-    return -1;
-
-  for (unsigned i = 0; i < bitMapLength; i++)
-  {
-    uint32 mask = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint32(&mask));
-    attrset->bitmap4_val[i] = mask;
-  }
+  RETURN_ON_ERROR(decodeBitmap(xdr, attrset));
   // TODO sarat - will there be any actual attribute values following this??
 
   /* get the delegation type */
   uint32 delegType = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&delegType));
+  RETURN_ON_ERROR(xdr.decodeUint32(&delegType));
   res->OPEN4res_u.resok4.delegation.delegation_type = (open_delegation_type4)delegType;
 
   if (delegType == OPEN_DELEGATE_READ)
@@ -812,154 +865,173 @@ COMPOUNDCall::decode_OP_OPEN(RpcPacketPtr packet, OPEN4res *res)
 }
 
 int
-COMPOUNDCall::encode_OP_OPENATTR(RpcPacketPtr packet, const OPENATTR4args *arg)
+COMPOUNDCall::encode_OP_OPENATTR(XdrWriter& xdr, const OPENATTR4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->createdir));
+  RETURN_ON_ERROR(xdr.reserve(4));
+  xdr.putUint32(arg->createdir);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_OPENATTR(RpcPacketPtr packet, OPENATTR4res *res)
+COMPOUNDCall::decode_OP_OPENATTR(XdrReader& xdr, OPENATTR4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_OPEN_CONFIRM(RpcPacketPtr packet, const OPEN_CONFIRM4args *arg)
+COMPOUNDCall::encode_OP_OPEN_CONFIRM(XdrWriter& xdr, const OPEN_CONFIRM4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->open_stateid.seqid));
-  RETURN_ON_ERROR(packet->xdrEncodeFixedOpaque((void*)arg->open_stateid.other, 12));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->seqid));
+  RETURN_ON_ERROR(xdr.reserve(4 + 12 + 4));
+  xdr.putUint32(arg->open_stateid.seqid);
+  xdr.putFixedOpaque(arg->open_stateid.other, 12);
+  xdr.putUint32(arg->seqid);
   return 0;
 }
 
 
 int
-COMPOUNDCall::decode_OP_OPEN_CONFIRM(RpcPacketPtr packet, OPEN_CONFIRM4res *res)
+COMPOUNDCall::decode_OP_OPEN_CONFIRM(XdrReader& xdr, OPEN_CONFIRM4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
     return 0;
 
   uint32 seqid = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&seqid));
+  RETURN_ON_ERROR(xdr.decodeUint32(&seqid));
   res->OPEN_CONFIRM4res_u.resok4.open_stateid.seqid=seqid;
 
-  RETURN_ON_ERROR(packet->xdrDecodeFixedOpaque((unsigned char*)res->OPEN_CONFIRM4res_u.resok4.open_stateid.other, 12));
+  RETURN_ON_ERROR(xdr.decodeFixedOpaque((unsigned char*)res->OPEN_CONFIRM4res_u.resok4.open_stateid.other, 12));
 
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_OPEN_DOWNGRADE(RpcPacketPtr packet, const OPEN_DOWNGRADE4args *arg)
+COMPOUNDCall::encode_OP_OPEN_DOWNGRADE(XdrWriter& xdr, const OPEN_DOWNGRADE4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->open_stateid.seqid));
-  RETURN_ON_ERROR(packet->xdrEncodeFixedOpaque((void*)arg->open_stateid.other, 12));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->seqid));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->share_access));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->share_deny));
+  RETURN_ON_ERROR(xdr.reserve(4 + 12 + 4 + 4 + 4));
+  xdr.putUint32(arg->open_stateid.seqid);
+  xdr.putFixedOpaque(arg->open_stateid.other, 12);
+  xdr.putUint32(arg->seqid);
+  xdr.putUint32(arg->share_access);
+  xdr.putUint32(arg->share_deny);
 
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_OPEN_DOWNGRADE(RpcPacketPtr packet, OPEN_DOWNGRADE4res *res)
+COMPOUNDCall::decode_OP_OPEN_DOWNGRADE(XdrReader& xdr, OPEN_DOWNGRADE4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
     return 0;
 
   uint32 seqid = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&seqid));
+  RETURN_ON_ERROR(xdr.decodeUint32(&seqid));
   res->OPEN_DOWNGRADE4res_u.resok4.open_stateid.seqid = seqid;
 
-  RETURN_ON_ERROR(packet->xdrDecodeFixedOpaque((unsigned char*)res->OPEN_DOWNGRADE4res_u.resok4.open_stateid.other, 12));
+  RETURN_ON_ERROR(xdr.decodeFixedOpaque((unsigned char*)res->OPEN_DOWNGRADE4res_u.resok4.open_stateid.other, 12));
 
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_PUTFH(RpcPacketPtr packet, const PUTFH4args *arg)
+COMPOUNDCall::encode_OP_PUTFH(XdrWriter& xdr, const PUTFH4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeVarOpaque(arg->object.nfs_fh4_val, arg->object.nfs_fh4_len));
+  RETURN_ON_ERROR(xdr.reserve(XdrWriter::varOpaqueSize(arg->object.nfs_fh4_len)));
+  xdr.putVarOpaque(arg->object.nfs_fh4_val, arg->object.nfs_fh4_len);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_PUTFH(RpcPacketPtr packet, PUTFH4res *res)
+COMPOUNDCall::decode_OP_PUTFH(XdrReader& xdr, PUTFH4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_PUTPUBFH(RpcPacketPtr packet)
+COMPOUNDCall::encode_OP_PUTPUBFH(XdrWriter& xdr)
 {
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_PUTPUBFH(RpcPacketPtr packet, PUTPUBFH4res *res)
+COMPOUNDCall::decode_OP_PUTPUBFH(XdrReader& xdr, PUTPUBFH4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_PUTROOTFH(RpcPacketPtr packet)
+COMPOUNDCall::encode_OP_PUTROOTFH(XdrWriter& xdr)
 {
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_PUTROOTFH(RpcPacketPtr packet, PUTROOTFH4res *res)
+COMPOUNDCall::decode_OP_PUTROOTFH(XdrReader& xdr, PUTROOTFH4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_READ(RpcPacketPtr packet, const READ4args *arg)
+COMPOUNDCall::encode_OP_READ(XdrWriter& xdr, const READ4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->stateid.seqid));
-  RETURN_ON_ERROR(packet->xdrEncodeFixedOpaque((char*)arg->stateid.other,12));
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->offset));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->count));
+  RETURN_ON_ERROR(xdr.reserve(4 + 12 + 8 + 4));
+  xdr.putUint32(arg->stateid.seqid);
+  xdr.putFixedOpaque(arg->stateid.other,12);
+  xdr.putUint64(arg->offset);
+  xdr.putUint32(arg->count);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_READ(RpcPacketPtr packet, READ4res *res)
+COMPOUNDCall::decode_OP_READ(XdrReader& xdr, READ4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
     return 0;
 
   uint32 iseof=false;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&iseof));
+  RETURN_ON_ERROR(xdr.decodeUint32(&iseof));
   res->READ4res_u.resok4.eof=iseof;
 
   unsigned char* str = NULL;
   uint32 len = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeString(str, len));
+  if (m_readSink && m_readSink->isPlaced())
+  {
+    // the data went to the caller buffers on receive
+    RETURN_ON_ERROR(xdr.decodeUint32(&len));
+    RETURN_ON_ERROR(xdr.skip(XdrReader::fixedOpaqueSize(len) - len));
+  }
+  else
+  {
+    RETURN_ON_ERROR(xdr.decodeString(str, len));
+    if (m_readSink)
+    {
+      RETURN_ON_ERROR(m_readSink->copyIn(str, len));
+      str = NULL;
+    }
+  }
   res->READ4res_u.resok4.data.data_len = len;
   res->READ4res_u.resok4.data.data_val = (char*)str;
 
@@ -967,47 +1039,43 @@ COMPOUNDCall::decode_OP_READ(RpcPacketPtr packet, READ4res *res)
 }
 
 int
-COMPOUNDCall::encode_OP_READDIR(RpcPacketPtr packet, const READDIR4args *arg)
+COMPOUNDCall::encode_OP_READDIR(XdrWriter& xdr, const READDIR4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->cookie));
-  RETURN_ON_ERROR(packet->xdrEncodeFixedOpaque((void*)arg->cookieverf, NFS4_VERIFIER_SIZE));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->dircount));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->maxcount));
+  RETURN_ON_ERROR(xdr.reserve(8 + NFS4_VERIFIER_SIZE + 4 + 4 + 4 + 4 * arg->attr_request.bitmap4_len));
+  xdr.putUint64(arg->cookie);
+  xdr.putFixedOpaque(arg->cookieverf, NFS4_VERIFIER_SIZE);
+  xdr.putUint32(arg->dircount);
+  xdr.putUint32(arg->maxcount);
 
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->attr_request.bitmap4_len));
-  uint32_t *mask = arg->attr_request.bitmap4_val;
-  for (unsigned i = 0; i < arg->attr_request.bitmap4_len; i++)
-  {
-    RETURN_ON_ERROR(packet->xdrEncodeUint32(*mask));
-    mask++;
-  }
+  xdr.putUint32(arg->attr_request.bitmap4_len);
+  xdr.putUint32Array(arg->attr_request.bitmap4_val, arg->attr_request.bitmap4_len);
 
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_READDIR(RpcPacketPtr packet, READDIR4res *res)
+COMPOUNDCall::decode_OP_READDIR(XdrReader& xdr, READDIR4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
     return 0;
 
   verifier4 cookieverf;
-  RETURN_ON_ERROR(packet->xdrDecodeFixedOpaque((unsigned char*)&cookieverf,NFS4_VERIFIER_SIZE));
+  RETURN_ON_ERROR(xdr.decodeFixedOpaque((unsigned char*)&cookieverf,NFS4_VERIFIER_SIZE));
   memcpy(res->READDIR4res_u.resok4.cookieverf, cookieverf, NFS4_VERIFIER_SIZE);
 
   dirlist4 *list = &(res->READDIR4res_u.resok4.reply);
 
   uint32 valueFollows = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&valueFollows));
+  RETURN_ON_ERROR(xdr.decodeUint32(&valueFollows));
   if (valueFollows == 0)
   {
     // empty directory case
     uint32 eof = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint32(&eof));
+    RETURN_ON_ERROR(xdr.decodeUint32(&eof));
     list->eof = eof;
     if (list->eof == 1)
       list->entries = NULL;
@@ -1024,13 +1092,12 @@ COMPOUNDCall::decode_OP_READDIR(RpcPacketPtr packet, READDIR4res *res)
   do
   {
     // get the cookie
-    uint64 cookie = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint64(&cookie));
-    current->cookie = (nfs_cookie4) cookie;
+    RETURN_ON_ERROR(xdr.need(8));
+    current->cookie = (nfs_cookie4) xdr.getUint64();
 
     unsigned char* str = NULL;
     u_int len = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeString(str, len));
+    RETURN_ON_ERROR(xdr.decodeString(str, len));
     current->name.utf8string_val = (char*)str;
     current->name.utf8string_len = len;
 
@@ -1038,34 +1105,17 @@ COMPOUNDCall::decode_OP_READDIR(RpcPacketPtr packet, READDIR4res *res)
     bitmap4 *bitmap = &(current->attrs.attrmask);
     attrlist4 *attrList = &(current->attrs.attr_vals);
 
-    uint32 bitMapLength = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint32(&bitMapLength));
-
     // get the bitmap masks
-    bitmap->bitmap4_len = bitMapLength;
-    bitmap->bitmap4_val = (uint32_t *)malloc(bitMapLength * sizeof(uint32));
-    if (bitmap->bitmap4_val == NULL)
-      return -1;
+    RETURN_ON_ERROR(decodeBitmap(xdr, bitmap));
 
-    for (unsigned i = 0; i < bitMapLength; i++)
-    {
-      uint32 mask = 0;
-      RETURN_ON_ERROR(packet->xdrDecodeUint32(&mask));
-      bitmap->bitmap4_val[i] = mask;
-    }
-
-    // get the attrs as raw data un-decoded
+    // get the attrs as raw data un-decoded, a view like the name
+    unsigned char* attrs = NULL;
     uint32 attrLength = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint32(&attrLength));
+    RETURN_ON_ERROR(xdr.decodeString(attrs, attrLength));
+    attrList->attrlist4_val = (char*)attrs;
     attrList->attrlist4_len = attrLength;
 
-    attrList->attrlist4_val = (char *) malloc(attrLength);
-    if (attrList->attrlist4_val == NULL)
-      return -1;
-
-    RETURN_ON_ERROR(packet->xdrGetRawData((unsigned char *)attrList->attrlist4_val, attrLength));
-
-    RETURN_ON_ERROR(packet->xdrDecodeUint32(&valueFollows));
+    RETURN_ON_ERROR(xdr.decodeUint32(&valueFollows));
     if (valueFollows == 1)
     {
       entry4 *nextEntry = (entry4 *)malloc(sizeof(entry4));
@@ -1078,7 +1128,7 @@ COMPOUNDCall::decode_OP_READDIR(RpcPacketPtr packet, READDIR4res *res)
     else
     {
       uint32 eof = 0;
-      RETURN_ON_ERROR(packet->xdrDecodeUint32(&eof));
+      RETURN_ON_ERROR(xdr.decodeUint32(&eof));
       list->eof = eof;
     }
   } while (valueFollows == 1);
@@ -1087,16 +1137,16 @@ COMPOUNDCall::decode_OP_READDIR(RpcPacketPtr packet, READDIR4res *res)
 }
 
 int
-COMPOUNDCall::encode_OP_READLINK(RpcPacketPtr packet)
+COMPOUNDCall::encode_OP_READLINK(XdrWriter& xdr)
 {
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_READLINK(RpcPacketPtr packet, READLINK4res *res)
+COMPOUNDCall::decode_OP_READLINK(XdrReader& xdr, READLINK4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
@@ -1104,7 +1154,7 @@ COMPOUNDCall::decode_OP_READLINK(RpcPacketPtr packet, READLINK4res *res)
 
   unsigned char* str = NULL;
   u_int len = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeString(str, len));
+  RETURN_ON_ERROR(xdr.decodeString(str, len));
 
   res->READLINK4res_u.resok4.link.utf8string_len = len;
   res->READLINK4res_u.resok4.link.utf8string_val = (char*)str;
@@ -1113,209 +1163,222 @@ COMPOUNDCall::decode_OP_READLINK(RpcPacketPtr packet, READLINK4res *res)
 }
 
 int
-COMPOUNDCall::encode_OP_REMOVE(RpcPacketPtr packet, const REMOVE4args *arg)
+COMPOUNDCall::encode_OP_REMOVE(XdrWriter& xdr, const REMOVE4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeString((unsigned char*)arg->target.utf8string_val, arg->target.utf8string_len));
+  RETURN_ON_ERROR(xdr.reserve(XdrWriter::varOpaqueSize(arg->target.utf8string_len)));
+  xdr.putString(arg->target.utf8string_val, arg->target.utf8string_len);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_REMOVE(RpcPacketPtr packet, REMOVE4res *res)
+COMPOUNDCall::decode_OP_REMOVE(XdrReader& xdr, REMOVE4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
     return 0;
 
   bool_t sato;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32((unsigned int*)&sato));
+  RETURN_ON_ERROR(xdr.decodeUint32((unsigned int*)&sato));
   res->REMOVE4res_u.resok4.cinfo.atomic = sato;
 
   uint64 sbefo;
-  RETURN_ON_ERROR(packet->xdrDecodeUint64(&sbefo));
+  RETURN_ON_ERROR(xdr.decodeUint64(&sbefo));
   res->REMOVE4res_u.resok4.cinfo.before = sbefo;
 
   uint64 safte;
-  RETURN_ON_ERROR(packet->xdrDecodeUint64(&safte));
+  RETURN_ON_ERROR(xdr.decodeUint64(&safte));
   res->REMOVE4res_u.resok4.cinfo.after = safte;
 
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_RENAME(RpcPacketPtr packet, const RENAME4args *arg)
+COMPOUNDCall::encode_OP_RENAME(XdrWriter& xdr, const RENAME4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeString((unsigned char*)arg->oldname.utf8string_val, arg->oldname.utf8string_len));
-  RETURN_ON_ERROR(packet->xdrEncodeString((unsigned char*)arg->newname.utf8string_val, arg->newname.utf8string_len));
+  RETURN_ON_ERROR(xdr.reserve(XdrWriter::varOpaqueSize(arg->oldname.utf8string_len) + XdrWriter::varOpaqueSize(arg->newname.utf8string_len)));
+  xdr.putString(arg->oldname.utf8string_val, arg->oldname.utf8string_len);
+  xdr.putString(arg->newname.utf8string_val, arg->newname.utf8string_len);
 
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_RENAME(RpcPacketPtr packet, RENAME4res *res)
+COMPOUNDCall::decode_OP_RENAME(XdrReader& xdr, RENAME4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
     return 0;
 
   bool_t sato;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32((unsigned int*)&sato));
+  RETURN_ON_ERROR(xdr.decodeUint32((unsigned int*)&sato));
   res->RENAME4res_u.resok4.source_cinfo.atomic = sato;
 
   uint64 sbefo;
-  RETURN_ON_ERROR(packet->xdrDecodeUint64(&sbefo));
+  RETURN_ON_ERROR(xdr.decodeUint64(&sbefo));
   res->RENAME4res_u.resok4.source_cinfo.before = sbefo;
 
   uint64 safte;
-  RETURN_ON_ERROR(packet->xdrDecodeUint64(&safte));
+  RETURN_ON_ERROR(xdr.decodeUint64(&safte));
   res->RENAME4res_u.resok4.source_cinfo.after = safte;
 
   bool_t tato;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32((unsigned int*)&tato));
+  RETURN_ON_ERROR(xdr.decodeUint32((unsigned int*)&tato));
   res->RENAME4res_u.resok4.target_cinfo.atomic = tato;
 
   uint64 tbefo;
-  RETURN_ON_ERROR(packet->xdrDecodeUint64(&tbefo));
+  RETURN_ON_ERROR(xdr.decodeUint64(&tbefo));
   res->RENAME4res_u.resok4.target_cinfo.before = tbefo;
 
   uint64 tafte;
-  RETURN_ON_ERROR(packet->xdrDecodeUint64(&tafte));
+  RETURN_ON_ERROR(xdr.decodeUint64(&tafte));
   res->RENAME4res_u.resok4.target_cinfo.after = tafte;
 
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_RENEW(RpcPacketPtr packet, const RENEW4args *arg)
+COMPOUNDCall::encode_OP_RENEW(XdrWriter& xdr, const RENEW4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->clientid));
+  RETURN_ON_ERROR(xdr.reserve(8));
+  xdr.putUint64(arg->clientid);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_RENEW(RpcPacketPtr packet, RENEW4res *res)
+COMPOUNDCall::decode_OP_RENEW(XdrReader& xdr, RENEW4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_RESTOREFH(RpcPacketPtr packet)
+COMPOUNDCall::encode_OP_RESTOREFH(XdrWriter& xdr)
 {
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_RESTOREFH(RpcPacketPtr packet, RESTOREFH4res *res)
+COMPOUNDCall::decode_OP_RESTOREFH(XdrReader& xdr, RESTOREFH4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_SAVEFH(RpcPacketPtr packet)
+COMPOUNDCall::encode_OP_SAVEFH(XdrWriter& xdr)
 {
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_SAVEFH(RpcPacketPtr packet, SAVEFH4res *res)
+COMPOUNDCall::decode_OP_SAVEFH(XdrReader& xdr, SAVEFH4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_SECINFO(RpcPacketPtr packet)
+COMPOUNDCall::encode_OP_SECINFO(XdrWriter& xdr)
 {
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_SECINFO(RpcPacketPtr packet)
+COMPOUNDCall::decode_OP_SECINFO(XdrReader& xdr)
 {
+  // nfs_resop4 has no room for the result, it is still read past
+  // so that the ops after it are decoded from the right place
+  uint32 opSts = 0;
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
+  if (opSts != NFS4_OK)
+    return 0;
+
+  uint32 count = 0;
+  RETURN_ON_ERROR(xdr.decodeUint32(&count));
+  for (uint32 i = 0; i < count; i++)
+  {
+    uint32 flavor = 0;
+    RETURN_ON_ERROR(xdr.decodeUint32(&flavor));
+    if (flavor != RPCSEC_GSS)
+      continue;
+
+    // rpcsec_gss_info: oid, qop, service
+    unsigned char* oid = NULL;
+    uint32 oidLen = 0;
+    RETURN_ON_ERROR(xdr.decodeString(oid, oidLen));
+    RETURN_ON_ERROR(xdr.skip(8));
+  }
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_SETATTR(RpcPacketPtr packet, const SETATTR4args *arg)
+COMPOUNDCall::encode_OP_SETATTR(XdrWriter& xdr, const SETATTR4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->stateid.seqid));
-  RETURN_ON_ERROR(packet->xdrEncodeFixedOpaque((char*)arg->stateid.other, 12));
-  RETURN_ON_ERROR(NfsUtil::encode_fattr4(packet, &arg->obj_attributes));
+  RETURN_ON_ERROR(xdr.reserve(4 + 12 + NfsUtil::fattr4MaxSize(&arg->obj_attributes)));
+  xdr.putUint32(arg->stateid.seqid);
+  xdr.putFixedOpaque(arg->stateid.other, 12);
+  NfsUtil::encode_fattr4(xdr, &arg->obj_attributes);
 
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_SETATTR(RpcPacketPtr packet, SETATTR4res *res)
+COMPOUNDCall::decode_OP_SETATTR(XdrReader& xdr, SETATTR4res *res)
 {
   uint32 opSts;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
 
-  uint32 bitMapLength = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&bitMapLength));
-  res->attrsset.bitmap4_len = bitMapLength;
-
-  res->attrsset.bitmap4_val = (uint32_t*)malloc(bitMapLength * sizeof(uint32));
-  if (res->attrsset.bitmap4_val == NULL)
-    return -1;
-
-  uint32 *ptr = res->attrsset.bitmap4_val;
-  for (unsigned i = 0; i < bitMapLength; i++)
-  {
-    uint32 mask = 0;
-    RETURN_ON_ERROR(packet->xdrDecodeUint32(&mask));
-    ptr[i] = mask;
-  }
+  RETURN_ON_ERROR(decodeBitmap(xdr, &res->attrsset));
 
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_SETCLIENTID(RpcPacketPtr     request,
-                                    SETCLIENTID4args *arg)
+COMPOUNDCall::encode_OP_SETCLIENTID(XdrWriter& xdr, SETCLIENTID4args *arg)
 {
-  RETURN_ON_ERROR(request->xdrEncodeFixedOpaque(arg->client.verifier, NFS4_VERIFIER_SIZE));
-  RETURN_ON_ERROR(request->xdrEncodeVarOpaque(arg->client.id.id_val, arg->client.id.id_len));
-  RETURN_ON_ERROR(request->xdrEncodeUint32(arg->callback.cb_program));
-  RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)arg->callback.cb_location.r_netid,
-                                           strlen(arg->callback.cb_location.r_netid)));
-  RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)arg->callback.cb_location.r_addr,
-                                           strlen(arg->callback.cb_location.r_addr)));
-  RETURN_ON_ERROR(request->xdrEncodeUint32(arg->callback_ident));
+  uint32 netidLen = strlen(arg->callback.cb_location.r_netid);
+  uint32 addrLen = strlen(arg->callback.cb_location.r_addr);
+  RETURN_ON_ERROR(xdr.reserve(NFS4_VERIFIER_SIZE + XdrWriter::varOpaqueSize(arg->client.id.id_len) + 4 +
+                              XdrWriter::varOpaqueSize(netidLen) + XdrWriter::varOpaqueSize(addrLen) + 4));
+  xdr.putFixedOpaque(arg->client.verifier, NFS4_VERIFIER_SIZE);
+  xdr.putVarOpaque(arg->client.id.id_val, arg->client.id.id_len);
+  xdr.putUint32(arg->callback.cb_program);
+  xdr.putString(arg->callback.cb_location.r_netid, netidLen);
+  xdr.putString(arg->callback.cb_location.r_addr, addrLen);
+  xdr.putUint32(arg->callback_ident);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_SETCLIENTID(RpcPacketPtr reply, SETCLIENTID4res *res)
+COMPOUNDCall::decode_OP_SETCLIENTID(XdrReader& xdr, SETCLIENTID4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(reply->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
 
   if (opSts == NFS4_OK)
   {
     uint64 clientid = 0;
-    RETURN_ON_ERROR(reply->xdrDecodeUint64(&clientid));
+    RETURN_ON_ERROR(xdr.decodeUint64(&clientid));
     res->SETCLIENTID4res_u.resok4.clientid = clientid;
 
     verifier4 verifierConfirm;
-    RETURN_ON_ERROR(reply->xdrDecodeFixedOpaque((unsigned char*)&verifierConfirm,
+    RETURN_ON_ERROR(xdr.decodeFixedOpaque((unsigned char*)&verifierConfirm,
                                                 NFS4_VERIFIER_SIZE));
     memcpy(res->SETCLIENTID4res_u.resok4.setclientid_confirm,
            verifierConfirm,
@@ -1326,10 +1389,10 @@ COMPOUNDCall::decode_OP_SETCLIENTID(RpcPacketPtr reply, SETCLIENTID4res *res)
     //TODO sarat nfs - sectio not tested
     unsigned char* r_netid = NULL;
     uint32 r_netid_len;
-    RETURN_ON_ERROR(reply->xdrDecodeString(r_netid, r_netid_len));
+    RETURN_ON_ERROR(xdr.decodeString(r_netid, r_netid_len));
     unsigned char* r_addr = NULL;
     uint32 r_addr_len;
-    RETURN_ON_ERROR(reply->xdrDecodeString(r_addr, r_addr_len));
+    RETURN_ON_ERROR(xdr.decodeString(r_addr, r_addr_len));
     res->SETCLIENTID4res_u.client_using.r_netid = (char*)r_netid;
     res->SETCLIENTID4res_u.client_using.r_addr = (char*)r_addr;
   }
@@ -1338,79 +1401,76 @@ COMPOUNDCall::decode_OP_SETCLIENTID(RpcPacketPtr reply, SETCLIENTID4res *res)
 }
 
 int
-COMPOUNDCall::encode_OP_SETCLIENTID_CONFIRM(RpcPacketPtr             request,
-                                            SETCLIENTID_CONFIRM4args *arg)
+COMPOUNDCall::encode_OP_SETCLIENTID_CONFIRM(XdrWriter& xdr, SETCLIENTID_CONFIRM4args *arg)
 {
-  RETURN_ON_ERROR(request->xdrEncodeUint64((uint64)arg->clientid));
-  RETURN_ON_ERROR(request->xdrEncodeFixedOpaque(arg->setclientid_confirm, NFS4_VERIFIER_SIZE));
+  RETURN_ON_ERROR(xdr.reserve(8 + NFS4_VERIFIER_SIZE));
+  xdr.putUint64((uint64)arg->clientid);
+  xdr.putFixedOpaque(arg->setclientid_confirm, NFS4_VERIFIER_SIZE);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_SETCLIENTID_CONFIRM(RpcPacketPtr request, SETCLIENTID_CONFIRM4res *res)
+COMPOUNDCall::decode_OP_SETCLIENTID_CONFIRM(XdrReader& xdr, SETCLIENTID_CONFIRM4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(request->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_VERIFY(RpcPacketPtr packet, const VERIFY4args *arg)
+COMPOUNDCall::encode_OP_VERIFY(XdrWriter& xdr, const VERIFY4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->obj_attributes.attrmask.bitmap4_len));
-  uint32_t *mask = arg->obj_attributes.attrmask.bitmap4_val;
-  for (unsigned i = 0; i < arg->obj_attributes.attrmask.bitmap4_len; i++)
-  {
-    RETURN_ON_ERROR(packet->xdrEncodeUint32(*mask));
-    mask++;
-  }
+  RETURN_ON_ERROR(xdr.reserve(4 + 4 * arg->obj_attributes.attrmask.bitmap4_len + NfsUtil::fattr4MaxSize(&arg->obj_attributes)));
+  xdr.putUint32(arg->obj_attributes.attrmask.bitmap4_len);
+  xdr.putUint32Array(arg->obj_attributes.attrmask.bitmap4_val, arg->obj_attributes.attrmask.bitmap4_len);
 
-  RETURN_ON_ERROR(NfsUtil::encode_fattr4(packet, &arg->obj_attributes));
+  NfsUtil::encode_fattr4(xdr, &arg->obj_attributes);
 
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_VERIFY(RpcPacketPtr packet, VERIFY4res *res)
+COMPOUNDCall::decode_OP_VERIFY(XdrReader& xdr, VERIFY4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
 
 int
-COMPOUNDCall::encode_OP_WRITE(RpcPacketPtr packet, const WRITE4args *arg)
+COMPOUNDCall::encode_OP_WRITE(XdrWriter& xdr, const WRITE4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->stateid.seqid));
-  RETURN_ON_ERROR(packet->xdrEncodeFixedOpaque((char*)arg->stateid.other, 12));
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->offset));
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(arg->stable));
-  RETURN_ON_ERROR(packet->xdrEncodeVarOpaque(arg->data.data_val, arg->data.data_len));
+  RETURN_ON_ERROR(xdr.reserve(4 + 12 + 8 + 4));
+  xdr.putUint32(arg->stateid.seqid);
+  xdr.putFixedOpaque(arg->stateid.other, 12);
+  xdr.putUint64(arg->offset);
+  xdr.putUint32(arg->stable);
+  RETURN_ON_ERROR(xdr.putVarOpaqueRef(arg->data.data_val, arg->data.data_len));
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_WRITE(RpcPacketPtr packet, WRITE4res *res)
+COMPOUNDCall::decode_OP_WRITE(XdrReader& xdr, WRITE4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
 
   res->status = (nfsstat4)opSts;
   if (opSts != NFS4_OK)
     return 0;
 
   uint32 count = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&count));
+  RETURN_ON_ERROR(xdr.decodeUint32(&count));
   res->WRITE4res_u.resok4.count = count;
 
   uint32 stable = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&stable));
+  RETURN_ON_ERROR(xdr.decodeUint32(&stable));
   res->WRITE4res_u.resok4.committed = (stable_how4)stable;
 
   verifier4 verfierwrite;
-  RETURN_ON_ERROR(packet->xdrDecodeFixedOpaque((unsigned char*)&verfierwrite,
+  RETURN_ON_ERROR(xdr.decodeFixedOpaque((unsigned char*)&verfierwrite,
                                                NFS4_VERIFIER_SIZE));
   memcpy(res->WRITE4res_u.resok4.writeverf, verfierwrite,NFS4_VERIFIER_SIZE);
 
@@ -1418,19 +1478,20 @@ COMPOUNDCall::decode_OP_WRITE(RpcPacketPtr packet, WRITE4res *res)
 }
 
 int
-COMPOUNDCall::encode_OP_RELEASE_LOCKOWNER(RpcPacketPtr packet, const RELEASE_LOCKOWNER4args *arg)
+COMPOUNDCall::encode_OP_RELEASE_LOCKOWNER(XdrWriter& xdr, const RELEASE_LOCKOWNER4args *arg)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint64(arg->lock_owner.clientid));
-  RETURN_ON_ERROR(packet->xdrEncodeVarOpaque(arg->lock_owner.owner.owner_val,
-                                             arg->lock_owner.owner.owner_len));
+  RETURN_ON_ERROR(xdr.reserve(8 + XdrWriter::varOpaqueSize(arg->lock_owner.owner.owner_len)));
+  xdr.putUint64(arg->lock_owner.clientid);
+  xdr.putVarOpaque(arg->lock_owner.owner.owner_val,
+                   arg->lock_owner.owner.owner_len);
   return 0;
 }
 
 int
-COMPOUNDCall::decode_OP_RELEASE_LOCKOWNER(RpcPacketPtr packet, RELEASE_LOCKOWNER4res *res)
+COMPOUNDCall::decode_OP_RELEASE_LOCKOWNER(XdrReader& xdr, RELEASE_LOCKOWNER4res *res)
 {
   uint32 opSts = 0;
-  RETURN_ON_ERROR(packet->xdrDecodeUint32(&opSts));
+  RETURN_ON_ERROR(xdr.decodeUint32(&opSts));
   res->status = (nfsstat4)opSts;
   return 0;
 }
@@ -1441,6 +1502,7 @@ COMPOUNDCall::decode_OP_RELEASE_LOCKOWNER(RpcPacketPtr packet, RELEASE_LOCKOWNER
  Whenever anything is encoded by RpcPacket the write index aka m_writeIndex
  moves to the proper position, so the same RpcPacket can be used to encode
  multiple commands. they will just be appended at the end.
+ The encoders share one XdrWriter, each op reserves its own worst case size.
 
  Similarly during decoding the read index aka m_readIndex is advanced accodringly.
  So if we give the same RpcPacket can be used to keep decoding multiple commands.
@@ -1450,233 +1512,236 @@ int COMPOUNDCall::encodeArguments()
   RpcPacketPtr request = getRequest();
   if (request)
   {
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(4 + 4 + 4));
     // set a empty tag
-    RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)NULL, 0));
+    xdr.putString(NULL, 0);
     // minor version is 0
-    RETURN_ON_ERROR(request->xdrEncodeUint32(args.minorversion));
+    xdr.putUint32(args.minorversion);
     // op count
-    RETURN_ON_ERROR(request->xdrEncodeUint32(args.argarray.argarray_len));
+    xdr.putUint32(args.argarray.argarray_len);
 
     // Now encode each command in the compound array to request buffer
     nfs_argop4 *cmdItem = args.argarray.argarray_val;
     for (unsigned i = 0; i < args.argarray.argarray_len; i++)
     {
       // op code
-      RETURN_ON_ERROR(request->xdrEncodeUint32(cmdItem->argop));
+      RETURN_ON_ERROR(xdr.reserve(4));
+      xdr.putUint32(cmdItem->argop);
       switch (cmdItem->argop)
       {
         case OP_ACCESS:
         {
           ACCESS4args *args = &(cmdItem->nfs_argop4_u.opaccess);
-          RETURN_ON_ERROR(encode_OP_ACCESS(request, args));
+          RETURN_ON_ERROR(encode_OP_ACCESS(xdr, args));
         }
         break;
         case OP_CLOSE:
         {
           CLOSE4args *args = &(cmdItem->nfs_argop4_u.opclose);
-          RETURN_ON_ERROR(encode_OP_CLOSE(request, args));
+          RETURN_ON_ERROR(encode_OP_CLOSE(xdr, args));
         }
         break;
         case OP_COMMIT:
         {
           COMMIT4args *args = &(cmdItem->nfs_argop4_u.opcommit);
-          RETURN_ON_ERROR(encode_OP_COMMIT(request, args));
+          RETURN_ON_ERROR(encode_OP_COMMIT(xdr, args));
         }
         break;
         case OP_CREATE:
         {
           CREATE4args *args = &(cmdItem->nfs_argop4_u.opcreate);
-          RETURN_ON_ERROR(encode_OP_CREATE(request, args));
+          RETURN_ON_ERROR(encode_OP_CREATE(xdr, args));
         }
         break;
         case OP_DELEGPURGE:
         {
           DELEGPURGE4args *args = &(cmdItem->nfs_argop4_u.opdelegpurge);
-          RETURN_ON_ERROR(encode_OP_DELEGPURGE(request, args));
+          RETURN_ON_ERROR(encode_OP_DELEGPURGE(xdr, args));
         }
         break;
         case OP_DELEGRETURN:
         {
           DELEGRETURN4args *args = &(cmdItem->nfs_argop4_u.opdelegreturn);
-          RETURN_ON_ERROR(encode_OP_DELEGRETURN(request, args));
+          RETURN_ON_ERROR(encode_OP_DELEGRETURN(xdr, args));
         }
         break;
         case OP_GETATTR:
         {
           GETATTR4args *args = &(cmdItem->nfs_argop4_u.opgetattr);
-          RETURN_ON_ERROR(encode_OP_GETATTR(request, args));
+          RETURN_ON_ERROR(encode_OP_GETATTR(xdr, args));
         }
         break;
         case OP_GETFH:
         {
-          RETURN_ON_ERROR(encode_OP_GETFH(request));
+          RETURN_ON_ERROR(encode_OP_GETFH(xdr));
         }
         break;
         case OP_LINK:
         {
           LINK4args *args = &(cmdItem->nfs_argop4_u.oplink);
-          RETURN_ON_ERROR(encode_OP_LINK(request, args));
+          RETURN_ON_ERROR(encode_OP_LINK(xdr, args));
         }
         break;
         case OP_LOCK:
         {
           LOCK4args *args = &(cmdItem->nfs_argop4_u.oplock);
-          RETURN_ON_ERROR(encode_OP_LOCK(request, args));
+          RETURN_ON_ERROR(encode_OP_LOCK(xdr, args));
         }
         break;
         case OP_LOCKT:
         {
           LOCKT4args *args = &(cmdItem->nfs_argop4_u.oplockt);
-          RETURN_ON_ERROR(encode_OP_LOCKT(request, args));
+          RETURN_ON_ERROR(encode_OP_LOCKT(xdr, args));
         }
         break;
         case OP_LOCKU:
         {
           LOCKU4args *args = &(cmdItem->nfs_argop4_u.oplocku);
-          RETURN_ON_ERROR(encode_OP_LOCKU(request, args));
+          RETURN_ON_ERROR(encode_OP_LOCKU(xdr, args));
         }
         break;
         case OP_LOOKUP:
         {
           LOOKUP4args *args = &(cmdItem->nfs_argop4_u.oplookup);
-          RETURN_ON_ERROR(encode_OP_LOOKUP(request, args));
+          RETURN_ON_ERROR(encode_OP_LOOKUP(xdr, args));
         }
         break;
         case OP_LOOKUPP:
         {
-          RETURN_ON_ERROR(encode_OP_LOOKUPP(request));
+          RETURN_ON_ERROR(encode_OP_LOOKUPP(xdr));
         }
         break;
         case OP_NVERIFY:
         {
           NVERIFY4args *args = &(cmdItem->nfs_argop4_u.opnverify);
-          RETURN_ON_ERROR(encode_OP_NVERIFY(request, args));
+          RETURN_ON_ERROR(encode_OP_NVERIFY(xdr, args));
         }
         break;
         case OP_OPEN:
         {
           OPEN4args *args = &(cmdItem->nfs_argop4_u.opopen);
-          RETURN_ON_ERROR(encode_OP_OPEN(request, args));
+          RETURN_ON_ERROR(encode_OP_OPEN(xdr, args));
         }
         break;
         case OP_OPENATTR:
         {
           OPENATTR4args *args = &(cmdItem->nfs_argop4_u.opopenattr);
-          RETURN_ON_ERROR(encode_OP_OPENATTR(request, args));
+          RETURN_ON_ERROR(encode_OP_OPENATTR(xdr, args));
         }
         break;
         case OP_OPEN_CONFIRM:
         {
           OPEN_CONFIRM4args *args = &(cmdItem->nfs_argop4_u.opopen_confirm);
-          RETURN_ON_ERROR(encode_OP_OPEN_CONFIRM(request, args));
+          RETURN_ON_ERROR(encode_OP_OPEN_CONFIRM(xdr, args));
         }
         break;
         case OP_OPEN_DOWNGRADE:
         {
           OPEN_DOWNGRADE4args *args = &(cmdItem->nfs_argop4_u.opopen_downgrade);
-          RETURN_ON_ERROR(encode_OP_OPEN_DOWNGRADE(request, args));
+          RETURN_ON_ERROR(encode_OP_OPEN_DOWNGRADE(xdr, args));
         }
         break;
         case OP_PUTFH:
         {
           PUTFH4args *args = &(cmdItem->nfs_argop4_u.opputfh);
-          RETURN_ON_ERROR(encode_OP_PUTFH(request, args));
+          RETURN_ON_ERROR(encode_OP_PUTFH(xdr, args));
         }
         break;
         case OP_PUTPUBFH:
         {
-          RETURN_ON_ERROR(encode_OP_PUTPUBFH(request));
+          RETURN_ON_ERROR(encode_OP_PUTPUBFH(xdr));
         }
         break;
         case OP_PUTROOTFH:
         {
-          RETURN_ON_ERROR(encode_OP_PUTROOTFH(request));
+          RETURN_ON_ERROR(encode_OP_PUTROOTFH(xdr));
         }
         break;
         case OP_READ:
         {
           READ4args *args = &(cmdItem->nfs_argop4_u.opread);
-          RETURN_ON_ERROR(encode_OP_READ(request, args));
+          RETURN_ON_ERROR(encode_OP_READ(xdr, args));
         }
         break;
         case OP_READDIR:
         {
           READDIR4args *args = &(cmdItem->nfs_argop4_u.opreaddir);
-          RETURN_ON_ERROR(encode_OP_READDIR(request, args));
+          RETURN_ON_ERROR(encode_OP_READDIR(xdr, args));
         }
         break;
         case OP_READLINK:
         {
-          RETURN_ON_ERROR(encode_OP_READLINK(request));
+          RETURN_ON_ERROR(encode_OP_READLINK(xdr));
         }
         break;
         case OP_REMOVE:
         {
           REMOVE4args *args = &(cmdItem->nfs_argop4_u.opremove);
-          RETURN_ON_ERROR(encode_OP_REMOVE(request, args));
+          RETURN_ON_ERROR(encode_OP_REMOVE(xdr, args));
         }
         break;
         case OP_RENAME:
         {
           RENAME4args *args = &(cmdItem->nfs_argop4_u.oprename);
-          RETURN_ON_ERROR(encode_OP_RENAME(request, args));
+          RETURN_ON_ERROR(encode_OP_RENAME(xdr, args));
         }
         break;
         case OP_RENEW:
         {
           RENEW4args *args = &(cmdItem->nfs_argop4_u.oprenew);
-          RETURN_ON_ERROR(encode_OP_RENEW(request, args));
+          RETURN_ON_ERROR(encode_OP_RENEW(xdr, args));
         }
         break;
         case OP_RESTOREFH:
         {
-          RETURN_ON_ERROR(encode_OP_RESTOREFH(request));
+          RETURN_ON_ERROR(encode_OP_RESTOREFH(xdr));
         }
         break;
         case OP_SAVEFH:
         {
-          RETURN_ON_ERROR(encode_OP_SAVEFH(request));
+          RETURN_ON_ERROR(encode_OP_SAVEFH(xdr));
         }
         break;
         case OP_SECINFO:
         {
-          RETURN_ON_ERROR(encode_OP_SECINFO(request));
+          RETURN_ON_ERROR(encode_OP_SECINFO(xdr));
         }
         break;
         case OP_SETATTR:
         {
           SETATTR4args *args = &(cmdItem->nfs_argop4_u.opsetattr);
-          RETURN_ON_ERROR(encode_OP_SETATTR(request, args));
+          RETURN_ON_ERROR(encode_OP_SETATTR(xdr, args));
         }
         break;
         case OP_SETCLIENTID:
         {
           SETCLIENTID4args *args = &(cmdItem->nfs_argop4_u.opsetclientid);
-          RETURN_ON_ERROR(encode_OP_SETCLIENTID(request, args));
+          RETURN_ON_ERROR(encode_OP_SETCLIENTID(xdr, args));
         }
         break;
         case OP_SETCLIENTID_CONFIRM:
         {
           SETCLIENTID_CONFIRM4args *args = &(cmdItem->nfs_argop4_u.opsetclientid_confirm);
-          RETURN_ON_ERROR(encode_OP_SETCLIENTID_CONFIRM(request, args));
+          RETURN_ON_ERROR(encode_OP_SETCLIENTID_CONFIRM(xdr, args));
         }
         break;
         case OP_VERIFY:
         {
           VERIFY4args *args = &(cmdItem->nfs_argop4_u.opverify);
-          RETURN_ON_ERROR(encode_OP_VERIFY(request, args));
+          RETURN_ON_ERROR(encode_OP_VERIFY(xdr, args));
         }
         break;
         case OP_WRITE:
         {
           WRITE4args *args = &(cmdItem->nfs_argop4_u.opwrite);
-          RETURN_ON_ERROR(encode_OP_WRITE(request, args));
+          RETURN_ON_ERROR(encode_OP_WRITE(xdr, args));
         }
         break;
         case OP_RELEASE_LOCKOWNER:
         {
           RELEASE_LOCKOWNER4args *args = &(cmdItem->nfs_argop4_u.oprelease_lockowner);
-          RETURN_ON_ERROR(encode_OP_RELEASE_LOCKOWNER(request, args));
+          RETURN_ON_ERROR(encode_OP_RELEASE_LOCKOWNER(xdr, args));
         }
         break;
         default:
@@ -1696,7 +1761,8 @@ int COMPOUNDCall::decodeResults()
   if (reply == NULL)
     return -1;
 
-  RETURN_ON_ERROR(reply->xdrDecodeUint32(&status));
+  XdrReader xdr(reply);
+  RETURN_ON_ERROR(xdr.decodeUint32(&status));
   res.status = (nfsstat4)status;
 
   /* The following are always received, on success or on failure.
@@ -1706,10 +1772,10 @@ int COMPOUNDCall::decodeResults()
   {
     unsigned char* tag = NULL;
     uint32 tagLen;
-    RETURN_ON_ERROR(reply->xdrDecodeString(tag, tagLen));
+    RETURN_ON_ERROR(xdr.decodeString(tag, tagLen));
 
     uint32 opCount = 0;
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&opCount));
+    RETURN_ON_ERROR(xdr.decodeUint32(&opCount));
     res.resarray.resarray_len = opCount;
 
     res.resarray.resarray_val = NULL;
@@ -1722,229 +1788,229 @@ int COMPOUNDCall::decodeResults()
     for (unsigned i = 0; i < opCount; i++)
     {
       uint32 opCode = 0;
-      RETURN_ON_ERROR(reply->xdrDecodeUint32(&opCode));
+      RETURN_ON_ERROR(xdr.decodeUint32(&opCode));
       cmdReply->resop = (nfs_opnum4)opCode;
       switch (opCode)
       {
         case OP_ACCESS:
         {
           ACCESS4res *result = &(cmdReply->nfs_resop4_u.opaccess);
-          RETURN_ON_ERROR(decode_OP_ACCESS(reply, result));
+          RETURN_ON_ERROR(decode_OP_ACCESS(xdr, result));
         }
         break;
         case OP_CLOSE:
         {
           CLOSE4res *result = &(cmdReply->nfs_resop4_u.opclose);
-          RETURN_ON_ERROR(decode_OP_CLOSE(reply, result));
+          RETURN_ON_ERROR(decode_OP_CLOSE(xdr, result));
         }
         break;
         case OP_COMMIT:
         {
           COMMIT4res *result = &(cmdReply->nfs_resop4_u.opcommit);
-          RETURN_ON_ERROR(decode_OP_COMMIT(reply, result));
+          RETURN_ON_ERROR(decode_OP_COMMIT(xdr, result));
         }
         break;
         case OP_CREATE:
         {
           CREATE4res *result = &(cmdReply->nfs_resop4_u.opcreate);
-          RETURN_ON_ERROR(decode_OP_CREATE(reply, result));
+          RETURN_ON_ERROR(decode_OP_CREATE(xdr, result));
         }
         break;
         case OP_DELEGPURGE:
         {
           DELEGPURGE4res *result = &(cmdReply->nfs_resop4_u.opdelegpurge);
-          RETURN_ON_ERROR(decode_OP_DELEGPURGE(reply, result));
+          RETURN_ON_ERROR(decode_OP_DELEGPURGE(xdr, result));
         }
         break;
         case OP_DELEGRETURN:
         {
           DELEGRETURN4res *result = &(cmdReply->nfs_resop4_u.opdelegreturn);
-          RETURN_ON_ERROR(decode_OP_DELEGRETURN(reply, result));
+          RETURN_ON_ERROR(decode_OP_DELEGRETURN(xdr, result));
         }
         break;
         case OP_GETATTR:
         {
           GETATTR4res *result = &(cmdReply->nfs_resop4_u.opgetattr);
-          RETURN_ON_ERROR(decode_OP_GETATTR(reply, result));
+          RETURN_ON_ERROR(decode_OP_GETATTR(xdr, result));
         }
         break;
         case OP_GETFH:
         {
           GETFH4res *result = &(cmdReply->nfs_resop4_u.opgetfh);
-          RETURN_ON_ERROR(decode_OP_GETFH(reply, result));
+          RETURN_ON_ERROR(decode_OP_GETFH(xdr, result));
         }
         break;
         case OP_LINK:
         {
           LINK4res *result = &(cmdReply->nfs_resop4_u.oplink);
-          RETURN_ON_ERROR(decode_OP_LINK(reply, result));
+          RETURN_ON_ERROR(decode_OP_LINK(xdr, result));
         }
         break;
         case OP_LOCK:
         {
           LOCK4res *result = &(cmdReply->nfs_resop4_u.oplock);
-          RETURN_ON_ERROR(decode_OP_LOCK(reply, result));
+          RETURN_ON_ERROR(decode_OP_LOCK(xdr, result));
         }
         break;
         case OP_LOCKT:
         {
           LOCKT4res *result = &(cmdReply->nfs_resop4_u.oplockt);
-          RETURN_ON_ERROR(decode_OP_LOCKT(reply, result));
+          RETURN_ON_ERROR(decode_OP_LOCKT(xdr, result));
         }
         break;
         case OP_LOCKU:
         {
           LOCKU4res *result = &(cmdReply->nfs_resop4_u.oplocku);
-          RETURN_ON_ERROR(decode_OP_LOCKU(reply, result));
+          RETURN_ON_ERROR(decode_OP_LOCKU(xdr, result));
         }
         break;
         case OP_LOOKUP:
         {
           LOOKUP4res *result = &(cmdReply->nfs_resop4_u.oplookup);
-          RETURN_ON_ERROR(decode_OP_LOOKUP(reply, result));
+          RETURN_ON_ERROR(decode_OP_LOOKUP(xdr, result));
         }
         break;
         case OP_LOOKUPP:
         {
           LOOKUPP4res *result = &(cmdReply->nfs_resop4_u.oplookupp);
-          RETURN_ON_ERROR(decode_OP_LOOKUPP(reply, result));
+          RETURN_ON_ERROR(decode_OP_LOOKUPP(xdr, result));
         }
         break;
         case OP_NVERIFY:
         {
           NVERIFY4res *result = &(cmdReply->nfs_resop4_u.opnverify);
-          RETURN_ON_ERROR(decode_OP_NVERIFY(reply, result));
+          RETURN_ON_ERROR(decode_OP_NVERIFY(xdr, result));
         }
         break;
         case OP_OPEN:
         {
           OPEN4res *result = &(cmdReply->nfs_resop4_u.opopen);
-          RETURN_ON_ERROR(decode_OP_OPEN(reply, result));
+          RETURN_ON_ERROR(decode_OP_OPEN(xdr, result));
         }
         break;
         case OP_OPENATTR:
         {
           OPENATTR4res *result = &(cmdReply->nfs_resop4_u.opopenattr);
-          RETURN_ON_ERROR(decode_OP_OPENATTR(reply, result));
+          RETURN_ON_ERROR(decode_OP_OPENATTR(xdr, result));
         }
         break;
         case OP_OPEN_CONFIRM:
         {
           OPEN_CONFIRM4res *result = &(cmdReply->nfs_resop4_u.opopen_confirm);
-          RETURN_ON_ERROR(decode_OP_OPEN_CONFIRM(reply, result));
+          RETURN_ON_ERROR(decode_OP_OPEN_CONFIRM(xdr, result));
         }
         break;
         case OP_OPEN_DOWNGRADE:
         {
           OPEN_DOWNGRADE4res *result = &(cmdReply->nfs_resop4_u.opopen_downgrade);
-          RETURN_ON_ERROR(decode_OP_OPEN_DOWNGRADE(reply, result));
+          RETURN_ON_ERROR(decode_OP_OPEN_DOWNGRADE(xdr, result));
         }
         break;
         case OP_PUTFH:
         {
           PUTFH4res *result = &(cmdReply->nfs_resop4_u.opputfh);
-          RETURN_ON_ERROR(decode_OP_PUTFH(reply, result));
+          RETURN_ON_ERROR(decode_OP_PUTFH(xdr, result));
         }
         break;
         case OP_PUTPUBFH:
         {
           PUTPUBFH4res *result = &(cmdReply->nfs_resop4_u.opputpubfh);
-          RETURN_ON_ERROR(decode_OP_PUTPUBFH(reply, result));
+          RETURN_ON_ERROR(decode_OP_PUTPUBFH(xdr, result));
         }
         break;
         case OP_PUTROOTFH:
         {
           PUTROOTFH4res *result = &(cmdReply->nfs_resop4_u.opputrootfh);
-          RETURN_ON_ERROR(decode_OP_PUTROOTFH(reply, result));
+          RETURN_ON_ERROR(decode_OP_PUTROOTFH(xdr, result));
         }
         break;
         case OP_READ:
         {
           READ4res *result = &(cmdReply->nfs_resop4_u.opread);
-          RETURN_ON_ERROR(decode_OP_READ(reply, result));
+          RETURN_ON_ERROR(decode_OP_READ(xdr, result));
         }
         break;
         case OP_READDIR:
         {
           READDIR4res *result = &(cmdReply->nfs_resop4_u.opreaddir);
-          RETURN_ON_ERROR(decode_OP_READDIR(reply, result));
+          RETURN_ON_ERROR(decode_OP_READDIR(xdr, result));
         }
         break;
         case OP_READLINK:
         {
           READLINK4res *result = &(cmdReply->nfs_resop4_u.opreadlink);
-          RETURN_ON_ERROR(decode_OP_READLINK(reply, result));
+          RETURN_ON_ERROR(decode_OP_READLINK(xdr, result));
         }
         break;
         case OP_REMOVE:
         {
           REMOVE4res *result = &(cmdReply->nfs_resop4_u.opremove);
-          RETURN_ON_ERROR(decode_OP_REMOVE(reply, result));
+          RETURN_ON_ERROR(decode_OP_REMOVE(xdr, result));
         }
         break;
         case OP_RENAME:
         {
           RENAME4res *result = &(cmdReply->nfs_resop4_u.oprename);
-          RETURN_ON_ERROR(decode_OP_RENAME(reply, result));
+          RETURN_ON_ERROR(decode_OP_RENAME(xdr, result));
         }
         break;
         case OP_RENEW:
         {
           RENEW4res *result = &(cmdReply->nfs_resop4_u.oprenew);
-          RETURN_ON_ERROR(decode_OP_RENEW(reply, result));
+          RETURN_ON_ERROR(decode_OP_RENEW(xdr, result));
         }
         break;
         case OP_RESTOREFH:
         {
           RESTOREFH4res *result = &(cmdReply->nfs_resop4_u.oprestorefh);
-          RETURN_ON_ERROR(decode_OP_RESTOREFH(reply, result));
+          RETURN_ON_ERROR(decode_OP_RESTOREFH(xdr, result));
         }
         break;
         case OP_SAVEFH:
         {
           SAVEFH4res *result = &(cmdReply->nfs_resop4_u.opsavefh);
-          RETURN_ON_ERROR(decode_OP_SAVEFH(reply, result));
+          RETURN_ON_ERROR(decode_OP_SAVEFH(xdr, result));
         }
         break;
         case OP_SECINFO:
         {
-          RETURN_ON_ERROR(decode_OP_SECINFO(reply));
+          RETURN_ON_ERROR(decode_OP_SECINFO(xdr));
         }
         break;
         case OP_SETATTR:
         {
           SETATTR4res *result = &(cmdReply->nfs_resop4_u.opsetattr);
-          RETURN_ON_ERROR(decode_OP_SETATTR(reply, result));
+          RETURN_ON_ERROR(decode_OP_SETATTR(xdr, result));
         }
         break;
         case OP_SETCLIENTID:
         {
           SETCLIENTID4res *result = &(cmdReply->nfs_resop4_u.opsetclientid);
-          RETURN_ON_ERROR(decode_OP_SETCLIENTID(reply, result));
+          RETURN_ON_ERROR(decode_OP_SETCLIENTID(xdr, result));
         }
         break;
         case OP_SETCLIENTID_CONFIRM:
         {
           SETCLIENTID_CONFIRM4res *result = &(cmdReply->nfs_resop4_u.opsetclientid_confirm);
-          RETURN_ON_ERROR(decode_OP_SETCLIENTID_CONFIRM(reply, result));
+          RETURN_ON_ERROR(decode_OP_SETCLIENTID_CONFIRM(xdr, result));
         }
         break;
         case OP_VERIFY:
         {
           VERIFY4res *result = &(cmdReply->nfs_resop4_u.opverify);
-          RETURN_ON_ERROR(decode_OP_VERIFY(reply, result));
+          RETURN_ON_ERROR(decode_OP_VERIFY(xdr, result));
         }
         break;
         case OP_WRITE:
         {
           WRITE4res *result = &(cmdReply->nfs_resop4_u.opwrite);
-          RETURN_ON_ERROR(decode_OP_WRITE(reply, result));
+          RETURN_ON_ERROR(decode_OP_WRITE(xdr, result));
         }
         break;
         case OP_RELEASE_LOCKOWNER:
         {
           RELEASE_LOCKOWNER4res *result = &(cmdReply->nfs_resop4_u.oprelease_lockowner);
-          RETURN_ON_ERROR(decode_OP_RELEASE_LOCKOWNER(reply, result));
+          RETURN_ON_ERROR(decode_OP_RELEASE_LOCKOWNER(xdr, result));
         }
         break;
         default:
@@ -20,19 +20,25 @@
 #include "RpcConnection.h"
 #include "NfsUtil.h"
 #include "RpcDefs.h"
+#include "XdrWriter.h"
+#include "XdrReader.h"
 #include <syslog.h>
 #include <iostream>
 
 namespace OpenNfsC {
 namespace NFSv3{
 
+#define FH3_SIZE(fh) XdrWriter::varOpaqueSize((fh)->fh3_data.fh3_data_len)
+#define PUT_FH3(xdr, fh) (xdr).putVarOpaque((fh)->fh3_data.fh3_data_val, (fh)->fh3_data.fh3_data_len)
+
 #define DECODE_STATUS() \
    \
     uint32 status; \
     RpcPacketPtr reply = getReply(); \
     if (reply == NULL) \
         return -1; \
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&status)); \
+    XdrReader xdr(reply); \
+    RETURN_ON_ERROR(xdr.decodeUint32(&status)); \
     res.status = (nfsstat3)status; \
    \
 
@@ -51,7 +57,9 @@ int GetAttrCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.getattr3_object;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh)));
+    PUT_FH3(xdr, fh);
     return 0;
   }
   return -1;
@@ -65,11 +73,13 @@ int GetAttrCall::decodeResults()
   if (reply == NULL)
     return -1;
 
-  RETURN_ON_ERROR(reply->xdrDecodeUint32(&status));
+  XdrReader xdr(reply);
+
+  RETURN_ON_ERROR(xdr.decodeUint32(&status));
   res.status = (nfsstat3)status;
   if (status == 0)
   {
-    RETURN_ON_ERROR(NfsUtil::decodeFattr3(reply,&res.GETATTR3res_u.getattr3ok.getattr3_obj_attributes));
+    RETURN_ON_ERROR(NfsUtil::decodeFattr3(xdr,&res.GETATTR3res_u.getattr3ok.getattr3_obj_attributes));
     return 0;
   }
   return -1;
@@ -90,11 +100,16 @@ int SetAttrCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.setattr3_object;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
-    RETURN_ON_ERROR(NfsUtil::encodeSattr3(request, &args.setattr3_new_attributes));
-    RETURN_ON_ERROR(request->xdrEncodeUint32(args.setattr3_guard.check));
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + NfsUtil::SATTR3_MAX_SIZE + 4 + 8));
+    PUT_FH3(xdr, fh);
+    NfsUtil::encodeSattr3(xdr, &args.setattr3_new_attributes);
+    xdr.putUint32(args.setattr3_guard.check);
     if (args.setattr3_guard.check)
-      RETURN_ON_ERROR(ENCODEVAR(request,args.setattr3_guard.sattrguard3_u.sattr3_obj_ctime));
+    {
+      xdr.putUint32(args.setattr3_guard.sattrguard3_u.sattr3_obj_ctime.time3_seconds);
+      xdr.putUint32(args.setattr3_guard.sattrguard3_u.sattr3_obj_ctime.time3_nseconds);
+    }
     return 0;
   }
   return -1;
@@ -122,9 +137,12 @@ int LookUpCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.lookup3_what.dirop3_dir;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
     char * filename = args.lookup3_what.dirop3_name;
-    RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)filename, strlen((const char*)filename)));
+    uint32 nameLen = strlen((const char*)filename);
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + XdrWriter::varOpaqueSize(nameLen)));
+    PUT_FH3(xdr, fh);
+    xdr.putString(filename, nameLen);
     return 0;
   }
   return -1;
@@ -135,17 +153,17 @@ int LookUpCall::decodeResults()
   DECODE_STATUS();
   if (status == 0)
   {
-    RETURN_ON_ERROR(NfsUtil::decodeFH3(reply, &res.LOOKUP3res_u.lookup3ok.lookup3_object));
+    RETURN_ON_ERROR(NfsUtil::decodeFH3(xdr, &res.LOOKUP3res_u.lookup3ok.lookup3_object));
     struct post_op_attr* postAttr = &res.LOOKUP3res_u.lookup3ok.lookup3_obj_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
     postAttr = &res.LOOKUP3res_u.lookup3ok.lookup3_dir_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
     return 0;
   }
   else
   {
     struct post_op_attr* postAttr = &res.LOOKUP3res_u.lookup3fail.lookup3fail_dir_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
     return 0;
   }
   return -1;
@@ -167,8 +185,10 @@ int AccessCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.access3_object;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
-    RETURN_ON_ERROR(request->xdrEncodeUint32((args.access3_access)));
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + 4));
+    PUT_FH3(xdr, fh);
+    xdr.putUint32(args.access3_access);
     return 0;
   }
   return -1;
@@ -180,16 +200,16 @@ int AccessCall::decodeResults()
   if (status == 0)
   {
     struct post_op_attr* postAttr = &res.ACCESS3res_u.access3ok.access3_obj_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
     uint32 access;
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&access));
+    RETURN_ON_ERROR(xdr.decodeUint32(&access));
     res.ACCESS3res_u.access3ok.access3_res = access;
     return 0;
   }
   else
   {
     struct post_op_attr* postAttr = &res.ACCESS3res_u.access3fail.access3fail_obj_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
     return 0;
   }
   return -1;
@@ -213,7 +233,9 @@ int ReadLinkCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.readlink3_symlink;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh)));
+    PUT_FH3(xdr, fh);
     return 0;
   }
   return -1;
@@ -225,27 +247,68 @@ int ReadLinkCall::decodeResults()
   if (status == 0)
   {
     struct post_op_attr* postAttr = &res.READLINK3res_u.readlink3ok.readlink3_symlink_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
-    RETURN_ON_ERROR(NfsUtil::decodeString(reply, &res.READLINK3res_u.readlink3ok.readlink3_data));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodeString(xdr, &res.READLINK3res_u.readlink3ok.readlink3_data));
     return 0;
   }
   else
   {
     struct post_op_attr* postAttr = &res.READLINK3res_u.readlink3fail.readlink3fail_symlink_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
     return 0;
   }
   return -1;
 }
 
 // read call
+int ReadSink::locatePayload(const unsigned char* rec, uint32 len, uint32& offset, uint32& length)
+{
+  uint32 off = 0;
+  uint32 val = 0;
+  int outcome = skipReplyHeader(rec, len, off);
+  if (outcome != 0)
+    return outcome;
+
+  // status
+  if (getUint32(rec, len, off, val) != 0)
+    return 1;
+  if (val != NFS3_OK)
+    return -1;
+  off += sizeof(uint32);
+
+  // post op attributes
+  if (getUint32(rec, len, off, val) != 0)
+    return 1;
+  off += sizeof(uint32);
+  if (val)
+    off += 84; // fattr3
+
+  // count, eof, then the data length
+  off += 2 * sizeof(uint32);
+  if (getUint32(rec, len, off, val) != 0)
+    return 1;
+  off += sizeof(uint32);
+
+  offset = off;
+  length = val;
+  return 0;
+}
+
 ReadCall::ReadCall(const READ3args&  arg)
- :RemoteCall(NFS, NFS_V3_READ),args(arg), res()
+ :RemoteCall(NFS, NFS_V3_READ),args(arg), res(), m_sink(NULL)
+{
+}
+
+ReadCall::ReadCall(const READ3args&  arg, const struct iovec* iov, int iovcnt)
+ :RemoteCall(NFS, NFS_V3_READ),args(arg), res(), m_sink(new ReadSink(iov, iovcnt))
 {
+  setReplySink(m_sink);
 }
 
 ReadCall::~ReadCall()
 {
+  if (m_sink)
+    delete m_sink;
 }
 
 int ReadCall::encodeArguments()
@@ -254,9 +317,11 @@ int ReadCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.read3_file;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
-    RETURN_ON_ERROR(request->xdrEncodeUint64((args.read3_offset)));
-    RETURN_ON_ERROR(request->xdrEncodeUint32((args.read3_count)));
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + 8 + 4));
+    PUT_FH3(xdr, fh);
+    xdr.putUint64(args.read3_offset);
+    xdr.putUint32(args.read3_count);
     return 0;
   }
   return -1;
@@ -268,16 +333,30 @@ int ReadCall::decodeResults()
   if (status == 0)
   {
     struct post_op_attr* postAttr = &res.READ3res_u.read3ok.read3_file_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
     uint32 readtmp;
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&readtmp));
+    RETURN_ON_ERROR(xdr.decodeUint32(&readtmp));
     res.READ3res_u.read3ok.read3_count_res = readtmp;
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&readtmp));
+    RETURN_ON_ERROR(xdr.decodeUint32(&readtmp));
     res.READ3res_u.read3ok.read3_eof = readtmp;
 
     unsigned char* dataPtr = NULL;
     uint32 dataLen;
-    RETURN_ON_ERROR(reply->xdrDecodeString(dataPtr, dataLen));
+    if (m_sink && m_sink->isPlaced())
+    {
+      // the data went to the caller buffers on receive
+      RETURN_ON_ERROR(xdr.decodeUint32(&dataLen));
+      RETURN_ON_ERROR(xdr.skip(XdrReader::fixedOpaqueSize(dataLen) - dataLen));
+    }
+    else
+    {
+      RETURN_ON_ERROR(xdr.decodeString(dataPtr, dataLen));
+      if (m_sink)
+      {
+        RETURN_ON_ERROR(m_sink->copyIn(dataPtr, dataLen));
+        dataPtr = NULL;
+      }
+    }
 
     if (res.READ3res_u.read3ok.read3_count_res != dataLen)
       return -1;
@@ -290,7 +369,7 @@ int ReadCall::decodeResults()
   else
   {
     struct post_op_attr* postAttr = &res.READ3res_u.read3fail.read3fail_file_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
     return 0;
   }
   return -1;
@@ -312,11 +391,14 @@ int WriteCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.write3_file;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
-    RETURN_ON_ERROR(request->xdrEncodeUint64((args.write3_offset)));
-    RETURN_ON_ERROR(request->xdrEncodeUint32((args.write3_count)));
-    RETURN_ON_ERROR(request->xdrEncodeUint32((args.write3_stable)));
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(args.write3_data.write3_data_val, args.write3_data.write3_data_len));
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + 8 + 4 + 4));
+    PUT_FH3(xdr, fh);
+    xdr.putUint64(args.write3_offset);
+    xdr.putUint32(args.write3_count);
+    xdr.putUint32(args.write3_stable);
+    // the data may be referenced instead of copied
+    RETURN_ON_ERROR(xdr.putVarOpaqueRef(args.write3_data.write3_data_val, args.write3_data.write3_data_len));
     return 0;
   }
   return -1;
@@ -328,21 +410,21 @@ int WriteCall::decodeResults()
   if (status == 0)
   {
     struct wcc_data* wccData = &res.WRITE3res_u.write3ok.write3_file_wcc;
-    RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+    RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
 
     uint32 writeInt;
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&writeInt));
+    RETURN_ON_ERROR(xdr.decodeUint32(&writeInt));
     res.WRITE3res_u.write3ok.write3_count_res = writeInt;
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&writeInt));
+    RETURN_ON_ERROR(xdr.decodeUint32(&writeInt));
     res.WRITE3res_u.write3ok.write3_committed = (enum stable_how)writeInt;
 
-    RETURN_ON_ERROR(DECODEVAR(reply, res.WRITE3res_u.write3ok.write3_verf));
+    RETURN_ON_ERROR(DECODEVAR(xdr, res.WRITE3res_u.write3ok.write3_verf));
     return 0;
   }
   else
   {
     struct wcc_data* wccData = &res.WRITE3res_u.write3fail.write3fail_file_wcc;
-    RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+    RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
     return 0;
   }
   return -1;
@@ -364,19 +446,22 @@ int CreateCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.create3_where.dirop3_dir;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
     char * filename = args.create3_where.dirop3_name;
-    RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)filename, strlen((const char*)filename)));
-    RETURN_ON_ERROR(request->xdrEncodeUint32(args.create3_how.mode));
+    uint32 nameLen = strlen((const char*)filename);
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + XdrWriter::varOpaqueSize(nameLen) + 4 + NfsUtil::SATTR3_MAX_SIZE));
+    PUT_FH3(xdr, fh);
+    xdr.putString(filename, nameLen);
+    xdr.putUint32(args.create3_how.mode);
 
     switch (args.create3_how.mode)
     {
       case CREATE_UNCHECKED:
       case CREATE_GUARDED:
-        RETURN_ON_ERROR(NfsUtil::encodeSattr3(request, &args.create3_how.createhow3_u.create3_obj_attributes));
+        NfsUtil::encodeSattr3(xdr, &args.create3_how.createhow3_u.create3_obj_attributes);
       break;
       case CREATE_EXCLUSIVE:
-        RETURN_ON_ERROR(ENCODEVAR(request, args.create3_how.createhow3_u.create3_verf));
+        xdr.putFixedOpaque(args.create3_how.createhow3_u.create3_verf, NFS3_CREATEVERFSIZE);
       default:
       break;
     }
@@ -390,17 +475,17 @@ int CreateCall::decodeResults()
   DECODE_STATUS();
   if (status == 0)
   {
-    RETURN_ON_ERROR(NfsUtil::decodePostOpFH3(reply, &res.CREATE3res_u.create3_ok.create3_obj));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpFH3(xdr, &res.CREATE3res_u.create3_ok.create3_obj));
     struct post_op_attr* postAttr = &res.CREATE3res_u.create3_ok.create3_obj_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
     struct wcc_data* wccData = &res.CREATE3res_u.create3_ok.create3_dir_wcc;
-    RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+    RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
     return 0;
   }
   else
   {
     struct wcc_data* wccData = &res.CREATE3res_u.create3fail.create3fail_dir_wcc;
-    RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+    RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
     return 0;
   }
   return -1;
@@ -423,10 +508,13 @@ int MkdirCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.mkdir3_where.dirop3_dir;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
     char * filename = args.mkdir3_where.dirop3_name;
-    RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)filename, strlen((const char*)filename)));
-    RETURN_ON_ERROR(NfsUtil::encodeSattr3(request, &args.mkdir3_attributes));
+    uint32 nameLen = strlen((const char*)filename);
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + XdrWriter::varOpaqueSize(nameLen) + NfsUtil::SATTR3_MAX_SIZE));
+    PUT_FH3(xdr, fh);
+    xdr.putString(filename, nameLen);
+    NfsUtil::encodeSattr3(xdr, &args.mkdir3_attributes);
     return 0;
   }
   return -1;
@@ -437,17 +525,17 @@ int MkdirCall::decodeResults()
   DECODE_STATUS();
   if (status == 0)
   {
-    RETURN_ON_ERROR(NfsUtil::decodePostOpFH3(reply, &res.MKDIR3res_u.mkdir3ok.mkdir3_obj));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpFH3(xdr, &res.MKDIR3res_u.mkdir3ok.mkdir3_obj));
     struct post_op_attr* postAttr = &res.MKDIR3res_u.mkdir3ok.mkdir3_obj_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
     struct wcc_data* wccData = &res.MKDIR3res_u.mkdir3ok.mkdir3_dir_wcc;
-    RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+    RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
     return 0;
   }
   else
   {
     struct wcc_data* wccData = &res.MKDIR3res_u.mkdir3fail.mkdir3fail_dir_wcc;
-    RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+    RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
     return 0;
   }
   return -1;
@@ -469,12 +557,17 @@ int SymLinkCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.symlink3_where.dirop3_dir;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
     char * filename = args.symlink3_where.dirop3_name;
-    RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)filename, strlen((const char*)filename)));
-    RETURN_ON_ERROR(NfsUtil::encodeSattr3(request, &args.symlink3_symlink.symlink3_attributes));
+    uint32 nameLen = strlen((const char*)filename);
     char *symname = args.symlink3_symlink.symlink3_data;
-    RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)symname, strlen((const char*)symname)));
+    uint32 symLen = strlen((const char*)symname);
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + XdrWriter::varOpaqueSize(nameLen) + NfsUtil::SATTR3_MAX_SIZE +
+                                XdrWriter::varOpaqueSize(symLen)));
+    PUT_FH3(xdr, fh);
+    xdr.putString(filename, nameLen);
+    NfsUtil::encodeSattr3(xdr, &args.symlink3_symlink.symlink3_attributes);
+    xdr.putString(symname, symLen);
     return 0;
   }
   return -1;
@@ -485,16 +578,16 @@ int SymLinkCall::decodeResults()
   DECODE_STATUS();
   if (status == 0)
   {
-    RETURN_ON_ERROR(NfsUtil::decodePostOpFH3(reply, &res.SYMLINK3res_u.symlink3ok.symlink3_obj));
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, &res.SYMLINK3res_u.symlink3ok.symlink3_obj_attributes));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpFH3(xdr, &res.SYMLINK3res_u.symlink3ok.symlink3_obj));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, &res.SYMLINK3res_u.symlink3ok.symlink3_obj_attributes));
     struct wcc_data* wccData = &res.SYMLINK3res_u.symlink3ok.symlink3_dir_wcc;
-    RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+    RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
     return 0;
   }
   else
   {
     struct wcc_data* wccData = &res.SYMLINK3res_u.symlink3fail.symlink3fail_dir_wcc;
-    RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+    RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
     return 0;
   }
   return -1;
@@ -517,23 +610,26 @@ int MknodCall::encodeArguments()
   {
     nfs_fh3* fh = &args.mknod3_where.dirop3_dir;
     char * filename = args.mknod3_where.dirop3_name;
+    uint32 nameLen = strlen((const char*)filename);
 
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
-    RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)filename, strlen((const char*)filename)));
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + XdrWriter::varOpaqueSize(nameLen) + 4 + NfsUtil::SATTR3_MAX_SIZE + 4 + 4));
+    PUT_FH3(xdr, fh);
+    xdr.putString(filename, nameLen);
 
-    RETURN_ON_ERROR(request->xdrEncodeUint32(args.mknod3_what.type));
+    xdr.putUint32(args.mknod3_what.type);
 
     switch (args.mknod3_what.type)
     {
       case NF3CHR:
       case NF3BLK:
-        RETURN_ON_ERROR(NfsUtil::encodeSattr3(request, &args.mknod3_what.mknoddata3_u.mknod3_device.dev3_attributes));
-        RETURN_ON_ERROR(request->xdrEncodeUint32(args.mknod3_what.mknoddata3_u.mknod3_device.dev3_spec.specdata1));
-        RETURN_ON_ERROR(request->xdrEncodeUint32(args.mknod3_what.mknoddata3_u.mknod3_device.dev3_spec.specdata2));
+        NfsUtil::encodeSattr3(xdr, &args.mknod3_what.mknoddata3_u.mknod3_device.dev3_attributes);
+        xdr.putUint32(args.mknod3_what.mknoddata3_u.mknod3_device.dev3_spec.specdata1);
+        xdr.putUint32(args.mknod3_what.mknoddata3_u.mknod3_device.dev3_spec.specdata2);
       break;
       case NF3SOCK:
       case NF3FIFO:
-        RETURN_ON_ERROR(NfsUtil::encodeSattr3(request, &args.mknod3_what.mknoddata3_u.mknod3_pipe_attributes));
+        NfsUtil::encodeSattr3(xdr, &args.mknod3_what.mknoddata3_u.mknod3_pipe_attributes);
       default:
       break;
     }
@@ -550,15 +646,15 @@ int MknodCall::decodeResults()
     struct post_op_fh3 * postfh = &res.MKNOD3res_u.mknod3ok.mknod3_obj;
     struct post_op_attr* postattr = &res.MKNOD3res_u.mknod3ok.mknod3_obj_attributes;
     struct wcc_data* wccData = &res.MKNOD3res_u.mknod3ok.mknod3_dir_wcc;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpFH3(reply, postfh));
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postattr));
-    RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpFH3(xdr, postfh));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postattr));
+    RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
     return 0;
   }
   else
   {
     struct wcc_data* wccData = &res.MKNOD3res_u.mknod3fail.mknod3fail_dir_wcc;
-    RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+    RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
     return 0;
   }
   return -1;
@@ -580,9 +676,12 @@ int RemoveCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.remove3_object.dirop3_dir;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
     char * filename = args.remove3_object.dirop3_name;
-    RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)filename, strlen((const char*)filename)));
+    uint32 nameLen = strlen((const char*)filename);
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + XdrWriter::varOpaqueSize(nameLen)));
+    PUT_FH3(xdr, fh);
+    xdr.putString(filename, nameLen);
     return 0;
   }
   return -1;
@@ -592,7 +691,7 @@ int RemoveCall::decodeResults()
 {
   DECODE_STATUS();
   struct wcc_data* wccData = &res.REMOVE3res_u.remove3ok.remove3_dir_wcc;
-  RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+  RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
   return 0;
 }
 
@@ -612,9 +711,12 @@ int RmdirCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.rmdir3_object.dirop3_dir;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
     char * filename = args.rmdir3_object.dirop3_name;
-    RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)filename, strlen((const char*)filename)));
+    uint32 nameLen = strlen((const char*)filename);
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + XdrWriter::varOpaqueSize(nameLen)));
+    PUT_FH3(xdr, fh);
+    xdr.putString(filename, nameLen);
     return 0;
   }
   return -1;
@@ -624,7 +726,7 @@ int RmdirCall::decodeResults()
 {
   DECODE_STATUS();
   struct wcc_data* wccData = &res.RMDIR3res_u.rmdir3ok.rmdir3_dir_wcc;
-  RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+  RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
   return 0;
 }
 
@@ -643,15 +745,20 @@ int RenameCall::encodeArguments()
   RpcPacketPtr request = getRequest();
   if (request)
   {
-    nfs_fh3* fh = &args.rename3_from.dirop3_dir;
-    char * filename = args.rename3_from.dirop3_name;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
-    RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)filename, strlen((const char*)filename)));
-
-    fh = &args.rename3_to.dirop3_dir;
-    filename = args.rename3_to.dirop3_name;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
-    RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)filename, strlen((const char*)filename)));
+    nfs_fh3* fromFh = &args.rename3_from.dirop3_dir;
+    char * fromName = args.rename3_from.dirop3_name;
+    uint32 fromLen = strlen((const char*)fromName);
+    nfs_fh3* toFh = &args.rename3_to.dirop3_dir;
+    char * toName = args.rename3_to.dirop3_name;
+    uint32 toLen = strlen((const char*)toName);
+
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fromFh) + XdrWriter::varOpaqueSize(fromLen) +
+                                FH3_SIZE(toFh) + XdrWriter::varOpaqueSize(toLen)));
+    PUT_FH3(xdr, fromFh);
+    xdr.putString(fromName, fromLen);
+    PUT_FH3(xdr, toFh);
+    xdr.putString(toName, toLen);
 
     return 0;
   }
@@ -662,9 +769,9 @@ int RenameCall::decodeResults()
 {
   DECODE_STATUS();
   struct wcc_data* wccData = &res.RENAME3res_u.rename3ok.rename3_fromdir_wcc;
-  RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+  RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
   wccData = &res.RENAME3res_u.rename3ok.rename3_todir_wcc;
-  RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+  RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
   return 0;
 }
 
@@ -685,12 +792,15 @@ int LinkCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.link3_file;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
-
-    fh = &args.link3_link.dirop3_dir;
+    nfs_fh3* dirFh = &args.link3_link.dirop3_dir;
     char* filename = args.link3_link.dirop3_name;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
-    RETURN_ON_ERROR(request->xdrEncodeString((unsigned char*)filename, strlen((const char*)filename)));
+    uint32 nameLen = strlen((const char*)filename);
+
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + FH3_SIZE(dirFh) + XdrWriter::varOpaqueSize(nameLen)));
+    PUT_FH3(xdr, fh);
+    PUT_FH3(xdr, dirFh);
+    xdr.putString(filename, nameLen);
 
     return 0;
   }
@@ -701,9 +811,9 @@ int LinkCall::decodeResults()
 {
   DECODE_STATUS();
   struct post_op_attr* postAttr = &res.LINK3res_u.link3ok.link3_file_attributes;
-  RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+  RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
   struct wcc_data* wccData = &res.LINK3res_u.link3ok.link3_linkdir_wcc;
-  RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+  RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
   return 0;
 }
 
@@ -733,14 +843,16 @@ int ReaddirCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.readdir3_dir;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
     uint64 cookie = args.readdir3_cookie;
-    RETURN_ON_ERROR((request->xdrEncodeUint64(cookie)));
-    RETURN_ON_ERROR(ENCODEVAR(request, args.readdir3_cookieverf));
-
     uint32 count = args.readdir3_count;
     if (count > 32768) count = 32768;
-    RETURN_ON_ERROR(request->xdrEncodeUint32(count));
+
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + 8 + NFS3_COOKIEVERFSIZE + 4));
+    PUT_FH3(xdr, fh);
+    xdr.putUint64(cookie);
+    xdr.putFixedOpaque(args.readdir3_cookieverf, NFS3_COOKIEVERFSIZE);
+    xdr.putUint32(count);
     return 0;
   }
   else
@@ -755,20 +867,22 @@ int ReaddirCall::decodeResults()
   if (reply == NULL)
     return -1;
 
-  RETURN_ON_ERROR(reply->xdrDecodeUint32(&status));
+  XdrReader xdr(reply);
+
+  RETURN_ON_ERROR(xdr.decodeUint32(&status));
   res.status = (nfsstat3)status;
   if (status == 0)
   {
     struct post_op_attr* postAttr = &res.READDIR3res_u.readdir3ok.readdir3_dir_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
 
     cookieverf3* verf = &res.READDIR3res_u.readdir3ok.readdir3_cookieverf_res;
-    RETURN_ON_ERROR(reply->xdrDecodeFixedOpaque((unsigned char*)verf, sizeof(cookieverf3)));
+    RETURN_ON_ERROR(xdr.decodeFixedOpaque((unsigned char*)verf, sizeof(cookieverf3)));
 
     res.READDIR3res_u.readdir3ok.readdir3_reply.dirlist3_entries = NULL;
 
     uint32 entryFollow = 0;
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&entryFollow));
+    RETURN_ON_ERROR(xdr.decodeUint32(&entryFollow));
     int i = 0;
     entry3* lastEntry = NULL;
     m_decodedStringBuffer = new Buffer(reply->getCapacity());
@@ -778,16 +892,18 @@ int ReaddirCall::decodeResults()
     while (entryFollow)
     {
       entry3* newEntry = new entry3;
-      DECODE_UQUAD(reply, newEntry->entry3_fileid);;
+      DECODE_UQUAD(xdr, newEntry->entry3_fileid);;
       char* filename = reinterpret_cast<char*>(m_decodedStringBuffer->end());
-      RETURN_ON_ERROR(NfsUtil::decodeStringToBuffer(reply, m_decodedStringBuffer));
+      RETURN_ON_ERROR(NfsUtil::decodeStringToBuffer(xdr, m_decodedStringBuffer));
       newEntry->entry3_name = filename;
 
-      DECODE_UQUAD(reply, newEntry->entry3_cookie);;
+      // cookie and the next entry flag
+      RETURN_ON_ERROR(xdr.need(8 + 4));
+      newEntry->entry3_cookie = xdr.getUint64();
 
       newEntry->entry3_nextentry = NULL;
       ++i;
-      RETURN_ON_ERROR(reply->xdrDecodeUint32(&entryFollow));
+      entryFollow = xdr.getUint32();
 
       if (lastEntry == NULL)
       {
@@ -801,7 +917,7 @@ int ReaddirCall::decodeResults()
       lastEntry = newEntry;
     }
     uint32 listEOF = 0;
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&listEOF));
+    RETURN_ON_ERROR(xdr.decodeUint32(&listEOF));
     res.READDIR3res_u.readdir3ok.readdir3_reply.dirlist3_eof = (listEOF == 0);
     return 0;
   }
@@ -835,16 +951,18 @@ int ReaddirPlusCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.readdirplus3_dir;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
     uint64 cookie = args.readdirplus3_cookie;
-    RETURN_ON_ERROR(request->xdrEncodeUint64(cookie));
-    RETURN_ON_ERROR(ENCODEVAR(request, args.readdirplus3_cookieverf));
-
     uint32 count = args.readdirplus3_dircount;
     uint32 maxcount = args.readdirplus3_maxcount;
     if (maxcount > 32768) maxcount = 32768;
-    RETURN_ON_ERROR(request->xdrEncodeUint32(count));
-    RETURN_ON_ERROR(request->xdrEncodeUint32(maxcount));
+
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + 8 + NFS3_COOKIEVERFSIZE + 4 + 4));
+    PUT_FH3(xdr, fh);
+    xdr.putUint64(cookie);
+    xdr.putFixedOpaque(args.readdirplus3_cookieverf, NFS3_COOKIEVERFSIZE);
+    xdr.putUint32(count);
+    xdr.putUint32(maxcount);
     return 0;
   }
   else
@@ -859,20 +977,22 @@ int ReaddirPlusCall::decodeResults()
   if (reply == NULL)
     return -1;
 
-  RETURN_ON_ERROR(reply->xdrDecodeUint32(&status));
+  XdrReader xdr(reply);
+
+  RETURN_ON_ERROR(xdr.decodeUint32(&status));
   res.status = (nfsstat3)status;
   if (status == 0)
   {
     struct post_op_attr* postAttr = &res.READDIRPLUS3res_u.readdirplus3ok.readdirplus3_dir_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
 
     cookieverf3* verf = &res.READDIRPLUS3res_u.readdirplus3ok.readdirplus3_cookieverf_res;
-    RETURN_ON_ERROR(reply->xdrDecodeFixedOpaque((unsigned char*)verf, sizeof(cookieverf3)));
+    RETURN_ON_ERROR(xdr.decodeFixedOpaque((unsigned char*)verf, sizeof(cookieverf3)));
 
     res.READDIRPLUS3res_u.readdirplus3ok.readdirplus3_reply.dirlistplus3_entries = NULL;
 
     uint32 entryFollow = 0;
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&entryFollow));
+    RETURN_ON_ERROR(xdr.decodeUint32(&entryFollow));
     int i = 0;
     entryplus3* lastEntry = NULL;
     m_decodedStringBuffer = new Buffer(reply->getCapacity());
@@ -882,20 +1002,23 @@ int ReaddirPlusCall::decodeResults()
     while (entryFollow)
     {
       entryplus3* newEntry = new entryplus3;
-      DECODE_UQUAD(reply, newEntry->entryplus3_fileid);
+      DECODE_UQUAD(xdr, newEntry->entryplus3_fileid);
 
       char* filename = reinterpret_cast<char*>(m_decodedStringBuffer->end());
-      RETURN_ON_ERROR(NfsUtil::decodeStringToBuffer(reply, m_decodedStringBuffer));
+      RETURN_ON_ERROR(NfsUtil::decodeStringToBuffer(xdr, m_decodedStringBuffer));
 
       newEntry->entryplus3_name = filename;
 
-      DECODE_UQUAD(reply, newEntry->entryplus3_cookie);;
-      RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, &newEntry->entryplus3_name_attributes));
-      RETURN_ON_ERROR(NfsUtil::decodePostOpFH3(reply, &newEntry->entryplus3_name_handle));
+      RETURN_ON_ERROR(xdr.need(8 + 4));
+      newEntry->entryplus3_cookie = xdr.getUint64();
+      newEntry->entryplus3_name_attributes.attributes_follow = xdr.getUint32();
+      if (newEntry->entryplus3_name_attributes.attributes_follow)
+        RETURN_ON_ERROR(NfsUtil::decodeFattr3(xdr, &newEntry->entryplus3_name_attributes.post_op_attr_u.post_op_attr));
+      RETURN_ON_ERROR(NfsUtil::decodePostOpFH3(xdr, &newEntry->entryplus3_name_handle));
 
       newEntry->entryplus3_nextentry = NULL;
       ++i;
-      RETURN_ON_ERROR(reply->xdrDecodeUint32(&entryFollow));
+      RETURN_ON_ERROR(xdr.decodeUint32(&entryFollow));
 
       if (lastEntry == NULL)
       {
@@ -910,7 +1033,7 @@ int ReaddirPlusCall::decodeResults()
     }
 
     uint32 listEOF = 0;
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&listEOF));
+    RETURN_ON_ERROR(xdr.decodeUint32(&listEOF));
     res.READDIRPLUS3res_u.readdirplus3ok.readdirplus3_reply.dirlistplus3_eof  = listEOF;
     syslog(LOG_DEBUG, "Readdirplus got %d entries, EOF = %d\n", i, listEOF);
     return 0;
@@ -934,7 +1057,9 @@ int FsstatCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.fsstat3_fsroot;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh)));
+    PUT_FH3(xdr, fh);
     return 0;
   }
   return -1;
@@ -946,9 +1071,10 @@ int FsstatCall::decodeResults()
   if (status == 0)
   {
     struct post_op_attr* postAttr = &res.FSSTAT3res_u.fsstat3ok.fsstat3_obj_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
 
-#define DECODE_FSSTAT(VAR) DECODE_UQUAD(reply, res.FSSTAT3res_u.fsstat3ok.fsstat3_fsstat3.fsstat3_##VAR);
+    RETURN_ON_ERROR(xdr.need(6 * 8 + 4));
+#define DECODE_FSSTAT(VAR) res.FSSTAT3res_u.fsstat3ok.fsstat3_fsstat3.fsstat3_##VAR = xdr.getUint64()
     DECODE_FSSTAT(tbytes);
     DECODE_FSSTAT(fbytes);
     DECODE_FSSTAT(abytes);
@@ -956,14 +1082,14 @@ int FsstatCall::decodeResults()
     DECODE_FSSTAT(ffiles);
     DECODE_FSSTAT(afiles);
 #undef DECODE_FSSTAT
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&res.FSSTAT3res_u.fsstat3ok.fsstat3_invarsec));
+    res.FSSTAT3res_u.fsstat3ok.fsstat3_invarsec = xdr.getUint32();
 
     return 0;
   }
   else
   {
     struct post_op_attr* postAttr = &res.FSSTAT3res_u.fsstat3fail.fsstat3fail_obj_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
     return 0;
   }
   return -1;
@@ -985,7 +1111,9 @@ int FsinfoCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.fsinfo3_fsroot;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh)));
+    PUT_FH3(xdr, fh);
     return 0;
   }
   return -1;
@@ -997,10 +1125,11 @@ int FsinfoCall::decodeResults()
   if (status == 0)
   {
     struct post_op_attr* postAttr = &res.FSINFO3res_u.fsinfo3ok.fsinfo3_obj_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
 
 #define FSINFO_RESULT res.FSINFO3res_u.fsinfo3ok.fsinfo3_fsinfo3
-#define DECODE_FSINFO(VAR) RETURN_ON_ERROR(reply->xdrDecodeUint32(&res.FSINFO3res_u.fsinfo3ok.fsinfo3_fsinfo3.fsinfo3_##VAR))
+    RETURN_ON_ERROR(xdr.need(7 * 4 + 8 + 3 * 4));
+#define DECODE_FSINFO(VAR) res.FSINFO3res_u.fsinfo3ok.fsinfo3_fsinfo3.fsinfo3_##VAR = xdr.getUint32()
     DECODE_FSINFO(rtmax);
     DECODE_FSINFO(rtpref);
     DECODE_FSINFO(rtmult);
@@ -1008,7 +1137,7 @@ int FsinfoCall::decodeResults()
     DECODE_FSINFO(wtpref);
     DECODE_FSINFO(wtmult);
     DECODE_FSINFO(dtpref);
-    DECODE_UQUAD(reply, res.FSINFO3res_u.fsinfo3ok.fsinfo3_fsinfo3.fsinfo3_maxfilesize);;
+    res.FSINFO3res_u.fsinfo3ok.fsinfo3_fsinfo3.fsinfo3_maxfilesize = xdr.getUint64();
     DECODE_FSINFO(time_delta.time3_seconds);
     DECODE_FSINFO(time_delta.time3_nseconds);
     DECODE_FSINFO(properties);
@@ -1019,7 +1148,7 @@ int FsinfoCall::decodeResults()
   else
   {
     struct post_op_attr* postAttr = &res.FSINFO3res_u.fsinfo3fail.fsinfo3fail_obj_attributes;
-    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(reply, postAttr));
+    RETURN_ON_ERROR(NfsUtil::decodePostOpAttr(xdr, postAttr));
     return 0;
   }
   return -1;
@@ -1041,9 +1170,11 @@ int CommitCall::encodeArguments()
   if (request)
   {
     nfs_fh3* fh = &args.commit3_file;
-    RETURN_ON_ERROR(request->xdrEncodeVarOpaque(fh->fh3_data.fh3_data_val, fh->fh3_data.fh3_data_len));
-    RETURN_ON_ERROR(request->xdrEncodeUint64((args.commit3_offset)));
-    RETURN_ON_ERROR(request->xdrEncodeUint32((args.commit3_count)));
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(FH3_SIZE(fh) + 8 + 4));
+    PUT_FH3(xdr, fh);
+    xdr.putUint64(args.commit3_offset);
+    xdr.putUint32(args.commit3_count);
     return 0;
   }
   return -1;
@@ -1055,14 +1186,14 @@ int CommitCall::decodeResults()
   if (status == 0)
   {
     struct wcc_data* wccData = &res.COMMIT3res_u.commit3ok.commit3_file_wcc;
-    RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
-    RETURN_ON_ERROR(DECODEVAR(reply, res.COMMIT3res_u.commit3ok.commit3_verf));
+    RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
+    RETURN_ON_ERROR(DECODEVAR(xdr, res.COMMIT3res_u.commit3ok.commit3_verf));
     return 0;
   }
   else
   {
     struct wcc_data* wccData = &res.COMMIT3res_u.commit3fail.commit3fail_file_wcc;
-    RETURN_ON_ERROR(NfsUtil::decodeWccData(reply, wccData));
+    RETURN_ON_ERROR(NfsUtil::decodeWccData(xdr, wccData));
     return 0;
   }
   return -1;
@@ -24,6 +24,7 @@
 #include "RpcDefs.h"
 #include "NfsUtil.h"
 #include "Nfs4Call.h"
+#include "Responder.h"
 
 #include <nfsrpc/pmap.h>
 #include <nfsrpc/nfs.h>
@@ -36,6 +37,7 @@
 #include <sstream>
 #include <sys/types.h>
 #include <unistd.h>
+#include <errno.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -51,9 +53,39 @@ const uint16 portmap_port = 111;
 Mutex NfsConnectionGroup::serverTableMutex;
 std::map<std::string, NfsConnectionGroupPtr> NfsConnectionGroup::serverTable;
 TransportType NfsConnectionGroup::gTransportConfig = TRANSP_TCP;
+time_t NfsConnectionGroup::gPortmapCacheTTL = 300; // seconds
+uint32 NfsConnectionGroup::gNconnect = 1;
 
+void NfsConnectionGroup::setReplySpinCount(uint32 spins)
+{
+  Responder::setSpinCount(spins);
+}
+
+void NfsConnectionGroup::setReactorCount(uint32 count, bool pinCpus)
+{
+  ConnectionMgr::setReactorCount(count);
+  ConnectionMgr::setCpuPinning(pinCpus);
+}
+
+void NfsConnectionGroup::setLowLatency(bool on)
+{
+  RpcConnection::setLowLatency(on);
+}
 
-NfsConnectionGroup::NfsConnectionGroup(std::string serverIP, NFSVersion nfsVersion, bool startKeepAlive):m_serverIP(serverIP),m_nfsTransp(TRANSP_TCP)
+void NfsConnectionGroup::setWindowLimits(uint32 initial, uint32 minWindow, uint32 maxWindow)
+{
+  RpcConnection::setWindowLimits(initial, minWindow, maxWindow);
+}
+
+
+NfsConnectionGroup::NfsConnectionGroup(std::string serverIP, NFSVersion nfsVersion, bool startKeepAlive):
+  m_serverIP(serverIP),
+  m_nfsTransp(TRANSP_TCP),
+  m_nconnect(gNconnect),
+  m_rpcPortsUpdateTime(0),
+  m_servicesReady(false),
+  m_extraFailed(false),
+  m_callTimeoutMs(0)
 {
   // Open the syslog
   setlogmask(LOG_UPTO(LOG_NOTICE));
@@ -139,6 +171,9 @@ NfsConnectionGroup::~NfsConnectionGroup()
     for (int j = 0; j < MAX_TRANSP; ++j)
       RpcConnection::clear(m_connections[i][j]);
 
+  for (int i = 0; i < NFS_MAX_NCONNECT-1; ++i)
+    RpcConnection::clear(m_extraNfsConnections[i]);
+
   if (m_initialClientVerifier)
   {
     free(m_initialClientVerifier);
@@ -199,6 +234,16 @@ bool NfsConnectionGroup::initNfs()
   if ( m_nfsTransp != transp )
     m_nfsTransp = transp;
 
+  if (m_nfsVersion != NFSV3 && m_nfsVersion != NFSV4)
+    throw std::string("Unknown NFS version");
+
+  return refreshServices(true);
+}
+
+bool NfsConnectionGroup::refreshServices(bool bForcePortRefresh)
+{
+  m_servicesReady.store(false, std::memory_order_release);
+
   bool bForceRecreate = false;
 
   if (m_nfsVersion == NFSV3)
@@ -206,11 +251,16 @@ bool NfsConnectionGroup::initNfs()
     if ( !ensurePortMapperConnection(/*out*/ bForceRecreate) )
       return false;
 
-    // Update port mapper
-    if ( !updateRpcPorts(m_nfsTransp) )
+    // The port table is only dumped again when it is too old or a service
+    // connection went away, the service might have moved to another port
+    bool bStale = (time(NULL) - m_rpcPortsUpdateTime) >= gPortmapCacheTTL;
+    if ( bForcePortRefresh || bForceRecreate || bStale || hasFailedService() )
     {
-      syslog(LOG_ERR, "NfsConnectionGroup::initNfs failed to updateRpcPorts for server %s\n", getServerIpStr());
-      return false;
+      if ( !updateRpcPorts(m_nfsTransp) )
+      {
+        syslog(LOG_ERR, "NfsConnectionGroup::%s: failed to updateRpcPorts for server %s\n", __func__, getServerIpStr());
+        return false;
+      }
     }
 
     // mount version 3
@@ -218,6 +268,7 @@ bool NfsConnectionGroup::initNfs()
 
     // NFS v3
     initRpcService(NFS, 3, m_nfsTransp, bForceRecreate);
+    initExtraNfsConnections(3, bForceRecreate);
 
     // NLM v4
     initRpcService(NLM, 4, m_nfsTransp, bForceRecreate);
@@ -226,13 +277,125 @@ bool NfsConnectionGroup::initNfs()
   {
     // NFS v4
     initRpcService(NFS, 4, m_nfsTransp, bForceRecreate);
+    initExtraNfsConnections(4, bForceRecreate);
   }
-  else
-    throw std::string("Unknown NFS version");
 
+  m_extraFailed.store(false, std::memory_order_release);
+  m_servicesReady.store(true, std::memory_order_release);
   return true;
 }
 
+bool NfsConnectionGroup::hasFailedService()
+{
+  // NFS must always be there, MOUNT and NLM may legitimately be missing
+  if ( m_connections[NFS][m_nfsTransp].empty() )
+    return true;
+
+  ServiceType services[] = { MOUNT, NFS, NLM };
+  for ( ServiceType service : services )
+  {
+    BasicConnectionPtr conn = m_connections[service][m_nfsTransp];
+    if ( conn.empty() )
+      continue;
+    if ( !conn->isUsable() || conn->getErrno() == ECONNRESET || !conn->isAlive() )
+      return true;
+  }
+
+  for ( uint32 i = 0; i+1 < m_nconnect; i++ )
+  {
+    BasicConnectionPtr conn = m_extraNfsConnections[i];
+    if ( conn.empty() || !conn->isUsable() || conn->getErrno() == ECONNRESET || !conn->isAlive() )
+      return true;
+  }
+  return false;
+}
+
+bool NfsConnectionGroup::isServiceValid(BasicConnectionPtr conn, uint16 port)
+{
+  return !conn.empty() && conn->getConnKey().getServerPort() == port
+         && conn->isUsable() && conn->getErrno() != ECONNRESET && conn->isAlive();
+}
+
+void NfsConnectionGroup::initExtraNfsConnections(uint32 version, const bool bReset)
+{
+  // the extra connections follow the first one, without it there is no NFS service
+  const BasicConnectionPtr& first = m_connections[NFS][m_nfsTransp];
+  if ( m_nconnect < 2 || first.empty() )
+    return;
+
+  uint16 port = first->getConnKey().getServerPort();
+  for ( uint32 i = 0; i+1 < m_nconnect; i++ )
+  {
+    BasicConnectionPtr& conn = m_extraNfsConnections[i];
+    if ( !bReset && isServiceValid(conn, port) )
+      continue;
+
+    RpcConnection::clear(conn);
+
+    ConnKey nfsKey(m_serverIP, port, m_nfsTransp);
+    conn = RpcConnection::create(nfsKey, RPCPROG_NFS, version);
+  }
+}
+
+BasicConnectionPtr NfsConnectionGroup::getLeastLoadedNfsConnection()
+{
+  // initExtraNfsConnections() replaces the connections under the lock
+  BasicConnectionPtr best;
+  BasicConnectionPtr extra[NFS_MAX_NCONNECT-1];
+  {
+    // on the reactor, a refresh in progress means no connection for now
+    if ( ConnectionMgr::isReactorThread() ? !m_connMutex.tryAcquire() : !m_connMutex.acquire() )
+      return best;
+    best = m_connections[NFS][m_nfsTransp];
+    for ( uint32 i = 0; i+1 < m_nconnect; i++ )
+      extra[i] = m_extraNfsConnections[i];
+    m_connMutex.release();
+  }
+
+  // fewest outstanding requests first, then fewest outstanding bytes
+  uint32 bestReqs = best.empty() ? 0 : best->getOutstandingRequests();
+  uint64 bestBytes = best.empty() ? 0 : best->getOutstandingBytes();
+  bool bestUsable = !best.empty() && best->isUsable();
+
+  for ( uint32 i = 0; i+1 < m_nconnect; i++ )
+  {
+    BasicConnectionPtr conn = extra[i];
+    if ( conn.empty() || !conn->isUsable() )
+    {
+      // have the failed connection recreated by the next ensureConnection()
+      m_extraFailed.store(true, std::memory_order_release);
+      continue;
+    }
+
+    uint32 reqs = conn->getOutstandingRequests();
+    uint64 bytes = conn->getOutstandingBytes();
+    if ( !bestUsable || reqs < bestReqs || (reqs == bestReqs && bytes < bestBytes) )
+    {
+      best = conn;
+      bestReqs = reqs;
+      bestBytes = bytes;
+      bestUsable = true;
+    }
+  }
+  return best;
+}
+
+void NfsConnectionGroup::getWindowStats(std::vector<RpcWindowStats>& stats)
+{
+  stats.clear();
+  for ( uint32 i = 0; i < m_nconnect; i++ )
+  {
+    BasicConnectionPtr conn;
+    {
+      MutexGuard lock(m_connMutex);
+      conn = (i == 0) ? m_connections[NFS][m_nfsTransp] : m_extraNfsConnections[i-1];
+    }
+    RpcWindowStats connStats;
+    if ( !conn.empty() && conn->getWindowStats(connStats) )
+      stats.push_back(connStats);
+  }
+}
+
 bool NfsConnectionGroup::initRpcService(ServiceType progType, uint32 version, TransportType transpType, const bool bReset)
 {
   if ( version > 4 || version < 1 )
@@ -241,8 +404,7 @@ bool NfsConnectionGroup::initRpcService(ServiceType progType, uint32 version, Tr
   BasicConnectionPtr conn = m_connections[progType][transpType];
   if ( !conn.empty() )
   {
-    if ( !bReset && conn->getConnKey().getServerPort() == m_rpcPorts[progType][version-1][transpType]
-         && conn->isAlive() )
+    if ( !bReset && isServiceValid(conn, m_rpcPorts[progType][version-1][transpType]) )
       return true;
 
     RpcConnection::clear(m_connections[progType][transpType]);
@@ -343,6 +505,7 @@ bool NfsConnectionGroup::updateRpcPorts(TransportType transp)
 
   // Copy local port array to member port array
   memcpy(m_rpcPorts, rpcPorts, sizeof(rpcPorts));
+  m_rpcPortsUpdateTime = time(NULL);
 
   syslog(LOG_DEBUG, "NfsConnectionGroup::%s: %s\n", __func__, out.str().c_str());
 
@@ -382,37 +545,23 @@ bool NfsConnectionGroup::ensurePortMapperConnection(bool& bForceRecreate)
 
 bool NfsConnectionGroup::ensureConnection()
 {
-  MutexGuard lock(m_connMutex);
-
-  bool bForceRecreate = false;
-
-  if (m_nfsVersion == NFSV3)
-  {
-    if ( !ensurePortMapperConnection(/*out*/ bForceRecreate) )
-      return false;
-
-    // Update port mapper
-    if ( !updateRpcPorts(m_nfsTransp) )
-    {
-      syslog(LOG_ERR, "NfsConnectionGroup::%s: failed to updateRpcPorts for server %s\n", __func__, getServerIpStr());
-      return false;
-    }
-
-    // mount version 3
-    initRpcService(MOUNT, 3, m_nfsTransp, bForceRecreate);
+  // fast path, nothing has failed since the services were last set up
+  if ( m_servicesReady.load(std::memory_order_acquire) && !m_extraFailed.load(std::memory_order_acquire) )
+    return true;
 
-    // NFS v3
-    initRpcService(NFS, 3, m_nfsTransp, bForceRecreate);
+  // a call made from a completion must not block the reactor on portmap
+  // calls or on a refresh holding the lock, it fails instead and the next
+  // call from an application thread does the refresh
+  if ( ConnectionMgr::isReactorThread() )
+    return m_servicesReady.load(std::memory_order_acquire);
 
-    // NLM v4
-    initRpcService(NLM, 4, m_nfsTransp, bForceRecreate);
-  }
-  else if (m_nfsVersion == NFSV4)
-  {
-    // NFS v4
-    initRpcService(NFS, 4, m_nfsTransp, bForceRecreate);
-  }
+  MutexGuard lock(m_connMutex);
+  if ( !m_servicesReady.load(std::memory_order_acquire) )
+    return refreshServices(false);
 
+  // only an extra NFS connection went down, the others are left alone
+  if ( m_extraFailed.exchange(false, std::memory_order_acq_rel) )
+    initExtraNfsConnections((m_nfsVersion == NFSV3) ? 3 : 4, false);
   return true;
 }
 
@@ -535,8 +684,9 @@ bool NfsConnectionGroup::removeFromPool()
   return true;
 }
 
-void NfsConnectionGroup::init()
+void NfsConnectionGroup::init(TransportBackend backend)
 {
+  ConnectionMgr::setBackend(backend);
 }
 
 void NfsConnectionGroup::fini()
@@ -627,6 +777,18 @@ bool NfsConnectionGroup::read(NfsFh        &fileFH,
   return m_NfsApiHandle->read(fileFH, offset, length, data, bytesRead, eof, postAttr, status);
 }
 
+bool NfsConnectionGroup::read(NfsFh              &fileFH,
+                              uint64_t            offset,
+                              const struct iovec *iov,
+                              int                 iovcnt,
+                              uint32_t           &bytesRead,
+                              bool               &eof,
+                              NfsAttr            &postAttr,
+                              NfsError           &status)
+{
+  return m_NfsApiHandle->read(fileFH, offset, iov, iovcnt, bytesRead, eof, postAttr, status);
+}
+
 bool NfsConnectionGroup::write(NfsFh       &fileFH,
                                uint64_t     offset,
                                uint32_t     length,
@@ -790,6 +952,26 @@ bool NfsConnectionGroup::lookup(NfsFh &dirFh, const std::string &file, NfsFh &lo
   return m_NfsApiHandle->lookup(dirFh, file, lookup_fh, attr, status);
 }
 
+bool NfsConnectionGroup::readAsync(NfsFh &fileFH, uint64_t offset, uint32_t length, const NfsReadCompletion &done, NfsError &status)
+{
+  return m_NfsApiHandle->readAsync(fileFH, offset, length, done, status);
+}
+
+bool NfsConnectionGroup::writeAsync(NfsFh &fileFH, uint64_t offset, uint32_t length, std::string &data, const NfsWriteCompletion &done, NfsError &status)
+{
+  return m_NfsApiHandle->writeAsync(fileFH, offset, length, data, done, status);
+}
+
+bool NfsConnectionGroup::getAttrAsync(NfsFh &fh, const NfsGetAttrCompletion &done, NfsError &status)
+{
+  return m_NfsApiHandle->getAttrAsync(fh, done, status);
+}
+
+bool NfsConnectionGroup::lookupAsync(NfsFh &dirFh, const std::string &file, const NfsLookupCompletion &done, NfsError &status)
+{
+  return m_NfsApiHandle->lookupAsync(dirFh, file, done, status);
+}
+
 bool NfsConnectionGroup::fsstat(NfsFh &rootFh, NfsFsStat &stat, uint32 &invarSec, NfsError &status)
 {
   return m_NfsApiHandle->fsstat(rootFh, stat, invarSec, status);
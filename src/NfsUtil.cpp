@@ -19,137 +19,142 @@
 #include "RpcPacket.h"
 #include "ByteBuffer.h"
 #include "RpcDefs.h"
+#include "XdrWriter.h"
+#include "XdrReader.h"
 
 #include <string.h>
 
 namespace OpenNfsC {
 namespace NfsUtil {
 
-int decodeFH3(RpcPacketPtr pkt, struct nfs_fh3* fh)
+int decodeFH3(XdrReader& xdr, struct nfs_fh3* fh)
 {
   unsigned char* str = NULL;
   uint32 len = 0;
-  RETURN_ON_ERROR(pkt->xdrDecodeString(str, len));
+  RETURN_ON_ERROR(xdr.decodeString(str, len));
 
   fh->fh3_data.fh3_data_val = (char*)str;
   fh->fh3_data.fh3_data_len = len;
   return 0;
 }
 
-int decodePostOpAttr(RpcPacketPtr pkt, struct post_op_attr *post)
+int decodePostOpAttr(XdrReader& xdr, struct post_op_attr *post)
 {
   uint32 attr;
-  RETURN_ON_ERROR(pkt->xdrDecodeUint32(&attr));
+  RETURN_ON_ERROR(xdr.decodeUint32(&attr));
   post->attributes_follow = attr;
   if(attr)
   {
-    RETURN_ON_ERROR(decodeFattr3(pkt, &post->post_op_attr_u.post_op_attr));
+    RETURN_ON_ERROR(decodeFattr3(xdr, &post->post_op_attr_u.post_op_attr));
   }
   return 0;
 }
 
-int decodePreOpAttr(RpcPacketPtr pkt, struct pre_op_attr *pre)
+int decodePreOpAttr(XdrReader& xdr, struct pre_op_attr *pre)
 {
   uint32 attr = 0;
-  RETURN_ON_ERROR(pkt->xdrDecodeUint32(&attr));
+  RETURN_ON_ERROR(xdr.decodeUint32(&attr));
   pre->attributes_follow = attr;
   if (attr)
   {
-#define DECODEWCC(BIT, VAR) RETURN_ON_ERROR(pkt->xdrDecodeUint##BIT((&pre->pre_op_attr_u.pre_op_attr.wcc_##VAR)))
-    DECODE_UQUAD(pkt, pre->pre_op_attr_u.pre_op_attr.wcc_size);
-    DECODEWCC(32, mtime.time3_seconds);
-    DECODEWCC(32, mtime.time3_nseconds);
-    DECODEWCC(32, ctime.time3_seconds);
-    DECODEWCC(32, ctime.time3_nseconds);
+    RETURN_ON_ERROR(xdr.need(WCC_ATTR_SIZE));
+    uint32 w[WCC_ATTR_SIZE / 4];
+    xdr.getUint32Array(w, WCC_ATTR_SIZE / 4);
+    wcc_attr* wcc = &pre->pre_op_attr_u.pre_op_attr;
+    wcc->wcc_size = ((uint64)w[0] << 32) | w[1];
+    wcc->wcc_mtime.time3_seconds = w[2];
+    wcc->wcc_mtime.time3_nseconds = w[3];
+    wcc->wcc_ctime.time3_seconds = w[4];
+    wcc->wcc_ctime.time3_nseconds = w[5];
   }
   return 0;
 }
 
-int decodeWccData(RpcPacketPtr pkt, struct wcc_data *wcc)
+int decodeWccData(XdrReader& xdr, struct wcc_data *wcc)
 {
-  RETURN_ON_ERROR(decodePreOpAttr(pkt, &wcc->wcc_before));
-  RETURN_ON_ERROR(decodePostOpAttr(pkt, &wcc->wcc_after));
+  RETURN_ON_ERROR(decodePreOpAttr(xdr, &wcc->wcc_before));
+  RETURN_ON_ERROR(decodePostOpAttr(xdr, &wcc->wcc_after));
 
   return 0;
 }
 
 
-int decodePostOpFH3(RpcPacketPtr pkt, struct post_op_fh3 *postfh)
+int decodePostOpFH3(XdrReader& xdr, struct post_op_fh3 *postfh)
 {
-  RETURN_ON_ERROR(pkt->xdrDecodeUint32((uint32*)&postfh->handle_follows));
+  RETURN_ON_ERROR(xdr.decodeUint32((uint32*)&postfh->handle_follows));
   if (postfh->handle_follows)
   {
     nfs_fh3* fh = &postfh->post_op_fh3_u.post_op_fh3;
-    return decodeFH3(pkt, fh);
+    return decodeFH3(xdr, fh);
   }
   return 0;
 }
 
-int encodeSattr3(RpcPacketPtr pkt, sattr3 *sa)
+void encodeSattr3(XdrWriter& xdr, const sattr3 *sa)
 {
-#define ENCODEINT(BIT, VAR) pkt->xdrEncodeUint##BIT((VAR))
+#define ENCODEINT(BIT, VAR) xdr.putUint##BIT((VAR))
 
 #define ENCODE(TYPE, VAR, BIT) \
-RETURN_ON_ERROR(pkt->xdrEncodeUint32((uint32)sa->sattr3_##VAR.set_it)); \
+xdr.putUint32((uint32)sa->sattr3_##VAR.set_it); \
 if (sa->sattr3_##VAR.set_it) \
-RETURN_ON_ERROR(ENCODEINT(BIT, sa->sattr3_##VAR.set_##TYPE##3##_u.TYPE))
+ENCODEINT(BIT, sa->sattr3_##VAR.set_##TYPE##3##_u.TYPE)
   ENCODE(mode, mode, 32);
   ENCODE(uid, uid, 32);
   ENCODE(gid, gid, 32);
   ENCODE(size, size, 64);
 #undef ENCODE
 
-  RETURN_ON_ERROR(pkt->xdrEncodeUint32((uint32)sa->sattr3_atime.set_it));
+  xdr.putUint32((uint32)sa->sattr3_atime.set_it);
   if (sa->sattr3_atime.set_it == TIME_SET_TO_CLIENT_TIME)
   {
-    RETURN_ON_ERROR(ENCODEINT(32, sa->sattr3_atime.set_atime_u.atime.time3_seconds));
-    RETURN_ON_ERROR(ENCODEINT(32, sa->sattr3_atime.set_atime_u.atime.time3_nseconds));
+    ENCODEINT(32, sa->sattr3_atime.set_atime_u.atime.time3_seconds);
+    ENCODEINT(32, sa->sattr3_atime.set_atime_u.atime.time3_nseconds);
   }
 
-  RETURN_ON_ERROR(pkt->xdrEncodeUint32((uint32)sa->sattr3_mtime.set_it));
+  xdr.putUint32((uint32)sa->sattr3_mtime.set_it);
   if (sa->sattr3_mtime.set_it == TIME_SET_TO_CLIENT_TIME)
   {
-    RETURN_ON_ERROR(ENCODEINT(32, sa->sattr3_mtime.set_mtime_u.mtime.time3_seconds));
-    RETURN_ON_ERROR(ENCODEINT(32, sa->sattr3_mtime.set_mtime_u.mtime.time3_nseconds));
+    ENCODEINT(32, sa->sattr3_mtime.set_mtime_u.mtime.time3_seconds);
+    ENCODEINT(32, sa->sattr3_mtime.set_mtime_u.mtime.time3_nseconds);
   }
 #undef ENCODEINT
-
-  return 0;
 }
 
-int decodeFattr3(RpcPacketPtr pkt, fattr3 *sa)
+int decodeFattr3(XdrReader& xdr, fattr3 *sa)
 {
-  uint32 tmp;
-  RETURN_ON_ERROR(pkt->xdrDecodeUint32(&tmp));
-  sa->fattr3_type = (ftype3)tmp;
-#define DECODEINT(BIT, VAR) RETURN_ON_ERROR(pkt->xdrDecodeUint##BIT(&sa->fattr3_##VAR))
-  DECODEINT(32, mode);
-  DECODEINT(32, nlink);
-  DECODEINT(32, uid);
-  DECODEINT(32, gid);
-  DECODE_UQUAD(pkt, sa->fattr3_size);
-  DECODE_UQUAD(pkt, sa->fattr3_used);
-  DECODEINT(32, rdev.specdata1);
-  DECODEINT(32, rdev.specdata2);
-  DECODE_UQUAD(pkt, sa->fattr3_fsid);
-  DECODE_UQUAD(pkt, sa->fattr3_fileid);
-  DECODEINT(32, atime.time3_seconds);
-  DECODEINT(32, atime.time3_nseconds);
-  DECODEINT(32, mtime.time3_seconds);
-  DECODEINT(32, mtime.time3_nseconds);
-  DECODEINT(32, ctime.time3_seconds);
-  DECODEINT(32, ctime.time3_nseconds);
-#undef DECODEINT
+  // swap the whole struct as 32 bit words, the hypers are then joined
+  RETURN_ON_ERROR(xdr.need(FATTR3_SIZE));
+  uint32 w[FATTR3_SIZE / 4];
+  xdr.getUint32Array(w, FATTR3_SIZE / 4);
+#define HYPER(I) (((uint64)w[I] << 32) | w[I + 1])
+  sa->fattr3_type = (ftype3)w[0];
+  sa->fattr3_mode = w[1];
+  sa->fattr3_nlink = w[2];
+  sa->fattr3_uid = w[3];
+  sa->fattr3_gid = w[4];
+  sa->fattr3_size = HYPER(5);
+  sa->fattr3_used = HYPER(7);
+  sa->fattr3_rdev.specdata1 = w[9];
+  sa->fattr3_rdev.specdata2 = w[10];
+  sa->fattr3_fsid = HYPER(11);
+  sa->fattr3_fileid = HYPER(13);
+  sa->fattr3_atime.time3_seconds = w[15];
+  sa->fattr3_atime.time3_nseconds = w[16];
+  sa->fattr3_mtime.time3_seconds = w[17];
+  sa->fattr3_mtime.time3_nseconds = w[18];
+  sa->fattr3_ctime.time3_seconds = w[19];
+  sa->fattr3_ctime.time3_nseconds = w[20];
+#undef HYPER
   return 0;
 }
 
-int decodeString(RpcPacketPtr pkt, char**name)
+int decodeString(XdrReader& xdr, char**name)
 {
   unsigned char* str = NULL;
   uint32 len = 0;
-  if (pkt == NULL || name == NULL )
+  if (name == NULL )
     return -1;
-  RETURN_ON_ERROR(pkt->xdrDecodeString(str, len));
+  RETURN_ON_ERROR(xdr.decodeString(str, len));
   char *filename = new char[len+1];
   memcpy(filename, str, len);
   filename[len] = '\0';
@@ -157,14 +162,14 @@ int decodeString(RpcPacketPtr pkt, char**name)
   return 0;
 }
 
-int decodeStringToBuffer(RpcPacketPtr pkt, Buffer* buf)
+int decodeStringToBuffer(XdrReader& xdr, Buffer* buf)
 {
   unsigned char* str = NULL;
   unsigned char endofstring = 0;
   uint32 len = 0;
-  if (pkt == NULL || buf == NULL )
+  if (buf == NULL )
     return -1;
-  RETURN_ON_ERROR(pkt->xdrDecodeString(str, len));
+  RETURN_ON_ERROR(xdr.decodeString(str, len));
   RETURN_ON_ERROR(buf->append(str, len));
   RETURN_ON_ERROR(buf->append(&endofstring, 1));
   return 0;
@@ -195,20 +200,25 @@ void buildNfsPath(std::string &Path, std::vector<std::string> &Segments)
   }
 }
 
+// attrlist4_len undercounts an attribute by at most 8 bytes, settime4 carries its set_it
+uint32 fattr4MaxSize(const fattr4 *attr)
+{
+  uint32 count = 0;
+  for (unsigned int i = 0; i < attr->attrmask.bitmap4_len; i++)
+    count += __builtin_popcount(attr->attrmask.bitmap4_val[i]);
+  return 4 + 4 * attr->attrmask.bitmap4_len + 4 + attr->attr_vals.attrlist4_len + 8 * count;
+}
+
 /* We must send two masks even if one of them is zero.
    And maintain the order of these two masks.
    So all calls sending fattr4 must send two masks
  */
-int encode_fattr4(RpcPacketPtr packet, const fattr4 *attr)
+void encode_fattr4(XdrWriter& xdr, const fattr4 *attr)
 {
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(attr->attrmask.bitmap4_len));
-  for (unsigned int i = 0; i < attr->attrmask.bitmap4_len; i++)
-  {
-    uint32_t mask = attr->attrmask.bitmap4_val[i];
-    RETURN_ON_ERROR(packet->xdrEncodeUint32(mask));
-  }
+  xdr.putUint32(attr->attrmask.bitmap4_len);
+  xdr.putUint32Array(attr->attrmask.bitmap4_val, attr->attrmask.bitmap4_len);
 
-  RETURN_ON_ERROR(packet->xdrEncodeUint32(attr->attr_vals.attrlist4_len));
+  xdr.putUint32(attr->attr_vals.attrlist4_len);
 
   char *avals = attr->attr_vals.attrlist4_val;
 
@@ -223,7 +233,7 @@ int encode_fattr4(RpcPacketPtr packet, const fattr4 *attr)
     if (mask1 & (1 << FATTR4_TYPE))
     {
       uint32_t *ftype = (uint32_t*)avals;
-      RETURN_ON_ERROR(packet->xdrEncodeUint32(*ftype));
+      xdr.putUint32(*ftype);
       avals += sizeof(uint32_t);
     }
     if (mask1 & (1 << FATTR4_FH_EXPIRE_TYPE))
@@ -232,13 +242,13 @@ int encode_fattr4(RpcPacketPtr packet, const fattr4 *attr)
     if (mask1 & (1 << FATTR4_CHANGE))
     {
       uint64_t *chid = (uint64_t*)avals;
-      RETURN_ON_ERROR(packet->xdrEncodeUint64(*chid));
+      xdr.putUint64(*chid);
       avals += sizeof(uint64_t);
     }
     if (mask1 & (1 << FATTR4_SIZE))
     {
       uint64_t *size = (uint64_t*)avals;
-      RETURN_ON_ERROR(packet->xdrEncodeUint64(*size));
+      xdr.putUint64(*size);
       avals += sizeof(uint64_t);
     }
     if (mask1 & (1 << FATTR4_LINK_SUPPORT))
@@ -271,11 +281,7 @@ int encode_fattr4(RpcPacketPtr packet, const fattr4 *attr)
       uint32_t *size = (uint32_t*)avals;
       avals += sizeof(uint32_t);
       // append the encoded acl
-      if (packet->append((unsigned char*)avals, *size) < 0)
-      {
-        cout << "Failed to append ACL encoded buffer" <<endl;
-        return -1;
-      }
+      xdr.putFixedOpaque(avals, *size);
       // advance the buffer
       avals += (*size);
     }
@@ -343,7 +349,7 @@ int encode_fattr4(RpcPacketPtr packet, const fattr4 *attr)
     if (mask2 & (1 << (FATTR4_MODE - 32)))
     {
       uint32_t *mode = (uint32_t*)avals;
-      RETURN_ON_ERROR(packet->xdrEncodeUint32(*mode));
+      xdr.putUint32(*mode);
       avals += sizeof(uint32_t);
     }
     if (mask2 & (1 << (FATTR4_NO_TRUNC - 32)))
@@ -358,7 +364,7 @@ int encode_fattr4(RpcPacketPtr packet, const fattr4 *attr)
       // strings are padded with '\0' to differentiate, skip that null character
       char *owner = avals;
       size_t len = strlen(owner);
-      RETURN_ON_ERROR(packet->xdrEncodeString((unsigned char*)owner, len));
+      xdr.putString(owner, len);
       avals += (len + 1);
     }
     if (mask2 & (1 << (FATTR4_OWNER_GROUP - 32)))
@@ -366,7 +372,7 @@ int encode_fattr4(RpcPacketPtr packet, const fattr4 *attr)
       // strings are padded with '\0' to differentiate, skip that null character
       char *group = avals;
       size_t len = strlen(group);
-      RETURN_ON_ERROR(packet->xdrEncodeString((unsigned char*)group, len));
+      xdr.putString(group, len);
       avals += (len + 1);
     }
     if (mask2 & (1 << (FATTR4_QUOTA_AVAIL_HARD - 32)))
@@ -404,13 +410,13 @@ int encode_fattr4(RpcPacketPtr packet, const fattr4 *attr)
     {
       // First set the setit to 1
       uint32_t setit = 1;
-      RETURN_ON_ERROR(packet->xdrEncodeUint32(setit));
+      xdr.putUint32(setit);
 
       uint64_t *seconds = (uint64_t*)avals;
-      RETURN_ON_ERROR(packet->xdrEncodeUint64(*seconds));
+      xdr.putUint64(*seconds);
       avals += sizeof(uint64_t);
       uint32_t *nanosec = (uint32_t*)avals;
-      RETURN_ON_ERROR(packet->xdrEncodeUint32(*nanosec));
+      xdr.putUint32(*nanosec);
       avals += sizeof(uint32_t);
     }
     if (mask2 & (1 << (FATTR4_TIME_BACKUP - 32)))
@@ -433,21 +439,19 @@ int encode_fattr4(RpcPacketPtr packet, const fattr4 *attr)
     {
       // First set the setit to 1
       uint32_t setit = 1;
-      RETURN_ON_ERROR(packet->xdrEncodeUint32(setit));
+      xdr.putUint32(setit);
 
       uint64_t *seconds = (uint64_t*)avals;
-      RETURN_ON_ERROR(packet->xdrEncodeUint64(*seconds));
+      xdr.putUint64(*seconds);
       avals += sizeof(uint64_t);
       uint32_t *nanosec = (uint32_t*)avals;
-      RETURN_ON_ERROR(packet->xdrEncodeUint32(*nanosec));
+      xdr.putUint32(*nanosec);
       avals += sizeof(uint32_t);
     }
     if (mask2 & (1 << (FATTR4_MOUNTED_ON_FILEID - 32)))
     {
     }
   }
-
-  return 0;
 }
 
 int NfsAttr_fattr4(NfsAttr &attr, fattr4 *fattr)
@@ -757,19 +761,10 @@ int NfsAttr_fattr4(NfsAttr &attr, fattr4 *fattr)
 // 2 masks are sufficient to hold all attributes
 int decode_fattr4(fattr4 *fattr, uint32_t mask1, uint32_t mask2, NfsAttr &attr)
 {
-  RpcPacketPtr attrPacket = new RpcPacket(0);
-  if ( attrPacket.empty() )
-  {
-    syslog(LOG_ERR, "Failed to allocate attr packet for decoding\n");
-    return -1;
-  }
-
-  if (attrPacket->append((unsigned char*)fattr->attr_vals.attrlist4_val,
-                         fattr->attr_vals.attrlist4_len) < 0)
-  {
-    syslog(LOG_ERR, "Failed to append to attr packet for decoding\n");
-    return -1;
-  }
+  // the attrs are read in place, attrlist4_val points into the reply
+  const unsigned char *attrs = (const unsigned char*)fattr->attr_vals.attrlist4_val;
+  uint32 attrsLen = fattr->attr_vals.attrlist4_len;
+  XdrReader xdr(attrs, attrsLen);
 
   if (mask1 !=0)
   {
@@ -783,7 +778,7 @@ int decode_fattr4(fattr4 *fattr, uint32_t mask1, uint32_t mask2, NfsAttr &attr)
     if (mask1 & (1 << FATTR4_TYPE))
     {
       uint32_t ftype = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint32(&ftype));
+      RETURN_ON_ERROR(xdr.decodeUint32(&ftype));
       attr.fileType = (NfsFileType)ftype;
     }
     if (mask1 & (1 << FATTR4_FH_EXPIRE_TYPE))
@@ -792,13 +787,13 @@ int decode_fattr4(fattr4 *fattr, uint32_t mask1, uint32_t mask2, NfsAttr &attr)
     if (mask1 & (1 << FATTR4_CHANGE))
     {
       uint64 chid = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&chid));
+      RETURN_ON_ERROR(xdr.decodeUint64(&chid));
       attr.changeID = chid;
     }
     if (mask1 & (1 << FATTR4_SIZE))
     {
       uint64 sz = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&sz));
+      RETURN_ON_ERROR(xdr.decodeUint64(&sz));
       attr.size = sz;
     }
     if (mask1 & (1 << FATTR4_LINK_SUPPORT))
@@ -813,8 +808,8 @@ int decode_fattr4(fattr4 *fattr, uint32_t mask1, uint32_t mask2, NfsAttr &attr)
     if (mask1 & (1 << FATTR4_FSID))
     {
       uint64 major = 0, minor = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&major));
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&minor));
+      RETURN_ON_ERROR(xdr.decodeUint64(&major));
+      RETURN_ON_ERROR(xdr.decodeUint64(&minor));
       attr.fsid.FSIDMajor = major;
       attr.fsid.FSIDMinor = minor;
     }
@@ -833,49 +828,29 @@ int decode_fattr4(fattr4 *fattr, uint32_t mask1, uint32_t mask2, NfsAttr &attr)
     if (mask1 & (1 << FATTR4_ACL))
     {
       Nfs4ACL acl;
-      uint32 aclSize = 0;
+      const unsigned char *aclStart = attrs + (attrsLen - xdr.remaining());
       uint32 noOfAces = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint32(&noOfAces));
+      RETURN_ON_ERROR(xdr.decodeUint32(&noOfAces));
       acl.no_of_aces = noOfAces;
-      aclSize += sizeof(uint32_t);
 
       for (uint32 i = 0; i < noOfAces; i++)
       {
-        uint32 aceSize = 0;
         uint32 acetype = 0, aceflag = 0, accessmask = 0;
-        RETURN_ON_ERROR(attrPacket->xdrDecodeUint32(&acetype));
-        aceSize += sizeof(uint32_t);
-        RETURN_ON_ERROR(attrPacket->xdrDecodeUint32(&aceflag));
-        aceSize += sizeof(uint32_t);
-        RETURN_ON_ERROR(attrPacket->xdrDecodeUint32(&accessmask));
-        aceSize += sizeof(uint32_t);
+        RETURN_ON_ERROR(xdr.decodeUint32(&acetype));
+        RETURN_ON_ERROR(xdr.decodeUint32(&aceflag));
+        RETURN_ON_ERROR(xdr.decodeUint32(&accessmask));
         unsigned char *value = NULL;
         uint32 value_len = 0;
-        RETURN_ON_ERROR(attrPacket->xdrDecodeString(value, value_len));
+        RETURN_ON_ERROR(xdr.decodeString(value, value_len));
         Nfs4ACE ace;
         ace.ACEType = acetype;
         ace.ACEFlag = aceflag;
         ace.AccessMask = accessmask;
         ace.who = std::string((char*)value, value_len);
         acl.aces.push_back(ace);
-        int padSize = 0;
-        if (value_len%4 != 0)
-          padSize = 4 - value_len%4;
-        aceSize += (sizeof(uint32_t) + value_len + padSize);
-        aclSize += aceSize;
-      }
-      // encode the acl again to get raw bytes
-      // we decoded first because we never knew what was the size
-      RpcPacketPtr aclPacket = new RpcPacket(aclSize);
-      RETURN_ON_ERROR(aclPacket->xdrEncodeUint32(acl.no_of_aces));
-      for (auto &ace : acl.aces)
-      {
-        RETURN_ON_ERROR(aclPacket->xdrEncodeUint32(ace.ACEType));
-        RETURN_ON_ERROR(aclPacket->xdrEncodeUint32(ace.ACEFlag));
-        RETURN_ON_ERROR(aclPacket->xdrEncodeUint32(ace.AccessMask));
-        RETURN_ON_ERROR(aclPacket->xdrEncodeString((unsigned char*)ace.who.c_str(), ace.who.length()));
       }
-      attr.acl = std::string((char*)aclPacket->getBuffer(), aclPacket->getSize());
+      // the raw acl is the span just decoded, no need to encode it again
+      attr.acl = std::string((const char*)aclStart, attrs + (attrsLen - xdr.remaining()) - aclStart);
     }
     if (mask1 & (1 << FATTR4_ACLSUPPORT))
     {
@@ -898,25 +873,25 @@ int decode_fattr4(fattr4 *fattr, uint32_t mask1, uint32_t mask2, NfsAttr &attr)
     if (mask1 & (1 << FATTR4_FILEID))
     {
       uint64 fid = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&fid));
+      RETURN_ON_ERROR(xdr.decodeUint64(&fid));
       attr.fid = fid;
     }
     if (mask1 & (1 << FATTR4_FILES_AVAIL))
     {
       uint64 filesAvail = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&filesAvail));
+      RETURN_ON_ERROR(xdr.decodeUint64(&filesAvail));
       attr.files_avail = filesAvail;
     }
     if (mask1 & (1 << FATTR4_FILES_FREE))
     {
       uint64 filesFree = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&filesFree));
+      RETURN_ON_ERROR(xdr.decodeUint64(&filesFree));
       attr.files_free = filesFree;
     }
     if (mask1 & (1 << FATTR4_FILES_TOTAL))
     {
       uint64 filesTotal = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&filesTotal));
+      RETURN_ON_ERROR(xdr.decodeUint64(&filesTotal));
       attr.files_total = filesTotal;
     }
     if (mask1 & (1 << FATTR4_FS_LOCATIONS))
@@ -937,7 +912,7 @@ int decode_fattr4(fattr4 *fattr, uint32_t mask1, uint32_t mask2, NfsAttr &attr)
     if (mask1 & (1 << FATTR4_MAXNAME))
     {
       uint32 maxName = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint32(&maxName));
+      RETURN_ON_ERROR(xdr.decodeUint32(&maxName));
       attr.name_max = maxName;
     }
     if (mask1 & (1 << FATTR4_MAXREAD))
@@ -956,7 +931,7 @@ int decode_fattr4(fattr4 *fattr, uint32_t mask1, uint32_t mask2, NfsAttr &attr)
     if (mask2 & (1 << (FATTR4_MODE - 32)))
     {
       uint32 mode = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint32(&mode));
+      RETURN_ON_ERROR(xdr.decodeUint32(&mode));
       attr.fmode = mode;
     }
     if (mask2 & (1 << (FATTR4_NO_TRUNC - 32)))
@@ -965,21 +940,21 @@ int decode_fattr4(fattr4 *fattr, uint32_t mask1, uint32_t mask2, NfsAttr &attr)
     if (mask2 & (1 << (FATTR4_NUMLINKS - 32)))
     {
       uint32 nlinks = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint32(&nlinks));
+      RETURN_ON_ERROR(xdr.decodeUint32(&nlinks));
       attr.nlinks = nlinks;
     }
     if (mask2 & (1 << (FATTR4_OWNER - 32)))
     {
       unsigned char *value = NULL;
       uint32 value_len = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeString(value, value_len));
+      RETURN_ON_ERROR(xdr.decodeString(value, value_len));
       attr.owner = std::string((char*)value, value_len);
     }
     if (mask2 & (1 << (FATTR4_OWNER_GROUP - 32)))
     {
       unsigned char* value = NULL;
       uint32 value_len = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeString(value, value_len));
+      RETURN_ON_ERROR(xdr.decodeString(value, value_len));
       attr.group = std::string((char*)value, value_len);
     }
     if (mask2 & (1 << (FATTR4_QUOTA_AVAIL_HARD - 32)))
@@ -994,31 +969,31 @@ int decode_fattr4(fattr4 *fattr, uint32_t mask1, uint32_t mask2, NfsAttr &attr)
     if (mask2 & (1 << (FATTR4_RAWDEV - 32)))
     {
       uint64 rdev = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&rdev));
+      RETURN_ON_ERROR(xdr.decodeUint64(&rdev));
       attr.rawDevice = rdev;
     }
     if (mask2 & (1 << (FATTR4_SPACE_AVAIL - 32)))
     {
       uint64 spcAvail = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&spcAvail));
+      RETURN_ON_ERROR(xdr.decodeUint64(&spcAvail));
       attr.bytes_avail = spcAvail;
     }
     if (mask2 & (1 << (FATTR4_SPACE_FREE - 32)))
     {
       uint64 spcFree = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&spcFree));
+      RETURN_ON_ERROR(xdr.decodeUint64(&spcFree));
       attr.bytes_free = spcFree;
     }
     if (mask2 & (1 << (FATTR4_SPACE_TOTAL - 32)))
     {
       uint64 spcTotal = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&spcTotal));
+      RETURN_ON_ERROR(xdr.decodeUint64(&spcTotal));
       attr.bytes_total = spcTotal;
     }
     if (mask2 & (1 << (FATTR4_SPACE_USED - 32)))
     {
       uint64 spcusd = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&spcusd));
+      RETURN_ON_ERROR(xdr.decodeUint64(&spcusd));
       attr.bytes_used = spcusd;
     }
     if (mask2 & (1 << (FATTR4_SYSTEM - 32)))
@@ -1027,10 +1002,10 @@ int decode_fattr4(fattr4 *fattr, uint32_t mask1, uint32_t mask2, NfsAttr &attr)
     if (mask2 & (1 << (FATTR4_TIME_ACCESS - 32)))
     {
       uint64 seconds = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&seconds));
+      RETURN_ON_ERROR(xdr.decodeUint64(&seconds));
       attr.time_access.seconds = seconds;
       uint32 nanosecs = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint32(&nanosecs));
+      RETURN_ON_ERROR(xdr.decodeUint32(&nanosecs));
       attr.time_access.nanosecs = nanosecs;
     }
     if (mask2 & (1 << (FATTR4_TIME_ACCESS_SET - 32)))
@@ -1048,19 +1023,19 @@ int decode_fattr4(fattr4 *fattr, uint32_t mask1, uint32_t mask2, NfsAttr &attr)
     if (mask2 & (1 << (FATTR4_TIME_METADATA - 32)))
     {
       uint64 seconds = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&seconds));
+      RETURN_ON_ERROR(xdr.decodeUint64(&seconds));
       attr.time_metadata.seconds = seconds;
       uint32 nanosecs = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint32(&nanosecs));
+      RETURN_ON_ERROR(xdr.decodeUint32(&nanosecs));
       attr.time_metadata.nanosecs = nanosecs;
     }
     if (mask2 & (1 << (FATTR4_TIME_MODIFY - 32)))
     {
       uint64 seconds = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint64(&seconds));
+      RETURN_ON_ERROR(xdr.decodeUint64(&seconds));
       attr.time_modify.seconds = seconds;
       uint32 nanosecs = 0;
-      RETURN_ON_ERROR(attrPacket->xdrDecodeUint32(&nanosecs));
+      RETURN_ON_ERROR(xdr.decodeUint32(&nanosecs));
       attr.time_modify.nanosecs = nanosecs;
     }
     if (mask2 & (1 << (FATTR4_TIME_MODIFY_SET - 32)))
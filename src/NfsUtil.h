@@ -31,6 +31,8 @@ namespace OpenNfsC {
 
 class Buffer;
 class RpcPacket;
+class XdrWriter;
+class XdrReader;
 
 namespace NfsUtil {
 
@@ -43,32 +45,39 @@ namespace NfsUtil {
 
 #define RETURN_ON_ERROR(x) RETURN_ON_FALSE((x >= 0))
 
-#define ENCODEVAR(req, VAR) req->xdrEncodeFixedOpaque((unsigned char*)&(VAR),sizeof(VAR))
-#define DECODEVAR(req, VAR) req->xdrDecodeFixedOpaque((unsigned char*)&(VAR),sizeof(VAR))
+#define DECODEVAR(xdr, VAR) (xdr).decodeFixedOpaque(&(VAR),sizeof(VAR))
 
 #define DECODE_UQUAD(PKT, VAR) \
 { \
     uint64 iVal = 0; \
-    RETURN_ON_ERROR(PKT->xdrDecodeUint64(&iVal)); \
+    RETURN_ON_ERROR((PKT).decodeUint64(&iVal)); \
     VAR = iVal; \
 } \
 
-  int decodeFH3(RpcPacketPtr pkt, struct nfs_fh3* fh);
-  int decodePostOpAttr(RpcPacketPtr pkt, struct post_op_attr *post);
-  int decodePreOpAttr(RpcPacketPtr pkt, struct pre_op_attr *pre);
-  int decodeWccData(RpcPacketPtr pkt, struct wcc_data *pre);
-  int decodePostOpFH3(RpcPacketPtr pkt, struct post_op_fh3 *postfh);
-  int encodeSattr3(RpcPacketPtr pkt, sattr3 *sa);
-  int decodeFattr3(RpcPacketPtr pkt, fattr3 *sa);
-  int decodeString(RpcPacketPtr pkt, char**name);
-  int decodeStringToBuffer(RpcPacketPtr pkt, Buffer* buf);
+  // encoded sizes of the fixed size structs
+  const uint32 WCC_ATTR_SIZE = 8 + 2 * 8;
+  const uint32 FATTR3_SIZE = 5 * 4 + 2 * 8 + 2 * 4 + 2 * 8 + 3 * 8;
+
+  int decodeFH3(XdrReader& xdr, struct nfs_fh3* fh);
+  int decodePostOpAttr(XdrReader& xdr, struct post_op_attr *post);
+  int decodePreOpAttr(XdrReader& xdr, struct pre_op_attr *pre);
+  int decodeWccData(XdrReader& xdr, struct wcc_data *pre);
+  int decodePostOpFH3(XdrReader& xdr, struct post_op_fh3 *postfh);
+  // most bytes encodeSattr3() writes, the caller reserves them
+  const uint32 SATTR3_MAX_SIZE = 6 * 4 + 3 * 4 + 3 * 8;
+  void encodeSattr3(XdrWriter& xdr, const sattr3 *sa);
+  int decodeFattr3(XdrReader& xdr, fattr3 *sa);
+  int decodeString(XdrReader& xdr, char**name);
+  int decodeStringToBuffer(XdrReader& xdr, Buffer* buf);
 
   void splitNfsPath(const std::string &Path,
                     std::vector<std::string> &Segments);
   void buildNfsPath(std::string &Path,
                     std::vector<std::string> &Segments);
 
-  int encode_fattr4(RpcPacketPtr packet, const fattr4 *attr);
+  // most bytes encode_fattr4() writes, the caller reserves them
+  uint32 fattr4MaxSize(const fattr4 *attr);
+  void encode_fattr4(XdrWriter& xdr, const fattr4 *attr);
   int decode_fattr4(fattr4 *fattr, uint32_t mask1, uint32_t mask2, NfsAttr &attr);
   int NfsAttr_fattr4(NfsAttr &attr, fattr4 *fattr);
 }}
@@ -19,51 +19,61 @@
 #include "RpcPacket.h"
 #include "RpcConnection.h"
 #include "NfsUtil.h"
+#include "XdrWriter.h"
+#include "XdrReader.h"
 #include <syslog.h>
 
 namespace OpenNfsC {
 namespace NLMv4 {
 
-#define ENCODE_NETOBJ(PKT, VAR) RETURN_ON_ERROR(PKT->xdrEncodeVarOpaque((unsigned char*)VAR.n_bytes, VAR.n_len))
+#define NETOBJ_SIZE(VAR) XdrWriter::varOpaqueSize(VAR.n_len)
+#define PUT_NETOBJ(XDR, VAR) XDR.putVarOpaque(VAR.n_bytes, VAR.n_len)
 
-static inline int decodeNetObj(RpcPacketPtr& pkt, struct netobj* obj)
+static inline int decodeNetObj(XdrReader& xdr, struct netobj* obj)
 {
   uint32 len = 0;
   unsigned char* bytes = NULL;
-  RETURN_ON_ERROR(pkt->xdrDecodeString(bytes, len));
+  RETURN_ON_ERROR(xdr.decodeString(bytes, len));
   obj->n_bytes = reinterpret_cast<char*>(bytes);
   obj->n_len = len;
   return 0;
 }
 
-static inline int encodeNlmLock(RpcPacketPtr& pkt, struct nlm4_lock& lock)
+static inline uint32 nlmLockSize(const struct nlm4_lock& lock)
 {
-  RETURN_ON_ERROR(pkt->xdrEncodeString((unsigned char*)lock.nlm4_lock_caller_name, strlen(lock.nlm4_lock_caller_name)));
-  ENCODE_NETOBJ(pkt, lock.nlm4_lock_fh);
-  ENCODE_NETOBJ(pkt, lock.nlm4_lock_oh);
-  RETURN_ON_ERROR(pkt->xdrEncodeUint32(lock.nlm4_lock_svid));
-  RETURN_ON_ERROR(pkt->xdrEncodeUint64(lock.nlm4_lock_l_offset));
-  RETURN_ON_ERROR(pkt->xdrEncodeUint64(lock.nlm4_lock_l_len));
-  return 0;
+  return XdrWriter::varOpaqueSize(strlen(lock.nlm4_lock_caller_name)) +
+         NETOBJ_SIZE(lock.nlm4_lock_fh) + NETOBJ_SIZE(lock.nlm4_lock_oh) + 4 + 8 + 8;
 }
 
-static inline int decodeNlmHolder(RpcPacketPtr& pkt, struct nlm4_holder* holder)
+// the caller reserves nlmLockSize()
+static inline void encodeNlmLock(XdrWriter& xdr, const struct nlm4_lock& lock)
 {
-  RETURN_ON_ERROR(pkt->xdrDecodeUint32((uint32*)&(holder->nlm4_holder_exclusive)) );
-  RETURN_ON_ERROR(pkt->xdrDecodeUint32(&(holder->nlm4_holder_svid)) );
-  //DECODE_NETOBJ(pkt, holder.nlm4_holder_oh);
-  RETURN_ON_ERROR(decodeNetObj(pkt, &(holder->nlm4_holder_oh)) );
-  DECODE_UQUAD(pkt, holder->nlm4_holder_l_offset);
-  DECODE_UQUAD(pkt, holder->nlm4_holder_l_len);
+  xdr.putString(lock.nlm4_lock_caller_name, strlen(lock.nlm4_lock_caller_name));
+  PUT_NETOBJ(xdr, lock.nlm4_lock_fh);
+  PUT_NETOBJ(xdr, lock.nlm4_lock_oh);
+  xdr.putUint32(lock.nlm4_lock_svid);
+  xdr.putUint64(lock.nlm4_lock_l_offset);
+  xdr.putUint64(lock.nlm4_lock_l_len);
+}
+
+static inline int decodeNlmHolder(XdrReader& xdr, struct nlm4_holder* holder)
+{
+  RETURN_ON_ERROR(xdr.need(4 + 4));
+  holder->nlm4_holder_exclusive = xdr.getUint32();
+  holder->nlm4_holder_svid = xdr.getUint32();
+  RETURN_ON_ERROR(decodeNetObj(xdr, &(holder->nlm4_holder_oh)) );
+  RETURN_ON_ERROR(xdr.need(8 + 8));
+  holder->nlm4_holder_l_offset = xdr.getUint64();
+  holder->nlm4_holder_l_len = xdr.getUint64();
   return 0;
 }
 
-static inline int decodeNlmRes(RpcPacketPtr& pkt, struct nlm4_res& res)
+static inline int decodeNlmRes(XdrReader& xdr, struct nlm4_res& res)
 {
-  RETURN_ON_ERROR(decodeNetObj(pkt, &res.nlm4_res_cookie));
+  RETURN_ON_ERROR(decodeNetObj(xdr, &res.nlm4_res_cookie));
   //DECODE_NETOBJ(pkt, res.nlm4_res_cookie);
   uint32 stat = 0;
-  RETURN_ON_ERROR(pkt->xdrDecodeUint32(&stat));
+  RETURN_ON_ERROR(xdr.decodeUint32(&stat));
   res.nlm4_res_stat.nlm4_stat = (enum nlm4_stats)stat;
   return 0;
 }
@@ -83,9 +93,12 @@ int TestCall::encodeArguments()
   RpcPacketPtr request = getRequest();
   if (request)
   {
-    ENCODE_NETOBJ(request, args.nlm4_testargs_cookie);
-    RETURN_ON_ERROR(request->xdrEncodeUint32(args.nlm4_testargs_exclusive));
-    return encodeNlmLock(request, args.nlm4_testargs_alock);
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(NETOBJ_SIZE(args.nlm4_testargs_cookie) + 4 + nlmLockSize(args.nlm4_testargs_alock)));
+    PUT_NETOBJ(xdr, args.nlm4_testargs_cookie);
+    xdr.putUint32(args.nlm4_testargs_exclusive);
+    encodeNlmLock(xdr, args.nlm4_testargs_alock);
+    return 0;
   }
   else
     return -1;
@@ -99,12 +112,14 @@ int TestCall::decodeResults()
   if (reply == NULL)
     return -1;
 
-  RETURN_ON_ERROR(decodeNetObj(reply, &res.nlm4_testres_cookie));
-  RETURN_ON_ERROR(reply->xdrDecodeUint32(&status));
+  XdrReader xdr(reply);
+
+  RETURN_ON_ERROR(decodeNetObj(xdr, &res.nlm4_testres_cookie));
+  RETURN_ON_ERROR(xdr.decodeUint32(&status));
   res.nlm4_testres_stat.stat = (enum nlm4_stats)status;
   if (status == NLMSTAT4_DENIED)
   {
-    return decodeNlmHolder(reply, &res.nlm4_testres_stat.nlm4_testrply_u.nlm4_testrply_holder);
+    return decodeNlmHolder(xdr, &res.nlm4_testres_stat.nlm4_testrply_u.nlm4_testrply_holder);
   }
   return 0;
 }
@@ -118,12 +133,15 @@ int LockCall::encodeArguments()
   RpcPacketPtr request = getRequest();
   if (request)
   {
-    ENCODE_NETOBJ(request, args.nlm4_lockargs_cookie);
-    RETURN_ON_ERROR(request->xdrEncodeUint32(args.nlm4_lockargs_block));
-    RETURN_ON_ERROR(request->xdrEncodeUint32(args.nlm4_lockargs_exclusive));
-    RETURN_ON_ERROR(encodeNlmLock(request, args.nlm4_lockargs_alock));
-    RETURN_ON_ERROR(request->xdrEncodeUint32(args.nlm4_lockargs_reclaim));
-    RETURN_ON_ERROR(request->xdrEncodeUint32(args.nlm4_lockargs_state));
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(NETOBJ_SIZE(args.nlm4_lockargs_cookie) + 4 + 4 +
+                                nlmLockSize(args.nlm4_lockargs_alock) + 4 + 4));
+    PUT_NETOBJ(xdr, args.nlm4_lockargs_cookie);
+    xdr.putUint32(args.nlm4_lockargs_block);
+    xdr.putUint32(args.nlm4_lockargs_exclusive);
+    encodeNlmLock(xdr, args.nlm4_lockargs_alock);
+    xdr.putUint32(args.nlm4_lockargs_reclaim);
+    xdr.putUint32(args.nlm4_lockargs_state);
     return 0;
   }
 
@@ -137,7 +155,9 @@ int LockCall::decodeResults()
   if (reply == NULL)
     return -1;
 
-  return decodeNlmRes(reply, res);
+  XdrReader xdr(reply);
+
+  return decodeNlmRes(xdr, res);
 }
 
 CancelCall::CancelCall(const nlm4_cancargs& cancargs):RemoteCall(NLM, NLM_V4_CANCEL),args(cancargs)
@@ -149,10 +169,13 @@ int CancelCall::encodeArguments()
   RpcPacketPtr request = getRequest();
   if (request)
   {
-    ENCODE_NETOBJ(request, args.nlm4_cancargs_cookie);
-    RETURN_ON_ERROR(request->xdrEncodeUint32(args.nlm4_cancargs_block));
-    RETURN_ON_ERROR(request->xdrEncodeUint32(args.nlm4_cancargs_exclusive));
-    RETURN_ON_ERROR(encodeNlmLock(request, args.nlm4_cancargs_alock));
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(NETOBJ_SIZE(args.nlm4_cancargs_cookie) + 4 + 4 +
+                                nlmLockSize(args.nlm4_cancargs_alock)));
+    PUT_NETOBJ(xdr, args.nlm4_cancargs_cookie);
+    xdr.putUint32(args.nlm4_cancargs_block);
+    xdr.putUint32(args.nlm4_cancargs_exclusive);
+    encodeNlmLock(xdr, args.nlm4_cancargs_alock);
     return 0;
   }
 
@@ -166,7 +189,9 @@ int CancelCall::decodeResults()
   if (reply == NULL)
     return -1;
 
-  return decodeNlmRes(reply, res);
+  XdrReader xdr(reply);
+
+  return decodeNlmRes(xdr, res);
 }
 
 UnlockCall::UnlockCall(const nlm4_unlockargs& unlockargs):RemoteCall(NLM, NLM_V4_UNLOCK),args(unlockargs)
@@ -178,8 +203,10 @@ int UnlockCall::encodeArguments()
   RpcPacketPtr request = getRequest();
   if (request)
   {
-    ENCODE_NETOBJ(request, args.nlm4_unlockargs_cookie);
-    RETURN_ON_ERROR(encodeNlmLock(request, args.nlm4_unlockargs_alock));
+    XdrWriter xdr(request);
+    RETURN_ON_ERROR(xdr.reserve(NETOBJ_SIZE(args.nlm4_unlockargs_cookie) + nlmLockSize(args.nlm4_unlockargs_alock)));
+    PUT_NETOBJ(xdr, args.nlm4_unlockargs_cookie);
+    encodeNlmLock(xdr, args.nlm4_unlockargs_alock);
     return 0;
   }
 
@@ -193,7 +220,9 @@ int UnlockCall::decodeResults()
   if (reply == NULL)
     return -1;
 
-  return decodeNlmRes(reply, res);
+  XdrReader xdr(reply);
+
+  return decodeNlmRes(xdr, res);
 }
 
 }}
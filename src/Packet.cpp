@@ -16,7 +16,72 @@
 */
 
 #include "Packet.h"
+#include <string.h>
 
 namespace OpenNfsC {
 
+int Packet::appendRef(const unsigned char* inBuf, uint32 len)
+{
+  if (len == 0)
+    return 0;
+
+  Reference ref = { m_buffer.size(), inBuf, len };
+  m_refs.push_back(ref);
+  m_refBytes += len;
+  return len;
+}
+
+void Packet::copyReferences()
+{
+  if (!m_refCopy.empty())
+    return;
+
+  m_refCopy.resize(m_refBytes);
+  uint32 pos = 0;
+  for (size_t i = 0; i < m_refs.size(); i++)
+  {
+    memcpy(&m_refCopy[pos], m_refs[i].data, m_refs[i].len);
+    m_refs[i].data = &m_refCopy[pos];
+    pos += m_refs[i].len;
+  }
+}
+
+int Packet::getWriteIov(struct iovec* iov, int maxIov)
+{
+  int count = 0;
+  uint32 wirePos = 0;
+  uint32 bufPos = 0;
+
+  // the packet data is split by the references into alternating pieces
+  for (size_t i = 0; i <= m_refs.size() && count < maxIov; i++)
+  {
+    uint32 bufEnd = (i < m_refs.size()) ? m_refs[i].offset : m_buffer.size();
+    uint32 len = bufEnd - bufPos;
+    if (len > 0 && wirePos + len > m_writeIndex)
+    {
+      uint32 skip = (m_writeIndex > wirePos) ? m_writeIndex - wirePos : 0;
+      iov[count].iov_base = m_buffer.seek(bufPos + skip);
+      iov[count].iov_len = len - skip;
+      count++;
+    }
+    wirePos += len;
+    bufPos = bufEnd;
+
+    if (i == m_refs.size() || count == maxIov)
+      break;
+
+    len = m_refs[i].len;
+    if (wirePos + len > m_writeIndex)
+    {
+      uint32 skip = (m_writeIndex > wirePos) ? m_writeIndex - wirePos : 0;
+      iov[count].iov_base = (void*)(m_refs[i].data + skip);
+      iov[count].iov_len = len - skip;
+      count++;
+    }
+    wirePos += len;
+  }
+
+  return count;
+}
+
 }
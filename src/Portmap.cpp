@@ -18,6 +18,7 @@
 #include "Portmap.h"
 #include "RpcPacket.h"
 #include "NfsUtil.h"
+#include "XdrReader.h"
 #include "RpcConnection.h"
 
 namespace OpenNfsC {
@@ -35,20 +36,23 @@ int DumpCall::decodeResults()
   if ( reply == NULL )
     return -1;
 
-  int len = reply->getUnparsedDataSize()/(4*5);
+  XdrReader xdr(reply);
+
+  int len = xdr.remaining()/(4*5);
   PortmapDumpData* dumpList = new PortmapDumpData[len];
 
   uint32 cont = 0;
-  RETURN_ON_ERROR(reply->xdrDecodeUint32(&cont));
+  RETURN_ON_ERROR(xdr.decodeUint32(&cont));
 
   int i = 0;
   while ( cont && i < len )
   {
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&dumpList[i].program));
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&dumpList[i].version));
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&dumpList[i].transp));
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&(dumpList[i].port)));
-    RETURN_ON_ERROR(reply->xdrDecodeUint32(&cont));
+    RETURN_ON_ERROR(xdr.need(4*5));
+    dumpList[i].program = xdr.getUint32();
+    dumpList[i].version = xdr.getUint32();
+    dumpList[i].transp = xdr.getUint32();
+    dumpList[i].port = xdr.getUint32();
+    cont = xdr.getUint32();
     i++;
   }
 
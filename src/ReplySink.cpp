@@ -0,0 +1,126 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ReplySink.h"
+#include <arpa/inet.h>
+#include <string.h>
+
+namespace OpenNfsC {
+
+ReplySink::ReplySink(const struct iovec* iov, int iovcnt):
+  m_iov(iov, iov + ((iovcnt > 0) ? iovcnt : 0)), m_capacity(0), m_filled(0), m_placed(false)
+{
+  for ( size_t i = 0; i < m_iov.size(); i++ )
+    m_capacity += m_iov[i].iov_len;
+}
+
+int ReplySink::copyIn(const unsigned char* data, uint32 len)
+{
+  if ( m_filled + len > m_capacity )
+    return -1;
+
+  uint32 skip = m_filled;
+  uint32 left = len;
+  for ( size_t i = 0; i < m_iov.size() && left > 0; i++ )
+  {
+    uint32 iovLen = m_iov[i].iov_len;
+    if ( skip >= iovLen )
+    {
+      skip -= iovLen;
+      continue;
+    }
+
+    uint32 n = iovLen - skip;
+    if ( n > left )
+      n = left;
+    memcpy((char*)m_iov[i].iov_base + skip, data, n);
+    data += n;
+    left -= n;
+    skip = 0;
+  }
+
+  m_filled += len;
+  return len;
+}
+
+int ReplySink::getIov(struct iovec* iov, int maxIov, uint32 len) const
+{
+  int count = 0;
+  uint32 skip = m_filled;
+  for ( size_t i = 0; i < m_iov.size() && count < maxIov && len > 0; i++ )
+  {
+    uint32 iovLen = m_iov[i].iov_len;
+    if ( skip >= iovLen )
+    {
+      skip -= iovLen;
+      continue;
+    }
+
+    uint32 n = iovLen - skip;
+    if ( n > len )
+      n = len;
+    iov[count].iov_base = (char*)m_iov[i].iov_base + skip;
+    iov[count].iov_len = n;
+    count++;
+    len -= n;
+    skip = 0;
+  }
+  return count;
+}
+
+int ReplySink::getUint32(const unsigned char* rec, uint32 len, uint32 off, uint32& val)
+{
+  if ( off + sizeof(uint32) > len )
+    return 1;
+
+  uint32 nValue;
+  memcpy(&nValue, rec + off, sizeof(nValue));
+  val = ntohl(nValue);
+  return 0;
+}
+
+int ReplySink::skipReplyHeader(const unsigned char* rec, uint32 len, uint32& off)
+{
+  uint32 val = 0;
+
+  // xid, message type
+  off = 2 * sizeof(uint32);
+
+  // reply status, MSG_ACCEPTED
+  if ( getUint32(rec, len, off, val) != 0 )
+    return 1;
+  if ( val != 0 )
+    return -1;
+  off += sizeof(uint32);
+
+  // verifier flavor and body
+  off += sizeof(uint32);
+  if ( getUint32(rec, len, off, val) != 0 )
+    return 1;
+  off += sizeof(uint32) + ((val + 3) & ~3);
+
+  // accept status, SUCCESS
+  if ( getUint32(rec, len, off, val) != 0 )
+    return 1;
+  if ( val != 0 )
+    return -1;
+  off += sizeof(uint32);
+
+  return 0;
+}
+
+} // end of namespace
@@ -17,39 +17,119 @@
 
 #include "Responder.h"
 #include "RpcPacket.h"
-#include <sys/time.h>
+#include "ReplySink.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
 #include <syslog.h>
 
 namespace OpenNfsC {
 
-using Thread::Mutex;
-using Thread::ConditionVar;
-using Thread::MutexGuard;
-
 const int defaultTimeOut = 5000;  // 5 seconds
 
-Responder::Responder():m_done(false), m_wait(false), m_condMutex(false), m_cond(&m_condMutex), m_response(NULL)
+uint32 Responder::gSpinCount = 0;
+
+static uint64 nowMs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void futexWait(std::atomic<uint32>* word, uint32 expected, int timeout_ms)
+{
+  struct timespec ts;
+  ts.tv_sec = timeout_ms / 1000;
+  ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+  syscall(SYS_futex, (uint32*)word, FUTEX_WAIT_PRIVATE, expected, &ts, NULL, 0);
+}
+
+static void futexWake(std::atomic<uint32>* word)
+{
+  syscall(SYS_futex, (uint32*)word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+Responder::Responder():
+  m_state(PENDING), m_response(NULL),
+  m_callback(), m_request(NULL), m_sentTime(0), m_timeout(0), m_maxTimeout(0), m_retries(0),
+  m_startTime(0), m_retried(false), m_deadline(0), m_cancelled(false), m_timer(), m_sink(NULL), m_sinkStart(0), m_receiving(false), m_nextFree(0), m_pooled(false)
+{
+}
+
+void Responder::reset()
+{
+  m_state.store(PENDING, std::memory_order_relaxed);
+  m_response = NULL;
+  m_callback = nullptr;
+  m_request = NULL;
+  m_sentTime = 0;
+  m_timeout = 0;
+  m_maxTimeout = 0;
+  m_retries = 0;
+  m_startTime = 0;
+  m_retried = false;
+  m_deadline = 0;
+  m_cancelled = false;
+  m_sink = NULL;
+  m_sinkStart = 0;
+  m_receiving = false;
+}
+
+void Responder::reset(const ReplyCallback& callback, RpcPacketPtr request, int timeout_ms, int retries)
 {
+  reset();
+  m_callback = callback;
+  m_request = request;
+  m_timeout = timeout_ms;
+  m_maxTimeout = timeout_ms;
+  m_retries = retries;
+  m_sink = request.empty() ? NULL : request->getReplySink();
+  m_sinkStart = (m_sink != NULL) ? m_sink->filled() : 0;
+}
+
+void Responder::complete(int outcome, RpcPacketPtr response)
+{
+  try
+  {
+    m_callback(outcome, response);
+  }
+  catch (const std::string& err)
+  {
+    syslog(LOG_ERR, "Responder::%s: completion failed: %s\n", __func__, err.c_str());
+  }
+  catch (...)
+  {
+    syslog(LOG_ERR, "Responder::%s: An unhandled exception occurred in completion\n", __func__);
+  }
 }
 
 void Responder::waitForResponse(int timeoutVal)
 {
-  if (timeoutVal < defaultTimeOut)
-    timeoutVal = defaultTimeOut;
+  // a fast server answers before a sleep would pay off
+  for (uint32 i = 0; i < gSpinCount; i++)
+  {
+    if (m_state.load(std::memory_order_acquire) == DONE)
+      return;
+  }
 
-  struct timespec absTimeout;
-  ConditionVar::reltime_to_abs(timeoutVal, &absTimeout);
+  uint64 deadline = nowMs() + timeoutVal;
+  uint32 state = PENDING;
+  if (!m_state.compare_exchange_strong(state, WAITING, std::memory_order_acquire))
+    return;
 
-  bool isTimeout;
-  m_condMutex.acquire();
-  if (!m_done)
+  while (m_state.load(std::memory_order_acquire) == WAITING)
   {
-    m_wait = true;
-    m_response = NULL;
-    m_cond.waitAbs(&absTimeout, &isTimeout);
-    m_wait = false;
+    uint64 now = nowMs();
+    if (now >= deadline)
+      break;
+    futexWait(&m_state, WAITING, (int)(deadline - now));
   }
-  m_condMutex.release();
+
+  // timed out, a later signal need not wake anybody
+  state = WAITING;
+  m_state.compare_exchange_strong(state, PENDING, std::memory_order_acquire);
 }
 
 void Responder::waitForResponse()
@@ -57,13 +137,16 @@ void Responder::waitForResponse()
   waitForResponse(defaultTimeOut);
 }
 
+// signals are serialized by the xid table slot of the request
 void Responder::signalReady(RpcPacketPtr response)
 {
-  m_condMutex.acquire();
-  m_done = true;
+  // the first reply wins, the waiter may be reading it already
+  if (m_state.load(std::memory_order_acquire) == DONE)
+    return;
+
   m_response = response;
-  if (m_wait)
-    m_cond.signal();
+  if (m_state.exchange(DONE, std::memory_order_acq_rel) == WAITING)
+    futexWake(&m_state);
 
   if (response)
   {
@@ -73,15 +156,86 @@ void Responder::signalReady(RpcPacketPtr response)
   {
     syslog(LOG_DEBUG, "Responder::signalReady got NULL response \n");
   }
-
-  m_condMutex.release();
 }
 
 RpcPacketPtr Responder::getReply()
 {
-  MutexGuard lock(m_condMutex);
+  if (m_state.load(std::memory_order_acquire) != DONE)
+    return NULL;
   return m_response;
 }
 
-} // namespace OpenNfsC
+ResponderPool::ResponderPool(uint32 size):
+  m_responders(new Responder[size]), m_size(size), m_freeHead(0)
+{
+  // chain them all into the free list
+  for (uint32 i = 0; i < m_size; i++)
+  {
+    m_responders[i].m_pooled = true;
+    m_responders[i].m_nextFree.store(i, std::memory_order_relaxed);
+  }
+  m_freeHead.store(m_size, std::memory_order_release);
+}
+
+ResponderPool::~ResponderPool()
+{
+  delete [] m_responders;
+}
+
+Responder* ResponderPool::pop()
+{
+  uint64 head = m_freeHead.load(std::memory_order_acquire);
+  while (true)
+  {
+    uint32 index = (uint32)head;
+    if (index == 0)
+      return NULL;
+
+    Responder* responder = &m_responders[index - 1];
+    uint64 next = ((head >> 32) + 1) << 32 | responder->m_nextFree.load(std::memory_order_relaxed);
+    if (m_freeHead.compare_exchange_weak(head, next, std::memory_order_acquire))
+      return responder;
+  }
+}
+
+Responder* ResponderPool::get()
+{
+  Responder* responder = pop();
+  if (responder == NULL)
+    responder = new Responder;
+  responder->reset();
+  return responder;
+}
+
+Responder* ResponderPool::get(const ReplyCallback& callback, RpcPacketPtr request, int timeout_ms, int retries)
+{
+  Responder* responder = pop();
+  if (responder == NULL)
+    responder = new Responder;
+  responder->reset(callback, request, timeout_ms, retries);
+  return responder;
+}
 
+void ResponderPool::put(Responder* responder)
+{
+  if (!responder->m_pooled)
+  {
+    delete responder;
+    return;
+  }
+
+  // drop the references the call holds right away
+  responder->reset();
+
+  uint32 index = (uint32)(responder - m_responders) + 1;
+  uint64 head = m_freeHead.load(std::memory_order_relaxed);
+  while (true)
+  {
+    responder->m_nextFree.store((uint32)head, std::memory_order_relaxed);
+    uint64 next = ((head >> 32) + 1) << 32 | index;
+    if (m_freeHead.compare_exchange_weak(head, next, std::memory_order_release))
+      return;
+  }
+}
+
+} // namespace OpenNfsC
@@ -19,35 +19,140 @@
 #define _RESPONDER_H_
 
 #include "RpcPacket.h"
-#include <Thread.h>
+#include "BasicConnection.h"
+#include "TimerWheel.h"
+#include <atomic>
 
 namespace OpenNfsC {
 
 class RpcPacket;
+class ResponderPool;
 
 class Responder
 {
   public:
     Responder();
+    // synchronous responder, a waiter is woken with the reply
+    void reset();
+    // asynchronous responder, the callback is run instead of waking a waiter.
+    // a synchronous one if the callback is empty
+    void reset(const ReplyCallback& callback, RpcPacketPtr request, int timeout_ms, int retries);
+
     void waitForResponse();
     void waitForResponse(int timeout);
     void signalReady(RpcPacketPtr reply);
 
     RpcPacketPtr getReply();
+    // true once the reply is set or the wait has been given up
+    bool isReady() const { return m_state.load(std::memory_order_acquire) == DONE; }
+
+    bool isAsync() const { return (bool)m_callback; }
+    void complete(int outcome, RpcPacketPtr reply);
+
+    // requests are retried and expired by the timer of the connection
+    RpcPacketPtr getRequest() const { return m_request; }
+    bool isExpired(uint64 now_ms) const { return now_ms - m_sentTime >= (uint64)m_timeout; }
+    // the whole call is given up at the deadline, in monotonic ms
+    void setDeadline(uint64 deadline_ms) { m_deadline = deadline_ms; }
+    uint64 getDeadline() const { return m_deadline; }
+    // when the timer has to fire next, the send times out or the deadline passes
+    uint64 getNextEvent() const
+    {
+      uint64 expiry = m_sentTime + m_timeout;
+      return (expiry < m_deadline) ? expiry : m_deadline;
+    }
+    TimerWheel::Timer* getTimer() { return &m_timer; }
+    // given up by the caller, see RpcConnection::cancelRequest()
+    void markCancelled() { m_cancelled = true; }
+    bool isCancelled() const { return m_cancelled; }
+    bool canRetry() const { return m_retries > 0; }
+    void markSent(uint64 now_ms) { m_sentTime = now_ms; }
+    // timeout of the current send, up to the timeout given to reset()
+    int getTimeout() const { return m_timeout; }
+    int getMaxTimeout() const { return m_maxTimeout; }
+    void setTimeout(int timeout_ms) { m_timeout = timeout_ms; }
+    void retry(uint64 now_ms, int timeout_ms) { --m_retries; m_sentTime = now_ms; m_timeout = timeout_ms; m_retried = true; }
+    // sent again on a new connection, does not use up a retry
+    void replay(uint64 now_ms) { m_sentTime = now_ms; m_retried = true; }
+    // first send in microseconds, for the round trip time of the window
+    void markStart(uint64 now_us) { m_startTime = now_us; }
+    uint64 getStartTime() const { return m_startTime; }
+    bool wasRetried() const { return m_retried; }
+
+    // caller memory the reply payload goes to. receiving is set while the
+    // connection writes to it, the responder must be kept until it is done.
+    // both are only used while the xid table slot of the request is held
+    ReplySink* getSink() const { return m_sink; }
+    void setSink(ReplySink* sink) { m_sink = sink; }
+    // bytes the sink held when the request was made, a replay starts there
+    uint32 getSinkStart() const { return m_sinkStart; }
+    bool isReceiving() const { return m_receiving; }
+    void setReceiving(bool receiving) { m_receiving = receiving; }
+
+    // times a waiter polls for the reply before it sleeps, 0 to sleep at once
+    static void setSpinCount(uint32 spins) { gSpinCount = spins; }
 
   private:
     Responder(const Responder&); // not implemented
     Responder& operator=(const Responder&); //not implemented;
+    friend class ResponderPool;
+
+    enum State { PENDING, WAITING, DONE };
 
   private:
-    bool m_done;
-    bool m_wait;
-    Thread::Mutex m_condMutex;
-    Thread::ConditionVar m_cond;
+    // futex word, the reply is set before it becomes DONE
+    std::atomic<uint32> m_state;
     RpcPacketPtr m_response;
-    struct timespec m_timeout;
+
+    ReplyCallback m_callback;
+    RpcPacketPtr m_request;
+    uint64 m_sentTime;
+    int m_timeout;
+    int m_maxTimeout;
+    int m_retries;
+    uint64 m_startTime;
+    bool m_retried;
+    uint64 m_deadline;
+    bool m_cancelled;
+    // guarded by the timer lock of the connection, off the wheel whenever
+    // the responder is not pending
+    TimerWheel::Timer m_timer;
+
+    ReplySink* m_sink;
+    uint32 m_sinkStart;
+    bool m_receiving;
+
+    // free list link of the pool, index + 1 of the next free responder
+    std::atomic<uint32> m_nextFree;
+    bool m_pooled;
+
+    static uint32 gSpinCount;
 };
 
-}
+/* Preallocated responders of a connection. get() falls back to the heap
+ * when all of them are in use */
+class ResponderPool
+{
+  public:
+    ResponderPool(uint32 size);
+    ~ResponderPool();
+
+    Responder* get();
+    Responder* get(const ReplyCallback& callback, RpcPacketPtr request, int timeout_ms, int retries);
+    void put(Responder* responder);
+
+  private:
+    ResponderPool(const ResponderPool&); // not implemented
+    ResponderPool& operator=(const ResponderPool&); // not implemented
 
+    Responder* pop();
+
+  private:
+    Responder* m_responders;
+    uint32 m_size;
+    // tag in the high half against ABA, index + 1 of the first free one below
+    std::atomic<uint64> m_freeHead;
+};
+
+}
 #endif /* _RESPONDER_H_ */
@@ -0,0 +1,97 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "RpcAuth.h"
+#include "RpcDefs.h"
+#include <Thread.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <map>
+
+using OpenNfsC::Thread::MutexGuard;
+
+namespace OpenNfsC {
+
+// identities cached at most, later ones are encoded for each get()
+const size_t gMaxCachedCreds = 4096;
+
+namespace
+{
+  typedef std::map<std::vector<uint32>, AuthUnixPtr> CredCache;
+
+  Thread::Mutex credCacheLock(false);
+  CredCache credCache;
+
+  inline unsigned char* putUint32(unsigned char* p, uint32 value)
+  {
+    uint32 nValue = htonl(value);
+    memcpy(p, &nValue, sizeof(nValue));
+    return p + sizeof(nValue);
+  }
+}
+
+AuthUnix::AuthUnix(uint32 uid, uint32 gid, const std::vector<uint32>& gids):
+  m_uid(uid), m_gid(gid), m_size(0)
+{
+  uint32 ngids = (gids.size() > MAX_GIDS) ? MAX_GIDS : gids.size();
+
+  unsigned char* p = putUint32(m_encoded, AUTHTYPE_UNIX);
+  unsigned char* length = p;
+  p += sizeof(uint32);
+  p = putUint32(p, 0); // stamp
+  p = putUint32(p, 3); // machine name
+  memcpy(p, "fma", 4);
+  p += 4;
+  p = putUint32(p, uid);
+  p = putUint32(p, gid);
+  p = putUint32(p, ngids);
+  for ( uint32 i = 0; i < ngids; i++ )
+    p = putUint32(p, gids[i]);
+  putUint32(length, p - length - sizeof(uint32));
+
+  p = putUint32(p, AUTHTYPE_NULL); // verifier
+  p = putUint32(p, 0);
+  m_size = p - m_encoded;
+}
+
+AuthUnixPtr AuthUnix::get(uint32 uid, uint32 gid, const std::vector<uint32>& gids)
+{
+  std::vector<uint32> key;
+  key.reserve(2 + gids.size());
+  key.push_back(uid);
+  key.push_back(gid);
+  key.insert(key.end(), gids.begin(), gids.end());
+
+  MutexGuard lock(credCacheLock);
+  CredCache::iterator it = credCache.find(key);
+  if ( it != credCache.end() )
+    return it->second;
+
+  AuthUnixPtr cred = new AuthUnix(uid, gid, gids);
+  if ( credCache.size() < gMaxCachedCreds )
+    credCache.insert(std::make_pair(key, cred));
+  return cred;
+}
+
+const AuthUnix* AuthUnix::getDefault()
+{
+  static AuthUnixPtr defaultCred = new AuthUnix(0, 0, std::vector<uint32>());
+  return defaultCred.ptr();
+}
+
+} // end of namespace
@@ -22,6 +22,7 @@
 #include <iostream>
 #include <rpc/rpc.h>
 #include <syslog.h>
+#include <errno.h>
 
 namespace OpenNfsC {
 
@@ -34,6 +35,8 @@ RemoteCall::~RemoteCall()
 
 void RemoteCall::clear()
 {
+  MutexGuard lock(m_callLock);
+  m_conn = NULL;
   if ( !m_request.empty() )
   {
     syslog(LOG_DEBUG, "RemoteCall::%s: delete request \n", __func__);
@@ -53,6 +56,50 @@ enum clnt_stat RemoteCall::call(const NfsConnectionGroupPtr& connGroup, int time
 }
 
 enum clnt_stat RemoteCall::call(NfsConnectionGroup* pConnGroup, int timeout_s)
+{
+  // the caller waits for the reply, bulk data can be sent from its memory
+  BasicConnectionPtr conn;
+  enum clnt_stat stat = prepareRequest(pConnGroup, conn, true);
+  if ( stat != RPC_SUCCESS )
+    return stat;
+
+  int outcome = conn->sendAndWait(m_request, m_reply, getTimeout(pConnGroup, timeout_s));
+  return processReply(pConnGroup, conn, outcome);
+}
+
+enum clnt_stat RemoteCall::callAsync(const NfsConnectionGroupPtr& connGroup, const Completion& completion, int timeout_s)
+{
+  return callAsync(connGroup.ptr(), completion, timeout_s);
+}
+
+enum clnt_stat RemoteCall::callAsync(NfsConnectionGroup* pConnGroup, const Completion& completion, int timeout_s)
+{
+  BasicConnectionPtr conn;
+  enum clnt_stat stat = prepareRequest(pConnGroup, conn, false);
+  if ( stat != RPC_SUCCESS )
+    return stat;
+
+  // keep the call and the group alive until the completion has run
+  RemoteCallPtr self(this);
+  NfsConnectionGroupPtr group(pConnGroup);
+
+  ReplyCallback onReply = [self, group, conn, completion](int outcome, RpcPacketPtr reply) mutable
+  {
+    self->m_reply = reply;
+    enum clnt_stat result = self->processReply(group.ptr(), conn, outcome);
+    completion(result);
+  };
+
+  if ( conn->sendAsync(m_request, onReply, getTimeout(pConnGroup, timeout_s)) < 0 )
+  {
+    syslog(LOG_ERR, "RemoteCall::callAsync failed to queue request\n");
+    return RPC_CANTSEND;
+  }
+
+  return RPC_SUCCESS;
+}
+
+enum clnt_stat RemoteCall::prepareRequest(NfsConnectionGroup* pConnGroup, BasicConnectionPtr& conn, bool borrowData)
 {
   setErrno(0);
   if ( pConnGroup == NULL )
@@ -67,23 +114,53 @@ enum clnt_stat RemoteCall::call(NfsConnectionGroup* pConnGroup, int timeout_s)
     return RPC_SYSTEMERROR;
   }
 
-  BasicConnectionPtr conn = pConnGroup->getNfsConnection(m_program);
+  conn = pConnGroup->getNfsConnection(m_program);
+  if ( checkForConnection() && (conn.empty() || !conn->isUsable()) )
+  {
+    // the connection failed since the services were last set up
+    pConnGroup->invalidateConnections();
+    if ( !pConnGroup->ensureConnection() )
+    {
+      syslog(LOG_ERR, "RemoteCall::call unable to ensure connection\n");
+      return RPC_SYSTEMERROR;
+    }
+    conn = pConnGroup->getNfsConnection(m_program);
+  }
+
   if ( conn.empty() )
   {
     syslog(LOG_ERR, "RemoteCall::call connection is NULL\n");
     return RPC_SYSTEMERROR;
   }
 
-  m_request = conn->createRequest(m_procedure);
+  RpcPacketPtr request = conn->createRequest(m_procedure, m_cred.empty() ? NULL : m_cred.ptr());
+  {
+    MutexGuard lock(m_callLock);
+    m_request = request;
+    m_conn = conn;
+  }
   if ( m_request.empty() )
     return RPC_SYSTEMERROR;
+  m_request->setReplySink(m_replySink);
+  m_request->setBorrowData(borrowData);
 
   if ( encodeArguments() < 0 )
     return RPC_CANTENCODEARGS;
+  conn->hintRequestSize(m_procedure, m_request->getSize());
+
+  return RPC_SUCCESS;
+}
+
+enum clnt_stat RemoteCall::processReply(NfsConnectionGroup* pConnGroup, BasicConnectionPtr& conn, int outcome)
+{
+  // the connection is fine, the caller gave up
+  if ( outcome == REQUEST_CANCELLED )
+    return RPC_INTR;
 
-  int timeout_ms = timeout_s * 1000;
-  int outcome = conn->sendAndWait(m_request, m_reply, timeout_ms);
   setErrno(conn->getErrno());
+  if ( outcome < 0 || getErrno() == ECONNRESET )
+    pConnGroup->invalidateConnections();
+
   if ( outcome < 0 )
     return RPC_CANTRECV;
 
@@ -102,4 +179,28 @@ enum clnt_stat RemoteCall::call(NfsConnectionGroup* pConnGroup, int timeout_s)
   return RPC_SUCCESS;
 }
 
+bool RemoteCall::cancel()
+{
+  BasicConnectionPtr conn;
+  RpcPacketPtr request;
+  {
+    MutexGuard lock(m_callLock);
+    conn = m_conn;
+    request = m_request;
+  }
+
+  if ( conn.empty() || request.empty() )
+    return false;
+  return conn->cancelRequest(request) == 0;
+}
+
+int RemoteCall::getTimeout(NfsConnectionGroup* pConnGroup, int timeout_s) const
+{
+  if ( timeout_s > 0 )
+    return timeout_s * 1000;
+  if ( m_timeoutMs > 0 )
+    return m_timeoutMs;
+  return pConnGroup->getCallTimeout();
+}
+
 } // end of namespace
@@ -18,8 +18,11 @@
 #include "RpcConnection.h"
 #include "RpcPacket.h"
 #include "Responder.h"
+#include "ReplySink.h"
 #include "ConnectionMgr.h"
 #include "RpcDefs.h"
+#include "RpcAuth.h"
+#include <time.h>
 
 #include <fcntl.h>
 #include <sys/types.h>
@@ -35,6 +38,8 @@
 #include <sstream>
 #include <stdlib.h>
 #include <syslog.h>
+#include <sched.h>
+#include <poll.h>
 
 #include <nfsrpc/pmap.h>
 #include <nfsrpc/nfs.h>
@@ -45,29 +50,120 @@ using OpenNfsC::Thread::MutexGuard;
 
 namespace OpenNfsC {
 
-// allowed udp pending requests
+// initial udp window of pending requests
 #define	NFS_UDP_CONCURRENCY	8
 #define	NFS_UDP_RETRIES		6
 #define	NFS_UDP_TIMEOUT		10000
+// udp retransmit timeout before the first round trip sample, and its floor
+#define	NFS_UDP_INITIAL_RTO	1100
+#define	NFS_UDP_MIN_RTO		200
 
-// allowed tcp pending requests
+// initial tcp window of pending requests
 #define	NFS_TCP_CONCURRENCY	128
 #define	NFS_TCP_TIMEOUT		180000
 
 
 const int udpRetries = NFS_UDP_RETRIES;// udp retries
 
+// size of a TCP receive buffer chunk
+const uint32 gRecvChunkSize = (256 * 1024);
+
+// datagrams received with one recvmmsg(), each into a buffer of the largest size
+const uint32 gDatagramBatch = 8;
+const uint32 gMaxDatagramSize = 65536;
+// replies up to this size are copied out, larger ones keep their buffer
+const uint32 gDatagramCopyMax = gMaxDatagramSize / 2;
+
+// resolution of the request timers
+const uint32 gTimerTickMs = 10;
+// a synchronous caller gives up this long after the deadline if its timer
+// has not fired
+const int gDeadlineSlackMs = 1000;
+
+// slots of the xid table, a power of two above the largest window
+const uint32 gXidTableSize = 1024;
+
+// runtime window limits, see setWindowLimits()
+static uint32 gWindowInitial = 0;
+static uint32 gWindowMin = 0;
+static uint32 gWindowMax = 0;
+
+void RpcConnection::setWindowLimits(uint32 initial, uint32 minWindow, uint32 maxWindow)
+{
+  gWindowInitial = initial;
+  gWindowMin = minWindow;
+  gWindowMax = maxWindow;
+}
+
+// see setLowLatency()
+static bool gLowLatency = false;
+
+// see setReconnectAttempts()
+uint32 RpcConnection::gReconnectAttempts = 16;
+// the first reconnect is tried at once, the next ones after a delay doubling up to the maximum
+const uint32 gReconnectDelayMs = 100;
+const uint32 gMaxReconnectDelayMs = 5000;
+
+void RpcConnection::setLowLatency(bool on)
+{
+  gLowLatency = on;
+  // a reactor passing over a socket must not be woken for it again and again
+  ConnectionMgr::setEdgeTriggered(on);
+}
+
 static inline int getConcurrencyConfig(const ConnKey& connKey)
 {
   int concurrency = (connKey.getTransport() == TRANSP_TCP) ? NFS_TCP_CONCURRENCY : NFS_UDP_CONCURRENCY;
-  if (concurrency <= 0 || concurrency > 128)
+  if ( gWindowInitial > 0 )
+    concurrency = gWindowInitial;
+  if (concurrency <= 0)
     concurrency = (connKey.getTransport() == TRANSP_TCP) ? 128 : 8;
   return concurrency;
 }
 
+static inline uint32 getMinWindowConfig(const ConnKey& connKey)
+{
+  if ( gWindowMin > 0 )
+    return gWindowMin;
+  // the window is not cut below a quarter of the initial concurrency
+  uint32 floor = getConcurrencyConfig(connKey) / 4;
+  return (floor > 0) ? floor : 1;
+}
+
+static inline uint32 getMaxWindowConfig(const ConnKey& connKey)
+{
+  // the xid table needs free slots to hand out xids
+  uint32 limit = gXidTableSize / 2;
+  uint32 maxWindow = (connKey.getTransport() == TRANSP_TCP) ? limit : 4 * NFS_UDP_CONCURRENCY;
+  if ( gWindowMax > 0 )
+    maxWindow = gWindowMax;
+  return (maxWindow > limit) ? limit : maxWindow;
+}
+
+static inline uint64 monotonicMs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static inline uint64 monotonicUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 // Initialize salt to 0
 uint32 RpcConnection::salt = 0;
 
+uint32 RpcConnection::initialXid()
+{
+  uint32 xid = salt + ((uint64_t)time(NULL) * 1000) + ((uint32_t)getpid() << 16);
+  salt += 0x00ABCDEF;
+  return xid;
+}
+
 BasicConnectionPtr RpcConnection::create(ConnKey& connKey, uint32 prog, uint32 version, bool resvPort)
 {
   BasicConnectionPtr ptr;
@@ -90,7 +186,7 @@ BasicConnectionPtr RpcConnection::create(ConnKey& connKey, uint32 prog, uint32 v
     throw std::string("Unable to create RpcConnection object");
 
   if ( ptr->getSocketId() > 0 )
-    ConnectionMgr::getInstance()->addConnection(ptr);
+    ConnectionMgr::getInstance(ptr.ptr())->addConnection(ptr);
 
   return ptr;
 }
@@ -98,23 +194,41 @@ BasicConnectionPtr RpcConnection::create(ConnKey& connKey, uint32 prog, uint32 v
 void RpcConnection::clear(BasicConnectionPtr& ptr)
 {
   if ( ! ptr.empty() )
-    ConnectionMgr::getInstance()->removeConnection(ptr);
+    ConnectionMgr::getInstance(ptr.ptr())->removeConnection(ptr);
   ptr.clear();
 }
 
 RpcConnection::RpcConnection(ConnKey& connKey, uint32 prog, uint32 version, bool resvPort):
     BasicConnection(connKey, resvPort),
-    m_nextXid(0),
     m_progNumber(prog),
     m_version(version),
-    m_fragment(),
-    m_xidTableLock(false),
-    m_concurrency(getConcurrencyConfig(connKey))
+    m_callHeaderSize(0),
+    m_callXidOffset(0),
+    m_recvStart(0),
+    m_recvEnd(0),
+    m_recvDrained(false),
+    m_recvSocket(-1),
+    m_recvData(NULL),
+    m_recvDataLeft(0),
+    m_directSink(NULL),
+    m_directXid(0),
+    m_directPayloadLeft(0),
+    m_directSuffixLeft(0),
+    m_directFilled(0),
+    m_recordChecked(false),
+    m_xidTable(gXidTableSize, initialXid()),
+    m_responderPool(new ResponderPool(getConcurrencyConfig(connKey))),
+    m_window(getConcurrencyConfig(connKey), getMinWindowConfig(connKey), getMaxWindowConfig(connKey)),
+    m_rtt(NFS_UDP_INITIAL_RTO, NFS_UDP_MIN_RTO, NFS_UDP_TIMEOUT),
+    m_timerLock(false),
+    m_timers(gTimerTickMs, monotonicMs()),
+    m_reconnects(0)
 {
-  m_nextXid = salt + ((uint64_t)time(NULL) * 1000) + ((uint32_t)getpid() << 16);
-  salt += 0x00ABCDEF;
-
-  syslog(LOG_DEBUG, "RpcConnection::RpcConnection concurrency = %d\n", getConcurrencyConfig(connKey));
+  initCallHeader();
+  for ( int i = 0; i < SIZE_HINT_PROCS; i++ )
+    m_sizeHints[i].store(0, std::memory_order_relaxed);
+  syslog(LOG_DEBUG, "RpcConnection::RpcConnection concurrency = %d, max = %u\n",
+         getConcurrencyConfig(connKey), getMaxWindowConfig(connKey));
 
   // Only log the following info once
   static bool tInit = false;
@@ -133,15 +247,37 @@ RpcConnection::RpcConnection(ConnKey& connKey, uint32 prog, uint32 version, bool
 RpcConnection::~RpcConnection()
 {
   cleanup();
+  delete m_responderPool;
 }
 
 uint32 RpcConnection::getNextXid()
 {
-  MutexGuard lock(m_xidTableLock);
-  return ++m_nextXid;
+  return m_xidTable.nextXid();
 }
 
-RpcPacketPtr RpcConnection::createRequest(int proc)
+// the header every call of the connection starts with, record mark included
+void RpcConnection::initCallHeader()
+{
+  uint32 words[7];
+  uint32 count = 0;
+
+  // tcp record, set when the request is written
+  if (getConnKey().getTransport() == TRANSP_TCP)
+    words[count++] = 0;
+
+  m_callXidOffset = count * sizeof(uint32);
+  words[count++] = 0; // xid
+  words[count++] = htonl(RPC_CALL);
+  words[count++] = htonl(2); // rpc version
+  words[count++] = htonl(m_progNumber);
+  words[count++] = htonl(m_version);
+  words[count++] = 0; // proc
+
+  m_callHeaderSize = count * sizeof(uint32);
+  memcpy(m_callHeader, words, m_callHeaderSize);
+}
+
+RpcPacketPtr RpcConnection::createRequest(int proc, const AuthUnix* cred)
 {
   RpcHeader hdrInfo;
   RpcInfo procInfo = {m_progNumber, m_version, static_cast<uint32>(proc)};
@@ -149,21 +285,26 @@ RpcPacketPtr RpcConnection::createRequest(int proc)
   hdrInfo.call = 0; //RPC_CALL
   hdrInfo.cr.proc = procInfo;
 
-  RpcPacketPtr request = new RpcPacket(hdrInfo);
+  uint32 size = 0;
+  if ( proc >= 0 && proc < SIZE_HINT_PROCS )
+    size = m_sizeHints[proc].load(std::memory_order_relaxed);
+
+  RpcPacketPtr request = (size > 0) ? new RpcPacket(hdrInfo, size) : new RpcPacket(hdrInfo);
   if ( !request.empty() )
   {
-    // tcp record
-    if (getConnKey().getTransport() == TRANSP_TCP)
-    {
-      if (request->xdrEncodeUint32(0) < 0)
-      {
-        syslog(LOG_ERR, "RpcConnection::createRequest failed to encode TCP request\n");
-        request = NULL;
-        return NULL;
-      }
-    }
-
-    if (request->encodeHeader()  < 0)
+    if ( cred == NULL )
+      cred = AuthUnix::getDefault();
+
+    // the template patched with xid and proc, followed by the credential
+    unsigned char hdr[sizeof(m_callHeader) + AuthUnix::MAX_ENCODED_SIZE];
+    uint32 xid = htonl(hdrInfo.xid);
+    uint32 nproc = htonl(proc);
+    memcpy(hdr, m_callHeader, m_callHeaderSize);
+    memcpy(hdr + m_callXidOffset, &xid, sizeof(xid));
+    memcpy(hdr + m_callHeaderSize - sizeof(uint32), &nproc, sizeof(nproc));
+    memcpy(hdr + m_callHeaderSize, cred->getEncoded(), cred->getEncodedSize());
+
+    if (request->appendEncodedHeader(hdr, m_callHeaderSize + cred->getEncodedSize(), m_callXidOffset) < 0)
     {
       syslog(LOG_ERR, "RpcConnection::createRequest failed to encode request\n");
       request = NULL;
@@ -173,6 +314,12 @@ RpcPacketPtr RpcConnection::createRequest(int proc)
   return request;
 }
 
+void RpcConnection::hintRequestSize(int proc, uint32 size)
+{
+  if ( proc >= 0 && proc < SIZE_HINT_PROCS )
+    m_sizeHints[proc].store(size, std::memory_order_relaxed);
+}
+
 std::string RpcConnection::toString() const
 {
   std::ostringstream out;
@@ -202,7 +349,13 @@ int RpcConnection::writePacket(RpcPacketPtr pkt)
   if ( pkt.empty() )
     return -1;
 
-  uint32 packetSize = pkt->getSize();
+  setRecordMark(pkt);
+  return BasicConnection::writePacket(pkt);
+}
+
+void RpcConnection::setRecordMark(RpcPacketPtr pkt)
+{
+  uint32 packetSize = pkt->getWireSize();
 
   if ( getConnKey().getTransport() == TRANSP_TCP )
   {
@@ -214,8 +367,100 @@ int RpcConnection::writePacket(RpcPacketPtr pkt)
       abort();
     }
   }
+}
 
-  return BasicConnection::writePacket(pkt);
+// wait for the reply reading the socket ourselves, saves the handoffs to
+// and from the reactor. returns the time left of timeout for waiting on the
+// reactor, all of it if another thread reads the socket
+int RpcConnection::readOwnReply(Responder* responder, int timeout)
+{
+  if ( ConnectionMgr::isReactorThread() || !beginRead(true) )
+    return timeout;
+
+  // taken under the reader token, the socket may have been replaced before
+  int skt = getSocketId();
+  if ( skt == -1 )
+  {
+    endRead();
+    return timeout;
+  }
+
+  ConnectionMgr::setCompletionThread(true);
+  uint64 deadline = monotonicMs() + timeout;
+  int outcome = 0;
+  while ( !responder->isReady() )
+  {
+    uint64 now = monotonicMs();
+    if ( now >= deadline || getSocketId() != skt )
+      break;
+
+    struct pollfd pfd;
+    pfd.fd = skt;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int res = poll(&pfd, 1, deadline - now);
+    if ( res < 0 && errno == EINTR )
+      continue;
+    // errors are left to the reactor
+    if ( res <= 0 || (pfd.revents & (POLLERR|POLLHUP|POLLNVAL)) )
+      break;
+
+    do
+    {
+      outcome = recvPacket();
+    } while ( outcome == 0 );
+
+    if ( outcome < 0 )
+    {
+      // the reactor owns the socket and tears it down
+      syslog(LOG_WARNING, "RpcConnection::%s(%s) failed to receive\n", __func__, toString().c_str());
+      requestFail(skt, ECONNRESET);
+      break;
+    }
+  }
+
+  endRead();
+  drainSocket();
+  ConnectionMgr::setCompletionThread(false);
+
+  uint64 now = monotonicMs();
+  return (now < deadline) ? (int)(deadline - now) : 0;
+}
+
+// the reactor passed over the data that arrived while a caller was reading
+void RpcConnection::drainSocket()
+{
+  while ( true )
+  {
+    int skt = getSocketId();
+    int len = 0;
+    if ( skt == -1 || ioctl(skt, FIONREAD, &len) != 0 || len == 0 )
+      return;
+
+    // else the reactor is on it
+    if ( !beginRead(true) )
+      return;
+
+    // the socket may have been replaced before we got the token
+    if ( getSocketId() != skt )
+    {
+      endRead();
+      continue;
+    }
+
+    int outcome = 0;
+    do
+    {
+      outcome = recvPacket();
+    } while ( outcome == 0 );
+    endRead();
+
+    if ( outcome < 0 )
+    {
+      requestFail(skt, ECONNRESET);
+      return;
+    }
+  }
 }
 
 int RpcConnection::recvPacket()
@@ -256,226 +501,874 @@ int RpcConnection::recvPacket()
   return -1;
 }
 
+int RpcConnection::recvData(const unsigned char* data, uint32 len)
+{
+  m_recvData = data;
+  m_recvDataLeft = len;
+
+  int outcome = 0;
+  do
+  {
+    outcome = recvPacket();
+  } while ( outcome == 0 );
+
+  m_recvData = NULL;
+  m_recvDataLeft = 0;
+  return (outcome < 0) ? -1 : 0;
+}
+
 int RpcConnection::recvUDPPacket(RpcPacketPtr& reply)
 {
+  // a datagram handed over by recvData()
+  if ( m_recvData != NULL )
+  {
+    if ( m_recvDataLeft == 0 )
+      return 1;
+
+    reply = new RpcPacket(m_recvDataLeft);
+    reply->append((unsigned char*)m_recvData, m_recvDataLeft);
+    m_recvDataLeft = 0;
+    return 0;
+  }
+
+  // datagrams of the last recvmmsg() go first
+  if ( !m_datagrams.empty() )
+  {
+    reply = m_datagrams.front();
+    m_datagrams.pop_front();
+    return 0;
+  }
+
   int skt = getSocketId();
   if ( skt == -1 )
     return -1;
 
-  if ( getConnKey().getTransport() == TRANSP_UDP )
-  {
-    int len = 0;
-    if ( ioctl(skt, SIOCINQ, &len) != 0 )
-      return -1;
+  if ( m_datagramChunks.size() != gDatagramBatch )
+    m_datagramChunks.resize(gDatagramBatch);
 
-    if ( len == 0 )
+  struct iovec iov[gDatagramBatch];
+  struct mmsghdr msgs[gDatagramBatch];
+  for ( uint32 i = 0; i < gDatagramBatch; i++ )
+  {
+    BufferChunkPtr& chunk = m_datagramChunks[i];
+    if ( chunk.empty() || chunk.refCount() > 1 )
     {
-      char aByte;
-      if ( recv(skt, &aByte, sizeof(aByte), MSG_PEEK|MSG_TRUNC) == 0 )
+      chunk = new BufferChunk(gMaxDatagramSize);
+      if ( chunk->capacity() < gMaxDatagramSize )
       {
-        recv(skt, &aByte, sizeof(aByte), MSG_TRUNC);
+        syslog(LOG_ERR, "RpcConnection::%s(%s) failed to allocate %u bytes\n",
+               __func__, toString().c_str(), gMaxDatagramSize);
+        chunk = NULL;
+        return -1;
       }
-
-      return 1;
     }
+    iov[i].iov_base = chunk->begin();
+    iov[i].iov_len = gMaxDatagramSize;
+    memset(&msgs[i], 0, sizeof(msgs[i]));
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
 
-    RpcPacketPtr response = new RpcPacket(len);
-    if ( !response.empty() )
+  while ( true )
+  {
+    int count = recvmmsg(skt, msgs, gDatagramBatch, MSG_DONTWAIT, NULL);
+    if ( count < 0 )
     {
-      int nread = recv(skt, response->getBuffer(), len, MSG_TRUNC|MSG_NOSIGNAL);
-      if ( nread > 0 )
-        response->append(NULL, nread);
+      if ( errno == EINTR )
+        continue;
+      return (errno == EAGAIN) ? 1 : -1;
+    }
 
-      if ( nread == len )
+    for ( int i = 0; i < count; i++ )
+    {
+      // empty or cut short, no reply to find in it
+      if ( msgs[i].msg_len == 0 || (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) )
+        continue;
+
+      // a small reply must not pin a whole buffer, a large one is not copied
+      unsigned char* data = m_datagramChunks[i]->begin();
+      uint32 len = msgs[i].msg_len;
+      RpcPacketPtr packet;
+      if ( len <= gDatagramCopyMax )
       {
-        reply = response;
-        return 0;
+        packet = new RpcPacket(len);
+        packet->append(data, len);
       }
+      else
+      {
+        packet = new RpcPacket(m_datagramChunks[i], data, len);
+      }
+      m_datagrams.push_back(packet);
     }
+
+    if ( !m_datagrams.empty() || count < (int)gDatagramBatch )
+      break;
+
+    // all of them were dropped, the buffers can be used again
+    for ( uint32 i = 0; i < gDatagramBatch; i++ )
+      msgs[i].msg_hdr.msg_flags = 0;
   }
-  return -1;
+
+  if ( m_datagrams.empty() )
+    return 1;
+
+  reply = m_datagrams.front();
+  m_datagrams.pop_front();
+  return 0;
 }
 
 int RpcConnection::recvTCPPacket(RpcPacketPtr& reply)
 {
-  do
+  // data buffered from a previous socket is of no use
+  if ( m_recvSocket != getSocketId() )
   {
-    if ( m_fragment.isIncompleteHeader())
+    resetRecvBuffer();
+    m_recvSocket = getSocketId();
+  }
+
+  while ( true )
+  {
+    uint32 needed = 0;
+    int outcome = parseTCPRecord(reply, needed);
+    if ( outcome != 1 )
+      return outcome;
+
+    // the socket had no more data last time, let epoll tell us when it has
+    if ( m_recvDrained )
     {
-      if (!m_readState.isInitialized())
-        m_readState.initialize(&m_fragment.header, sizeof(uint32));
-      int outcome = recvNbyte();
-      if (outcome < 0)
-      {
-        m_fragment.clear();
-      }
-      if (outcome != 0)
-        return outcome;
-      syslog(LOG_DEBUG, "RpcConnection::recvTCPPacket header is done\n");
-      m_fragment.length = ntohl(m_fragment.header) & ~0x80000000;
-      m_fragment.isHeaderDone = true;
-      m_readState.reset();
-      if ( m_fragment.m_packet == NULL )
+      m_recvDrained = false;
+      return 1;
+    }
+
+    outcome = fillRecvBuffer(needed);
+    if ( outcome != 0 )
+      return outcome;
+  }
+}
+
+// carve complete records out of the receive buffer
+// returns 0 with a reply, 1 if more data is needed (needed holds the bytes
+// the next record takes from m_recvStart on)
+int RpcConnection::parseTCPRecord(RpcPacketPtr& reply, uint32& needed)
+{
+  while ( true )
+  {
+    uint32 avail = m_recvEnd - m_recvStart;
+
+    if ( m_directSink != NULL )
+    {
+      // the payload is still on its way into the sink
+      needed = 0;
+      if ( m_directPayloadLeft > 0 )
+        return 1;
+
+      if ( avail < m_directSuffixLeft )
       {
-        m_fragment.m_packet = new RpcPacket(m_fragment.length);
-        syslog(LOG_DEBUG, "recvTCPPacket intialize packet length %d\n", m_fragment.length);
+        needed = m_directSuffixLeft;
+        return 1;
       }
-      else
+
+      m_directReply->append(m_recvChunk->begin() + m_recvStart, m_directSuffixLeft);
+      m_recvStart += m_directSuffixLeft;
+      m_directSink->setPlaced(true);
+      reply = m_directReply;
+      syslog(LOG_DEBUG, "got complete reply %d, payload received into the caller buffer\n", reply->getSize());
+      endDirectRecv(true);
+      return 0;
+    }
+
+    if ( avail < sizeof(uint32) )
+    {
+      needed = sizeof(uint32);
+      return 1;
+    }
+
+    unsigned char* rec = m_recvChunk->begin() + m_recvStart;
+    uint32 mark = 0;
+    memcpy(&mark, rec, sizeof(mark));
+    mark = ntohl(mark);
+    bool isLast = (mark & 0x80000000) != 0;
+    uint32 length = mark & ~0x80000000;
+
+    if ( avail - sizeof(uint32) < length )
+    {
+      // a large reply may have a caller buffer to go to
+      if ( isLast && m_partialReply.empty() && !m_recordChecked )
       {
-        syslog(LOG_DEBUG, "recvTCPPacket enlarge packet length %d\n", m_fragment.length);
-        m_fragment.m_packet->reserve( m_fragment.length);
+        int outcome = beginDirectRecv(rec + sizeof(uint32), avail - sizeof(uint32), length);
+        if ( outcome == 0 )
+          continue;
+
+        if ( outcome == 1 )
+        {
+          // just enough to see the head of the reply
+          needed = avail + 1;
+          return 1;
+        }
+        m_recordChecked = true;
       }
+
+      needed = sizeof(uint32) + length;
+      return 1;
+    }
+    m_recvStart += sizeof(uint32) + length;
+    m_recordChecked = false;
+
+    if ( isLast && m_partialReply.empty() )
+    {
+      reply = new RpcPacket(m_recvChunk, rec + sizeof(uint32), length);
+      syslog(LOG_DEBUG, "got complete reply %d\n", length);
+      return 0;
     }
 
-    if ( m_fragment.isIncompleteFragment() )
+    // replies of several fragments are assembled in a packet of their own
+    if ( m_partialReply.empty() )
+      m_partialReply = new RpcPacket(length);
+    if ( m_partialReply->append(rec + sizeof(uint32), length) < 0 )
     {
-      if (!m_readState.isInitialized())
-        m_readState.initialize(m_fragment.m_packet->getBufferEnd(), m_fragment.length);
-      int outcome = recvNbyte();
-      if (outcome < 0)
+      syslog(LOG_ERR, "RpcConnection::%s(%s) failed to assemble reply\n", __func__, toString().c_str());
+      m_partialReply = NULL;
+      return -1;
+    }
+
+    if ( isLast )
+    {
+      reply = m_partialReply;
+      m_partialReply = NULL;
+      syslog(LOG_DEBUG, "got complete reply %d\n", reply->getSize());
+      return 0;
+    }
+  }
+}
+
+// receive as much as fits into the buffer with a single recv()
+int RpcConnection::fillRecvBuffer(uint32 needed)
+{
+  int skt = getSocketId();
+  if ( skt == -1 )
+  {
+    syslog(LOG_ERR, "RpcConnection::%s Invalid socket id for %s\n", __func__, toString().c_str());
+    return -1;
+  }
+
+  uint32 pending = m_recvEnd - m_recvStart;
+  if ( m_recvChunk.empty() || m_recvChunk->capacity() - m_recvStart < needed ||
+       m_recvChunk->capacity() == m_recvEnd )
+  {
+    if ( !m_recvChunk.empty() && m_recvChunk.refCount() == 1 && m_recvChunk->capacity() >= needed )
+    {
+      // no reply references the chunk, reuse it
+      memmove(m_recvChunk->begin(), m_recvChunk->begin() + m_recvStart, pending);
+    }
+    else
+    {
+      uint32 size = (needed > gRecvChunkSize) ? needed : gRecvChunkSize;
+      BufferChunkPtr chunk = new BufferChunk(size);
+      if ( chunk->capacity() < size )
       {
-        m_fragment.clear();
-        m_readState.reset();
+        syslog(LOG_ERR, "RpcConnection::%s(%s) failed to allocate %u bytes\n", __func__, toString().c_str(), size);
+        return -1;
       }
-      if (outcome != 0)
-        return outcome;
+      if ( pending > 0 )
+        memcpy(chunk->begin(), m_recvChunk->begin() + m_recvStart, pending);
+      m_recvChunk = chunk;
+    }
+    m_recvStart = 0;
+    m_recvEnd = pending;
+  }
+
+  uint32 space = m_recvChunk->capacity() - m_recvEnd;
+
+  // the payload goes to the sink, whatever follows it to the buffer
+  struct iovec iov[64];
+  int iovcnt = 0;
+  uint32 direct = 0;
+  if ( m_directSink != NULL && m_directPayloadLeft > 0 )
+  {
+    iovcnt = m_directSink->getIov(iov, 63, m_directPayloadLeft);
+    for ( int i = 0; i < iovcnt; i++ )
+      direct += iov[i].iov_len;
+  }
+  iov[iovcnt].iov_base = m_recvChunk->begin() + m_recvEnd;
+  iov[iovcnt].iov_len = space;
+  iovcnt++;
+
+  // data handed over by recvData() is spread as readv() would do
+  if ( m_recvData != NULL )
+  {
+    if ( m_recvDataLeft == 0 )
+      return 1;
 
-      m_fragment.m_packet->append(NULL, m_fragment.length);
-      m_readState.reset();
+    uint32 nread = 0;
+    for ( int i = 0; i < iovcnt && m_recvDataLeft > 0; i++ )
+    {
+      uint32 len = (iov[i].iov_len < m_recvDataLeft) ? iov[i].iov_len : m_recvDataLeft;
+      memcpy(iov[i].iov_base, m_recvData, len);
+      m_recvData += len;
+      m_recvDataLeft -= len;
+      nread += len;
     }
 
-    m_fragment.isHeaderDone = 0; //complete fragment
-    m_fragment.isDataDone = 0;
-  } while( !m_fragment.isLastFragment() );
+    uint32 toSink = (nread < direct) ? nread : direct;
+    if ( toSink > 0 )
+    {
+      m_directSink->advance(toSink);
+      m_directPayloadLeft -= toSink;
+    }
+    m_recvEnd += nread - toSink;
+    m_recvDrained = (m_recvDataLeft == 0);
+    return 0;
+  }
+
+  do
+  {
+    int nread = readv(skt, iov, iovcnt);
+    if ( nread < 0 )
+    {
+      if ( errno == EAGAIN )
+        return 1;
+      if ( errno == EINTR )
+        continue;
+
+      char errstr[128];
+      syslog(LOG_ERR, "RpcConnection::%s(%s) got error=%d (%s)\n",
+             __func__, toString().c_str(), errno, strerror_r(errno, errstr, sizeof(errstr)));
+      return -1;
+    }
+    else if ( nread == 0 )
+    {
+      syslog(LOG_DEBUG, "RpcConnection::%s connection %s is closed\n", __func__, toString().c_str());
+      errno = ECONNRESET;
+      return -1;
+    }
+
+    uint32 toSink = ((uint32)nread < direct) ? nread : direct;
+    if ( toSink > 0 )
+    {
+      m_directSink->advance(toSink);
+      m_directPayloadLeft -= toSink;
+    }
+
+    m_recvEnd += nread - toSink;
+    m_recvDrained = ((uint32)nread < direct + space);
+    return 0;
+  } while ( true );
+}
+
+void RpcConnection::resetRecvBuffer()
+{
+  if ( m_directSink != NULL )
+    endDirectRecv(false);
+
+  m_recvStart = 0;
+  m_recvEnd = 0;
+  m_recvDrained = false;
+  m_recordChecked = false;
+  m_partialReply = NULL;
+
+  // replies may still reference the old chunk
+  if ( !m_recvChunk.empty() && m_recvChunk.refCount() > 1 )
+    m_recvChunk = NULL;
+}
 
-  reply = m_fragment.m_packet;
-  syslog(LOG_DEBUG, "got complete reply %d\n", m_fragment.length);
-  m_fragment.clear();
+// start receiving the reply at the head of the buffer into the sink of its request
+// returns 0 if started, 1 if more of the reply is needed to tell, -1 if not applicable
+int RpcConnection::beginDirectRecv(const unsigned char* rec, uint32 avail, uint32 length)
+{
+  if ( avail < sizeof(uint32) )
+    return 1;
+
+  Xid xid;
+  memcpy(&xid, rec, sizeof(xid));
+  xid = ntohl(xid);
+
+  ReplySink* sink = NULL;
+  uint32 offset = 0;
+  uint32 payload = 0;
+  int outcome = -1;
+
+  // the sink belongs to the caller, it must not go away while in use
+  m_xidTable.visit(xid, [&](Responder* resp) -> XidTable::Action
+  {
+    if ( resp == NULL || resp->getSink() == NULL )
+      return XidTable::KEEP;
+
+    outcome = resp->getSink()->locatePayload(rec, avail, offset, payload);
+    if ( outcome != 0 )
+      return XidTable::KEEP;
+
+    if ( offset + payload > length || resp->getSink()->filled() + payload > resp->getSink()->capacity() )
+    {
+      outcome = -1;
+      return XidTable::KEEP;
+    }
+
+    sink = resp->getSink();
+    resp->setReceiving(true);
+    return XidTable::KEEP;
+  });
+
+  if ( sink == NULL )
+    return (outcome == 1) ? 1 : -1;
+
+  m_directSink = sink;
+  m_directXid = xid;
+  m_directFilled = sink->filled();
+  m_directReply = new RpcPacket(length - payload);
+  m_directReply->append((unsigned char*)rec, offset);
+
+  // part of the payload may be in the buffer already
+  uint32 inBuffer = (avail - offset < payload) ? avail - offset : payload;
+  sink->copyIn(rec + offset, inBuffer);
+  m_recvStart += sizeof(uint32) + offset + inBuffer;
+
+  m_directPayloadLeft = payload - inBuffer;
+  m_directSuffixLeft = length - offset - payload;
+
+  syslog(LOG_DEBUG, "RpcConnection::%s(%s) receive %u bytes of reply xid=%u into the caller buffer\n",
+         __func__, toString().c_str(), payload, xid);
   return 0;
 }
 
-int RpcConnection::sendAndWait(RpcPacketPtr request, RpcPacketPtr& reply, int timeout_ms)
+void RpcConnection::endDirectRecv(bool completed)
 {
-  SemaphoreGuard sem(m_concurrency);
-  return doSendAndWait(request, reply, timeout_ms);
-/*
-  int retVal = ensureConnection();
-  if ( retVal == 0 )
+  uint32 filled = m_directFilled;
+  m_xidTable.visit(m_directXid, [completed, filled](Responder* resp) -> XidTable::Action
   {
-    SemaphoreGuard sem(m_concurrency);
-    retVal = doSendAndWait(request, reply, timeout_ms);
-  }
-  return retVal;
-*/
+    if ( resp == NULL )
+      return XidTable::KEEP;
+    // the reply is received again, or decoded from a copy, from the start
+    if ( !completed && resp->getSink() != NULL )
+      resp->getSink()->rewind(filled);
+    resp->setReceiving(false);
+    return XidTable::KEEP;
+  });
+
+  m_directSink = NULL;
+  m_directXid = 0;
+  m_directReply = NULL;
+  m_directPayloadLeft = 0;
+  m_directSuffixLeft = 0;
+  m_directFilled = 0;
+  m_recordChecked = false;
 }
 
-int RpcConnection::doSendAndWait(RpcPacketPtr request, RpcPacketPtr& reply, int timeout_ms)
+bool RpcConnection::isReceivingReply(RpcPacketPtr request)
+{
+  bool receiving = false;
+  m_xidTable.visit(request->getXid(), [&receiving](Responder* resp) -> XidTable::Action
+  {
+    receiving = (resp != NULL && resp->isReceiving());
+    return XidTable::KEEP;
+  });
+  return receiving;
+}
+
+int RpcConnection::sendAndWait(RpcPacketPtr request, RpcPacketPtr& reply, int timeout_ms)
+{
+  // requests queued for a window slot count towards the load too
+  uint32 bytes = request.empty() ? 0 : request->getWireSize();
+  addLoad(bytes);
+
+  m_window.acquire();
+  uint64 start = monotonicUs();
+  bool retried = false;
+  int outcome = doSendAndWait(request, reply, timeout_ms, retried);
+
+  // a retransmitted request gives no round trip sample
+  bool congested = ((reply.empty() && outcome != REQUEST_CANCELLED) || retried);
+  uint64 rtt = (congested || reply.empty()) ? 0 : monotonicUs() - start;
+  int timerClass = request.empty() ? RpcRtt::TIMER_OTHER : getTimerClass(request);
+  m_window.release(rtt, congested, timerClass);
+  if ( rtt > 0 )
+    m_rtt.update(timerClass, rtt);
+
+  removeLoad(bytes);
+  return outcome;
+}
+
+int RpcConnection::doSendAndWait(RpcPacketPtr request, RpcPacketPtr& reply, int timeout_ms, bool& retried)
 {
   if ( request.empty() )
     return -1;
 
-  if( findPendingRequest(request) != NULL )
-  {
-    syslog(LOG_ERR, "RpcConnection::sendAndWait(%s) request %d already exists\n", toString().c_str(), request->getXid());
+  // retransmissions and the deadline are up to the timer of the request
+  Responder* responder = startRequest(request, ReplyCallback(), timeout_ms);
+  if ( responder == NULL )
     return -1;
+
+  syslog(LOG_DEBUG, "RpcConnection::sendAndWait send request xid=%d\n", request->getXid());
+
+  int outcome = 0;
+
+  // the caller sends and reads by itself unless another thread is busy with the socket
+  bool direct = gLowLatency && ConnectionMgr::getBackend() == BACKEND_EPOLL;
+  bool sent = false;
+  if ( direct )
+  {
+    setRecordMark(request);
+    sent = (sendDirect(request) == 0);
   }
 
-  Responder* responder = new Responder;
-  addPendingRequest(request, responder);
+  if ( !sent && writePacket(request) < 0 )
+  {
+    syslog(LOG_ERR, "RpcConnection::sendAndWait(%s) failed to send request xid = %d\n",
+           toString().c_str(),  request->getXid());
+    outcome = -1;
+  }
+  else
+  {
+    uint64 deadline = responder->getDeadline();
+    uint64 now = monotonicMs();
+    if ( direct && now < deadline )
+      readOwnReply(responder, (int)(deadline - now));
 
-  syslog(LOG_DEBUG, "RpcConnection::sendAndWait send request xid=%d\n", request->getXid());
+    // the timer wakes us at the deadline, the slack covers a stalled reactor
+    while ( !responder->isReady() )
+    {
+      now = monotonicMs();
+      if ( now >= deadline + gDeadlineSlackMs )
+        break;
+      responder->waitForResponse((int)(deadline + gDeadlineSlackMs - now));
+    }
+    reply =  responder->getReply();
 
-  int retries = 0;
-  int timeout = timeout_ms;
+    if ( reply.empty() && responder->isCancelled() )
+    {
+      syslog(LOG_DEBUG, "RpcConnection::sendAndWait(%s) request xid=%d cancelled\n",
+             toString().c_str(), request->getXid());
+      outcome = REQUEST_CANCELLED;
+    }
+    else if ( reply.empty() )
+    {
+      syslog(LOG_ERR, "RpcConnection::SendAndWait(%s): failed to get reply for request xid=%d\n",
+             toString().c_str(),  request->getXid());
+    }
+    else
+    {
+      syslog(LOG_DEBUG, "RpcConnection::sendAndWait(%s) got reply xid=%d\n",
+             toString().c_str(), request->getXid());
+    }
+  }
+
+  // the payload may still be on its way into the caller's buffer
+  while ( reply.empty() && isReceivingReply(request) )
+  {
+    responder->waitForResponse(gDeadlineSlackMs);
+    reply = responder->getReply();
+  }
+
+  // a queued copy of the request must not be sent from the caller's memory
+  // once we return. a send that does not finish is cancelled by failing
+  // the connection
+  if ( request->hasReferences() && !releasePendingWrite(request, gDeadlineSlackMs) )
+  {
+    syslog(LOG_WARNING, "RpcConnection::sendAndWait(%s): send of xid=%d is stuck, failing the connection\n",
+           toString().c_str(), request->getXid());
+    requestFail(getSocketId(), ETIMEDOUT);
+    while ( !releasePendingWrite(request, gDeadlineSlackMs) )
+      ;
+  }
+
+  removePendingRequest(request);
+  retried = responder->wasRetried();
+  releaseResponder(responder);
+
+  return outcome;
+}
 
-  // for udp, retry twice if time out
+void RpcConnection::getTimeouts(int timeout_ms, int& timeout, int& tries, uint64& deadline) const
+{
+  // for udp, retry if time out
   if (getConnKey().getTransport() == TRANSP_UDP)
   {
-    retries = udpRetries;
-    if (timeout <= 0)
+    tries = udpRetries;
+    timeout = NFS_UDP_TIMEOUT;
+  }
+  else
+  {
+    tries = 1;
+    timeout = NFS_TCP_TIMEOUT;
+  }
+
+  uint64 total = (uint64)timeout * tries;
+  if ( timeout_ms > 0 )
+  {
+    total = timeout_ms;
+    if ( timeout > timeout_ms )
+      timeout = timeout_ms;
+  }
+  deadline = monotonicMs() + total;
+}
+
+int RpcConnection::getTimerClass(RpcPacketPtr request) const
+{
+  return RpcRtt::getTimerClass(m_progNumber, m_version, request->getProc());
+}
+
+int RpcConnection::getFirstTimeout(int timerClass, int timeout)
+{
+  int rto = (int)m_rtt.getTimeout(timerClass);
+  return (rto < timeout) ? rto : timeout;
+}
+
+int RpcConnection::getNextTimeout(int last, int timeout) const
+{
+  int next = (int)m_rtt.backoff(last);
+  return (next < timeout) ? next : timeout;
+}
+
+Responder* RpcConnection::startRequest(RpcPacketPtr request, const ReplyCallback& callback, int timeout_ms)
+{
+  int tries = 0;
+  int timeout = 0;
+  uint64 deadline = 0;
+  getTimeouts(timeout_ms, timeout, tries, deadline);
+
+  Responder* responder = m_responderPool->get(callback, request, timeout, tries - 1);
+  // a datagram is resent after the estimated timeout, backing off up to timeout
+  if ( getConnKey().getTransport() == TRANSP_UDP )
+    responder->setTimeout(getFirstTimeout(getTimerClass(request), timeout));
+  responder->setDeadline(deadline);
+  responder->markSent(monotonicMs());
+  responder->markStart(monotonicUs());
+  if ( !addPendingRequest(request, responder) )
+  {
+    syslog(LOG_ERR, "RpcConnection::%s(%s) no free slot for request %d\n", __func__, toString().c_str(), request->getXid());
+    m_responderPool->put(responder);
+    return NULL;
+  }
+
+  // armed before the send, the reply may complete the request right away
+  armTimer(responder, responder->getNextEvent());
+  return responder;
+}
+
+void RpcConnection::armTimer(Responder* responder, uint64 expires_ms)
+{
+  TimerWheel::Timer* timer = responder->getTimer();
+  MutexGuard lock(m_timerLock);
+  timer->data = responder->getRequest()->getXid();
+  m_timers.schedule(timer, expires_ms);
+}
+
+void RpcConnection::releaseResponder(Responder* responder)
+{
+  {
+    MutexGuard lock(m_timerLock);
+    m_timers.cancel(responder->getTimer());
+  }
+  m_responderPool->put(responder);
+}
+
+int RpcConnection::sendAsync(RpcPacketPtr request, const ReplyCallback& callback, int timeout_ms)
+{
+  if ( request.empty() || !callback )
+    return -1;
+
+  uint32 bytes = request->getWireSize();
+  addLoad(bytes);
+
+  // A reactor thread must never block on the window, a completion
+  // issuing a new request there can only take a free slot
+  if ( ConnectionMgr::isReactorThread() )
+  {
+    if ( !m_window.tryAcquire() )
     {
-      timeout =  NFS_UDP_TIMEOUT;
+      syslog(LOG_ERR, "RpcConnection::%s(%s) too many pending requests\n", __func__, toString().c_str());
+      removeLoad(bytes);
+      return -1;
     }
   }
   else
   {
-    if (timeout <= 0)
+    m_window.acquire();
+  }
+
+  Responder* responder = startRequest(request, callback, timeout_ms);
+  if ( responder == NULL )
+  {
+    m_window.release(0, false, RpcRtt::TIMER_OTHER);
+    removeLoad(bytes);
+    return -1;
+  }
+
+  syslog(LOG_DEBUG, "RpcConnection::%s send request xid=%d\n", __func__, request->getXid());
+
+  if ( writePacket(request) < 0 )
+  {
+    syslog(LOG_ERR, "RpcConnection::%s(%s) failed to send request xid = %d\n",
+           __func__, toString().c_str(), request->getXid());
+
+    // the request may have been completed by a concurrent cleanup
+    if ( takePendingRequest(request) == responder )
     {
-      timeout = NFS_TCP_TIMEOUT;
+      releaseResponder(responder);
+      m_window.release(0, false, RpcRtt::TIMER_OTHER);
+      removeLoad(bytes);
+      return -1;
     }
   }
 
-  int outcome = 0;
+  return 0;
+}
 
-  do
+int RpcConnection::cancelRequest(RpcPacketPtr request)
+{
+  if ( request.empty() )
+    return -1;
+
+  Responder* taken = NULL;
+  bool cancelled = false;
+  m_xidTable.visit(request->getXid(), [&](Responder* resp) -> XidTable::Action
   {
-    if ( writePacket(request) < 0 )
+    // too late once the reply is there or on its way to an asynchronous sink
+    if ( resp == NULL || resp->isReady() || (resp->isAsync() && resp->isReceiving()) )
+      return XidTable::KEEP;
+
+    cancelled = true;
+    resp->markCancelled();
+    if ( resp->isAsync() )
     {
-      syslog(LOG_ERR, "RpcConnection::sendAndWait(%s) failed to send request xid = %d\n",
-             toString().c_str(),  request->getXid());
+      taken = resp;
+      return XidTable::TAKE;
     }
-    else
+
+    resp->signalReady(NULL);
+    return XidTable::KEEP;
+  });
+
+  if ( taken )
+    completeAsync(taken, REQUEST_CANCELLED, NULL);
+
+  return cancelled ? 0 : -1;
+}
+
+void RpcConnection::expireRequests()
+{
+  std::vector<uint32> xids;
+  {
+    // the timers belong to the responders, only their xids are safe to keep
+    std::vector<TimerWheel::Timer*> due;
+    MutexGuard lock(m_timerLock);
+    m_timers.advance(monotonicMs(), due);
+    for ( size_t i = 0; i < due.size(); i++ )
+      xids.push_back(due[i]->data);
+  }
+
+  std::vector<Responder*> expired;
+  std::vector<RpcPacketPtr> resend;
+  bool udp = (getConnKey().getTransport() == TRANSP_UDP);
+
+  for ( size_t i = 0; i < xids.size(); i++ )
+  {
+    m_xidTable.visit(xids[i], [&](Responder* resp) -> XidTable::Action
     {
-      responder->waitForResponse(timeout);
-      reply =  responder->getReply();
+      if ( resp == NULL || resp->isReady() )
+        return XidTable::KEEP;
 
-      int outcome = 0;
-      if ( reply.empty() )
+      uint64 now = monotonicMs();
+      // the reply is being received, look again later
+      if ( resp->isReceiving() )
       {
-        syslog(LOG_ERR, "RpcConnection::SendAndWait(%s): failed to get reply for request xid=%d retry=%d\n",
-               toString().c_str(),  request->getXid(), retries);
-        outcome = -1;
+        armTimer(resp, now);
+        return XidTable::KEEP;
       }
-      else
+
+      bool dead = (now >= resp->getDeadline());
+      if ( !dead && !resp->isExpired(now) )
       {
-        syslog(LOG_DEBUG, "RpcConnection::sendAndWait(%s) got reply xid=%d\n",
-               toString().c_str(), request->getXid());
-        break;
+        armTimer(resp, resp->getNextEvent());
+        return XidTable::KEEP;
       }
-    }
-    --retries;
-  } while( retries > 0 );
 
-  removePendingRequest(request);
-  delete responder;
+      if ( udp )
+        m_rtt.timedOut(getTimerClass(resp->getRequest()));
 
-  return outcome;
-}
+      if ( !dead && resp->canRetry() )
+      {
+        resp->retry(now, getNextTimeout(resp->getTimeout(), resp->getMaxTimeout()));
+        armTimer(resp, resp->getNextEvent());
+        resend.push_back(resp->getRequest());
+        return XidTable::KEEP;
+      }
 
-Responder* RpcConnection::findPendingRequest(RpcPacketPtr request)
-{
-  Xid xid = request->getXid();
-  Responder* found = NULL;
-  MutexGuard lock(m_xidTableLock);
-  std::map<Xid,Responder*>::iterator iter = m_xidTable.find(xid);
-  if (iter != m_xidTable.end() )
+      syslog(LOG_ERR, "RpcConnection::%s(%s) request xid=%d timed out\n",
+             __func__, toString().c_str(), xids[i]);
+
+      // a synchronous waiter removes the request itself
+      if ( !resp->isAsync() )
+      {
+        resp->signalReady(NULL);
+        return XidTable::KEEP;
+      }
+
+      expired.push_back(resp);
+      return XidTable::TAKE;
+    });
+  }
+
+  for ( size_t i = 0; i < resend.size(); i++ )
   {
-    found = iter->second;
+    // a retransmission goes out with the same xid, unless the last copy
+    // has not left the queue yet
+    if ( isWritePending(resend[i]) )
+      continue;
+
+    syslog(LOG_DEBUG, "RpcConnection::%s(%s) resend request xid=%d\n", __func__, toString().c_str(), resend[i]->getXid());
+    writePacket(resend[i]);
   }
-  return found;
+
+  for ( size_t i = 0; i < expired.size(); i++ )
+    completeAsync(expired[i], 0, NULL);
+}
+
+bool RpcConnection::getWindowStats(RpcWindowStats& stats)
+{
+  m_window.getStats(stats);
+  return true;
+}
+
+void RpcConnection::completeAsync(Responder* responder, int outcome, RpcPacketPtr reply)
+{
+  // free the window slot first, the completion may issue the next request
+  bool congested = ((reply.empty() && outcome != REQUEST_CANCELLED) || responder->wasRetried());
+  uint64 rtt = (congested || reply.empty()) ? 0 : monotonicUs() - responder->getStartTime();
+  int timerClass = getTimerClass(responder->getRequest());
+  m_window.release(rtt, congested, timerClass);
+  if ( rtt > 0 )
+    m_rtt.update(timerClass, rtt);
+  removeLoad(responder->getRequest()->getWireSize());
+  responder->complete(outcome, reply);
+  releaseResponder(responder);
 }
 
 bool RpcConnection::matchPendingRequest(RpcPacketPtr reply)
 {
-  bool found = false;
-  Xid xid = reply->getXid();
-  Responder* resp = NULL;
+  Responder* taken = NULL;
 
+  // a synchronous waiter is woken while its slot is held, it cannot go away
+  bool found = m_xidTable.visit(reply->getXid(), [&](Responder* resp) -> XidTable::Action
   {
-    MutexGuard lock(m_xidTableLock);
-    std::map<Xid,Responder*>::iterator iter = m_xidTable.find(xid);
-    if (iter != m_xidTable.end() )
+    if ( resp == NULL )
+      return XidTable::KEEP;
+
+    // nobody waits for an asynchronous request, it is done with here
+    if ( resp->isAsync() )
     {
-      if (iter->second)
-      {
-        resp = iter->second;
-        found = true;
-      }
+      taken = resp;
+      return XidTable::TAKE;
     }
-  }
-  if (found && resp)
+
     resp->signalReady(reply);
+    return XidTable::KEEP;
+  });
 
+  if ( taken )
+    completeAsync(taken, 0, reply);
+
+  if ( found )
+    m_reconnects.store(0, std::memory_order_relaxed);
   return found;
 }
 
@@ -485,12 +1378,16 @@ bool RpcConnection::addPendingRequest(RpcPacketPtr request, Responder* responder
   if ( request.empty() )
     return false;
 
-  Xid xid = request->getXid();
+  // the slot of the xid got taken since the xid was handed out, move on
+  for ( uint32 i = 0; i < m_xidTable.size(); i++ )
   {
-    MutexGuard lock(m_xidTableLock);
-    m_xidTable[xid] = responder;
+    if ( m_xidTable.insert(request->getXid(), responder) )
+      return true;
+
+    if ( request->updateXid(getNextXid()) < 0 )
+      return false;
   }
-  return true;
+  return false;
 }
 
 bool RpcConnection::removePendingRequest(RpcPacketPtr request)
@@ -498,49 +1395,111 @@ bool RpcConnection::removePendingRequest(RpcPacketPtr request)
   if ( request.empty() )
     return false;
 
-  Xid xid = request->getXid();
-  {
-    MutexGuard lock(m_xidTableLock);
-    std::map<Xid,Responder*>::iterator iter = m_xidTable.find(xid);
-    if ( iter != m_xidTable.end() )
-    {
-      m_xidTable.erase(iter);
-    }
-    else
-    {
-      syslog(LOG_DEBUG, "RpcConnection::removePendingRequest(%s) Request xid=%d not found\n", toString().c_str(), xid);
-    }
-  }
+  if ( m_xidTable.remove(request->getXid()) == NULL )
+    syslog(LOG_DEBUG, "RpcConnection::removePendingRequest(%s) Request xid=%d not found\n", toString().c_str(), request->getXid());
 
   return true;
 }
 
+Responder* RpcConnection::takePendingRequest(RpcPacketPtr request)
+{
+  return m_xidTable.remove(request->getXid());
+}
+
 int RpcConnection::cleanup()
 {
   syslog(LOG_DEBUG, "RpcConnection::cleanup cleanup pending requests\n");
   std::vector<Responder*> respVec;
 
+  // synchronous waiters remove their requests themselves
+  m_xidTable.sweep([&respVec](Responder* resp) -> XidTable::Action
   {
-    MutexGuard lock(m_xidTableLock);
-    std::map<Xid,Responder*>::iterator iter = m_xidTable.begin();
-    while (iter != m_xidTable.end())
+    if ( resp == NULL )
+      return XidTable::KEEP;
+
+    if ( resp->isAsync() )
     {
-      if (iter->second)
-        respVec.push_back(iter->second);
-      ++iter;
+      respVec.push_back(resp);
+      return XidTable::TAKE;
     }
-    m_xidTable.clear();
+
+    resp->signalReady(NULL);
+    return XidTable::KEEP;
+  });
+
+  for ( size_t i = 0; i < respVec.size(); i++ )
+    completeAsync(respVec[i], -1, NULL);
+
+  resetRecvBuffer();
+  return 0;
+}
+
+bool RpcConnection::beginReconnect(uint32& delay_ms)
+{
+  // a datagram socket has nothing to reconnect, without pending requests
+  // the next call sets up the connection again
+  if ( getConnKey().getTransport() != TRANSP_TCP || gReconnectAttempts == 0 || m_xidTable.pending() == 0 )
+    return false;
+
+  uint32 attempt = m_reconnects.fetch_add(1, std::memory_order_relaxed);
+  if ( attempt >= gReconnectAttempts )
+  {
+    syslog(LOG_ERR, "RpcConnection::%s(%s) gave up after %u reconnects\n", __func__, toString().c_str(), attempt);
+    m_reconnects.store(0, std::memory_order_relaxed);
+    return false;
   }
-  std::vector<Responder*>::iterator vecIt;
-  for(vecIt = respVec.begin(); vecIt < respVec.end(); vecIt++)
+
+  delay_ms = 0;
+  if ( attempt > 0 )
   {
-    Responder* resp = *vecIt;
-    if(resp)
-      resp->signalReady(NULL);
+    uint32 shift = (attempt - 1 < 6) ? attempt - 1 : 6;
+    delay_ms = gReconnectDelayMs << shift;
+    if ( delay_ms > gMaxReconnectDelayMs )
+      delay_ms = gMaxReconnectDelayMs;
   }
 
-  m_fragment.clear();
-  return 0;
+  // writers queue for the new socket from now on
+  setReconnecting(true);
+  closeSocket();
+  resetRecvBuffer();
+  // the failure is taken care of, the group must not replace the connection
+  setErrno(0);
+
+  syslog(LOG_WARNING, "RpcConnection::%s(%s) reconnecting in %u ms, %u requests pending\n",
+         __func__, toString().c_str(), delay_ms, m_xidTable.pending());
+  return true;
+}
+
+void RpcConnection::replayRequests()
+{
+  // requests made from now on are sent as usual, those made meanwhile are
+  // queued already. either way a packet is queued only once
+  setReconnecting(false);
+
+  std::vector<RpcPacketPtr> replay;
+  uint64 now = monotonicMs();
+  m_xidTable.sweep([&](Responder* resp) -> XidTable::Action
+  {
+    // the timer expires a request past its deadline
+    if ( resp == NULL || resp->isReady() || now >= resp->getDeadline() )
+      return XidTable::KEEP;
+
+    resp->replay(now);
+    // nothing of a reply to the old socket may stay in the sink
+    if ( resp->getSink() != NULL )
+      resp->getSink()->rewind(resp->getSinkStart());
+    replay.push_back(resp->getRequest());
+    return XidTable::KEEP;
+  });
+
+  syslog(LOG_WARNING, "RpcConnection::%s(%s) replaying %zu requests\n", __func__, toString().c_str(), replay.size());
+
+  // same xids, the duplicate request cache of the server recognizes the
+  // ones it has seen already
+  for ( size_t i = 0; i < replay.size(); i++ )
+    writePacket(replay[i]);
+
+  ConnectionMgr::getInstance(this)->writeConnection(this);
 }
 
 int RpcConnection::closeConnection()
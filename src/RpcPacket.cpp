@@ -17,6 +17,7 @@
 
 #include "RpcPacket.h"
 #include "RpcDefs.h"
+#include "RpcAuth.h"
 #include "NfsUtil.h"
 
 #include <base.h>
@@ -27,35 +28,29 @@
 
 namespace OpenNfsC {
 
-namespace
-{
-  RpcPacket* initDefaultUnixAuth()
-  {
-    RpcPacket* pkt = new RpcPacket(32);
-    pkt->xdrEncodeUint32(0); //stamp
-
-    unsigned char host[4] = "fma";
-    pkt->xdrEncodeString(host,3);
-    pkt->xdrEncodeUint32(0); //uid
-    pkt->xdrEncodeUint32(0); //gid
-    pkt->xdrEncodeUint32(0); // gid count
-    return pkt;
-  }
+// opaque data below this is copied into the packet even when it may be borrowed
+const uint32 gMinBorrowSize = 4096;
 
-  // a packet contains default unix auth bytes
-  RpcPacket* defaultUnixAuth = initDefaultUnixAuth();
+RpcPacket::RpcPacket(uint32 msgSize):Packet(msgSize), m_header(), m_xidOffset(0), m_sink(NULL), m_borrowData(false)
+{
+  syslog(LOG_DEBUG, "RpcPacket::RpcPacket calls %p\n", this);
 }
 
-RpcPacket::RpcPacket(uint32 msgSize):Packet(msgSize), m_header()
+RpcPacket::RpcPacket(RpcHeader& hdr):Packet(), m_header(hdr), m_xidOffset(0), m_sink(NULL), m_borrowData(false)
 {
-  syslog(LOG_DEBUG, "RpcPacket::RpcPacket calls %p\n", this);
+  syslog(LOG_DEBUG, "RpcPacket::RpcPacket hdr calls %p\n", this);
 }
 
-RpcPacket::RpcPacket(RpcHeader& hdr):Packet(), m_header(hdr)
+RpcPacket::RpcPacket(RpcHeader& hdr, uint32 size):Packet(size), m_header(hdr), m_xidOffset(0), m_sink(NULL), m_borrowData(false)
 {
   syslog(LOG_DEBUG, "RpcPacket::RpcPacket hdr calls %p\n", this);
 }
 
+RpcPacket::RpcPacket(const BufferChunkPtr& chunk, unsigned char* data, uint32 len):Packet(chunk, data, len), m_header(), m_xidOffset(0), m_sink(NULL), m_borrowData(false)
+{
+  syslog(LOG_DEBUG, "RpcPacket::RpcPacket chunk calls %p\n", this);
+}
+
 RpcPacket::~RpcPacket()
 {
   syslog(LOG_DEBUG, "RpcPacket::~RpcPacket this=%p xid=%d\n", this, m_header.xid);
@@ -105,6 +100,26 @@ int RpcPacket::xdrEncodeVarOpaque(void* buf, uint32 len)
 }
 
 
+// opaque data sent from the caller memory when borrowing is allowed
+int RpcPacket::xdrEncodeVarOpaqueRef(void* buf, uint32 len)
+{
+  // small data is cheaper to copy than to send as an iovec of its own
+  if (!m_borrowData || len < gMinBorrowSize)
+    return xdrEncodeVarOpaque(buf, len);
+
+  uint32 padding = 0;
+  int padSize = 0;
+  if (len%4 != 0)
+    padSize = 4 - len%4;
+
+  int nwrite = xdrEncodeUint32(len);
+  if (nwrite != -1)
+    nwrite = appendRef((unsigned char*)buf, len);
+  if (padSize > 0 && nwrite != -1)
+    nwrite = append((unsigned char*)&padding, padSize);
+  return nwrite;
+}
+
 int RpcPacket::xdrEncodeString( unsigned char* buf, uint32 len)
 {
   return xdrEncodeVarOpaque(buf, len);
@@ -211,8 +226,16 @@ int RpcPacket::decodeHeader()
 }
 
 
+int RpcPacket::updateXid(uint32 xid)
+{
+  m_header.xid = xid;
+  uint32 nValue = htonl(xid);
+  return writeOffset((unsigned char*)&nValue, sizeof(nValue), m_xidOffset);
+}
+
 int RpcPacket::encodeHeader()
 {
+  m_xidOffset = getSize();
   RETURN_ON_ERROR(xdrEncodeUint32(m_header.xid));
   RETURN_ON_ERROR(xdrEncodeUint32(m_header.call));
   if (m_header.call == RPC_CALL)
@@ -223,21 +246,17 @@ int RpcPacket::encodeHeader()
     RETURN_ON_ERROR(xdrEncodeUint32(m_header.cr.proc.vers));
     RETURN_ON_ERROR(xdrEncodeUint32(m_header.cr.proc.proc));
 
-    /* cred*/
-    RETURN_ON_ERROR(xdrEncodeUint32(AUTHTYPE_UNIX));
-
-    RpcPacket* pkt = defaultUnixAuth;
-
-    if (pkt == NULL)
-      return -1;
-
-    RETURN_ON_ERROR(xdrEncodeVarOpaque(pkt->getBuffer(), pkt->getSize())); // auth
-
-    /* verifier */
-    RETURN_ON_ERROR(xdrEncodeUint32(AUTHTYPE_NULL));
-    RETURN_ON_ERROR(xdrEncodeUint32(0)); // length
+    /* cred and verifier */
+    const AuthUnix* cred = AuthUnix::getDefault();
+    RETURN_ON_ERROR(append((unsigned char*)cred->getEncoded(), cred->getEncodedSize()));
   }
   return 0;
 }
 
+int RpcPacket::appendEncodedHeader(const unsigned char* hdr, uint32 len, uint32 xidOffset)
+{
+  m_xidOffset = getSize() + xidOffset;
+  return append((unsigned char*)hdr, len);
+}
+
 } // end of namespace
@@ -0,0 +1,130 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "RpcRtt.h"
+#include <nfsrpc/nfs.h>
+
+namespace OpenNfsC {
+
+using Thread::MutexGuard;
+
+// timeouts in a row that still double the timeout of a class
+const uint32 gMaxBackoffShift = 6;
+
+RpcRtt::RpcRtt(uint32 initialMs, uint32 minMs, uint32 maxMs):
+  m_lock(false), m_initial(initialMs), m_min(minMs), m_max(maxMs)
+{
+  if ( m_max < m_min )
+    m_max = m_min;
+  if ( m_initial < m_min )
+    m_initial = m_min;
+  if ( m_initial > m_max )
+    m_initial = m_max;
+
+  for ( int i = 0; i < TIMER_CLASSES; i++ )
+  {
+    m_srtt[i] = 0;
+    m_rttvar[i] = 0;
+    m_timeouts[i] = 0;
+  }
+}
+
+int RpcRtt::getTimerClass(uint32 prog, uint32 vers, uint32 proc)
+{
+  // the server takes much longer for data than for attributes, a compound
+  // of NFSv4 can be anything
+  if ( prog != RPCPROG_NFS || vers != NFS_V3 )
+    return TIMER_OTHER;
+
+  switch ( proc )
+  {
+  case NFS_V3_GETATTR:
+  case NFS_V3_ACCESS:
+    return TIMER_GETATTR;
+  case NFS_V3_LOOKUP:
+    return TIMER_LOOKUP;
+  case NFS_V3_READ:
+  case NFS_V3_READLINK:
+  case NFS_V3_READDIR:
+  case NFS_V3_READDIRPLUS:
+    return TIMER_READ;
+  case NFS_V3_WRITE:
+    return TIMER_WRITE;
+  default:
+    return TIMER_OTHER;
+  }
+}
+
+uint32 RpcRtt::getTimeout(int timerClass)
+{
+  if ( timerClass < 0 || timerClass >= TIMER_CLASSES )
+    timerClass = TIMER_OTHER;
+
+  MutexGuard lock(m_lock);
+  uint64 rto = m_initial;
+  if ( m_srtt[timerClass] > 0 )
+    rto = (m_srtt[timerClass] + 4 * m_rttvar[timerClass] + 999) / 1000;
+
+  uint32 shift = m_timeouts[timerClass];
+  rto <<= (shift < gMaxBackoffShift) ? shift : gMaxBackoffShift;
+
+  if ( rto < m_min )
+    rto = m_min;
+  if ( rto > m_max )
+    rto = m_max;
+  return (uint32)rto;
+}
+
+uint32 RpcRtt::backoff(uint32 timeout) const
+{
+  uint64 next = (uint64)timeout * 2;
+  return (next > m_max) ? m_max : (uint32)next;
+}
+
+void RpcRtt::update(int timerClass, uint64 rttUs)
+{
+  if ( timerClass < 0 || timerClass >= TIMER_CLASSES || rttUs == 0 )
+    return;
+
+  MutexGuard lock(m_lock);
+  uint64& srtt = m_srtt[timerClass];
+  uint64& rttvar = m_rttvar[timerClass];
+  if ( srtt == 0 )
+  {
+    srtt = rttUs;
+    rttvar = rttUs / 2;
+  }
+  else
+  {
+    uint64 err = (rttUs > srtt) ? rttUs - srtt : srtt - rttUs;
+    rttvar = (3 * rttvar + err) / 4;
+    srtt = (7 * srtt + rttUs) / 8;
+  }
+  m_timeouts[timerClass] = 0;
+}
+
+void RpcRtt::timedOut(int timerClass)
+{
+  if ( timerClass < 0 || timerClass >= TIMER_CLASSES )
+    return;
+
+  MutexGuard lock(m_lock);
+  if ( m_timeouts[timerClass] < gMaxBackoffShift )
+    ++m_timeouts[timerClass];
+}
+
+} // end of namespace
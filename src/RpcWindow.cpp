@@ -0,0 +1,164 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "RpcWindow.h"
+#include <time.h>
+#include <syslog.h>
+
+namespace OpenNfsC {
+
+using Thread::MutexGuard;
+
+// the baseline is taken again after this long, the path may have changed
+const uint64 gMinRttLifetimeUs = 10 * 1000000ULL;
+// jitter tolerated above the baseline before latency counts as inflated
+const uint64 gRttSlackUs = 500;
+
+static uint64 monotonicUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+RpcWindow::RpcWindow(uint32 initial, uint32 minWindow, uint32 maxWindow):
+  m_lock(false), m_cond(&m_lock), m_waiters(0),
+  m_window(initial), m_inFlight(0), m_min(minWindow), m_max(maxWindow),
+  m_lastClass(RpcRtt::TIMER_OTHER), m_lastDecrease(0),
+  m_completed(0), m_congested(0), m_decreases(0)
+{
+  for ( int i = 0; i < RpcRtt::TIMER_CLASSES; i++ )
+  {
+    m_minRtt[i] = 0;
+    m_minRttTime[i] = 0;
+    m_srtt[i] = 0;
+  }
+
+  if ( m_min < 1 )
+    m_min = 1;
+  if ( m_max < m_min )
+    m_max = m_min;
+  if ( m_window < m_min )
+    m_window = m_min;
+  if ( m_window > m_max )
+    m_window = m_max;
+}
+
+void RpcWindow::acquire()
+{
+  MutexGuard lock(m_lock);
+  while ( m_inFlight >= (uint32)m_window )
+  {
+    ++m_waiters;
+    m_cond.wait();
+    --m_waiters;
+  }
+  ++m_inFlight;
+}
+
+bool RpcWindow::tryAcquire()
+{
+  MutexGuard lock(m_lock);
+  if ( m_inFlight >= (uint32)m_window )
+    return false;
+  ++m_inFlight;
+  return true;
+}
+
+void RpcWindow::release(uint64 rttUs, bool congested, int timerClass)
+{
+  uint64 now = monotonicUs();
+  if ( timerClass < 0 || timerClass >= RpcRtt::TIMER_CLASSES )
+    timerClass = RpcRtt::TIMER_OTHER;
+
+  MutexGuard lock(m_lock);
+  bool limited = (m_inFlight >= (uint32)m_window);
+  --m_inFlight;
+  ++m_completed;
+
+  if ( rttUs > 0 )
+    sample(timerClass, rttUs, now);
+
+  // the latency is inflated once queues build up along the path. only a
+  // fresh sample is compared with the baseline of its own class
+  uint64 minRtt = m_minRtt[timerClass];
+  uint64 srtt = m_srtt[timerClass];
+  bool inflated = (rttUs > 0 && minRtt > 0 && srtt > minRtt + minRtt / 2 + gRttSlackUs);
+  if ( congested )
+    ++m_congested;
+
+  if ( congested || inflated )
+  {
+    // once per round trip, a burst of late replies is one event
+    if ( now - m_lastDecrease > srtt && m_window > m_min )
+    {
+      m_window = (m_window / 2 < m_min) ? m_min : m_window / 2;
+      m_lastDecrease = now;
+      ++m_decreases;
+      syslog(LOG_DEBUG, "RpcWindow::%s window cut to %u, class %d srtt=%llu us, min rtt=%llu us\n",
+             __func__, (uint32)m_window, timerClass, (unsigned long long)srtt, (unsigned long long)minRtt);
+    }
+  }
+  else if ( limited && rttUs > 0 )
+  {
+    // one more slot per window worth of replies
+    m_window += 1.0 / m_window;
+    if ( m_window > m_max )
+      m_window = m_max;
+  }
+
+  if ( m_waiters > 0 && m_inFlight < (uint32)m_window )
+    m_cond.broadcast();
+}
+
+void RpcWindow::sample(int timerClass, uint64 rttUs, uint64 now)
+{
+  uint64& minRtt = m_minRtt[timerClass];
+  uint64& srtt = m_srtt[timerClass];
+  if ( minRtt == 0 || rttUs < minRtt || now - m_minRttTime[timerClass] > gMinRttLifetimeUs )
+  {
+    minRtt = rttUs;
+    m_minRttTime[timerClass] = now;
+  }
+
+  if ( srtt == 0 )
+    srtt = rttUs;
+  else
+    srtt = (7 * srtt + rttUs) / 8;
+  m_lastClass = timerClass;
+}
+
+uint32 RpcWindow::getWindow()
+{
+  MutexGuard lock(m_lock);
+  return (uint32)m_window;
+}
+
+void RpcWindow::getStats(RpcWindowStats& stats)
+{
+  MutexGuard lock(m_lock);
+  stats.window = (uint32)m_window;
+  stats.inFlight = m_inFlight;
+  stats.minRttUs = (uint32)m_minRtt[m_lastClass];
+  stats.srttUs = (uint32)m_srtt[m_lastClass];
+  stats.completed = m_completed;
+  stats.congested = m_congested;
+  stats.decreases = m_decreases;
+}
+
+} // end of namespace
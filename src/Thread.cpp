@@ -475,6 +475,15 @@ void Semaphore::acquire()
 #endif
 }
 
+bool Semaphore::tryAcquire()
+{
+#ifdef R_WIN
+  return WaitForSingleObject(sem, 0) == WAIT_OBJECT_0;
+#else
+  return sem_trywait(&sem) == 0;
+#endif
+}
+
 void Semaphore::release()
 {
 #ifdef R_WIN
@@ -0,0 +1,139 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TimerWheel.h"
+
+namespace OpenNfsC {
+
+TimerWheel::TimerWheel(uint32 tickMs, uint64 nowMs):
+  m_tickMs(tickMs > 0 ? tickMs : 1), m_next(0), m_count(0)
+{
+  m_next = nowMs / m_tickMs + 1;
+  for ( uint32 level = 0; level < LEVELS; level++ )
+  {
+    for ( uint32 i = 0; i < SLOTS; i++ )
+      m_slots[level][i].next = m_slots[level][i].prev = &m_slots[level][i];
+  }
+}
+
+void TimerWheel::link(Timer* head, Timer* timer)
+{
+  timer->prev = head->prev;
+  timer->next = head;
+  head->prev->next = timer;
+  head->prev = timer;
+}
+
+void TimerWheel::unlink(Timer* timer)
+{
+  timer->prev->next = timer->next;
+  timer->next->prev = timer->prev;
+  timer->next = timer->prev = NULL;
+}
+
+void TimerWheel::add(Timer* timer)
+{
+  if ( timer->expires < m_next )
+    timer->expires = m_next;
+
+  // beyond the last level the timer waits in its last slot and is moved
+  // down again once that comes round
+  uint64 delta = timer->expires - m_next;
+  uint64 span = (uint64)1 << (SLOT_BITS * LEVELS);
+  uint64 expires = (delta < span) ? timer->expires : m_next + span - 1;
+
+  uint32 level = 0;
+  while ( level < LEVELS - 1 && delta >= ((uint64)1 << (SLOT_BITS * (level + 1))) )
+    ++level;
+
+  uint32 index = (uint32)(expires >> (SLOT_BITS * level)) & (SLOTS - 1);
+  link(&m_slots[level][index], timer);
+}
+
+void TimerWheel::schedule(Timer* timer, uint64 expiresMs)
+{
+  if ( timer->isPending() )
+    unlink(timer);
+  else
+    ++m_count;
+
+  timer->expires = (expiresMs + m_tickMs - 1) / m_tickMs;
+  add(timer);
+}
+
+void TimerWheel::cancel(Timer* timer)
+{
+  if ( !timer->isPending() )
+    return;
+  unlink(timer);
+  --m_count;
+}
+
+uint32 TimerWheel::cascade(uint32 level)
+{
+  uint32 index = (uint32)(m_next >> (SLOT_BITS * level)) & (SLOTS - 1);
+  Timer* head = &m_slots[level][index];
+  Timer list;
+  if ( head->next == head )
+    return index;
+
+  // detach the slot first, its timers may land in it again
+  list.next = head->next;
+  list.prev = head->prev;
+  list.next->prev = &list;
+  list.prev->next = &list;
+  head->next = head->prev = head;
+
+  while ( list.next != &list )
+  {
+    Timer* timer = list.next;
+    unlink(timer);
+    add(timer);
+  }
+  return index;
+}
+
+void TimerWheel::advance(uint64 nowMs, std::vector<Timer*>& due)
+{
+  uint64 now = nowMs / m_tickMs;
+  if ( m_count == 0 )
+  {
+    // nothing to move along
+    if ( now >= m_next )
+      m_next = now + 1;
+    return;
+  }
+
+  while ( m_next <= now )
+  {
+    uint32 index = (uint32)m_next & (SLOTS - 1);
+    for ( uint32 level = 1; index == 0 && level < LEVELS; level++ )
+      index = cascade(level);
+
+    Timer* head = &m_slots[0][(uint32)m_next & (SLOTS - 1)];
+    while ( head->next != head )
+    {
+      Timer* timer = head->next;
+      unlink(timer);
+      --m_count;
+      due.push_back(timer);
+    }
+    ++m_next;
+  }
+}
+
+} // end of namespace
@@ -0,0 +1,501 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "UringReactor.h"
+#include "ConnectionMgr.h"
+#include <syslog.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <poll.h>
+#include <time.h>
+
+#ifdef OPENNFSC_IO_URING
+#include <liburing.h>
+#endif
+
+namespace OpenNfsC {
+
+#ifdef OPENNFSC_IO_URING
+
+const unsigned gUringEntries = 256;
+// provided buffers, large enough for a whole datagram
+const uint32 gUringBufCount = 64;
+const uint32 gUringBufSize = 65536;
+const int gUringBufGroup = 0;
+
+namespace {
+
+inline uint64 userData(uint64 id, int op) { return (id << 3) | op; }
+
+struct io_uring_sqe* getSqe(struct io_uring* ring)
+{
+  struct io_uring_sqe* sqe = io_uring_get_sqe(ring);
+  if ( sqe == NULL )
+  {
+    // the submission queue is full, hand it to the kernel
+    io_uring_submit(ring);
+    sqe = io_uring_get_sqe(ring);
+  }
+  return sqe;
+}
+
+} // end of unamed namespace
+
+UringReactor::UringReactor(ConnectionMgr* mgr, int controlfd):
+  m_mgr(mgr),m_controlfd(controlfd),m_ring(NULL),m_bufRing(NULL),m_bufBase(NULL),m_nextId(1)
+{
+}
+
+UringReactor::~UringReactor()
+{
+  shutdown();
+}
+
+bool UringReactor::isSupported()
+{
+  return true;
+}
+
+bool UringReactor::init()
+{
+  m_ring = new struct io_uring;
+  memset(m_ring, 0, sizeof(*m_ring));
+
+  // only the reactor thread submits, completions need not interrupt it
+  int res = io_uring_queue_init(gUringEntries, m_ring, IORING_SETUP_SINGLE_ISSUER|IORING_SETUP_DEFER_TASKRUN);
+  if ( res == -EINVAL )
+    res = io_uring_queue_init(gUringEntries, m_ring, 0);
+  if ( res < 0 )
+  {
+    char errstr[128];
+    syslog(LOG_WARNING, "UringReactor::%s: io_uring_queue_init failed: %s\n", __func__, strerror_r(-res, errstr, sizeof(errstr)));
+    delete m_ring;
+    m_ring = NULL;
+    return false;
+  }
+
+  if ( posix_memalign((void**)&m_bufBase, 4096, gUringBufCount * gUringBufSize) != 0 )
+  {
+    syslog(LOG_ERR, "UringReactor::%s: failed to allocate the receive buffers\n", __func__);
+    m_bufBase = NULL;
+    release();
+    return false;
+  }
+
+  m_bufRing = io_uring_setup_buf_ring(m_ring, gUringBufCount, gUringBufGroup, 0, &res);
+  if ( m_bufRing == NULL )
+  {
+    char errstr[128];
+    syslog(LOG_WARNING, "UringReactor::%s: provided buffer rings not supported: %s\n", __func__, strerror_r(-res, errstr, sizeof(errstr)));
+    release();
+    return false;
+  }
+
+  for ( uint32 i = 0; i < gUringBufCount; i++ )
+  {
+    io_uring_buf_ring_add(m_bufRing, m_bufBase + i * gUringBufSize, gUringBufSize, i,
+                          io_uring_buf_ring_mask(gUringBufCount), i);
+  }
+  io_uring_buf_ring_advance(m_bufRing, gUringBufCount);
+
+  armControl();
+  return true;
+}
+
+void UringReactor::shutdown()
+{
+  if ( m_ring == NULL )
+    return;
+
+  // the kernel may still write into the buffers or read the packets of a send
+  std::map<uint64, Watch*>::iterator it = m_watches.begin();
+  for ( ; it != m_watches.end(); ++it )
+  {
+    if ( !it->second->closing )
+    {
+      m_sockets.erase(it->second->skt);
+      it->second->closing = true;
+      m_closed.push_back(it->second);
+    }
+    cancel(it->second, OP_RECV);
+    cancel(it->second, OP_SEND);
+    cancel(it->second, OP_POLLOUT);
+  }
+
+  time_t deadline = time(NULL) + 2;
+  while ( !m_watches.empty() && time(NULL) < deadline )
+    wait(100);
+
+  if ( !m_watches.empty() )
+    syslog(LOG_WARNING, "UringReactor::%s: %zu sockets still busy\n", __func__, m_watches.size());
+
+  release();
+}
+
+void UringReactor::release()
+{
+  if ( m_bufRing != NULL )
+    io_uring_free_buf_ring(m_ring, m_bufRing, gUringBufCount, gUringBufGroup);
+  m_bufRing = NULL;
+
+  if ( m_ring != NULL )
+  {
+    io_uring_queue_exit(m_ring);
+    delete m_ring;
+    m_ring = NULL;
+  }
+
+  free(m_bufBase);
+  m_bufBase = NULL;
+
+  std::map<uint64, Watch*>::iterator it = m_watches.begin();
+  for ( ; it != m_watches.end(); ++it )
+    delete it->second;
+  m_watches.clear();
+  m_sockets.clear();
+  m_closed.clear();
+}
+
+void UringReactor::watch(BasicConnectionPtr conn)
+{
+  int skt = conn->getSocketId();
+  if ( m_sockets.find(skt) != m_sockets.end() )
+    unwatch(skt);
+
+  Watch* w = new Watch;
+  w->id = m_nextId++;
+  w->skt = skt;
+  w->conn = conn;
+  w->ops = 0;
+  w->recvArmed = false;
+  w->sending = false;
+  w->polling = false;
+  w->closing = false;
+  m_watches[w->id] = w;
+  m_sockets[skt] = w->id;
+
+  if ( conn->getConnectionState() == STATE_CONNECTING )
+  {
+    armPollOut(w);
+    return;
+  }
+
+  armRecv(w);
+  submitSend(w);
+}
+
+void UringReactor::unwatch(int skt)
+{
+  std::map<int, uint64>::iterator it = m_sockets.find(skt);
+  if ( it == m_sockets.end() )
+    return;
+
+  Watch* w = m_watches[it->second];
+  m_sockets.erase(it);
+
+  w->closing = true;
+  if ( w->recvArmed )
+    cancel(w, OP_RECV);
+  if ( w->sending )
+    cancel(w, OP_SEND);
+  if ( w->polling )
+    cancel(w, OP_POLLOUT);
+  m_closed.push_back(w);
+}
+
+void UringReactor::send(BasicConnectionPtr conn)
+{
+  std::map<int, uint64>::iterator it = m_sockets.find(conn->getSocketId());
+  if ( it == m_sockets.end() )
+    return;
+
+  submitSend(m_watches[it->second]);
+}
+
+void UringReactor::wait(int timeoutMs)
+{
+  struct __kernel_timespec ts;
+  ts.tv_sec = timeoutMs / 1000;
+  ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+
+  struct io_uring_cqe* cqe = NULL;
+  int res = io_uring_submit_and_wait_timeout(m_ring, &cqe, 1, &ts, NULL);
+  if ( res < 0 && res != -ETIME && res != -EINTR )
+  {
+    char errstr[128];
+    syslog(LOG_ERR, "UringReactor::%s: io_uring_submit_and_wait_timeout failed: %s\n", __func__, strerror_r(-res, errstr, sizeof(errstr)));
+  }
+
+  unsigned head;
+  unsigned count = 0;
+  io_uring_for_each_cqe(m_ring, head, cqe)
+  {
+    complete(cqe);
+    count++;
+  }
+  io_uring_cq_advance(m_ring, count);
+
+  // sockets whose last operation has completed
+  for ( size_t i = 0; i < m_closed.size(); )
+  {
+    Watch* w = m_closed[i];
+    if ( w->ops > 0 )
+    {
+      i++;
+      continue;
+    }
+    m_watches.erase(w->id);
+    delete w;
+    m_closed[i] = m_closed.back();
+    m_closed.pop_back();
+  }
+}
+
+void UringReactor::complete(struct io_uring_cqe* cqe)
+{
+  uint64 data = io_uring_cqe_get_data64(cqe);
+  int op = data & 7;
+  uint64 id = data >> 3;
+
+  if ( op == OP_CONTROL )
+  {
+    m_mgr->processControlMsg();
+    if ( !(cqe->flags & IORING_CQE_F_MORE) )
+      armControl();
+    return;
+  }
+  if ( op == OP_CANCEL )
+    return;
+
+  std::map<uint64, Watch*>::iterator it = m_watches.find(id);
+  if ( it == m_watches.end() )
+  {
+    syslog(LOG_ERR, "UringReactor::%s: completion %d of unknown socket\n", __func__, op);
+    if ( cqe->flags & IORING_CQE_F_BUFFER )
+      recycleBuffer(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+    return;
+  }
+
+  Watch* w = it->second;
+  if ( op == OP_RECV )
+    completeRecv(w, cqe->res, cqe->flags);
+  else if ( op == OP_SEND )
+    completeSend(w, cqe->res);
+  else if ( op == OP_POLLOUT )
+    completePollOut(w, cqe->res);
+}
+
+void UringReactor::completeRecv(Watch* w, int res, uint32 flags)
+{
+  if ( !(flags & IORING_CQE_F_MORE) )
+  {
+    w->recvArmed = false;
+    w->ops--;
+  }
+
+  if ( flags & IORING_CQE_F_BUFFER )
+  {
+    uint32 bid = flags >> IORING_CQE_BUFFER_SHIFT;
+    int outcome = 0;
+    if ( res > 0 && !w->closing )
+      outcome = w->conn->recvData(m_bufBase + bid * gUringBufSize, res);
+    recycleBuffer(bid);
+
+    if ( outcome < 0 )
+    {
+      fail(w, errno);
+      return;
+    }
+  }
+
+  if ( w->closing )
+    return;
+
+  if ( res == 0 )
+  {
+    syslog(LOG_DEBUG, "UringReactor::%s: connection %s is closed\n", __func__, w->conn->toString().c_str());
+    fail(w, ECONNRESET);
+    return;
+  }
+
+  // out of buffers ends the multishot recv, they are back by now
+  if ( res < 0 && res != -ENOBUFS )
+  {
+    fail(w, -res);
+    return;
+  }
+
+  if ( !w->recvArmed )
+    armRecv(w);
+}
+
+void UringReactor::completeSend(Watch* w, int res)
+{
+  w->ops--;
+  w->sending = false;
+
+  int outcome = w->conn->endSend(res);
+  w->batch.clear();
+  if ( w->closing )
+    return;
+
+  if ( outcome < 0 )
+  {
+    fail(w, -res);
+    return;
+  }
+
+  if ( outcome == SOCKET_BUSY )
+  {
+    // the socket buffer is full, wait until it takes more
+    if ( res == -EAGAIN )
+      armPollOut(w);
+    else
+      submitSend(w);
+  }
+}
+
+void UringReactor::completePollOut(Watch* w, int res)
+{
+  w->ops--;
+  w->polling = false;
+  if ( w->closing )
+    return;
+
+  if ( res < 0 )
+  {
+    fail(w, -res);
+    return;
+  }
+
+  if ( w->conn->getConnectionState() == STATE_CONNECTING )
+  {
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if ( (res & (POLLERR|POLLHUP)) || getsockopt(w->skt, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0 )
+    {
+      syslog(LOG_ERR, "UringReactor::%s: socket %d fail to connect to %s\n", __func__, w->skt, w->conn->toString().c_str());
+      fail(w, error);
+      return;
+    }
+
+    syslog(LOG_DEBUG, "UringReactor::%s: socket %d connected to %s\n", __func__, w->skt, w->conn->toString().c_str());
+    w->conn->setConnectionState(STATE_CONNECTED);
+    armRecv(w);
+  }
+
+  submitSend(w);
+}
+
+// reconnect or drop the connection as the epoll reactor does on a socket error
+void UringReactor::fail(Watch* w, int error)
+{
+  char errstr[128];
+  syslog(LOG_WARNING, "UringReactor::%s: socket %d of %s failed: %d (%s)\n",
+         __func__, w->skt, w->conn->toString().c_str(), error, strerror_r(error, errstr, sizeof(errstr)));
+
+  BasicConnectionPtr conn = w->conn;
+  conn->setErrno(error);
+  unwatch(w->skt);
+  m_mgr->m_sktMap.remove(w->skt);
+  m_mgr->failConnection(conn);
+}
+
+void UringReactor::armControl()
+{
+  struct io_uring_sqe* sqe = getSqe(m_ring);
+  io_uring_prep_poll_multishot(sqe, m_controlfd, POLLIN);
+  io_uring_sqe_set_data64(sqe, userData(0, OP_CONTROL));
+}
+
+void UringReactor::armRecv(Watch* w)
+{
+  struct io_uring_sqe* sqe = getSqe(m_ring);
+  io_uring_prep_recv_multishot(sqe, w->skt, NULL, 0, 0);
+  sqe->flags |= IOSQE_BUFFER_SELECT;
+  sqe->buf_group = gUringBufGroup;
+  io_uring_sqe_set_data64(sqe, userData(w->id, OP_RECV));
+  w->recvArmed = true;
+  w->ops++;
+}
+
+void UringReactor::armPollOut(Watch* w)
+{
+  if ( w->polling )
+    return;
+
+  struct io_uring_sqe* sqe = getSqe(m_ring);
+  io_uring_prep_poll_add(sqe, w->skt, POLLOUT);
+  io_uring_sqe_set_data64(sqe, userData(w->id, OP_POLLOUT));
+  w->polling = true;
+  w->ops++;
+}
+
+void UringReactor::submitSend(Watch* w)
+{
+  if ( w->sending || w->polling || w->closing )
+    return;
+
+  int flags = 0;
+  int count = w->conn->beginSend(w->iov, IOV_MAX, w->batch, flags);
+  if ( count == 0 )
+    return;
+
+  memset(&w->msg, 0, sizeof(w->msg));
+  w->msg.msg_iov = w->iov;
+  w->msg.msg_iovlen = count;
+
+  struct io_uring_sqe* sqe = getSqe(m_ring);
+  io_uring_prep_sendmsg(sqe, w->skt, &w->msg, flags);
+  io_uring_sqe_set_data64(sqe, userData(w->id, OP_SEND));
+  w->sending = true;
+  w->ops++;
+}
+
+void UringReactor::cancel(Watch* w, Op op)
+{
+  struct io_uring_sqe* sqe = getSqe(m_ring);
+  io_uring_prep_cancel64(sqe, userData(w->id, op), 0);
+  io_uring_sqe_set_data64(sqe, userData(w->id, OP_CANCEL));
+}
+
+void UringReactor::recycleBuffer(uint32 bid)
+{
+  io_uring_buf_ring_add(m_bufRing, m_bufBase + bid * gUringBufSize, gUringBufSize, bid,
+                        io_uring_buf_ring_mask(gUringBufCount), 0);
+  io_uring_buf_ring_advance(m_bufRing, 1);
+}
+
+#else // OPENNFSC_IO_URING
+
+// built without io_uring, the reactors stay with epoll
+UringReactor::UringReactor(ConnectionMgr* mgr, int controlfd):
+  m_mgr(mgr),m_controlfd(controlfd),m_ring(NULL),m_bufRing(NULL),m_bufBase(NULL),m_nextId(1) {}
+UringReactor::~UringReactor() {}
+bool UringReactor::isSupported() { return false; }
+bool UringReactor::init() { return false; }
+void UringReactor::shutdown() {}
+void UringReactor::watch(BasicConnectionPtr conn) {}
+void UringReactor::unwatch(int skt) {}
+void UringReactor::send(BasicConnectionPtr conn) {}
+void UringReactor::wait(int timeoutMs) {}
+
+#endif // OPENNFSC_IO_URING
+
+} /* namespace OpenNfsC */
@@ -0,0 +1,120 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _URING_REACTOR_H_
+#define _URING_REACTOR_H_
+
+#include "BasicConnection.h"
+#include <map>
+#include <vector>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+struct io_uring;
+struct io_uring_buf_ring;
+struct io_uring_cqe;
+
+namespace OpenNfsC {
+
+class ConnectionMgr;
+
+// io_uring driven socket I/O of a reactor, an alternative to epoll.
+// replies arrive by a multishot recv per socket into a ring of provided buffers,
+// sends are sendmsg submissions, all submitted with one io_uring_enter per loop.
+// only used from the reactor thread
+class UringReactor
+{
+  public:
+    UringReactor(ConnectionMgr* mgr, int controlfd);
+    ~UringReactor();
+
+    // false if io_uring is not built in or the kernel lacks the features
+    bool init();
+    // cancel what is in flight and release the ring
+    void shutdown();
+
+    // start and stop serving a socket
+    void watch(BasicConnectionPtr conn);
+    void unwatch(int skt);
+    // submit the packets queued on the connection
+    void send(BasicConnectionPtr conn);
+
+    // submit what has been prepared, wait up to timeoutMs for completions and process them
+    void wait(int timeoutMs);
+
+    static bool isSupported();
+
+  private:
+    UringReactor(const UringReactor&); // not implemented
+    UringReactor& operator=(const UringReactor&); // not implemented
+
+    enum Op
+    {
+      OP_CONTROL = 0,
+      OP_RECV,
+      OP_SEND,
+      OP_POLLOUT,
+      OP_CANCEL
+    };
+
+    // a socket being served, kept until its operations have completed
+    struct Watch
+    {
+      uint64 id;
+      int skt;
+      BasicConnectionPtr conn;
+      uint32 ops;          // operations in flight
+      bool recvArmed;
+      bool sending;
+      bool polling;        // waiting for the socket to connect or to take more data
+      bool closing;
+      struct msghdr msg;
+      struct iovec iov[IOV_MAX];
+      std::vector<RpcPacketPtr> batch; // packets the send in flight references
+    };
+
+    void complete(struct io_uring_cqe* cqe);
+    void completeRecv(Watch* w, int res, uint32 flags);
+    void completeSend(Watch* w, int res);
+    void completePollOut(Watch* w, int res);
+    void fail(Watch* w, int error);
+    void release();
+
+    void armControl();
+    void armRecv(Watch* w);
+    void armPollOut(Watch* w);
+    void submitSend(Watch* w);
+    void cancel(Watch* w, Op op);
+    void recycleBuffer(uint32 bid);
+
+    ConnectionMgr* m_mgr;
+    int m_controlfd;
+    struct io_uring* m_ring;
+    struct io_uring_buf_ring* m_bufRing;
+    unsigned char* m_bufBase;
+
+    std::map<uint64, Watch*> m_watches;  // by id
+    std::map<int, uint64> m_sockets;     // socket to id of the watch serving it
+    std::vector<Watch*> m_closed;        // deleted once their operations completed
+    uint64 m_nextId;
+};
+
+} // end of namespace
+
+#endif /* _URING_REACTOR_H_ */
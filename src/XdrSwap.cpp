@@ -0,0 +1,188 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "XdrSwap.h"
+#include <base.h>
+#include <string.h>
+
+#if defined(R_ENDIAN_LITTLE) && (defined(__x86_64__) || defined(__i386__))
+#define XDR_SWAP_X86
+#include <immintrin.h>
+#endif
+
+namespace OpenNfsC {
+
+namespace
+{
+#if defined(R_ENDIAN_LITTLE)
+  void scalarCopy32(void* dst, const void* src, uint32 count)
+  {
+    unsigned char* d = (unsigned char*)dst;
+    const unsigned char* s = (const unsigned char*)src;
+    for ( uint32 i = 0; i < count; i++, d += 4, s += 4 )
+    {
+      uint32 value;
+      memcpy(&value, s, 4);
+      value = __builtin_bswap32(value);
+      memcpy(d, &value, 4);
+    }
+  }
+
+  void scalarCopy64(void* dst, const void* src, uint32 count)
+  {
+    unsigned char* d = (unsigned char*)dst;
+    const unsigned char* s = (const unsigned char*)src;
+    for ( uint32 i = 0; i < count; i++, d += 8, s += 8 )
+    {
+      uint64 value;
+      memcpy(&value, s, 8);
+      value = __builtin_bswap64(value);
+      memcpy(d, &value, 8);
+    }
+  }
+#else
+  // the host order is the XDR order
+  void scalarCopy32(void* dst, const void* src, uint32 count)
+  {
+    if ( dst != src )
+      memmove(dst, src, count * 4);
+  }
+
+  void scalarCopy64(void* dst, const void* src, uint32 count)
+  {
+    if ( dst != src )
+      memmove(dst, src, count * 8);
+  }
+#endif
+
+#if defined(XDR_SWAP_X86)
+  // pshufb masks reversing the bytes of each 32 or 64 bit lane
+#define SWAP32_MASK 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+#define SWAP64_MASK 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8
+
+  __attribute__((target("ssse3")))
+  void ssse3Swap(unsigned char* d, const unsigned char* s, uint32 len, __m128i mask)
+  {
+    uint32 i = 0;
+    for ( ; i + 16 <= len; i += 16 )
+    {
+      __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+      _mm_storeu_si128((__m128i*)(d + i), _mm_shuffle_epi8(v, mask));
+    }
+  }
+
+  __attribute__((target("ssse3")))
+  void ssse3Copy32(void* dst, const void* src, uint32 count)
+  {
+    uint32 vec = count & ~3U;
+    ssse3Swap((unsigned char*)dst, (const unsigned char*)src, vec * 4, _mm_setr_epi8(SWAP32_MASK));
+    scalarCopy32((unsigned char*)dst + vec * 4, (const unsigned char*)src + vec * 4, count - vec);
+  }
+
+  __attribute__((target("ssse3")))
+  void ssse3Copy64(void* dst, const void* src, uint32 count)
+  {
+    uint32 vec = count & ~1U;
+    ssse3Swap((unsigned char*)dst, (const unsigned char*)src, vec * 8, _mm_setr_epi8(SWAP64_MASK));
+    scalarCopy64((unsigned char*)dst + vec * 8, (const unsigned char*)src + vec * 8, count - vec);
+  }
+
+  __attribute__((target("avx2")))
+  void avx2Swap(unsigned char* d, const unsigned char* s, uint32 len, __m256i mask)
+  {
+    uint32 i = 0;
+    for ( ; i + 32 <= len; i += 32 )
+    {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+      _mm256_storeu_si256((__m256i*)(d + i), _mm256_shuffle_epi8(v, mask));
+    }
+  }
+
+  __attribute__((target("avx2")))
+  void avx2Copy32(void* dst, const void* src, uint32 count)
+  {
+    uint32 vec = count & ~7U;
+    avx2Swap((unsigned char*)dst, (const unsigned char*)src, vec * 4,
+             _mm256_setr_epi8(SWAP32_MASK, SWAP32_MASK));
+    scalarCopy32((unsigned char*)dst + vec * 4, (const unsigned char*)src + vec * 4, count - vec);
+  }
+
+  __attribute__((target("avx2")))
+  void avx2Copy64(void* dst, const void* src, uint32 count)
+  {
+    uint32 vec = count & ~3U;
+    avx2Swap((unsigned char*)dst, (const unsigned char*)src, vec * 8,
+             _mm256_setr_epi8(SWAP64_MASK, SWAP64_MASK));
+    scalarCopy64((unsigned char*)dst + vec * 8, (const unsigned char*)src + vec * 8, count - vec);
+  }
+
+#undef SWAP32_MASK
+#undef SWAP64_MASK
+#endif
+
+  // short arrays are not worth a vector pass
+  const uint32 gMinVectorBytes = 32;
+
+  typedef void (*CopyFn)(void* dst, const void* src, uint32 count);
+
+  struct WideCopy
+  {
+    CopyFn copy32;
+    CopyFn copy64;
+
+    WideCopy():copy32(scalarCopy32),copy64(scalarCopy64)
+    {
+#if defined(XDR_SWAP_X86)
+      __builtin_cpu_init();
+      if ( __builtin_cpu_supports("avx2") )
+      {
+        copy32 = avx2Copy32;
+        copy64 = avx2Copy64;
+      }
+      else if ( __builtin_cpu_supports("ssse3") )
+      {
+        copy32 = ssse3Copy32;
+        copy64 = ssse3Copy64;
+      }
+#endif
+    }
+  };
+
+  const WideCopy& wideCopy()
+  {
+    static const WideCopy wide;
+    return wide;
+  }
+}
+
+void XdrSwap::copy32(void* dst, const void* src, uint32 count)
+{
+  if ( count * 4 < gMinVectorBytes )
+    scalarCopy32(dst, src, count);
+  else
+    wideCopy().copy32(dst, src, count);
+}
+
+void XdrSwap::copy64(void* dst, const void* src, uint32 count)
+{
+  if ( count * 8 < gMinVectorBytes )
+    scalarCopy64(dst, src, count);
+  else
+    wideCopy().copy64(dst, src, count);
+}
+
+} // end of namespace
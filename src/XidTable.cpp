@@ -0,0 +1,106 @@
+/*
+   Copyright (C) 2020 by Sarat Kumar Behera <beherasaratkumar@gmail.com>
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation; either version 2.1 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "XidTable.h"
+
+namespace OpenNfsC {
+
+XidTable::XidTable(uint32 size, uint32 firstXid):
+  m_slots(NULL), m_mask(0), m_nextXid(firstXid), m_pending(0)
+{
+  // round up to a power of two
+  uint32 slots = 1;
+  while ( slots < size )
+    slots <<= 1;
+
+  m_slots = new Slot[slots];
+  m_mask = slots - 1;
+  for ( uint32 i = 0; i < slots; i++ )
+  {
+    m_slots[i].state.store(FREE, std::memory_order_relaxed);
+    m_slots[i].xid = 0;
+    m_slots[i].responder = NULL;
+  }
+}
+
+XidTable::~XidTable()
+{
+  delete [] m_slots;
+}
+
+uint32 XidTable::nextXid()
+{
+  uint32 xid = 0;
+  for ( uint32 i = 0; i <= m_mask; i++ )
+  {
+    xid = m_nextXid.fetch_add(1, std::memory_order_relaxed) + 1;
+    if ( m_slots[xid & m_mask].state.load(std::memory_order_relaxed) == FREE )
+      return xid;
+  }
+
+  // the table is full, insert() will tell
+  return xid;
+}
+
+bool XidTable::insert(uint32 xid, Responder* responder)
+{
+  Slot& slot = m_slots[xid & m_mask];
+  int state = FREE;
+  if ( !slot.state.compare_exchange_strong(state, CLAIMED, std::memory_order_acquire) )
+    return false;
+
+  slot.xid = xid;
+  slot.responder = responder;
+  m_pending.fetch_add(1, std::memory_order_relaxed);
+  slot.state.store(ARMED, std::memory_order_release);
+  return true;
+}
+
+Responder* XidTable::remove(uint32 xid)
+{
+  Slot& slot = m_slots[xid & m_mask];
+  while ( true )
+  {
+    int state = slot.state.load(std::memory_order_acquire);
+    if ( state == BUSY )
+    {
+      // a visit is in progress, it is short
+      sched_yield();
+      continue;
+    }
+
+    if ( state != ARMED || slot.xid != xid )
+      return NULL;
+
+    if ( lockSlot(slot) )
+    {
+      // the slot may have been reused meanwhile
+      if ( slot.xid != xid )
+      {
+        unlockSlot(slot, KEEP);
+        return NULL;
+      }
+
+      Responder* responder = slot.responder;
+      unlockSlot(slot, TAKE);
+      return responder;
+    }
+  }
+}
+
+} // end of namespace